@@ -36,6 +36,8 @@
 #include <limits>
 #include <type_traits>
 
+#include <KFL/FrameArena.hpp>
+
 namespace KlayGE
 {
 	template <typename pointer, bool trivial>
@@ -203,6 +205,107 @@ namespace KlayGE
 			return *this;
 		}
 	};
+
+
+	// Allocates from the FrameArena of the thread that creates the allocator. deallocate does nothing,
+	// so containers using it must be destroyed before that arena is reset.
+	template <typename T>
+	class frame_allocator
+	{
+		template <typename U>
+		friend class frame_allocator;
+
+	public:
+		typedef T value_type;
+		typedef value_type* pointer;
+		typedef value_type& reference;
+		typedef value_type const * const_pointer;
+		typedef value_type const & const_reference;
+
+		typedef size_t size_type;
+		typedef ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef frame_allocator<U> other;
+		};
+
+		frame_allocator() noexcept
+			: arena_(&FrameArena::ThreadInstance())
+		{
+		}
+
+		explicit frame_allocator(FrameArena& arena) noexcept
+			: arena_(&arena)
+		{
+		}
+
+		frame_allocator(frame_allocator<T> const & rhs) noexcept
+			: arena_(rhs.arena_)
+		{
+		}
+
+		template <typename U>
+		frame_allocator(frame_allocator<U> const & rhs) noexcept
+			: arena_(rhs.arena_)
+		{
+		}
+
+		template <typename U>
+		frame_allocator<T>& operator=(frame_allocator<U> const & rhs) noexcept
+		{
+			arena_ = rhs.arena_;
+			return *this;
+		}
+
+		pointer allocate(size_type count)
+		{
+			return static_cast<pointer>(arena_->Allocate(count * sizeof(T), std::alignment_of<T>::value));
+		}
+
+		void deallocate(pointer /*p*/, size_type /*count*/)
+		{
+		}
+
+		template<typename U, typename... Args>
+		void construct(U* p, Args&&... args)
+		{
+			void* vp = p;
+			::new (vp) U(std::forward<Args>(args)...);
+		}
+
+		template <typename U>
+		void destroy(U* p)
+		{
+			destroy_t<U*, std::is_trivially_destructible<U>::value>()(p);
+		}
+
+		size_type max_size() const noexcept
+		{
+			return std::numeric_limits<size_t>::max() / sizeof(T);
+		}
+
+		FrameArena* Arena() const noexcept
+		{
+			return arena_;
+		}
+
+	private:
+		FrameArena* arena_;
+	};
+
+	template <typename T, typename U>
+	inline bool operator==(frame_allocator<T> const & lhs, frame_allocator<U> const & rhs) noexcept
+	{
+		return lhs.Arena() == rhs.Arena();
+	}
+
+	template <typename T, typename U>
+	inline bool operator!=(frame_allocator<T> const & lhs, frame_allocator<U> const & rhs) noexcept
+	{
+		return lhs.Arena() != rhs.Arena();
+	}
 }
 
 #endif		// _KFL_ALIGNEDALLOCATOR_HPP
@@ -0,0 +1,79 @@
+/**
+ * @file FrameArena.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _KFL_FRAMEARENA_HPP
+#define _KFL_FRAMEARENA_HPP
+
+#pragma once
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace KlayGE
+{
+	// Bump pointer allocator for scratch data that dies within a frame. Nothing is freed individually,
+	// everything is reclaimed by Reset. Each thread has its own instance, and resets it at its own frame boundary.
+	class FrameArena : boost::noncopyable
+	{
+	public:
+		explicit FrameArena(size_t block_size = 64 * 1024);
+		~FrameArena();
+
+		static FrameArena& ThreadInstance();
+
+		void* Allocate(size_t size, size_t alignment);
+		void Reset();
+
+		size_t Capacity() const;
+		size_t BytesAllocated() const
+		{
+			return bytes_allocated_;
+		}
+
+	private:
+		void NewBlock(size_t size);
+
+	private:
+		struct Block
+		{
+			uint8_t* data;
+			size_t size;
+		};
+
+		size_t block_size_;
+		std::vector<Block> blocks_;
+		size_t curr_block_;
+		size_t offset_;
+		size_t bytes_allocated_;
+	};
+}
+
+#endif		// _KFL_FRAMEARENA_HPP
@@ -0,0 +1,123 @@
+/**
+ * @file FrameArena.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KFL, a subproject of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KFL/KFL.hpp>
+
+#include <algorithm>
+
+#include <KFL/FrameArena.hpp>
+
+namespace KlayGE
+{
+	FrameArena::FrameArena(size_t block_size)
+		: block_size_(block_size), curr_block_(0), offset_(0), bytes_allocated_(0)
+	{
+	}
+
+	FrameArena::~FrameArena()
+	{
+		for (auto const & block : blocks_)
+		{
+			delete[] block.data;
+		}
+	}
+
+	FrameArena& FrameArena::ThreadInstance()
+	{
+		static thread_local FrameArena arena;
+		return arena;
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		BOOST_ASSERT(0 == (alignment & (alignment - 1)));
+
+		for (;;)
+		{
+			if (curr_block_ < blocks_.size())
+			{
+				Block const & block = blocks_[curr_block_];
+				size_t const base = reinterpret_cast<size_t>(block.data);
+				size_t const aligned = (base + offset_ + alignment - 1) & ~(alignment - 1);
+				size_t const new_offset = aligned - base + size;
+				if (new_offset <= block.size)
+				{
+					offset_ = new_offset;
+					bytes_allocated_ += size;
+					return reinterpret_cast<void*>(aligned);
+				}
+
+				++ curr_block_;
+				offset_ = 0;
+			}
+			else
+			{
+				this->NewBlock(std::max(block_size_, size + alignment));
+			}
+		}
+	}
+
+	void FrameArena::Reset()
+	{
+		if (blocks_.size() > 1)
+		{
+			// Merges all blocks into one, so a frame with the same footprint won't allocate again
+			size_t const total = this->Capacity();
+			for (auto const & block : blocks_)
+			{
+				delete[] block.data;
+			}
+			blocks_.clear();
+			this->NewBlock(total);
+		}
+
+		curr_block_ = 0;
+		offset_ = 0;
+		bytes_allocated_ = 0;
+	}
+
+	size_t FrameArena::Capacity() const
+	{
+		size_t capacity = 0;
+		for (auto const & block : blocks_)
+		{
+			capacity += block.size;
+		}
+		return capacity;
+	}
+
+	void FrameArena::NewBlock(size_t size)
+	{
+		Block block;
+		block.data = new uint8_t[size];
+		block.size = size;
+		blocks_.push_back(block);
+	}
+}
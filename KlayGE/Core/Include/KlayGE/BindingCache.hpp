@@ -0,0 +1,169 @@
+/**
+ * @file BindingCache.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _BINDINGCACHE_HPP
+#define _BINDINGCACHE_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <array>
+#include <vector>
+
+#include <boost/assert.hpp>
+
+namespace KlayGE
+{
+	// The handles last bound to each slot of the device. Binding the same handle again is skipped, and both the issued
+	// and the skipped binds are counted for the per-frame stats. Plugins keeping their own caches only report the counts.
+	class KLAYGE_CORE_API BindingCache : boost::noncopyable
+	{
+	public:
+		enum BindingType
+		{
+			BT_StateObject = 0,
+			BT_Shader,
+			BT_VertexBuffer,
+			BT_IndexBuffer,
+			BT_ConstantBuffer,
+			BT_ShaderResource,
+			BT_Sampler,
+
+			BT_NumBindingTypes
+		};
+
+		static uint32_t const MAX_STAGES = 8;
+
+	public:
+		BindingCache();
+
+		// Returns true if the handle differs from the bound one, and the caller has to issue the bind
+		bool Bind(BindingType type, uint32_t stage, uint32_t slot, void const * handle)
+		{
+			BOOST_ASSERT(type < BT_NumBindingTypes);
+			BOOST_ASSERT(stage < MAX_STAGES);
+
+			auto& slots = slots_[type][stage];
+			if (slot >= slots.size())
+			{
+				slots.resize(slot + 1, this->Unknown());
+			}
+			if (slots[slot] == handle)
+			{
+				++ num_skipped_[type];
+				return false;
+			}
+			else
+			{
+				slots[slot] = handle;
+				++ num_issued_[type];
+				return true;
+			}
+		}
+
+		// Binds count slots from first. Returns the number of slots to issue, starting from first_changed. It's 0 if
+		// nothing changed. The unchanged slots in between are issued too, but only counted as skipped.
+		template <typename T>
+		uint32_t Bind(BindingType type, uint32_t stage, uint32_t first, uint32_t count, T* const * handles,
+			uint32_t& first_changed)
+		{
+			first_changed = first + count;
+			uint32_t end_changed = first;
+			for (uint32_t i = 0; i < count; ++ i)
+			{
+				if (this->Bind(type, stage, first + i, handles[i]))
+				{
+					if (first_changed > first + i)
+					{
+						first_changed = first + i;
+					}
+					end_changed = first + i + 1;
+				}
+			}
+			return (end_changed > first_changed) ? end_changed - first_changed : 0;
+		}
+
+		void Count(BindingType type, bool issued)
+		{
+			BOOST_ASSERT(type < BT_NumBindingTypes);
+
+			if (issued)
+			{
+				++ num_issued_[type];
+			}
+			else
+			{
+				++ num_skipped_[type];
+			}
+		}
+		void Count(BindingType type, uint32_t issued, uint32_t skipped)
+		{
+			BOOST_ASSERT(type < BT_NumBindingTypes);
+
+			num_issued_[type] += issued;
+			num_skipped_[type] += skipped;
+		}
+
+		// Forgets the bound handles, when the device state is changed behind the cache
+		void Invalidate();
+		void Invalidate(BindingType type, uint32_t stage);
+
+		uint32_t NumIssued(BindingType type) const
+		{
+			BOOST_ASSERT(type < BT_NumBindingTypes);
+			return num_issued_[type];
+		}
+		uint32_t NumSkipped(BindingType type) const
+		{
+			BOOST_ASSERT(type < BT_NumBindingTypes);
+			return num_skipped_[type];
+		}
+		uint32_t NumIssued() const;
+		uint32_t NumSkipped() const;
+		void ResetNumIssued();
+		void ResetNumSkipped();
+
+	private:
+		// No device handle could be the address of the cache, so an unknown slot never matches
+		void const * Unknown() const
+		{
+			return this;
+		}
+
+	private:
+		std::array<std::array<std::vector<void const *>, MAX_STAGES>, BT_NumBindingTypes> slots_;
+
+		std::array<uint32_t, BT_NumBindingTypes> num_issued_;
+		std::array<uint32_t, BT_NumBindingTypes> num_skipped_;
+	};
+}
+
+#endif		// _BINDINGCACHE_HPP
@@ -70,6 +70,12 @@ namespace KlayGE
 		std::vector<float3> const & CascadeBiases() const;
 		float4x4 const & CascadeCropMatrix(uint32_t index) const;
 
+		// World space bounds of the objects receiving shadows in the view. An empty list means they are unknown.
+		void Receivers(std::vector<AABBox> const & receivers_ws);
+		// Light space bounds of the receivers in a cascade, extruded to the near plane of the light. Casters outside it
+		// can't shadow anything visible. It's empty if the cascade has no receiver.
+		AABBox const & CascadeReceiverBounds(uint32_t index) const;
+
 	protected:
 		void UpdateCropMats();
 
@@ -78,6 +84,9 @@ namespace KlayGE
 		std::vector<float3> scales_;
 		std::vector<float3> biases_;
 		std::vector<float4x4> crop_mats_;
+
+		std::vector<AABBox> receivers_ws_;
+		std::vector<AABBox> receiver_bounds_;
 	};
 
 	class KLAYGE_CORE_API PSSMCascadedShadowLayer : public CascadedShadowLayer
@@ -91,12 +100,16 @@ namespace KlayGE
 		}
 
 		void Lambda(float lambda);
+		// Snaps the cascades to the texels of a shadow map in this size, so they don't shimmer when the camera moves.
+		// 0 turns it off.
+		void ShadowMapSize(uint32_t size);
 
 		virtual void UpdateCascades(Camera const & camera, float4x4 const & light_view_proj,
 			float3 const & light_space_border) override;
 
 	private:
 		float lambda_;
+		uint32_t sm_size_;
 	};
 
 	class KLAYGE_CORE_API SDSMCascadedShadowLayer : public CascadedShadowLayer
@@ -0,0 +1,134 @@
+/**
+ * @file CommandList.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _COMMANDLIST_HPP
+#define _COMMANDLIST_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/Thread.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace KlayGE
+{
+	// A draw recorded for later submission. The cbuffer snapshots taken with it are written back to the effect right
+	// before it's replayed, so the draw sees the parameter values of the time it was recorded.
+	struct CommandPacket
+	{
+		RenderEffect const * effect;
+		RenderTechnique const * tech;
+		RenderLayout const * layout;
+		uint32_t first_snapshot;
+		uint32_t num_snapshots;
+	};
+
+	// Draws recorded by one thread. Recording only touches the CPU side of the effects, the device is only reached in
+	// Execute, which has to be called on the render thread.
+	class KLAYGE_CORE_API CommandList : boost::noncopyable
+	{
+	public:
+		CommandList();
+
+		void Reset();
+
+		// Captures the cbuffers of the effect changed since its last draw in this list, all of them for its first one
+		void Draw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & layout);
+		// Captures a cbuffer into the next packet. It's copied if forced or dirty, and isn't dirty anymore afterward.
+		void CaptureCBuffer(RenderEffectConstantBuffer& cbuff, bool force);
+
+		uint32_t NumPackets() const
+		{
+			return static_cast<uint32_t>(packets_.size());
+		}
+		CommandPacket const & Packet(uint32_t index) const;
+		uint32_t NumSnapshotBytes() const
+		{
+			return static_cast<uint32_t>(snapshot_data_.size());
+		}
+
+		// Replays the packets in order. The snapshots of a packet are restored before draw is called, with the dirty
+		// spans they were captured with.
+		void Execute(std::function<void(CommandPacket const &)> const & draw) const;
+		void Execute(RenderEngine& re) const;
+
+	private:
+		struct CBufferSnapshot
+		{
+			RenderEffectConstantBuffer* cbuff;
+			uint32_t offset;
+			uint32_t size;
+			uint32_t dirty_begin;
+			uint32_t dirty_end;
+		};
+
+		std::vector<CommandPacket> packets_;
+		std::vector<CBufferSnapshot> snapshots_;
+		std::vector<uint8_t> snapshot_data_;
+		RenderEffect const * last_effect_;
+	};
+
+	// Records disjoint ranges of items into separate lists on the thread pool, and replays the lists in range order,
+	// so the result is the same as recording all the items serially into one list.
+	class KLAYGE_CORE_API CommandRecorder : boost::noncopyable
+	{
+	public:
+		explicit CommandRecorder(thread_pool& tp);
+
+		// Splits [0, num_items) into at most max_lists ranges of at least min_items_per_list items, and calls
+		// record(list, begin, end) for each of them. The first range is recorded on the calling thread.
+		// Two ranges must not share an effect.
+		void Record(uint32_t num_items, uint32_t max_lists, uint32_t min_items_per_list,
+			std::function<void(CommandList&, uint32_t, uint32_t)> const & record);
+
+		// Of the last Record
+		uint32_t NumLists() const
+		{
+			return num_lists_;
+		}
+		CommandList const & List(uint32_t index) const;
+		uint32_t NumPackets() const;
+
+		void Execute(std::function<void(CommandPacket const &)> const & draw) const;
+		void Execute(RenderEngine& re) const;
+
+	private:
+		thread_pool& tp_;
+
+		std::vector<std::unique_ptr<CommandList>> lists_;
+		uint32_t num_lists_;
+	};
+}
+
+#endif		// _COMMANDLIST_HPP
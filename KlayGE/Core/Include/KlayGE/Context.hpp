@@ -57,6 +57,11 @@ namespace KlayGE
 
 		bool perf_profiler;
 		bool location_sensor;
+
+		bool occlusion_culling;
+		bool mesh_bvh;
+		bool pipelined_frame;
+		bool parallel_draw_recording;
 	};
 
 	class KLAYGE_CORE_API Context : boost::noncopyable
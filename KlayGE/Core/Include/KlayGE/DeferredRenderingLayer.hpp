@@ -40,6 +40,7 @@
 #include <KlayGE/Light.hpp>
 #include <KlayGE/IndirectLightingLayer.hpp>
 #include <KlayGE/CascadedShadowLayer.hpp>
+#include <KlayGE/LightClusterGrid.hpp>
 
 #define TRIDITIONAL_DEFERRED 0
 #define LIGHT_INDEXED_DEFERRED 1
@@ -61,8 +62,9 @@ namespace KlayGE
 	struct PerViewport
 	{
 		PerViewport()
-			: attrib(0), num_cascades(4), curr_merged_buffer_index(0), ssvo_enabled(true)
+			: attrib(0), num_cascades(4), reused_cascades(0), curr_merged_buffer_index(0), ssvo_enabled(true)
 		{
+			cascade_seeds.fill(0);
 		}
 
 		uint32_t attrib;
@@ -83,8 +85,9 @@ namespace KlayGE
 		std::vector<TexturePtr> g_buffer_vdm_max_ds_texs;
 		std::vector<RenderViewPtr> g_buffer_vdm_max_ds_views;
 
-		FrameBufferPtr shadowing_fb;
-		TexturePtr shadowing_tex;
+		// Shadowed light i goes to component i % 4 of buffer i / 4
+		std::array<FrameBufferPtr, 2> shadowing_fbs;
+		std::array<TexturePtr, 2> shadowing_texs;
 
 		FrameBufferPtr projective_shadowing_fb;
 		TexturePtr projective_shadowing_tex;
@@ -102,6 +105,10 @@ namespace KlayGE
 
 		uint32_t num_cascades;
 		std::array<TexturePtr, CascadedShadowLayer::MAX_NUM_CASCADES> filtered_csm_texs;
+		// Hashes of the projection and casters of the cascades with static casters only, 0 for the others. A cascade
+		// with the same hash as last frame keeps its shadow map, and has its bit in reused_cascades.
+		std::array<size_t, CascadedShadowLayer::MAX_NUM_CASCADES> cascade_seeds;
+		uint32_t reused_cascades;
 
 		std::array<FrameBufferPtr, 2> merged_shading_fbs;
 		std::array<TexturePtr, 2> merged_shading_texs;
@@ -119,6 +126,8 @@ namespace KlayGE
 		IndirectLightingLayerPtr il_layer;
 
 		std::vector<char> light_visibles;
+		// The point, spot and area lights in the clusters of the view
+		LightClusterGridPtr light_clusters;
 
 #if DEFAULT_DEFERRED == TRIDITIONAL_DEFERRED
 		FrameBufferPtr lighting_fb;
@@ -291,6 +300,13 @@ namespace KlayGE
 		uint32_t NumRenderablesRendered() const;
 		uint32_t NumPrimitivesRendered() const;
 		uint32_t NumVerticesRendered() const;
+		// Casters of a cascade in its cropped frustum, and the ones left to render after culling them by the receivers
+		uint32_t NumCascadeCastersTested(uint32_t index) const;
+		uint32_t NumCascadeCastersRendered(uint32_t index) const;
+		// Cascades of the active viewport keeping their last shadow maps
+		uint32_t NumCascadesReused() const;
+		// Null before the viewport is rendered
+		LightClusterGridPtr const & LightClusters(uint32_t vp) const;
 
 #ifndef KLAYGE_SHIP
 		PerfRangePtr const & ShadowMapPerf() const
@@ -332,6 +348,12 @@ namespace KlayGE
 		void BuildVisibleSceneObjList(bool& has_opaque_objs, bool& has_transparency_back_objs, bool& has_transparency_front_objs);
 		void BuildPassScanList(bool has_opaque_objs, bool has_transparency_back_objs, bool has_transparency_front_objs);
 		void CheckLightVisible(uint32_t vp_index, uint32_t light_index);
+		float ShadowMapCoverage(LightSource const & light) const;
+		float ShadowMapImportance(LightSource const & light) const;
+		void AllocateShadowMaps();
+		size_t ShadowMapSeed(LightSource const & light) const;
+		bool NeedsFullShadowMap(LightSource const & light) const;
+		void ClusterLights(uint32_t vp_index);
 		void AppendGBufferPassScanCode(uint32_t vp_index, PassTargetBuffer pass_tb);
 		void AppendShadowPassScanCode(uint32_t light_index);
 		void AppendCascadedShadowPassScanCode(uint32_t vp_index, uint32_t light_index);
@@ -345,6 +367,10 @@ namespace KlayGE
 		void PrepareLightCamera(PerViewport const & pvp, LightSource const & light,
 			int32_t index_in_pass, PassType pass_type);
 		void PostGenerateShadowMap(PerViewport const & pvp, int32_t org_no, int32_t index_in_pass);
+		void ClipViewportViews();
+		void ClipLightViews(PerViewport& pvp, LightSource const & light);
+		void UpdateShadowReceivers();
+		void CullCascadeCasters(PerViewport& pvp, Camera const & sm_camera);
 		void UpdateShadowing(PerViewport const & pvp, int32_t index_in_pass);
 #if DEFAULT_DEFERRED == LIGHT_INDEXED_DEFERRED
 		void UpdateShadowingCS(PerViewport const & pvp, int32_t index_in_pass);
@@ -456,24 +482,41 @@ namespace KlayGE
 		RenderTechnique* technique_tbdr_light_intersection_unified_;
 		RenderTechnique* technique_tbdr_unified_;
 #endif
-		static uint32_t const MAX_NUM_SHADOWED_LIGHTS = 4;
-		static uint32_t const MAX_NUM_SHADOWED_SPOT_LIGHTS = 4;
+		// Spot lights share the shadow map atlas, so only the number of shadowing channels caps them. There are 4 channels
+		// in each shadowing buffer, and the projective light has its own buffer.
+		static uint32_t const MAX_NUM_SHADOWED_LIGHTS = 8;
+		static int32_t const PROJECTIVE_SHADOWING_CHANNEL = MAX_NUM_SHADOWED_LIGHTS;
+		static uint32_t const MAX_NUM_SHADOWED_SPOT_LIGHTS = MAX_NUM_SHADOWED_LIGHTS;
 		static uint32_t const MAX_NUM_SHADOWED_POINT_LIGHTS = 1;
 		static uint32_t const MAX_NUM_PROJECTIVE_SHADOWED_SPOT_LIGHTS = 1;
 		static uint32_t const MAX_NUM_PROJECTIVE_SHADOWED_POINT_LIGHTS = 1;
 
 		int32_t projective_light_index_;
-		std::vector<std::pair<int32_t, uint32_t>> sm_light_indices_;
+		// The map index and the shadowing channel of every light, -1 if it has none
+		std::vector<std::pair<int32_t, int32_t>> sm_light_indices_;
 		FrameBufferPtr sm_fb_;
 		TexturePtr sm_tex_;
 		TexturePtr sm_depth_tex_;
+		// Spot maps are rendered at the size of their tiles, from SM_SIZE down to the smallest tile. Level 0 is sm_fb_.
+		static uint32_t const NUM_SM_LEVELS = 4;
+		std::array<FrameBufferPtr, NUM_SM_LEVELS> sm_fbs_;
+		std::array<TexturePtr, NUM_SM_LEVELS> sm_texs_;
+		std::array<TexturePtr, NUM_SM_LEVELS> sm_depth_texs_;
 		FrameBufferPtr csm_fb_;
 		TexturePtr csm_tex_;
 		std::array<TexturePtr, MAX_NUM_SHADOWED_SPOT_LIGHTS + MAX_NUM_PROJECTIVE_SHADOWED_SPOT_LIGHTS> unfiltered_sm_2d_texs_;
-		std::array<TexturePtr, MAX_NUM_SHADOWED_SPOT_LIGHTS + MAX_NUM_PROJECTIVE_SHADOWED_SPOT_LIGHTS> filtered_sm_2d_texs_;
+		std::array<TexturePtr, NUM_SM_LEVELS> filtered_sm_2d_texs_;
 		std::array<TexturePtr, MAX_NUM_SHADOWED_POINT_LIGHTS + MAX_NUM_PROJECTIVE_SHADOWED_POINT_LIGHTS> filtered_sm_cube_texs_;
-
-		PostProcessPtr sm_filter_pp_;
+		// The filtered maps of spot lights are copied to their tiles. A map is rendered again only when its seed changes.
+		TexturePtr sm_atlas_tex_;
+		ShadowMapAtlasPtr sm_atlas_;
+		std::vector<uint4> sm_atlas_rects_;
+		std::vector<char> sm_cached_;
+		std::vector<uint32_t> sm_levels_;
+		std::array<std::pair<LightSource const *, size_t>,
+			MAX_NUM_SHADOWED_POINT_LIGHTS + MAX_NUM_PROJECTIVE_SHADOWED_POINT_LIGHTS> sm_cube_seeds_;
+
+		std::array<PostProcessPtr, NUM_SM_LEVELS> sm_filter_pps_;
 		PostProcessPtr csm_filter_pp_;
 		PostProcessPtr depth_to_esm_pp_;
 		PostProcessPtr depth_to_linear_pp_;
@@ -496,11 +539,10 @@ namespace KlayGE
 		RenderEffectParameter* projective_map_2d_tex_param_;
 		RenderEffectParameter* projective_map_cube_tex_param_;
 		RenderEffectParameter* filtered_sm_2d_tex_param_;
-		RenderEffectParameter* filtered_sm_2d_tex_array_param_;
-		RenderEffectParameter* filtered_sm_2d_light_index_param_;
+		RenderEffectParameter* filtered_sm_2d_scale_bias_param_;
 		RenderEffectParameter* filtered_sm_cube_tex_param_;
 		RenderEffectParameter* inv_width_height_param_;
-		RenderEffectParameter* shadowing_tex_param_;
+		std::array<RenderEffectParameter*, 2> shadowing_texs_param_;
 		RenderEffectParameter* projective_shadowing_tex_param_;
 		RenderEffectParameter* shadowing_channel_param_;
 		RenderEffectParameter* esm_scale_factor_param_;
@@ -530,9 +572,9 @@ namespace KlayGE
 		PostProcessPtr depth_to_max_pp_;
 
 		RenderEffectParameter* projective_shadowing_rw_tex_param_;
-		RenderEffectParameter* shadowing_rw_tex_param_;
+		std::array<RenderEffectParameter*, 2> shadowing_rw_texs_param_;
 		RenderEffectParameter* lights_view_proj_param_;
-		RenderEffectParameter* filtered_sms_2d_light_index_param_;
+		RenderEffectParameter* filtered_sms_2d_scale_bias_param_;
 		RenderEffectParameter* esms_scale_factor_param_;
 
 		RenderTechnique* technique_depth_to_tiled_min_max_;
@@ -584,6 +626,11 @@ namespace KlayGE
 		CascadedShadowLayerPtr cascaded_shadow_layer_;
 		float2 blur_size_light_space_;
 		int32_t curr_cascade_index_;
+		std::vector<AABBox> shadow_receivers_;
+		std::vector<LightClusterGrid::LightVolume> cluster_volumes_;
+		std::vector<uint32_t> cluster_light_indices_;
+		std::array<uint32_t, CascadedShadowLayer::MAX_NUM_CASCADES> num_cascade_casters_tested_;
+		std::array<uint32_t, CascadedShadowLayer::MAX_NUM_CASCADES> num_cascade_casters_rendered_;
 
 		bool force_line_mode_;
 
@@ -0,0 +1,104 @@
+/**
+ * @file FrameTaskGraph.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _FRAMETASKGRAPH_HPP
+#define _FRAMETASKGRAPH_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/Thread.hpp>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace KlayGE
+{
+	// The stages of a frame and their dependencies. It's built once and run every frame. Main thread tasks run on the
+	// thread calling Run, the others on the thread pool, so independent stages overlap.
+	class KLAYGE_CORE_API FrameTaskGraph : boost::noncopyable
+	{
+	public:
+		enum TaskAffinity
+		{
+			TA_MainThread,
+			TA_Worker
+		};
+
+	public:
+		explicit FrameTaskGraph(thread_pool& tp);
+
+		// A task could only depend on the tasks added before it, so the graph never has a cycle
+		uint32_t AddTask(std::function<void()> const & func, TaskAffinity affinity,
+			std::vector<uint32_t> const & deps = std::vector<uint32_t>());
+		void Clear();
+
+		uint32_t NumTasks() const
+		{
+			return static_cast<uint32_t>(tasks_.size());
+		}
+
+		// Returns after all the tasks are done
+		void Run();
+
+		// Seconds the task took in the last Run
+		double TaskTime(uint32_t task) const;
+
+	private:
+		struct Task
+		{
+			std::function<void()> func;
+			TaskAffinity affinity;
+			uint32_t num_deps;
+			std::vector<uint32_t> successors;
+			double time;
+		};
+
+		// Called with mutex_ locked
+		void Schedule(uint32_t task);
+		void Execute(uint32_t task);
+
+	private:
+		thread_pool& tp_;
+
+		std::vector<Task> tasks_;
+
+		std::mutex mutex_;
+		std::condition_variable finished_cond_;
+		std::vector<uint32_t> remaining_deps_;
+		std::vector<uint32_t> main_thread_queue_;
+		std::vector<joiner<void>> joiners_;
+		uint32_t num_finished_;
+	};
+}
+
+#endif		// _FRAMETASKGRAPH_HPP
@@ -169,6 +169,10 @@ namespace KlayGE
 		}
 
 		virtual void Render() override;
+		virtual bool Recordable() const override
+		{
+			return false;
+		}
 
 		virtual void ModelMatrix(float4x4 const & mat) override;
 
@@ -0,0 +1,147 @@
+/**
+ * @file LightClusterGrid.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _LIGHTCLUSTERGRID_HPP
+#define _LIGHTCLUSTERGRID_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/Thread.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Bins lights into clusters, the tiles of a view split into exponential slices of depth. Each cluster gets a range
+	// in a compact light index list, so shading a pixel only walks the lights touching its cluster.
+	class KLAYGE_CORE_API LightClusterGrid : boost::noncopyable
+	{
+	public:
+		// In world space. A spot light is the cone from position along direction, the others are spheres.
+		struct LightVolume
+		{
+			float3 position;
+			float range;
+			float3 direction;
+			// Of the half angle of a spot light, -1 for a sphere
+			float cos_half_angle;
+		};
+
+	public:
+		LightClusterGrid(uint32_t tiles_x, uint32_t tiles_y, uint32_t slices);
+
+		// Clusters the lights in a perspective view. The slices are spread over the threads of tp if it's not null.
+		void Build(float4x4 const & view, float4x4 const & proj, float near_plane, float far_plane,
+			std::vector<LightVolume> const & lights, thread_pool* tp = nullptr);
+
+		uint32_t TilesX() const
+		{
+			return tiles_x_;
+		}
+		uint32_t TilesY() const
+		{
+			return tiles_y_;
+		}
+		uint32_t Slices() const
+		{
+			return slices_;
+		}
+		uint32_t NumClusters() const
+		{
+			return tiles_x_ * tiles_y_ * slices_;
+		}
+		// Tile (0, 0) is on the top left
+		uint32_t ClusterIndex(uint32_t x, uint32_t y, uint32_t z) const
+		{
+			return (z * tiles_y_ + y) * tiles_x_ + x;
+		}
+		// The slice of a depth in view space
+		uint32_t Slice(float z) const;
+
+		// The lights of a cluster are LightIndices()[range.x(), range.x() + range.y())
+		std::vector<uint2> const & ClusterRanges() const
+		{
+			return cluster_ranges_;
+		}
+		std::vector<uint32_t> const & LightIndices() const
+		{
+			return light_indices_;
+		}
+		// If the light touches any cluster
+		bool LightVisible(uint32_t light) const
+		{
+			return light_visibles_[light] != 0;
+		}
+
+	private:
+		// In view space. Spot lights are also tested by the cone after their bounding spheres.
+		struct ViewLight
+		{
+			float3 center;
+			float radius;
+			float3 apex;
+			float range;
+			float3 direction;
+			float cos_half_angle;
+			float sin_half_angle;
+			uint32_t first_slice;
+			uint32_t last_slice;
+			uint32_t first_tile_x;
+			uint32_t last_tile_x;
+			uint32_t first_tile_y;
+			uint32_t last_tile_y;
+		};
+
+		void BuildSlices(uint32_t begin, uint32_t end);
+
+	private:
+		uint32_t tiles_x_;
+		uint32_t tiles_y_;
+		uint32_t slices_;
+		uint32_t num_hw_threads_;
+
+		float near_plane_;
+		float log_far_near_;
+		float4x4 proj_;
+
+		std::vector<float> slice_depths_;
+		std::vector<ViewLight> view_lights_;
+		std::vector<uint32_t> view_light_indices_;
+
+		std::vector<std::vector<uint32_t>> slice_light_indices_;
+		std::vector<uint2> cluster_ranges_;
+		std::vector<uint32_t> light_indices_;
+		std::vector<char> light_visibles_;
+	};
+}
+
+#endif		// _LIGHTCLUSTERGRID_HPP
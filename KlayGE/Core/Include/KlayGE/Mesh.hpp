@@ -133,6 +133,16 @@ namespace KlayGE
 			return hw_res_ready_;
 		}
 
+		// Optional, built at loading time if ContextCfg::mesh_bvh is on
+		TriangleBVHPtr const & BVH() const
+		{
+			return bvh_;
+		}
+		void BVH(TriangleBVHPtr const & bvh)
+		{
+			bvh_ = bvh;
+		}
+
 	protected:
 		virtual void DoBuildMeshInfo();
 
@@ -148,6 +158,8 @@ namespace KlayGE
 
 		std::weak_ptr<RenderModel> model_;
 
+		TriangleBVHPtr bvh_;
+
 		bool hw_res_ready_;
 	};
 
@@ -222,6 +234,9 @@ namespace KlayGE
 
 		virtual bool HWResourceReady() const override;
 
+		// Ray against the triangles of all meshes with a BVH, in model space. dir has to be normalized.
+		bool RayCast(float3 const & origin, float3 const & dir, float max_dist, float& dist) const;
+
 	protected:
 		virtual void UpdateBoundBox() override;
 		virtual void DoBuildModelInfo()
@@ -277,6 +292,14 @@ namespace KlayGE
 	};
 	typedef std::vector<AABBKeyFrames> AABBKeyFramesType;
 
+	// Kept on CPU only for skinning the BVH of a mesh. Each blend index packs 4 joints in bytes.
+	struct KLAYGE_CORE_API SkinnedBindPose
+	{
+		std::vector<float3> positions;
+		std::vector<uint32_t> blend_indices;
+		std::vector<float4> blend_weights;
+	};
+
 	struct KLAYGE_CORE_API AnimationAction
 	{
 		std::string name;
@@ -403,8 +426,17 @@ namespace KlayGE
 			return frame_pos_aabbs_;
 		}
 
+		void AttachBindPose(std::shared_ptr<SkinnedBindPose> const & bind_pose);
+		std::shared_ptr<SkinnedBindPose> const & GetBindPose() const
+		{
+			return bind_pose_;
+		}
+		// Skins the bind pose with the current joints of the model, and refits the BVH to it
+		void RefitBVH();
+
 	private:
 		std::shared_ptr<AABBKeyFrames> frame_pos_aabbs_;
+		std::shared_ptr<SkinnedBindPose> bind_pose_;
 	};
 
 
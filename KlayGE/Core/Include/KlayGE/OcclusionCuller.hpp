@@ -0,0 +1,119 @@
+/**
+ * @file OcclusionCuller.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _OCCLUSIONCULLER_HPP
+#define _OCCLUSIONCULLER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/AlignedAllocator.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Low-poly proxy geometry in model space, used only for occlusion
+	class KLAYGE_CORE_API OccluderMesh : boost::noncopyable
+	{
+	public:
+		OccluderMesh(std::vector<float3> positions, std::vector<uint32_t> indices);
+
+		std::vector<float3> const & Positions() const
+		{
+			return positions_;
+		}
+		std::vector<uint32_t> const & Indices() const
+		{
+			return indices_;
+		}
+		AABBox const & PosBound() const
+		{
+			return pos_aabb_;
+		}
+
+	private:
+		std::vector<float3> positions_;
+		std::vector<uint32_t> indices_;
+		AABBox pos_aabb_;
+	};
+
+	// Rasterizes occluders into a low resolution depth buffer on CPU, and tests bounding boxes against its mip chain
+	class KLAYGE_CORE_API OcclusionCuller : boost::noncopyable
+	{
+		struct ScreenTriangle
+		{
+			float2 v[3];
+			float z0;
+			float dzdx;
+			float dzdy;
+			int y_min;
+			int y_max;
+		};
+
+	public:
+		OcclusionCuller(uint32_t width, uint32_t height);
+
+		uint32_t Width() const
+		{
+			return width_;
+		}
+		uint32_t Height() const
+		{
+			return height_;
+		}
+
+		void Begin(float4x4 const & view_proj);
+		void AddOccluder(OccluderMesh const & mesh, float4x4 const & model);
+		void Rasterize();
+
+		uint32_t NumOccluderTriangles() const
+		{
+			return static_cast<uint32_t>(triangles_.size());
+		}
+
+		bool Occluded(AABBox const & aabb) const;
+
+	private:
+		void RasterizeBand(uint32_t y_begin, uint32_t y_end);
+		void BuildHiZ();
+
+	private:
+		uint32_t width_;
+		uint32_t height_;
+
+		float4x4 view_proj_;
+
+		std::vector<ScreenTriangle> triangles_;
+		std::vector<std::vector<float, aligned_allocator<float, 16>>> hiz_;
+	};
+}
+
+#endif		// _OCCLUSIONCULLER_HPP
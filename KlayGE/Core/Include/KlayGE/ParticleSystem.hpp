@@ -287,6 +287,7 @@ namespace KlayGE
 
 		virtual void SubThreadUpdate(float app_time, float elapsed_time) override;
 		virtual bool MainThreadUpdate(float app_time, float elapsed_time) override;
+		virtual void SyncSubThreadState() override;
 
 		uint32_t NumParticles() const
 		{
@@ -341,6 +342,12 @@ namespace KlayGE
 
 		std::vector<Particle> particles_;
 		std::vector<std::pair<uint32_t, float>> active_particles_;
+		AABBox active_particles_bb_;
+
+		// Copies of the active particles in drawing order, taken at SyncSubThreadState
+		std::vector<Particle> render_particles_;
+		// The view to sort the particles in SubThreadUpdate, also taken at SyncSubThreadState
+		float4x4 sim_view_mat_;
 
 		float gravity_;
 		float3 force_;
@@ -352,6 +359,8 @@ namespace KlayGE
 		Color particle_color_to_;
 
 		bool gs_support_;
+		// Instance data of each frame, sub-allocated from a ring
+		TransientBufferPtr tb_instance_;
 
 		std::mutex update_mutex_;
 	};
@@ -0,0 +1,118 @@
+/**
+ * @file PipelineCache.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _PIPELINECACHE_HPP
+#define _PIPELINECACHE_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KlayGE/RenderStateObject.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace KlayGE
+{
+	// Things that are expensive to rebuild every run, kept in a file in the local folder. It holds linked program
+	// binaries keyed by effect, technique and pass, the state objects and the effects used in the last session.
+	// The whole file is dropped when the version, the device or the driver changes. Main thread only.
+	class KLAYGE_CORE_API PipelineCache : boost::noncopyable
+	{
+	public:
+		PipelineCache();
+
+		// Called by the render engine after the device is created. device_identity should change with the driver.
+		void Open(std::string const & api_name, std::string const & device_identity);
+		void Save();
+		// Saves and releases the prewarmed effects. Must be called before the render engine is destroyed.
+		void Close();
+
+		bool IsOpen() const
+		{
+			return !file_name_.empty();
+		}
+
+		// source_hash covers everything the binary is built from. A binary built from other sources is a miss.
+		bool FindProgram(uint64_t key, uint64_t source_hash, uint32_t& format, std::vector<uint8_t>& binary) const;
+		void StoreProgram(uint64_t key, uint64_t source_hash, uint32_t format, std::vector<uint8_t> const & binary);
+
+		void RecordEffect(std::string const & effect_name);
+		void RecordRenderState(RasterizerStateDesc const & rs_desc, DepthStencilStateDesc const & dss_desc,
+			BlendStateDesc const & bs_desc);
+		void RecordSamplerState(SamplerStateDesc const & desc);
+
+		// Recreates the state objects and starts loading the effects from the last session in the background
+		void Prewarm();
+
+		uint32_t NumProgramHits() const
+		{
+			return num_program_hits_;
+		}
+		uint32_t NumProgramMisses() const
+		{
+			return num_program_misses_;
+		}
+
+	private:
+		struct ProgramEntry
+		{
+			uint64_t source_hash;
+			uint32_t format;
+			std::vector<uint8_t> binary;
+		};
+
+		struct RenderStateEntry
+		{
+			RasterizerStateDesc rs_desc;
+			DepthStencilStateDesc dss_desc;
+			BlendStateDesc bs_desc;
+		};
+
+	private:
+		std::string file_name_;
+		std::string device_identity_;
+		bool dirty_;
+
+		std::unordered_map<uint64_t, ProgramEntry> programs_;
+		std::vector<std::string> effect_names_;
+		std::unordered_map<size_t, RenderStateEntry> render_states_;
+		std::unordered_map<size_t, SamplerStateDesc> sampler_states_;
+
+		std::vector<RenderEffectPtr> prewarmed_effects_;
+
+		mutable uint32_t num_program_hits_;
+		mutable uint32_t num_program_misses_;
+	};
+}
+
+#endif		// _PIPELINECACHE_HPP
@@ -44,6 +44,7 @@ namespace KlayGE
 	typedef std::shared_ptr<PerfRange> PerfRangePtr;
 	class PerfProfiler;
 	typedef std::shared_ptr<PerfProfiler> PerfProfilerPtr;
+	class FrameTaskGraph;
 
 	class SceneManager;
 	class SceneNode;
@@ -58,6 +59,17 @@ namespace KlayGE
 	typedef std::shared_ptr<SceneObjectLightSourceProxy> SceneObjectLightSourceProxyPtr;
 	class SceneObjectCameraProxy;
 	typedef std::shared_ptr<SceneObjectCameraProxy> SceneObjectCameraProxyPtr;
+	class OccluderMesh;
+	typedef std::shared_ptr<OccluderMesh> OccluderMeshPtr;
+	class OcclusionCuller;
+	class SceneQuerySnapshot;
+	typedef std::shared_ptr<SceneQuerySnapshot> SceneQuerySnapshotPtr;
+	class TriangleBVH;
+	typedef std::shared_ptr<TriangleBVH> TriangleBVHPtr;
+	class LightClusterGrid;
+	typedef std::shared_ptr<LightClusterGrid> LightClusterGridPtr;
+	class WorldStreamer;
+	typedef std::shared_ptr<WorldStreamer> WorldStreamerPtr;
 
 	class Blitter;
 	typedef std::shared_ptr<Blitter> BlitterPtr;
@@ -75,6 +87,9 @@ namespace KlayGE
 	class Font;
 	typedef std::shared_ptr<Font> FontPtr;
 	class RenderEngine;
+	class CommandList;
+	class CommandRecorder;
+	class BindingCache;
 	struct RenderSettings;
 	struct RenderMaterial;
 	typedef std::shared_ptr<RenderMaterial> RenderMaterialPtr;
@@ -285,6 +300,8 @@ namespace KlayGE
 	typedef std::shared_ptr<PSSMCascadedShadowLayer> PSSMCascadedShadowLayerPtr;
 	class SDSMCascadedShadowLayer;
 	typedef std::shared_ptr<SDSMCascadedShadowLayer> SDSMCascadedShadowLayerPtr;
+	class ShadowMapAtlas;
+	typedef std::shared_ptr<ShadowMapAtlas> ShadowMapAtlasPtr;
 	class GpuFft;
 	typedef std::shared_ptr<GpuFft> GpuFftPtr;
 	class GpuFftPS;
@@ -58,11 +58,14 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
 
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/ShaderObject.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Hash.hpp>
 
 namespace KlayGE
 {
@@ -267,12 +270,15 @@ namespace KlayGE
 		{
 			if (in_cbuff_)
 			{
-				T& val_in_cbuff = *(data_.cbuff_desc.cbuff->template VariableInBuff<T>(data_.cbuff_desc.offset));
-				if (val_in_cbuff != value)
+				// Compared through the const buffer, so a cbuffer shared by clones is only copied on a real change
+				auto const & cbuff = *this->data_.cbuff_desc.cbuff;
+				uint32_t const offset = data_.cbuff_desc.offset;
+				if (*cbuff.template VariableInBuff<T>(offset) != value)
 				{
-					val_in_cbuff = value;
-					data_.cbuff_desc.cbuff->Dirty(true);
+					*data_.cbuff_desc.cbuff->template VariableInBuff<T>(offset) = value;
+					data_.cbuff_desc.cbuff->Dirty(offset, sizeof(T));
 				}
+				data_.cbuff_desc.cbuff->AddBytesWritten(sizeof(T));
 			}
 			else
 			{
@@ -285,7 +291,9 @@ namespace KlayGE
 		{
 			if (in_cbuff_)
 			{
-				val = *(data_.cbuff_desc.cbuff->template VariableInBuff<T>(data_.cbuff_desc.offset));
+				// Through the const buffer, reading never copies a cbuffer shared by clones
+				auto const & cbuff = *this->data_.cbuff_desc.cbuff;
+				val = *cbuff.template VariableInBuff<T>(data_.cbuff_desc.offset);
 			}
 			else
 			{
@@ -401,15 +409,29 @@ namespace KlayGE
 		{
 			if (this->in_cbuff_)
 			{
-				uint8_t* target = this->data_.cbuff_desc.cbuff->template VariableInBuff<uint8_t>(this->data_.cbuff_desc.offset);
-
+				auto& cbuff = *this->data_.cbuff_desc.cbuff;
+				auto const & const_cbuff = cbuff;
+				uint32_t const offset = this->data_.cbuff_desc.offset;
+				uint32_t const stride = this->data_.cbuff_desc.stride;
+				uint8_t const * current = const_cbuff.template VariableInBuff<uint8_t>(offset);
+				uint8_t* target = nullptr;
+
+				// Only the elements really changed are marked dirty
 				size_ = static_cast<uint32_t>(value.size());
-				for (size_t i = 0; i < value.size(); ++ i)
+				for (uint32_t i = 0; i < size_; ++ i)
 				{
-					memcpy(target + i * this->data_.cbuff_desc.stride, &value[i], sizeof(value[i]));
+					if (memcmp(current + i * stride, &value[i], sizeof(value[i])) != 0)
+					{
+						if (!target)
+						{
+							target = cbuff.template VariableInBuff<uint8_t>(offset);
+							current = target;
+						}
+						memcpy(target + i * stride, &value[i], sizeof(value[i]));
+						cbuff.Dirty(offset + i * stride, sizeof(value[i]));
+					}
 				}
-
-				this->data_.cbuff_desc.cbuff->Dirty(true);
+				cbuff.AddBytesWritten(size_ * static_cast<uint32_t>(sizeof(T)));
 			}
 			else
 			{
@@ -422,7 +444,8 @@ namespace KlayGE
 		{
 			if (this->in_cbuff_)
 			{
-				uint8_t const * src = this->data_.cbuff_desc.cbuff->template VariableInBuff<uint8_t>(this->data_.cbuff_desc.offset);
+				auto const & cbuff = *this->data_.cbuff_desc.cbuff;
+				uint8_t const * src = cbuff.template VariableInBuff<uint8_t>(this->data_.cbuff_desc.offset);
 
 				val.resize(size_);
 				for (size_t i = 0; i < size_; ++ i)
@@ -530,6 +553,29 @@ namespace KlayGE
 	typedef RenderVariableArray<float4> RenderVariableFloat4Array;
 
 
+	// The hash of a parameter, cbuffer or technique name. Made at compile time by EffectNameId(CT_HASH("name")), or
+	// once from a string and kept by the caller, so the lookups by it don't hash any string.
+	class EffectNameId
+	{
+	public:
+		constexpr explicit EffectNameId(size_t hash)
+			: hash_(hash)
+		{
+		}
+		explicit EffectNameId(std::string const & name)
+			: hash_(HashRange(name.begin(), name.end()))
+		{
+		}
+
+		constexpr size_t Hash() const
+		{
+			return hash_;
+		}
+
+	private:
+		size_t hash_;
+	};
+
 	class KLAYGE_CORE_API RenderEffectAnnotation : boost::noncopyable
 	{
 	public:
@@ -602,6 +648,7 @@ namespace KlayGE
 	class KLAYGE_CORE_API RenderEffect : boost::noncopyable
 	{
 		friend class RenderEffectTemplate;
+		friend class RenderPass;
 
 	public:
 		void Load(std::string const & name);
@@ -616,7 +663,9 @@ namespace KlayGE
 			return static_cast<uint32_t>(params_.size());
 		}
 		RenderEffectParameter* ParameterBySemantic(std::string const & semantic) const;
+		RenderEffectParameter* ParameterBySemantic(EffectNameId semantic) const;
 		RenderEffectParameter* ParameterByName(std::string const & name) const;
+		RenderEffectParameter* ParameterByName(EffectNameId name) const;
 		RenderEffectParameter* ParameterByIndex(uint32_t n) const
 		{
 			BOOST_ASSERT(n < this->NumParameters());
@@ -628,6 +677,7 @@ namespace KlayGE
 			return static_cast<uint32_t>(cbuffers_.size());
 		}
 		RenderEffectConstantBuffer* CBufferByName(std::string const & name) const;
+		RenderEffectConstantBuffer* CBufferByName(EffectNameId name) const;
 		RenderEffectConstantBuffer* CBufferByIndex(uint32_t n) const
 		{
 			BOOST_ASSERT(n < this->NumCBuffers());
@@ -636,6 +686,7 @@ namespace KlayGE
 
 		uint32_t NumTechniques() const;
 		RenderTechnique* TechniqueByName(std::string const & name) const;
+		RenderTechnique* TechniqueByName(EffectNameId name) const;
 		RenderTechnique* TechniqueByIndex(uint32_t n) const;
 
 		uint32_t NumShaderFragments() const;
@@ -655,6 +706,10 @@ namespace KlayGE
 			return shader_objs_[n];
 		}
 
+		// Creates the shader objects not used yet, spread over the thread pool if the device could create resources on
+		// any thread. Otherwise it has to be called on the render thread.
+		void Prewarm() const;
+
 #if KLAYGE_IS_DEV_PLATFORM
 		void GenHLSLShaderText();
 		std::string const & HLSLShaderText() const;
@@ -665,11 +720,15 @@ namespace KlayGE
 
 		std::vector<std::unique_ptr<RenderEffectParameter>> params_;
 		std::vector<std::unique_ptr<RenderEffectConstantBuffer>> cbuffers_;
-		std::vector<ShaderObjectPtr> shader_objs_;
+		// The passes streamed in from a kfx fill their slots on first use, once for each slot
+		mutable std::vector<ShaderObjectPtr> shader_objs_;
+		std::vector<std::unique_ptr<std::once_flag>> shader_obj_flags_;
 	};
 
 	class KLAYGE_CORE_API RenderEffectTemplate : boost::noncopyable
 	{
+		friend class RenderEffect;
+
 	public:
 		void Load(std::string const & name, RenderEffect& effect);
 
@@ -692,6 +751,7 @@ namespace KlayGE
 			return static_cast<uint32_t>(techniques_.size());
 		}
 		RenderTechnique* TechniqueByName(std::string const & name) const;
+		RenderTechnique* TechniqueByName(EffectNameId name) const;
 		RenderTechnique* TechniqueByIndex(uint32_t n) const
 		{
 			BOOST_ASSERT(n < this->NumTechniques());
@@ -733,6 +793,8 @@ namespace KlayGE
 #endif
 
 	private:
+		void IndexNames(RenderEffect const & effect);
+
 #if KLAYGE_IS_DEV_PLATFORM
 		void RecursiveIncludeNode(XMLNode const & root, std::vector<std::string>& include_names) const;
 		void InsertIncludeNodes(XMLDocument& target_doc, XMLNode& target_root,
@@ -755,6 +817,12 @@ namespace KlayGE
 #endif
 
 		std::vector<ShaderDesc> shader_descs_;
+
+		// From name hashes to indices, shared by all the effects made from this template
+		std::unordered_map<size_t, uint32_t> param_name_indices_;
+		std::unordered_map<size_t, uint32_t> param_semantic_indices_;
+		std::unordered_map<size_t, uint32_t> cbuffer_name_indices_;
+		std::unordered_map<size_t, uint32_t> technique_name_indices_;
 	};
 
 	class KLAYGE_CORE_API RenderTechnique : boost::noncopyable
@@ -764,7 +832,12 @@ namespace KlayGE
 		void Load(RenderEffect& effect, XMLNodePtr const & node, uint32_t tech_index);
 #endif
 
-		bool StreamIn(RenderEffect& effect, ResIdentifierPtr const & res, uint32_t tech_index);
+		// Only reads the data, so techniques can be streamed in in parallel. The native shaders are left in kfx_data,
+		// at offset plus their position in res. Resolve makes the state objects afterwards, in order on the loading
+		// thread, and the shader objects are made on first use.
+		void StreamIn(ResIdentifierPtr const & res, std::shared_ptr<std::vector<uint8_t>> const & kfx_data,
+			uint32_t offset, uint32_t tech_index);
+		void Resolve(RenderEffect& effect);
 #if KLAYGE_IS_DEV_PLATFORM
 		void StreamOut(RenderEffect const & effect, std::ostream& os, uint32_t tech_index) const;
 #endif
@@ -813,6 +886,9 @@ namespace KlayGE
 			return is_validate_;
 		}
 
+		// Creates the shader objects of the passes on the calling thread
+		void Prewarm(RenderEffect const & effect) const;
+
 		float Weight() const
 		{
 			return weight_;
@@ -857,7 +933,9 @@ namespace KlayGE
 		void Load(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, RenderPass const * inherit_pass);
 #endif
 
-		bool StreamIn(RenderEffect& effect, ResIdentifierPtr const & res, uint32_t tech_index, uint32_t pass_index);
+		void StreamIn(ResIdentifierPtr const & res, std::shared_ptr<std::vector<uint8_t>> const & kfx_data,
+			uint32_t offset, uint32_t tech_index, uint32_t pass_index);
+		void Resolve(RenderEffect& effect);
 #if KLAYGE_IS_DEV_PLATFORM
 		void StreamOut(RenderEffect const & effect, std::ostream& os, uint32_t tech_index, uint32_t pass_index) const;
 #endif
@@ -883,10 +961,8 @@ namespace KlayGE
 		{
 			return render_state_obj_;
 		}
-		ShaderObjectPtr const & GetShaderObject(RenderEffect const & effect) const
-		{
-			return effect.ShaderObjectByIndex(shader_obj_index_);
-		}
+		// The shader object of a streamed in pass is created here on first use. Thread safe.
+		ShaderObjectPtr const & GetShaderObject(RenderEffect const & effect) const;
 
 		uint32_t NumAnnotations() const
 		{
@@ -909,6 +985,11 @@ namespace KlayGE
 		}
 
 	private:
+		void CreateShaderObject(RenderEffect const & effect) const;
+
+	private:
+		struct StateDescs;
+
 		std::string name_;
 		size_t name_hash_;
 		std::shared_ptr<std::vector<RenderEffectAnnotationPtr>> annotations_;
@@ -918,14 +999,27 @@ namespace KlayGE
 		RenderStateObjectPtr render_state_obj_;
 		uint32_t shader_obj_index_;
 
+		// Held from StreamIn to Resolve
+		std::shared_ptr<StateDescs> state_descs_;
+		// Where the native shaders of a streamed in pass are in the techniques of the kfx. Shared by the passes and
+		// kept for the effects cloned later.
+		std::shared_ptr<std::vector<uint8_t>> kfx_data_;
+		uint32_t native_offset_;
+		uint32_t native_size_;
+		uint32_t tech_index_;
+		uint32_t pass_index_;
+
 		bool is_validate_;
 	};
 
+	// A cloned cbuffer shares the memory and the hardware buffer of its source. The first change through the non-const
+	// interface gives it a copy of the memory. Its own hardware buffer is made by the next Update, on the render thread.
 	class KLAYGE_CORE_API RenderEffectConstantBuffer : boost::noncopyable
 	{
 	public:
 		RenderEffectConstantBuffer()
-			: dirty_(true)
+			: hw_buff_shared_(false), buff_(MakeSharedPtr<std::vector<uint8_t>>()), dirty_begin_(0), dirty_end_(0xFFFFFFFF),
+				bytes_written_(0)
 		{
 		}
 
@@ -961,6 +1055,10 @@ namespace KlayGE
 		}
 
 		void Resize(uint32_t size);
+		uint32_t Size() const
+		{
+			return static_cast<uint32_t>(buff_->size());
+		}
 
 		template <typename T>
 		T const * VariableInBuff(uint32_t offset) const
@@ -970,28 +1068,64 @@ namespace KlayGE
 				uint8_t const * raw;
 				T const * t;
 			} r2t;
-			r2t.raw = &buff_[offset];
+			r2t.raw = &(*buff_)[offset];
 			return r2t.t;
 		}
 		template <typename T>
 		T* VariableInBuff(uint32_t offset)
 		{
+			if (buff_.use_count() > 1)
+			{
+				this->CopyOnWrite();
+			}
+
 			union Raw2T
 			{
 				uint8_t* raw;
 				T* t;
 			} r2t;
-			r2t.raw = &buff_[offset];
+			r2t.raw = &(*buff_)[offset];
 			return r2t.t;
 		}
 
+		// Marks the whole buffer, or nothing
 		void Dirty(bool dirty)
 		{
-			dirty_ = dirty;
+			dirty_begin_ = 0;
+			dirty_end_ = dirty ? 0xFFFFFFFF : 0;
+		}
+		// The dirty ranges are coalesced into one span, uploaded by the next Update
+		void Dirty(uint32_t offset, uint32_t size)
+		{
+			if (dirty_begin_ < dirty_end_)
+			{
+				dirty_begin_ = std::min(dirty_begin_, offset);
+				dirty_end_ = std::max(dirty_end_, offset + size);
+			}
+			else
+			{
+				dirty_begin_ = offset;
+				dirty_end_ = offset + size;
+			}
 		}
 		bool Dirty() const
 		{
-			return dirty_;
+			return dirty_begin_ < dirty_end_;
+		}
+		// The end is past the size when the whole buffer is dirty
+		uint32_t DirtyBegin() const
+		{
+			return dirty_begin_;
+		}
+		uint32_t DirtyEnd() const
+		{
+			return dirty_end_;
+		}
+
+		// Bytes assigned by the variables, including the ones that didn't change anything. Reported at next Update.
+		void AddBytesWritten(uint32_t size)
+		{
+			bytes_written_ += size;
 		}
 
 		void Update();
@@ -1001,13 +1135,20 @@ namespace KlayGE
 		}
 		void BindHWBuff(GraphicsBufferPtr const & buff);
 
+	private:
+		void CopyOnWrite();
+
 	private:
 		std::shared_ptr<std::pair<std::string, size_t>> name_;
 		std::shared_ptr<std::vector<uint32_t>> param_indices_;
 
 		GraphicsBufferPtr hw_buff_;
-		std::vector<uint8_t> buff_;
-		bool dirty_;
+		// The memory is copied, but the hardware buffer is still the shared one until the next Update
+		bool hw_buff_shared_;
+		std::shared_ptr<std::vector<uint8_t>> buff_;
+		uint32_t dirty_begin_;
+		uint32_t dirty_end_;
+		uint32_t bytes_written_;
 	};
 
 	class KLAYGE_CORE_API RenderEffectParameter : boost::noncopyable
@@ -1068,6 +1209,10 @@ namespace KlayGE
 		template <typename T>
 		RenderEffectParameter& operator=(T const & value)
 		{
+			if (var_.use_count() > 1)
+			{
+				this->CopyVarOnWrite();
+			}
 			*var_ = value;
 			return *this;
 		}
@@ -1100,7 +1245,8 @@ namespace KlayGE
 		template <typename T>
 		T const * MemoryInCBuff() const
 		{
-			return cbuff_->VariableInBuff<T>(var_->CBufferOffset());
+			RenderEffectConstantBuffer const & cbuff = *cbuff_;
+			return cbuff.VariableInBuff<T>(var_->CBufferOffset());
 		}
 		template <typename T>
 		T* MemoryInCBuff()
@@ -1108,12 +1254,16 @@ namespace KlayGE
 			return cbuff_->VariableInBuff<T>(var_->CBufferOffset());
 		}
 
+	private:
+		void CopyVarOnWrite();
+
 	private:
 		std::shared_ptr<std::pair<std::string, size_t>> name_;
 		std::shared_ptr<std::pair<std::string, size_t>> semantic_;
 
 		uint32_t type_;
-		std::unique_ptr<RenderVariable> var_;
+		// Shared by the clones until written if it's not in a cbuffer
+		std::shared_ptr<RenderVariable> var_;
 		std::shared_ptr<std::string> array_size_;
 
 		std::shared_ptr<std::vector<std::unique_ptr<RenderEffectAnnotation>>> annotations_;
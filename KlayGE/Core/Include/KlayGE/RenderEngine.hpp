@@ -76,6 +76,7 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <KlayGE/RenderDeviceCaps.hpp>
 #include <KlayGE/RenderSettings.hpp>
+#include <KlayGE/BindingCache.hpp>
 #include <KFL/Color.hpp>
 
 #include <vector>
@@ -98,6 +99,8 @@ namespace KlayGE
 		virtual void BeginFrame();
 		virtual void BeginPass();
 		void Render(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl);
+		// Called on the recording threads for each recorded draw, to resolve ahead the objects its Render binds
+		void PrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl);
 		void Dispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz);
 		void DispatchIndirect(RenderEffect const & effect, RenderTechnique const & tech,
 			GraphicsBufferPtr const & buff_args, uint32_t offset);
@@ -112,6 +115,17 @@ namespace KlayGE
 		uint32_t NumVerticesJustRendered();
 		uint32_t NumDrawsJustCalled();
 		uint32_t NumDispatchesJustCalled();
+		uint32_t NumBindsJustIssued();
+		uint32_t NumBindsJustSkipped();
+		uint32_t NumCBufferBytesJustWritten();
+		uint32_t NumCBufferBytesJustUploaded();
+
+		// Called by the cbuffers on each Update
+		void OnCBufferUpdated(uint32_t bytes_written, uint32_t bytes_uploaded)
+		{
+			num_cbuffer_bytes_just_written_ += bytes_written;
+			num_cbuffer_bytes_just_uploaded_ += bytes_uploaded;
+		}
 
 		void CreateRenderWindow(std::string const & name, RenderSettings& settings);
 		void DestroyRenderWindow();
@@ -197,6 +211,11 @@ namespace KlayGE
 			return cur_rs_obj_;
 		}
 
+		BindingCache& GetBindingCache()
+		{
+			return binding_cache_;
+		}
+
 		RenderLayoutPtr const & PostProcessRenderLayout() const
 		{
 			return pp_rl_;
@@ -256,6 +275,7 @@ namespace KlayGE
 		virtual void DoBindFrameBuffer(FrameBufferPtr const & fb) = 0;
 		virtual void DoBindSOBuffers(RenderLayoutPtr const & rl) = 0;
 		virtual void DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl) = 0;
+		virtual void DoPrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl);
 		virtual void DoDispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz) = 0;
 		virtual void DoDispatchIndirect(RenderEffect const & effect, RenderTechnique const & tech,
 			GraphicsBufferPtr const & buff_args, uint32_t offset) = 0;
@@ -288,12 +308,16 @@ namespace KlayGE
 		uint32_t num_vertices_just_rendered_;
 		uint32_t num_draws_just_called_;
 		uint32_t num_dispatches_just_called_;
+		uint32_t num_cbuffer_bytes_just_written_;
+		uint32_t num_cbuffer_bytes_just_uploaded_;
 
 		RenderDeviceCaps caps_;
 
 		RenderStateObjectPtr cur_rs_obj_;
 		RenderStateObjectPtr cur_line_rs_obj_;
 
+		BindingCache binding_cache_;
+
 		float default_fov_;
 		float default_render_width_scale_;
 		float default_render_height_scale_;
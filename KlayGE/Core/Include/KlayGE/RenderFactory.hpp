@@ -34,6 +34,7 @@
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/GraphicsBuffer.hpp>
 #include <KlayGE/RenderStateObject.hpp>
+#include <KlayGE/PipelineCache.hpp>
 
 #include <string>
 #include <unordered_map>
@@ -118,6 +119,11 @@ namespace KlayGE
 		SamplerStateObjectPtr MakeSamplerStateObject(SamplerStateDesc const & desc);
 		virtual ShaderObjectPtr MakeShaderObject() = 0;
 
+		PipelineCache& PipelineCacheInstance()
+		{
+			return pipeline_cache_;
+		}
+
 	private:
 		virtual std::unique_ptr<RenderEngine> DoMakeRenderEngine() = 0;
 
@@ -133,6 +139,8 @@ namespace KlayGE
 
 		std::unordered_map<size_t, RenderStateObjectPtr> rs_pool_;
 		std::unordered_map<size_t, SamplerStateObjectPtr> ss_pool_;
+
+		PipelineCache pipeline_cache_;
 	};
 }
 
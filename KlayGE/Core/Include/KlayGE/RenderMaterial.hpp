@@ -36,6 +36,7 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <string>
 #include <array>
+#include <vector>
 
 namespace KlayGE
 {
@@ -76,6 +77,16 @@ namespace KlayGE
 		SurfaceDetailMode detail_mode;
 		float2 height_offset_scale;
 		float4 tess_factors;
+
+		// The per_material cbuffer packed from the fields above, and the texture slots it's packed with. It's shared by
+		// all the renderables of this material. Call DirtyCBuffer after changing the fields.
+		std::vector<uint8_t> cbuffer_data;
+		uint32_t cbuffer_texture_mask;
+
+		void DirtyCBuffer()
+		{
+			cbuffer_data.clear();
+		}
 	};
 
 	float const MAX_SHININESS = 8192;
@@ -24,6 +24,7 @@
 #include <KlayGE/PreDeclare.hpp>
 #include <vector>
 #include <KlayGE/RenderMaterial.hpp>
+#include <KlayGE/RenderLayout.hpp>
 
 namespace KlayGE
 {
@@ -145,6 +146,10 @@ namespace KlayGE
 		}
 		virtual RenderLayout& GetRenderLayout() const = 0;
 		virtual std::wstring const & Name() const = 0;
+		RenderMaterialPtr const & GetMaterial() const
+		{
+			return mtl_;
+		}
 
 		virtual void OnRenderBegin();
 		virtual void OnRenderEnd();
@@ -159,6 +164,15 @@ namespace KlayGE
 		virtual void AddToRenderQueue();
 
 		virtual void Render();
+		// Records the draws of Render for a worker thread. PrepareRecord has to be called on the render thread before,
+		// and no other thread could touch the effect until the list is executed.
+		void PrepareRecord();
+		virtual void Record(CommandList& cmd_list);
+		// The ones drawing in their own way in Render are drawn directly on the render thread
+		virtual bool Recordable() const
+		{
+			return true;
+		}
 
 		template <typename Iterator>
 		void AssignInstances(Iterator begin, Iterator end)
@@ -180,6 +194,15 @@ namespace KlayGE
 			return instances_[index];
 		}
 
+		// True if the instances of rhs could be drawn in the same call as the ones of this. The default one checks the
+		// streams, effect, technique, material values and textures. Override it if a subclass has more per draw states.
+		virtual bool InstanceCompatible(Renderable const & rhs) const;
+		// Equal for compatible renderables
+		size_t InstanceBatchHash() const;
+		// Draws num instances from start of a buffer shared with other renderables, until the next ClearInstances
+		void BindSharedInstanceStream(GraphicsBufferPtr const & buffer, vertex_elements_type const & vet,
+			uint32_t start, uint32_t num);
+
 		virtual void ModelMatrix(float4x4 const & mat);
 
 		template <typename ForwardIterator>
@@ -253,14 +276,20 @@ namespace KlayGE
 	protected:
 		virtual void UpdateInstanceStream();
 		virtual void UpdateBoundBox();
+		void DoRender(CommandList* cmd_list);
 
 		// For deferred only
+		uint32_t TextureMask() const;
+		void PackMaterialCBuffer();
+		void BindMaterialCBuffer();
+		void WriteMaterialParams(RenderMaterial const & mtl, uint32_t tex_mask);
 		virtual void BindDeferredEffect(RenderEffectPtr const & deferred_effect);
 		virtual RenderTechnique* PassTech(PassType type) const;
 		virtual void UpdateTechniques();
 
 	protected:
 		std::vector<SceneObject const *> instances_;
+		bool shared_inst_stream_;
 
 		RenderEffectPtr effect_;
 		RenderTechnique* technique_;
@@ -325,6 +354,7 @@ namespace KlayGE
 		RenderEffectParameter* opaque_depth_tex_param_;
 		RenderEffectParameter* reflection_tex_param_;
 		RenderEffectParameter* alpha_test_threshold_param_;
+		RenderEffectConstantBuffer* mtl_cbuff_;
 
 		std::array<TexturePtr, RenderMaterial::TS_NumTextureSlots> textures_;
 
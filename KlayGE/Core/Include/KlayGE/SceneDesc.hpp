@@ -0,0 +1,136 @@
+/**
+ * @file SceneDesc.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _SCENEDESC_HPP
+#define _SCENEDESC_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/ResIdentifier.hpp>
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace KlayGE
+{
+	// Everything a .kges scene file describes, in flat arrays. The records only have 4-byte fields, so they're stored
+	// in a .scene_bin as they are and read back in one go.
+	struct KLAYGE_CORE_API SceneDesc
+	{
+		static uint32_t const NO_INDEX = 0xFFFFFFFF;
+
+		enum ResourceType
+		{
+			RT_Model,
+			RT_Texture
+		};
+
+		struct Resource
+		{
+			ResourceType type;
+			std::string name;
+		};
+
+		struct Model
+		{
+			float4x4 transform;
+			uint32_t resource;
+			uint32_t attrib;
+			uint32_t update_script;
+		};
+
+		struct Light
+		{
+			uint32_t type;
+			uint32_t attrib;
+			float3 color;
+			float3 dir;
+			float3 pos;
+			float3 falloff;
+			float inner_angle;
+			float outer_angle;
+			// Zero if the light has no proxy object
+			float3 proxy_scale;
+			uint32_t projective_tex;
+			uint32_t update_script;
+		};
+
+		struct Camera
+		{
+			float3 eye_pos;
+			float3 look_at;
+			float3 up;
+			float fov;
+			// Zero to use the one of the frame buffer
+			float aspect;
+			float near_plane;
+			float far_plane;
+			uint32_t update_script;
+		};
+
+		struct Streaming
+		{
+			uint32_t enabled;
+			float cell_size;
+			float load_radius;
+			float unload_radius;
+			uint32_t budget_mb;
+		};
+
+		std::string skybox;
+		Streaming streaming;
+
+		// Each resource is in the table only once, however many objects use it
+		std::vector<Resource> resources;
+		std::vector<std::string> scripts;
+
+		std::vector<Model> models;
+		std::vector<Light> lights;
+		std::vector<Camera> cameras;
+
+		SceneDesc();
+
+		uint32_t AddResource(ResourceType type, std::string const & name);
+		uint32_t AddScript(std::string const & script);
+	};
+
+	KLAYGE_CORE_API void LoadSceneXML(ResIdentifierPtr const & res, SceneDesc& desc);
+	// Returns false if the file is truncated, corrupt or of another version
+	KLAYGE_CORE_API bool LoadSceneBin(ResIdentifierPtr const & res, SceneDesc& desc);
+	KLAYGE_CORE_API void SaveSceneBin(SceneDesc const & desc, std::ostream& os);
+
+	// Reads the compiled name + ".scene_bin" if it's up to date, or the xml otherwise
+	KLAYGE_CORE_API void LoadSceneDesc(std::string const & name, SceneDesc& desc);
+}
+
+#endif		// _SCENEDESC_HPP
@@ -24,16 +24,30 @@
 #include <KlayGE/PreDeclare.hpp>
 
 #include <KlayGE/Renderable.hpp>
+#include <KlayGE/SceneQuery.hpp>
 #include <KFL/Frustum.hpp>
 #include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 
+#include <atomic>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace KlayGE
 {
 	class KLAYGE_CORE_API SceneManager : boost::noncopyable
 	{
+	public:
+		static uint32_t const MAX_NUM_CULLING_VIEWS = 32;
+
+		// One view of a multi-view cull. view_proj could include a crop, such as the one of a shadow cascade.
+		struct CullingView
+		{
+			Camera const * camera;
+			float4x4 view_proj;
+		};
+
 	public:
 		SceneManager();
 		virtual ~SceneManager();
@@ -43,7 +57,17 @@ namespace KlayGE
 
 		void SmallObjectThreshold(float area);
 		void SceneUpdateElapse(float elapse);
+		// Culling results are reused across frames while the camera's view_proj moves less than this per element
+		void VisibilityCacheThreshold(float threshold);
+		// Visible objects with an instance format are merged into one draw across renderables sharing the same mesh
+		// buffers, material and technique. A batch holds at most max_instances objects.
+		void MaxInstancesPerBatch(uint32_t max_instances);
+		// Initial size in bytes of the per-instance buffer shared by all batches. It grows if a flush needs more.
+		void InstanceBufferSize(uint32_t size);
 		virtual void ClipScene();
+		// Culls the scene against all the views in one traversal, and writes the results to SceneObject::ViewMask.
+		// In the same frame, Flush with a matching camera and view_proj reads its bit instead of clipping again.
+		virtual void ClipViews(std::vector<CullingView> const & views);
 
 		void AddCamera(CameraPtr const & camera);
 		void DelCamera(CameraPtr const & camera);
@@ -86,6 +110,32 @@ namespace KlayGE
 		uint32_t NumVerticesRendered() const;
 		uint32_t NumDrawCalls() const;
 		uint32_t NumDispatchCalls() const;
+		// Binds sent to the device, and the ones skipped because the same handle was already bound
+		uint32_t NumBindsIssued() const;
+		uint32_t NumBindsSkipped() const;
+		// Bytes assigned to the cbuffer variables, and the ones really sent to the device
+		uint32_t NumCBufferBytesWritten() const;
+		uint32_t NumCBufferBytesUploaded() const;
+		uint32_t NumObjectsOccluded() const;
+		uint32_t NumVisibleMarksReused() const;
+		uint32_t NumVisibleMarksTested() const;
+		// Seconds spent waiting for locks, by the main thread in the last frame and by the update thread in its last tick
+		float MainThreadLockWaitTime() const;
+		float SubThreadLockWaitTime() const;
+		// Of the mode in ContextCfg::pipelined_frame. Latency is the seconds from the start of simulating the presented
+		// state to presenting it, and throughput is in frames per second.
+		float FrameLatency() const;
+		float FrameThroughput() const;
+
+		// Spatial queries against the snapshot taken at the end of last Update. They could be called from any thread.
+		SceneQuerySnapshotPtr QuerySnapshot() const;
+		SceneRayHit RayCast(float3 const & origin, float3 const & dir, float max_dist,
+			SceneQueryFilter const & filter = SceneQueryFilter()) const;
+		void RayCast(std::vector<SceneRay> const & rays, SceneQueryFilter const & filter,
+			std::vector<SceneRayHit>& hits) const;
+		void QueryAABB(AABBox const & aabb, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
+		void QuerySphere(Sphere const & sphere, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
+		void QueryFrustum(Frustum const & frustum, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
 
 	protected:
 		void Flush(uint32_t urt);
@@ -98,11 +148,17 @@ namespace KlayGE
 		virtual void OnDelSceneObject(std::vector<SceneObjectPtr>::iterator iter) = 0;
 		virtual void DoSuspend() = 0;
 		virtual void DoResume() = 0;
+		virtual SceneQuerySnapshotPtr MakeQuerySnapshot();
 
 		void UpdateThreadFunc();
 
 		BoundOverlap VisibleTestFromParent(SceneObject* obj, float3 const & view_dir, float3 const & eye_pos,
 			float4x4 const & view_proj);
+		BoundOverlap ObjectVisible(SceneObject* obj, Camera const & camera, float4x4 const & view_proj);
+		float4x4 CullingViewProj(Camera const & camera) const;
+		void BeginClipViews(std::vector<CullingView> const & views);
+		uint32_t ObjectViewMask(SceneObject* obj, uint32_t test_mask, uint32_t inside_mask);
+		size_t VisibleSeed(std::vector<SceneObjectPtr> const & scene_objs) const;
 
 	protected:
 		std::vector<CameraPtr> cameras_;
@@ -111,18 +167,84 @@ namespace KlayGE
 		std::vector<SceneObjectPtr> scene_objs_;
 		std::vector<SceneObjectPtr> overlay_scene_objs_;
 
-		std::unordered_map<size_t, std::shared_ptr<std::vector<BoundOverlap>>> visible_marks_map_;
+		// Kept across frames. Within the frame it was written an entry is reused as is, in later frames
+		// only the objects moved since then are tested again.
+		struct VisibleMarks
+		{
+			uint32_t frame;
+			uint32_t scene_version;
+			float4x4 view_proj;
+			std::vector<BoundOverlap> marks;
+			std::vector<uint32_t> transform_versions;
+		};
+		std::unordered_map<size_t, VisibleMarks> visible_marks_map_;
+
+		struct CullingViewInfo
+		{
+			Camera const * camera;
+			float4x4 view_proj;
+			Frustum frustum;
+		};
+		std::vector<CullingViewInfo> culling_views_;
 
 		float small_obj_threshold_;
 		float update_elapse_;
 
+	private:
+		// Packed from high to low bits: technique rank (16), material (16), quantized min depth (32)
+		struct RenderQueueItem
+		{
+			uint64_t key;
+			Renderable* renderable;
+		};
+
 	private:
 		void FlushScene();
+		void OcclusionCullScene();
+		bool RasterizeOccluders(float4x4 const & view_proj);
+		bool UpdateVisibleMarks(VisibleMarks& vm, Camera const & camera, float4x4 const & view_proj, bool occlusion);
+		void StoreVisibleMarks(VisibleMarks& vm, uint32_t frame, float4x4 const & view_proj);
+		void SortRenderQueue();
+		void RecordRenderQueue();
+		void BatchInstances();
+		void UpdateQuerySnapshot();
+		void SyncSubThreadState();
+		void BuildFrameGraph();
+		void RenderFrame();
+		void SimulateFrame();
+		void UpdateScene();
+		void PresentFrame();
+		void UpdateViews();
+		void SubThreadUpdateObjects(float app_time, float elapsed_time);
+		void SubThreadUpdateRange(uint32_t begin, uint32_t end, float app_time, float elapsed_time);
+		int32_t CullingViewIndex(Camera const & camera, float4x4 const & view_proj, uint32_t frame, size_t visible_seed) const;
 
 	private:
 		uint32_t urt_;
 
-		std::vector<std::pair<RenderTechnique const *, std::vector<Renderable*>>> render_queue_;
+		std::vector<RenderTechnique const *> render_techs_;
+		std::vector<uint32_t> render_tech_ranks_;
+		std::vector<RenderQueueItem> render_queue_;
+		std::vector<RenderQueueItem> render_queue_scratch_;
+
+		// With ContextCfg::parallel_draw_recording, the queue is recorded into command lists on the thread pool.
+		// Only on the devices with multithread_rendering_support.
+		std::unique_ptr<CommandRecorder> cmd_recorder_;
+		std::unordered_set<RenderEffect const *> record_effects_;
+		uint32_t num_hw_threads_;
+
+		// Instance data of all the batches in a flush is written contiguously after inst_buffer_offset_. The buffer is
+		// only discarded when it wraps around, so the batches of the earlier flushes in a frame stay valid. Devices
+		// without no-overwrite maps discard it in every flush instead.
+		std::vector<SceneObject*> inst_objs_;
+		// Objects over the cap of their full batch, drawn in one more round
+		std::vector<SceneObject*> inst_overflow_objs_;
+		std::vector<Renderable*> inst_batches_;
+		std::unordered_multimap<size_t, Renderable*> inst_batch_map_;
+		GraphicsBufferPtr inst_buffer_;
+		uint32_t inst_buffer_size_;
+		uint32_t inst_buffer_offset_;
+		uint32_t max_instances_per_batch_;
 
 		uint32_t num_objects_rendered_;
 		uint32_t num_renderables_rendered_;
@@ -130,11 +252,57 @@ namespace KlayGE
 		uint32_t num_vertices_rendered_;
 		uint32_t num_draw_calls_;
 		uint32_t num_dispatch_calls_;
+		uint32_t num_binds_issued_;
+		uint32_t num_binds_skipped_;
+		uint32_t num_cbuffer_bytes_written_;
+		uint32_t num_cbuffer_bytes_uploaded_;
+		uint32_t num_objects_occluded_;
+		uint32_t num_visible_marks_reused_;
+		uint32_t num_visible_marks_tested_;
+
+		uint32_t scene_version_;
+		float visibility_cache_threshold_;
+
+		uint32_t culling_views_frame_;
+		uint32_t culling_views_scene_version_;
+		size_t culling_views_visible_seed_;
+
+		// Only touched with std::atomic_load/atomic_store
+		SceneQuerySnapshotPtr query_snapshot_;
+		uint32_t query_snapshot_scene_version_;
+		std::vector<uint32_t> query_transform_versions_;
+
+		std::unique_ptr<OcclusionCuller> occlusion_culler_;
 
 		std::mutex update_mutex_;
 		std::unique_ptr<joiner<void>> update_thread_;
 		volatile bool quit_;
 
+		// Held by the update thread during a tick. The object lists are handed over from the main thread at the sync point.
+		std::mutex sub_thread_mutex_;
+		std::vector<SceneObjectPtr> sub_thread_objs_;
+		std::vector<SceneObjectPtr> sub_thread_serial_objs_;
+		std::atomic<bool> sub_thread_synced_;
+
+		float main_thread_lock_wait_;
+		float main_thread_lock_wait_accum_;
+		std::atomic<float> sub_thread_lock_wait_;
+
+		// In the pipelined mode, the objects are simulated for the next frame in the graph instead of by the update thread
+		std::atomic<bool> pipelined_frame_;
+		std::unique_ptr<FrameTaskGraph> frame_graph_;
+		float frame_app_time_;
+		float frame_elapsed_time_;
+
+		Timer frame_timer_;
+		double sub_thread_tick_time_;
+		double published_sim_time_;
+		double rendered_sim_time_;
+		float frame_latency_;
+		float frame_throughput_;
+		double throughput_window_start_;
+		uint32_t throughput_window_frames_;
+
 		bool deferred_mode_;
 	};
 }
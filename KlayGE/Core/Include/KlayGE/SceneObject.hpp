@@ -35,7 +35,9 @@ namespace KlayGE
 			SOA_Moveable = 1UL << 2,
 			SOA_Invisible = 1UL << 3,
 			SOA_NotCastShadow = 1UL << 4,
-			SOA_SSS = 1UL << 5
+			SOA_SSS = 1UL << 5,
+			// SubThreadUpdate can't run concurrently with the ones of other objects
+			SOA_SerialUpdate = 1UL << 6
 		};
 
 	public:
@@ -50,12 +52,22 @@ namespace KlayGE
 		RenderablePtr const & GetRenderable() const;
 
 		virtual void ModelMatrix(float4x4 const & mat);
+		// Returns the update side on the threads running SubThreadUpdate, and the render side elsewhere
 		virtual float4x4 const & ModelMatrix() const;
 		virtual float4x4 const & AbsModelMatrix() const;
 		virtual AABBox const & PosBoundWS() const;
 		void UpdateAbsModelMatrix();
+		// Increased each time UpdateAbsModelMatrix finds the world transform or bound changed, or the visibility is toggled
+		uint32_t TransformVersion() const;
 		void VisibleMark(BoundOverlap vm);
 		BoundOverlap VisibleMark() const;
+		// Bit i is set if the object is visible in view i of the last SceneManager::ClipViews
+		void ViewMask(uint32_t mask);
+		uint32_t ViewMask() const;
+
+		// Low-poly proxy rasterized by the CPU occlusion culling
+		void Occluder(OccluderMeshPtr const & mesh);
+		OccluderMeshPtr const & Occluder() const;
 
 		virtual void OnAttachRenderable(bool add_to_scene);
 
@@ -67,8 +79,15 @@ namespace KlayGE
 		void BindSubThreadUpdateFunc(std::function<void(SceneObject&, float, float)> const & update_func);
 		void BindMainThreadUpdateFunc(std::function<void(SceneObject&, float, float)> const & update_func);
 
+		// SubThreadUpdate runs on worker threads concurrently with the ones of other objects, and with rendering. It only
+		// writes the update side of the state, and reads no state of the main thread other than the copies taken by
+		// SyncSubThreadState. That publishes the update side to the render side while no update is running.
 		virtual void SubThreadUpdate(float app_time, float elapsed_time);
 		virtual bool MainThreadUpdate(float app_time, float elapsed_time);
+		virtual void SyncSubThreadState();
+		// Set by SceneManager on the threads running SubThreadUpdate
+		static void SubThreadUpdating(bool updating);
+		static bool SubThreadUpdating();
 
 		uint32_t Attrib() const;
 		bool Visible() const;
@@ -76,6 +95,8 @@ namespace KlayGE
 
 		vertex_elements_type const & InstanceFormat() const;
 		virtual void const * InstanceData() const;
+		// The copy of InstanceData published at the last SyncSubThreadState
+		void const * RenderInstanceData() const;
 
 		// For select mode
 		virtual void ObjectID(uint32_t id);
@@ -102,10 +123,20 @@ namespace KlayGE
 		bool renderable_hw_res_ready_;
 		vertex_elements_type instance_format_;
 
+		// Update side, written by SubThreadUpdate
 		float4x4 model_;
+		// Render side. A model matrix set out of SubThreadUpdate goes here, and to the update side at the next sync.
+		float4x4 render_model_;
+		// Order of the last write of each side, for the sync to keep the later one
+		uint64_t model_seq_;
+		uint64_t render_model_seq_;
+		std::vector<uint8_t> render_instance_data_;
 		float4x4 abs_model_;
 		std::unique_ptr<AABBox> pos_aabb_ws_;
+		uint32_t transform_version_;
 		BoundOverlap visible_mark_;
+		uint32_t view_mask_;
+		OccluderMeshPtr occluder_;
 
 		std::function<void(SceneObject&, float, float)> sub_thread_update_func_;
 		std::function<void(SceneObject&, float, float)> main_thread_update_func_;
@@ -85,7 +85,7 @@ namespace KlayGE
 		SceneObjectCameraProxy(CameraPtr const & camera,
 			std::function<StaticMeshPtr(RenderModelPtr const &, std::wstring const &)> CreateMeshFactoryFunc);
 
-		virtual void SubThreadUpdate(float app_time, float elapsed_time) override;
+		virtual bool MainThreadUpdate(float app_time, float elapsed_time) override;
 
 		void Scaling(float x, float y, float z);
 		void Scaling(float3 const & s);
@@ -0,0 +1,109 @@
+/**
+ * @file SceneQuery.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _SCENEQUERY_HPP
+#define _SCENEQUERY_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/Sphere.hpp>
+#include <KFL/Frustum.hpp>
+
+#include <functional>
+#include <vector>
+
+namespace KlayGE
+{
+	// dir has to be normalized, dist is measured along it
+	struct SceneRay
+	{
+		float3 origin;
+		float3 dir;
+		float max_dist;
+	};
+
+	// obj is null if the ray hits nothing
+	struct SceneRayHit
+	{
+		SceneObjectPtr obj;
+		float dist;
+	};
+
+	// Returns false to skip an object. An empty filter accepts all.
+	typedef std::function<bool(SceneObject const & obj)> SceneQueryFilter;
+
+	// World space bounds of the scene objects frozen at one point of time. It's never changed after construction,
+	// so worker threads could query it while the main thread goes on updating the scene.
+	class KLAYGE_CORE_API SceneQuerySnapshot : boost::noncopyable
+	{
+	public:
+		explicit SceneQuerySnapshot(std::vector<SceneObjectPtr> const & scene_objs);
+		virtual ~SceneQuerySnapshot();
+
+		SceneRayHit RayCast(float3 const & origin, float3 const & dir, float max_dist,
+			SceneQueryFilter const & filter) const;
+		// Rays are traversed together, sharing the node and object tests
+		void RayCast(std::vector<SceneRay> const & rays, SceneQueryFilter const & filter,
+			std::vector<SceneRayHit>& hits) const;
+
+		void QueryAABB(AABBox const & aabb, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
+		void QuerySphere(Sphere const & sphere, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
+		void QueryFrustum(Frustum const & frustum, SceneQueryFilter const & filter, std::vector<SceneObjectPtr>& objs) const;
+
+	protected:
+		struct Entry
+		{
+			SceneObjectPtr obj;
+			AABBox aabb;
+		};
+
+		typedef std::function<BoundOverlap(AABBox const & aabb)> BoundTest;
+
+		// The default versions test every entry. Spatial structures override them to skip the entries they can.
+		virtual void DoRayCast(SceneRay const * rays, uint32_t num_rays, SceneQueryFilter const & filter,
+			SceneRayHit* hits) const;
+		virtual void DoQuery(BoundTest const & test, SceneQueryFilter const & filter,
+			std::vector<SceneObjectPtr>& objs) const;
+
+		// Updates the hits of the rays in ray_indices with one entry
+		void RayCastEntry(Entry const & entry, SceneRay const * rays, uint32_t const * ray_indices, uint32_t num_indices,
+			SceneQueryFilter const & filter, SceneRayHit* hits) const;
+
+		// Distance along the ray to the box, or a negative number if they don't intersect within max_dist
+		static float RayAABBDistance(SceneRay const & ray, AABBox const & aabb);
+
+	protected:
+		std::vector<Entry> entries_;
+	};
+}
+
+#endif		// _SCENEQUERY_HPP
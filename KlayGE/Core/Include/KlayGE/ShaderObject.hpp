@@ -147,6 +147,12 @@ namespace KlayGE
 			return cs_block_size_z_;
 		}
 
+		// Identifies the effect, technique and pass in the pipeline cache. Set before LinkShaders.
+		void PipelineKey(uint64_t key)
+		{
+			pipeline_key_ = key;
+		}
+
 	protected:
 		std::vector<uint8_t> CompileToDXBC(ShaderType type, RenderEffect const & effect,
 			RenderTechnique const & tech, RenderPass const & pass,
@@ -162,6 +168,7 @@ namespace KlayGE
 		bool has_discard_;
 		bool has_tessellation_;
 		uint32_t cs_block_size_x_, cs_block_size_y_, cs_block_size_z_;
+		uint64_t pipeline_key_;
 	};
 }
 
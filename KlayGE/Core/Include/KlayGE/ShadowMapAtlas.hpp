@@ -0,0 +1,127 @@
+/**
+ * @file ShadowMapAtlas.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _SHADOWMAPATLAS_HPP
+#define _SHADOWMAPATLAS_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace KlayGE
+{
+	// Places the shadow maps of the lights in square tiles of one texture. The tiles are nodes of a quadtree, so a
+	// freed tile merges back with its siblings. A light keeps its tile across frames, and the map in it could be
+	// reused as long as the light renders with the same seed.
+	class KLAYGE_CORE_API ShadowMapAtlas : boost::noncopyable
+	{
+	public:
+		ShadowMapAtlas(uint32_t size, uint32_t min_tile_size);
+
+		uint32_t Size() const
+		{
+			return size_;
+		}
+		uint32_t MinTileSize() const
+		{
+			return min_tile_size_;
+		}
+
+		// Tiles not requested in the last frame could be evicted for the requests of this one
+		void BeginFrame();
+
+		// Finds a tile for a light, about tile_size in size. It falls back to smaller tiles when the atlas is full, and
+		// returns false if nothing fits. A seed of 0 means the map always needs rendering. Otherwise cached is true if the
+		// tile holds the map rendered with the same seed.
+		bool Request(void const * key, uint32_t tile_size, size_t seed, uint4& rect, bool& cached);
+		// The map in the tile is gone, for example after a device reset
+		void Invalidate(void const * key);
+		void Release(void const * key);
+		void Clear();
+
+		uint32_t NumTiles() const
+		{
+			return static_cast<uint32_t>(entries_.size());
+		}
+		// Transforms [0, 1] texture coordinates of a map to its tile
+		float4 ScaleBias(uint4 const & rect) const;
+
+	private:
+		enum NodeState
+		{
+			NS_Free,
+			NS_Used,
+			NS_Split,
+			NS_Recycled
+		};
+
+		struct Node
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t size;
+			uint32_t level;
+			int32_t parent;
+			int32_t first_child;
+			NodeState state;
+		};
+
+		struct Entry
+		{
+			int32_t node;
+			size_t seed;
+			uint32_t last_frame;
+		};
+
+		uint32_t Level(uint32_t tile_size) const;
+		int32_t AllocateNode(uint32_t level);
+		void FreeNode(int32_t node);
+		void RemoveFree(int32_t node);
+		bool EvictOldest();
+
+	private:
+		uint32_t size_;
+		uint32_t min_tile_size_;
+		uint32_t num_levels_;
+		uint32_t frame_;
+
+		std::vector<Node> nodes_;
+		std::vector<std::vector<int32_t>> free_nodes_;
+		std::vector<int32_t> recycled_children_;
+
+		std::unordered_map<void const *, Entry> entries_;
+	};
+}
+
+#endif		// _SHADOWMAPATLAS_HPP
@@ -35,6 +35,8 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <list>
 
@@ -77,16 +79,32 @@ namespace KlayGE
 			BF_Index
 		};
 
+		enum AllocMode
+		{
+			// First fit from a free list. The buffer grows when it's full. Main thread only.
+			AM_FreeList,
+			// Bump allocation from a ring, reclaimed by frame fences. Alloc could be called from any thread, with no
+			// lock. Each thread grabs a sub-block with an atomic bump and fills it, without touching the shared head.
+			// When the ring is full, Alloc bumps into a reserve after it, and EnsureDataReady grows the ring on the
+			// owning thread. An alloc that overruns the reserve as well gets a length of 0.
+			AM_Ring
+		};
+
 	public:
-		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag);
+		// In ring mode, every offset is a multiple of stride, so offset_ / stride is a base vertex
+		TransientBuffer(uint32_t size_in_byte, BindFlag bind_flag, AllocMode mode = AM_FreeList, uint32_t stride = 1);
 
 		// Allocate a sub space from transient buffer
 		SubAlloc Alloc(uint32_t size_in_byte, void const * data);
 		// Knowtify transient buffer that this alloc is unused and will be freed at the end of the frame.
+		// Ring allocs are freed by frame fences, so it does nothing in ring mode.
 		void Dealloc(SubAlloc const & alloc);
+		// Must not run concurrently with Alloc. In ring mode, the sub-blocks handed out so far are retired.
 		void EnsureDataReady();
-		// Do with retired frames
+		// Do with retired frames. In ring mode, it could run concurrently with Alloc.
 		void OnPresent();
+		// Same as above, with frame_id in place of the frame count of the app
+		void OnPresent(uint32_t frame_id);
 
 		GraphicsBufferPtr const & GetBuffer() const
 		{
@@ -98,7 +116,19 @@ namespace KlayGE
 		// Free the sub alloc and return the space allocated back to transient buffer.
 		void DoFree(SubAlloc const & alloc);
 
+		SubAlloc RingAlloc(uint32_t size_in_byte, void const * data);
+		// Moves the head forward by size without wrapping inside the range. Returns false if the ring is full.
+		bool RingGrab(uint64_t size, uint64_t& start);
+		void RingUpload();
+		void RingOnPresent(uint32_t frame_id);
+		// Makes room for a frame that needed reserve_used bytes more than the ring
+		void RingGrow(uint64_t reserve_used);
+		uint64_t RingReserveSize(uint64_t ring_size) const;
+
 	private:
+		static uint32_t const MAX_FRAMES_IN_FLIGHT = 4;
+
+		AllocMode mode_;
 		bool use_no_overwrite_;
 		uint32_t num_pre_frames_;
 
@@ -110,6 +140,21 @@ namespace KlayGE
 		std::vector<uint8_t> simulate_buffer_;
 		uint32_t valid_min_;
 		uint32_t valid_max_;
+
+		// Ring positions only move forward. The byte in the buffer is at position % ring_size_. The reserve is after
+		// the ring, and only holds the allocs of the current frame. Alloc only changes the atomics, the rest is changed
+		// by EnsureDataReady and OnPresent.
+		uint32_t ring_id_;
+		uint32_t stride_;
+		uint32_t block_size_;
+		uint64_t ring_size_;
+		uint64_t reserve_size_;
+		std::atomic<uint64_t> head_;
+		std::atomic<uint64_t> tail_;
+		std::atomic<uint64_t> reserve_head_;
+		uint64_t uploaded_;
+		std::atomic<uint32_t> epoch_;
+		std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frame_fences_;
 	};
 }
 
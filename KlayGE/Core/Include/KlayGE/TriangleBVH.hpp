@@ -0,0 +1,108 @@
+/**
+ * @file TriangleBVH.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef _TRIANGLEBVH_HPP
+#define _TRIANGLEBVH_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/AlignedAllocator.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Bounding volume hierarchy over the triangles of a mesh, in model space
+	class KLAYGE_CORE_API TriangleBVH
+	{
+		// Up to 4 triangles of a leaf in SoA layout, tested together. Unused lanes are degenerated.
+		struct TrianglePacket
+		{
+			float v0[3][4];
+			float e1[3][4];
+			float e2[3][4];
+		};
+
+		struct Node
+		{
+			AABBox bb;
+			// Leaf: index of its packet. Inner: index of the second child, the first one follows the node.
+			uint32_t first;
+			// Number of triangles in a leaf, 0 for inner nodes
+			uint32_t count;
+		};
+
+	public:
+		TriangleBVH(std::vector<float3> positions, std::vector<uint32_t> indices);
+
+		uint32_t NumTriangles() const
+		{
+			return static_cast<uint32_t>(indices_.size() / 3);
+		}
+		std::vector<float3> const & Positions() const
+		{
+			return positions_;
+		}
+		std::vector<uint32_t> const & Indices() const
+		{
+			return indices_;
+		}
+		AABBox const & Bound() const
+		{
+			return bb_;
+		}
+
+		// Moves the vertices, such as to a skinned pose, and updates the bounds without changing the tree
+		void Refit(std::vector<float3> const & positions);
+
+		// dir has to be normalized. Returns the closest hit within max_dist.
+		bool RayCast(float3 const & origin, float3 const & dir, float max_dist, float& dist, uint32_t& triangle) const;
+
+	private:
+		uint32_t BuildNode(std::vector<uint32_t>& tris, uint32_t begin, uint32_t end,
+			std::vector<float3> const & centroids);
+		void FillPacket(uint32_t packet);
+		void RefitNodes();
+
+	private:
+		std::vector<float3> positions_;
+		std::vector<uint32_t> indices_;
+
+		AABBox bb_;
+		std::vector<Node> nodes_;
+		// 4 triangle indices per packet, ~0 for unused lanes
+		std::vector<uint32_t> packet_tris_;
+		std::vector<TrianglePacket, aligned_allocator<TrianglePacket, 16>> packets_;
+	};
+}
+
+#endif		// _TRIANGLEBVH_HPP
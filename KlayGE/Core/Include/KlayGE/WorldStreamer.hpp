@@ -0,0 +1,174 @@
+/**
+ * @file WorldStreamer.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _WORLDSTREAMER_HPP
+#define _WORLDSTREAMER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace KlayGE
+{
+	// Splits a world into square cells on the xz plane, and keeps only the cells around the camera resident. Cells are
+	// loaded nearest first, measured from the camera and from where its velocity takes it, so the cells ahead are
+	// requested early. A cell is unloaded only when it's beyond the unload radius, which is larger than the load radius
+	// to avoid thrashing on the border, or when a nearer cell needs its memory.
+	class KLAYGE_CORE_API WorldStreamer : boost::noncopyable
+	{
+	public:
+		enum CellState
+		{
+			CS_Unloaded,
+			CS_Loading,
+			CS_Loaded
+		};
+
+		struct CellObject
+		{
+			std::string meshml;
+			float4x4 model;
+			uint32_t attrib;
+		};
+
+		struct Cell
+		{
+			int2 coord;
+			float2 center;
+
+			// The dependency list. A cell is loaded when all of them are ready.
+			std::vector<CellObject> objects;
+			std::vector<std::string> models;
+			std::vector<std::string> textures;
+			uint64_t memory_size;
+
+			CellState state;
+			float distance;
+
+			std::vector<RenderModelPtr> loaded_models;
+			std::vector<TexturePtr> loaded_textures;
+			std::vector<SceneObjectPtr> scene_objs;
+		};
+
+	public:
+		WorldStreamer(float cell_size, float load_radius, float unload_radius, uint64_t memory_budget);
+		virtual ~WorldStreamer();
+
+		// Goes to the cell containing the translation of the model matrix
+		void AddObject(std::string const & meshml, float4x4 const & model, uint32_t attrib);
+		void AddTexture(float3 const & pos, std::string const & tex_name);
+
+		// Called once a frame. Activates the cells whose dependencies are ready, unloads the ones out of range, and
+		// starts loading the ones in range.
+		void Update(float3 const & eye_pos, float3 const & velocity);
+		void UnloadAll();
+
+		// Seconds of camera movement to look ahead
+		void Lookahead(float seconds)
+		{
+			lookahead_ = seconds;
+		}
+		float Lookahead() const
+		{
+			return lookahead_;
+		}
+
+		// Cells waiting for their resources at the same time
+		void MaxLoadingCells(uint32_t num)
+		{
+			max_loading_cells_ = num;
+		}
+		uint32_t MaxLoadingCells() const
+		{
+			return max_loading_cells_;
+		}
+
+		float CellSize() const
+		{
+			return cell_size_;
+		}
+		uint64_t MemoryBudget() const
+		{
+			return memory_budget_;
+		}
+		// Memory of the cells loading or loaded
+		uint64_t MemoryUsage() const
+		{
+			return memory_usage_;
+		}
+
+		uint32_t NumCells() const
+		{
+			return static_cast<uint32_t>(cells_.size());
+		}
+		Cell const & GetCell(uint32_t index) const
+		{
+			return cells_[index];
+		}
+		uint32_t NumCells(CellState state) const;
+
+	protected:
+		// Bytes a resource takes when loaded. The default one uses the file size.
+		virtual uint64_t EstimateMemorySize(std::string const & res_name);
+
+		// Requests the dependencies asynchronously, polls them, and moves the objects in and out of the scene
+		virtual void LoadCell(Cell& cell);
+		virtual bool CellReady(Cell const & cell);
+		virtual void ActivateCell(Cell& cell);
+		virtual void UnloadCell(Cell& cell);
+
+	private:
+		Cell& CellAt(float3 const & pos);
+		uint64_t ResourceSize(std::string const & res_name);
+		void Unload(Cell& cell);
+
+	private:
+		float cell_size_;
+		float load_radius_;
+		float unload_radius_;
+		uint64_t memory_budget_;
+		float lookahead_;
+		uint32_t max_loading_cells_;
+
+		std::vector<Cell> cells_;
+		std::unordered_map<uint64_t, uint32_t> cell_map_;
+		std::unordered_map<std::string, uint64_t> res_sizes_;
+
+		uint64_t memory_usage_;
+		std::vector<uint32_t> sorted_cells_;
+	};
+}
+
+#endif		// _WORLDSTREAMER_HPP
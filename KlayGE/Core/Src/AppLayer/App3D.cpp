@@ -29,6 +29,7 @@
 #include <KFL/Util.hpp>
 #include <KFL/ThrowErr.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/FrameArena.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/RenderEngine.hpp>
@@ -778,6 +779,9 @@ namespace KlayGE
 	{
 		if (0 == pass)
 		{
+			// Frame boundary of the main thread, all per-frame scratch data from last frame is dead here
+			FrameArena::ThreadInstance().Reset();
+
 			this->UpdateStats();
 			this->DoUpdateOverlay();
 
@@ -252,6 +252,10 @@ namespace KlayGE
 		std::vector<std::pair<std::string, std::string>> graphics_options;
 		bool perf_profiler = false;
 		bool location_sensor = false;
+		bool occlusion_culling = false;
+		bool mesh_bvh = false;
+		bool pipelined_frame = false;
+		bool parallel_draw_recording = false;
 
 		std::string rf_name = "D3D11";
 		std::string af_name = "OpenAL";
@@ -324,6 +328,30 @@ namespace KlayGE
 				location_sensor = location_sensor_node->Attrib("enabled")->ValueInt() ? true : false;
 			}
 
+			XMLNodePtr occlusion_culling_node = context_node->FirstNode("occlusion_culling");
+			if (occlusion_culling_node)
+			{
+				occlusion_culling = occlusion_culling_node->Attrib("enabled")->ValueInt() ? true : false;
+			}
+
+			XMLNodePtr mesh_bvh_node = context_node->FirstNode("mesh_bvh");
+			if (mesh_bvh_node)
+			{
+				mesh_bvh = mesh_bvh_node->Attrib("enabled")->ValueInt() ? true : false;
+			}
+
+			XMLNodePtr pipelined_frame_node = context_node->FirstNode("pipelined_frame");
+			if (pipelined_frame_node)
+			{
+				pipelined_frame = pipelined_frame_node->Attrib("enabled")->ValueInt() ? true : false;
+			}
+
+			XMLNodePtr parallel_draw_recording_node = context_node->FirstNode("parallel_draw_recording");
+			if (parallel_draw_recording_node)
+			{
+				parallel_draw_recording = parallel_draw_recording_node->Attrib("enabled")->ValueInt() ? true : false;
+			}
+
 			XMLNodePtr frame_node = graphics_node->FirstNode("frame");
 			XMLAttributePtr attr;
 			attr = frame_node->Attrib("width");
@@ -618,6 +646,10 @@ namespace KlayGE
 		cfg_.deferred_rendering = false;
 		cfg_.perf_profiler = perf_profiler;
 		cfg_.location_sensor = location_sensor;
+		cfg_.occlusion_culling = occlusion_culling;
+		cfg_.mesh_bvh = mesh_bvh;
+		cfg_.pipelined_frame = pipelined_frame;
+		cfg_.parallel_draw_recording = parallel_draw_recording;
 	}
 
 	void Context::SaveCfg(std::string const & cfg_file)
@@ -663,6 +695,22 @@ namespace KlayGE
 			XMLNodePtr location_sensor_node = cfg_doc.AllocNode(XNT_Element, "location_sensor");
 			location_sensor_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.location_sensor));
 			context_node->AppendNode(location_sensor_node);
+
+			XMLNodePtr occlusion_culling_node = cfg_doc.AllocNode(XNT_Element, "occlusion_culling");
+			occlusion_culling_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.occlusion_culling));
+			context_node->AppendNode(occlusion_culling_node);
+
+			XMLNodePtr mesh_bvh_node = cfg_doc.AllocNode(XNT_Element, "mesh_bvh");
+			mesh_bvh_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.mesh_bvh));
+			context_node->AppendNode(mesh_bvh_node);
+
+			XMLNodePtr pipelined_frame_node = cfg_doc.AllocNode(XNT_Element, "pipelined_frame");
+			pipelined_frame_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.pipelined_frame));
+			context_node->AppendNode(pipelined_frame_node);
+
+			XMLNodePtr parallel_draw_recording_node = cfg_doc.AllocNode(XNT_Element, "parallel_draw_recording");
+			parallel_draw_recording_node->AppendAttrib(cfg_doc.AllocAttribInt("enabled", cfg_.parallel_draw_recording));
+			context_node->AppendNode(parallel_draw_recording_node);
 		}
 		root->AppendNode(context_node);
 
@@ -0,0 +1,154 @@
+/**
+ * @file FrameTaskGraph.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+
+#include <boost/assert.hpp>
+
+#include <KlayGE/FrameTaskGraph.hpp>
+
+namespace KlayGE
+{
+	FrameTaskGraph::FrameTaskGraph(thread_pool& tp)
+		: tp_(tp), num_finished_(0)
+	{
+	}
+
+	uint32_t FrameTaskGraph::AddTask(std::function<void()> const & func, TaskAffinity affinity,
+		std::vector<uint32_t> const & deps)
+	{
+		uint32_t const index = static_cast<uint32_t>(tasks_.size());
+		for (auto dep : deps)
+		{
+			BOOST_ASSERT(dep < index);
+			tasks_[dep].successors.push_back(index);
+		}
+
+		Task task;
+		task.func = func;
+		task.affinity = affinity;
+		task.num_deps = static_cast<uint32_t>(deps.size());
+		task.time = 0;
+		tasks_.push_back(task);
+
+		return index;
+	}
+
+	void FrameTaskGraph::Clear()
+	{
+		tasks_.clear();
+	}
+
+	void FrameTaskGraph::Run()
+	{
+		uint32_t const num_tasks = static_cast<uint32_t>(tasks_.size());
+
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		num_finished_ = 0;
+		main_thread_queue_.clear();
+		remaining_deps_.resize(num_tasks);
+		for (uint32_t i = 0; i < num_tasks; ++ i)
+		{
+			remaining_deps_[i] = tasks_[i].num_deps;
+		}
+		for (uint32_t i = 0; i < num_tasks; ++ i)
+		{
+			if (0 == tasks_[i].num_deps)
+			{
+				this->Schedule(i);
+			}
+		}
+
+		while (num_finished_ < num_tasks)
+		{
+			if (main_thread_queue_.empty())
+			{
+				finished_cond_.wait(lock);
+			}
+			else
+			{
+				uint32_t const task = main_thread_queue_.back();
+				main_thread_queue_.pop_back();
+
+				lock.unlock();
+				this->Execute(task);
+				lock.lock();
+			}
+		}
+
+		// All the workers are done here, joining only releases them
+		std::vector<joiner<void>> joiners;
+		joiners.swap(joiners_);
+		lock.unlock();
+		for (auto& j : joiners)
+		{
+			j();
+		}
+	}
+
+	double FrameTaskGraph::TaskTime(uint32_t task) const
+	{
+		BOOST_ASSERT(task < tasks_.size());
+		return tasks_[task].time;
+	}
+
+	void FrameTaskGraph::Schedule(uint32_t task)
+	{
+		if (TA_MainThread == tasks_[task].affinity)
+		{
+			main_thread_queue_.push_back(task);
+		}
+		else
+		{
+			joiners_.push_back(tp_(std::bind(&FrameTaskGraph::Execute, this, task)));
+		}
+	}
+
+	void FrameTaskGraph::Execute(uint32_t task)
+	{
+		Timer timer;
+		tasks_[task].func();
+		tasks_[task].time = timer.elapsed();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (auto succ : tasks_[task].successors)
+		{
+			-- remaining_deps_[succ];
+			if (0 == remaining_deps_[succ])
+			{
+				this->Schedule(succ);
+			}
+		}
+		++ num_finished_;
+		finished_cond_.notify_one();
+	}
+}
@@ -0,0 +1,85 @@
+/**
+ * @file BindingCache.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+#include <KlayGE/BindingCache.hpp>
+
+namespace KlayGE
+{
+	BindingCache::BindingCache()
+	{
+		num_issued_.fill(0);
+		num_skipped_.fill(0);
+	}
+
+	void BindingCache::Invalidate()
+	{
+		for (uint32_t type = 0; type < BT_NumBindingTypes; ++ type)
+		{
+			for (uint32_t stage = 0; stage < MAX_STAGES; ++ stage)
+			{
+				this->Invalidate(static_cast<BindingType>(type), stage);
+			}
+		}
+	}
+
+	void BindingCache::Invalidate(BindingType type, uint32_t stage)
+	{
+		BOOST_ASSERT(type < BT_NumBindingTypes);
+		BOOST_ASSERT(stage < MAX_STAGES);
+
+		auto& slots = slots_[type][stage];
+		std::fill(slots.begin(), slots.end(), this->Unknown());
+	}
+
+	uint32_t BindingCache::NumIssued() const
+	{
+		return std::accumulate(num_issued_.begin(), num_issued_.end(), 0U);
+	}
+
+	uint32_t BindingCache::NumSkipped() const
+	{
+		return std::accumulate(num_skipped_.begin(), num_skipped_.end(), 0U);
+	}
+
+	void BindingCache::ResetNumIssued()
+	{
+		num_issued_.fill(0);
+	}
+
+	void BindingCache::ResetNumSkipped()
+	{
+		num_skipped_.fill(0);
+	}
+}
@@ -38,9 +38,38 @@
 #include <KlayGE/PostProcess.hpp>
 
 #include <algorithm>
+#include <limits>
 
 #include <KlayGE/CascadedShadowLayer.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Fitted sizes are rounded up to 1/CASCADE_SIZE_STEPS of the light's texture space
+	float const CASCADE_SIZE_STEPS = 64;
+
+	AABBox const & UnboundedBox()
+	{
+		float const f_max = std::numeric_limits<float>::max();
+		static AABBox const box(float3(-f_max, -f_max, -f_max), float3(+f_max, +f_max, +f_max));
+		return box;
+	}
+
+	// Rounds the size up to a step, and the corner down to a texel of a grid through the world origin. A slightly
+	// different fitting ends up in the same cascade, so the shadow doesn't shimmer.
+	void SnapToTexels(AABBox& aabb, float2 const & origin, uint32_t sm_size)
+	{
+		for (int i = 0; i < 2; ++ i)
+		{
+			float const size = std::ceil((aabb.Max()[i] - aabb.Min()[i]) * CASCADE_SIZE_STEPS) / CASCADE_SIZE_STEPS;
+			float const texel = size / (sm_size - 1);
+			aabb.Min()[i] = origin[i] + std::floor((aabb.Min()[i] - origin[i]) / texel) * texel;
+			aabb.Max()[i] = aabb.Min()[i] + texel * sm_size;
+		}
+	}
+}
+
 namespace KlayGE
 {
 	AABBox CalcFrustumExtents(Camera const & camera, float near_z, float far_z, float4x4 const & light_view_proj)
@@ -86,6 +115,7 @@ namespace KlayGE
 		scales_.resize(num_cascades);
 		biases_.resize(num_cascades);
 		crop_mats_.resize(num_cascades);
+		receiver_bounds_.resize(num_cascades, UnboundedBox());
 	}
 
 	std::vector<float2> const & CascadedShadowLayer::CascadeIntervals() const
@@ -109,6 +139,17 @@ namespace KlayGE
 		return crop_mats_[index];
 	}
 
+	void CascadedShadowLayer::Receivers(std::vector<AABBox> const & receivers_ws)
+	{
+		receivers_ws_ = receivers_ws;
+	}
+
+	AABBox const & CascadedShadowLayer::CascadeReceiverBounds(uint32_t index) const
+	{
+		BOOST_ASSERT(index < receiver_bounds_.size());
+		return receiver_bounds_[index];
+	}
+
 	void CascadedShadowLayer::UpdateCropMats()
 	{
 		for (size_t i = 0; i < intervals_.size(); ++ i)
@@ -124,7 +165,7 @@ namespace KlayGE
 
 
 	PSSMCascadedShadowLayer::PSSMCascadedShadowLayer()
-		: lambda_(0.8f)
+		: lambda_(0.8f), sm_size_(0)
 	{
 	}
 
@@ -133,6 +174,12 @@ namespace KlayGE
 		lambda_ = lambda;
 	}
 
+	void PSSMCascadedShadowLayer::ShadowMapSize(uint32_t size)
+	{
+		BOOST_ASSERT(size != 1);
+		sm_size_ = size;
+	}
+
 	void PSSMCascadedShadowLayer::UpdateCascades(Camera const & camera, float4x4 const & light_view_proj,
 			float3 const & light_space_border)
 	{
@@ -149,6 +196,18 @@ namespace KlayGE
 		}
 		distances[intervals_.size()] = camera.FarPlane();
 
+		std::vector<float2> receiver_depths(receivers_ws_.size());
+		std::vector<AABBox> receivers_ls(receivers_ws_.size());
+		for (size_t i = 0; i < receivers_ws_.size(); ++ i)
+		{
+			AABBox const aabb_vs = MathLib::transform_aabb(receivers_ws_[i], camera.ViewMatrix());
+			receiver_depths[i] = float2(aabb_vs.Min().z(), aabb_vs.Max().z());
+			receivers_ls[i] = MathLib::transform_aabb(receivers_ws_[i], light_view_proj);
+		}
+
+		float3 const origin_ls = MathLib::transform_coord(float3(0, 0, 0), light_view_proj);
+		float2 const origin_ts(+origin_ls.x() * 0.5f + 0.5f, -origin_ls.y() * 0.5f + 0.5f);
+
 		for (size_t i = 0; i < intervals_.size(); ++ i)
 		{
 			AABBox aabb = CalcFrustumExtents(camera, distances[i], distances[i + 1],
@@ -156,6 +215,39 @@ namespace KlayGE
 
 			aabb &= AABBox(float3(-1, -1, -1), float3(+1, +1, +1));
 
+			if (receivers_ws_.empty())
+			{
+				receiver_bounds_[i] = UnboundedBox();
+			}
+			else
+			{
+				float const f_max = std::numeric_limits<float>::max();
+				AABBox receiver_bb(float3(+f_max, +f_max, +f_max), float3(-f_max, -f_max, -f_max));
+				for (size_t j = 0; j < receivers_ws_.size(); ++ j)
+				{
+					if ((receiver_depths[j].x() <= distances[i + 1]) && (receiver_depths[j].y() >= distances[i]))
+					{
+						receiver_bb |= receivers_ls[j];
+					}
+				}
+
+				// Only fits x and y. The casters between the light and the receivers have to stay in the z range.
+				float2 const fit_min(std::max(aabb.Min().x(), receiver_bb.Min().x()),
+					std::max(aabb.Min().y(), receiver_bb.Min().y()));
+				float2 const fit_max(std::min(aabb.Max().x(), receiver_bb.Max().x()),
+					std::min(aabb.Max().y(), receiver_bb.Max().y()));
+				if ((fit_min.x() < fit_max.x()) && (fit_min.y() < fit_max.y()))
+				{
+					aabb.Min().x() = fit_min.x();
+					aabb.Min().y() = fit_min.y();
+					aabb.Max().x() = fit_max.x();
+					aabb.Max().y() = fit_max.y();
+				}
+
+				receiver_bb.Min().z() = -f_max;
+				receiver_bounds_[i] = receiver_bb;
+			}
+
 			aabb.Min() -= light_space_border;
 			aabb.Max() += light_space_border;
 
@@ -166,6 +258,11 @@ namespace KlayGE
 
 			std::swap(aabb.Min().y(), aabb.Max().y());
 
+			if (sm_size_ > 0)
+			{
+				SnapToTexels(aabb, origin_ts, sm_size_);
+			}
+
 			float3 const scale = float3(1.0f, 1.0f, 1.0f) / (aabb.Max() - aabb.Min());
 			float3 const bias = -aabb.Min() * scale;
 
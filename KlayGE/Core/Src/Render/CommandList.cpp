@@ -0,0 +1,217 @@
+/**
+ * @file CommandList.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/RenderEngine.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/assert.hpp>
+
+#include <KlayGE/CommandList.hpp>
+
+namespace KlayGE
+{
+	CommandList::CommandList()
+		: last_effect_(nullptr)
+	{
+	}
+
+	void CommandList::Reset()
+	{
+		packets_.resize(0);
+		snapshots_.resize(0);
+		snapshot_data_.resize(0);
+		last_effect_ = nullptr;
+	}
+
+	void CommandList::Draw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & layout)
+	{
+		// The later draws of an effect overwrite the CPU copies before this one is replayed, so its first draw
+		// captures all the cbuffers, not only the dirty ones
+		bool const first = (&effect != last_effect_);
+		for (uint32_t i = 0; i < effect.NumCBuffers(); ++ i)
+		{
+			this->CaptureCBuffer(*effect.CBufferByIndex(i), first);
+		}
+		last_effect_ = &effect;
+
+		uint32_t const first_snapshot = packets_.empty() ? 0 : packets_.back().first_snapshot + packets_.back().num_snapshots;
+
+		CommandPacket packet;
+		packet.effect = &effect;
+		packet.tech = &tech;
+		packet.layout = &layout;
+		packet.first_snapshot = first_snapshot;
+		packet.num_snapshots = static_cast<uint32_t>(snapshots_.size()) - first_snapshot;
+		packets_.push_back(packet);
+	}
+
+	void CommandList::CaptureCBuffer(RenderEffectConstantBuffer& cbuff, bool force)
+	{
+		uint32_t const size = cbuff.Size();
+		if ((size > 0) && (force || cbuff.Dirty()))
+		{
+			CBufferSnapshot snapshot;
+			snapshot.cbuff = &cbuff;
+			snapshot.offset = static_cast<uint32_t>(snapshot_data_.size());
+			snapshot.size = size;
+			// Relative to the previous capture, which is what the device holds when this one is replayed
+			snapshot.dirty_begin = cbuff.DirtyBegin();
+			snapshot.dirty_end = cbuff.DirtyEnd();
+			snapshots_.push_back(snapshot);
+
+			RenderEffectConstantBuffer const & const_cbuff = cbuff;
+			uint8_t const * src = const_cbuff.VariableInBuff<uint8_t>(0);
+			snapshot_data_.insert(snapshot_data_.end(), src, src + size);
+
+			cbuff.Dirty(false);
+		}
+	}
+
+	CommandPacket const & CommandList::Packet(uint32_t index) const
+	{
+		BOOST_ASSERT(index < packets_.size());
+		return packets_[index];
+	}
+
+	void CommandList::Execute(std::function<void(CommandPacket const &)> const & draw) const
+	{
+		for (auto const & packet : packets_)
+		{
+			for (uint32_t i = 0; i < packet.num_snapshots; ++ i)
+			{
+				CBufferSnapshot const & snapshot = snapshots_[packet.first_snapshot + i];
+				BOOST_ASSERT(snapshot.size == snapshot.cbuff->Size());
+				// Writing the same bytes back would make a cloned cbuffer copy the memory shared with its source
+				RenderEffectConstantBuffer const & const_cbuff = *snapshot.cbuff;
+				if (std::memcmp(const_cbuff.VariableInBuff<uint8_t>(0), &snapshot_data_[snapshot.offset], snapshot.size) != 0)
+				{
+					std::memcpy(snapshot.cbuff->VariableInBuff<uint8_t>(0), &snapshot_data_[snapshot.offset], snapshot.size);
+				}
+				// Merged with the span already dirty, which covers the whole buffer if the memory was just copied
+				if (snapshot.dirty_begin < snapshot.dirty_end)
+				{
+					snapshot.cbuff->Dirty(snapshot.dirty_begin, snapshot.dirty_end - snapshot.dirty_begin);
+				}
+			}
+
+			draw(packet);
+		}
+	}
+
+	void CommandList::Execute(RenderEngine& re) const
+	{
+		this->Execute([&re](CommandPacket const & packet)
+			{
+				re.Render(*packet.effect, *packet.tech, *packet.layout);
+			});
+	}
+
+
+	CommandRecorder::CommandRecorder(thread_pool& tp)
+		: tp_(tp), num_lists_(0)
+	{
+	}
+
+	void CommandRecorder::Record(uint32_t num_items, uint32_t max_lists, uint32_t min_items_per_list,
+		std::function<void(CommandList&, uint32_t, uint32_t)> const & record)
+	{
+		uint32_t const num_ranges = std::max(std::min(max_lists, num_items / std::max(min_items_per_list, 1U)), 1U);
+		uint32_t const items_per_range = (num_items + num_ranges - 1) / num_ranges;
+
+		while (lists_.size() < num_ranges)
+		{
+			lists_.push_back(MakeUniquePtr<CommandList>());
+		}
+		for (uint32_t i = 0; i < num_ranges; ++ i)
+		{
+			lists_[i]->Reset();
+		}
+		num_lists_ = num_ranges;
+
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_ranges - 1);
+		for (uint32_t i = 1; i < num_ranges; ++ i)
+		{
+			uint32_t const begin = std::min(i * items_per_range, num_items);
+			uint32_t const end = std::min(begin + items_per_range, num_items);
+			if (begin < end)
+			{
+				CommandList* list = lists_[i].get();
+				joiners.push_back(tp_([list, begin, end, &record]()
+					{
+						record(*list, begin, end);
+					}));
+			}
+		}
+		record(*lists_[0], 0, std::min(items_per_range, num_items));
+
+		for (auto& j : joiners)
+		{
+			j();
+		}
+	}
+
+	CommandList const & CommandRecorder::List(uint32_t index) const
+	{
+		BOOST_ASSERT(index < num_lists_);
+		return *lists_[index];
+	}
+
+	uint32_t CommandRecorder::NumPackets() const
+	{
+		uint32_t num = 0;
+		for (uint32_t i = 0; i < num_lists_; ++ i)
+		{
+			num += lists_[i]->NumPackets();
+		}
+		return num;
+	}
+
+	void CommandRecorder::Execute(std::function<void(CommandPacket const &)> const & draw) const
+	{
+		for (uint32_t i = 0; i < num_lists_; ++ i)
+		{
+			lists_[i]->Execute(draw);
+		}
+	}
+
+	void CommandRecorder::Execute(RenderEngine& re) const
+	{
+		for (uint32_t i = 0; i < num_lists_; ++ i)
+		{
+			lists_[i]->Execute(re);
+		}
+	}
+}
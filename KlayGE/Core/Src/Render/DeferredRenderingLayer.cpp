@@ -31,6 +31,7 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Util.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Hash.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderableHelper.hpp>
@@ -49,6 +50,7 @@
 #include <KlayGE/SSRPostProcess.hpp>
 #include <KlayGE/SSSBlur.hpp>
 #include <KlayGE/PerfProfiler.hpp>
+#include <KlayGE/ShadowMapAtlas.hpp>
 
 #include <boost/lexical_cast.hpp>
 
@@ -57,6 +59,8 @@
 namespace KlayGE
 {
 	int const SM_SIZE = 512;
+	// Holds 16 full size maps, more than the shadowed spot lights of a frame
+	int const SM_ATLAS_SIZE = SM_SIZE * 4;
 	
 	int const MAX_IL_MIPMAP_LEVELS = 3;
 
@@ -71,6 +75,9 @@ namespace KlayGE
 	uint32_t const TILE_SIZE = 32;
 #endif
 
+	uint32_t const CLUSTER_TILE_SIZE = 64;
+	uint32_t const CLUSTER_SLICES = 24;
+
 	template <typename T>
 	void CreateConeMesh(std::vector<T>& vb, std::vector<uint16_t>& ib, uint16_t vertex_base, float radius, float height, uint16_t n)
 	{
@@ -400,6 +407,10 @@ namespace KlayGE
 			dr_debug_pp_(MakeSharedPtr<DeferredRenderingDebugPostProcess>()),
 			display_type_(DT_Final)
 	{
+		num_cascade_casters_tested_.fill(0);
+		num_cascade_casters_rendered_.fill(0);
+		sm_cube_seeds_.fill(std::make_pair(nullptr, 0));
+
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine& re = rf.RenderEngineInstance();
 		RenderDeviceCaps const & caps = re.DeviceCaps();
@@ -428,7 +439,10 @@ namespace KlayGE
 #endif
 			pvp.vdm_fb = rf.MakeFrameBuffer();
 			pvp.shading_fb = rf.MakeFrameBuffer();
-			pvp.shadowing_fb = rf.MakeFrameBuffer();
+			for (size_t i = 0; i < pvp.shadowing_fbs.size(); ++ i)
+			{
+				pvp.shadowing_fbs[i] = rf.MakeFrameBuffer();
+			}
 			pvp.projective_shadowing_fb = rf.MakeFrameBuffer();
 			pvp.reflection_fb = rf.MakeFrameBuffer();
 			for (size_t i = 0; i < pvp.merged_shading_fbs.size(); ++i)
@@ -627,30 +641,37 @@ namespace KlayGE
 		sm_depth_tex_ = rf.MakeTexture2D(SM_SIZE, SM_SIZE, 1, 1, EF_D24S8, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
 		RenderViewPtr sm_depth_view = rf.Make2DDepthStencilRenderView(*sm_depth_tex_, 0, 1, 0);
 		sm_fb_->Attach(FrameBuffer::ATT_DepthStencil, sm_depth_view);
+		sm_fbs_[0] = sm_fb_;
+		sm_texs_[0] = sm_tex_;
+		sm_depth_texs_[0] = sm_depth_tex_;
+		for (uint32_t i = 1; i < sm_fbs_.size(); ++ i)
+		{
+			uint32_t const size = SM_SIZE >> i;
+			sm_fbs_[i] = rf.MakeFrameBuffer();
+			sm_texs_[i] = rf.MakeTexture2D(size, size, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
+			sm_fbs_[i]->Attach(FrameBuffer::ATT_Color0, rf.Make2DRenderView(*sm_texs_[i], 0, 1, 0));
+			sm_depth_texs_[i] = rf.MakeTexture2D(size, size, 1, 1, EF_D24S8, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
+			sm_fbs_[i]->Attach(FrameBuffer::ATT_DepthStencil, rf.Make2DDepthStencilRenderView(*sm_depth_texs_[i], 0, 1, 0));
+		}
 
 		csm_fb_ = rf.MakeFrameBuffer();
 		csm_tex_ = rf.MakeTexture2D(SM_SIZE * 2, SM_SIZE * 2, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
 		csm_fb_->Attach(FrameBuffer::ATT_Color0, rf.Make2DRenderView(*csm_tex_, 0, 1, 0));
 		csm_fb_->Attach(FrameBuffer::ATT_DepthStencil, rf.Make2DDepthStencilRenderView(SM_SIZE * 2, SM_SIZE * 2, EF_D24S8, 1, 0));
 
-		for (uint32_t i = 0; i < filtered_sm_2d_texs_.size(); ++ i)
+		for (uint32_t i = 0; i < unfiltered_sm_2d_texs_.size(); ++ i)
 		{
 			unfiltered_sm_2d_texs_[i] = rf.MakeTexture2D(SM_SIZE, SM_SIZE, 1, 1, sm_tex_->Format(), 1, 0,
 				EAH_GPU_Read | EAH_GPU_Write, nullptr);
 		}
-		if (tex_array_support_)
-		{
-			filtered_sm_2d_texs_[0] = rf.MakeTexture2D(SM_SIZE, SM_SIZE, 1, static_cast<uint32_t>(filtered_sm_2d_texs_.size()),
-				sm_tex_->Format(), 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
-		}
-		else
+		for (uint32_t i = 0; i < filtered_sm_2d_texs_.size(); ++ i)
 		{
-			for (uint32_t i = 0; i < filtered_sm_2d_texs_.size(); ++ i)
-			{
-				filtered_sm_2d_texs_[i] = rf.MakeTexture2D(SM_SIZE, SM_SIZE, 1, 1, sm_tex_->Format(), 1, 0,
-					EAH_GPU_Read | EAH_GPU_Write, nullptr);
-			}
+			filtered_sm_2d_texs_[i] = rf.MakeTexture2D(SM_SIZE >> i, SM_SIZE >> i, 1, 1, sm_tex_->Format(), 1, 0,
+				EAH_GPU_Read | EAH_GPU_Write, nullptr);
 		}
+		sm_atlas_tex_ = rf.MakeTexture2D(SM_ATLAS_SIZE, SM_ATLAS_SIZE, 1, 1, sm_tex_->Format(), 1, 0,
+			EAH_GPU_Read | EAH_GPU_Write, nullptr);
+		sm_atlas_ = MakeSharedPtr<ShadowMapAtlas>(SM_ATLAS_SIZE, SM_SIZE >> (NUM_SM_LEVELS - 1));
 		for (uint32_t i = 0; i < filtered_sm_cube_texs_.size(); ++ i)
 		{
 			filtered_sm_cube_texs_[i] = rf.MakeTextureCube(SM_SIZE, 1, 1, sm_tex_->Format(), 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
@@ -698,8 +719,11 @@ namespace KlayGE
 		copy_to_light_buffer_pp_ = SyncLoadPostProcess("Copy2LightBuffer.ppml", "CopyToLightBuffer");
 		copy_to_light_buffer_i_pp_ = SyncLoadPostProcess("Copy2LightBuffer.ppml", "CopyToLightBufferI");
 
-		sm_filter_pp_ = MakeSharedPtr<LogGaussianBlurPostProcess>(4, true);
-		sm_filter_pp_->InputPin(0, sm_tex_);
+		for (uint32_t i = 0; i < sm_filter_pps_.size(); ++ i)
+		{
+			sm_filter_pps_[i] = MakeSharedPtr<LogGaussianBlurPostProcess>(4, true);
+			sm_filter_pps_[i]->InputPin(0, sm_texs_[i]);
+		}
 		csm_filter_pp_ = MakeSharedPtr<LogGaussianBlurPostProcess>(4, true);
 		csm_filter_pp_->InputPin(0, csm_tex_);
 		depth_to_esm_pp_ = SyncLoadPostProcess("Depth.ppml", "DepthToESM");
@@ -728,11 +752,12 @@ namespace KlayGE
 		projective_map_2d_tex_param_ = dr_effect_->ParameterByName("projective_map_2d_tex");
 		projective_map_cube_tex_param_ = dr_effect_->ParameterByName("projective_map_cube_tex");
 		filtered_sm_2d_tex_param_ = dr_effect_->ParameterByName("filtered_sm_2d_tex");
-		filtered_sm_2d_tex_array_param_ = dr_effect_->ParameterByName("filtered_sm_2d_tex_array");
-		filtered_sm_2d_light_index_param_ = dr_effect_->ParameterByName("filtered_sm_2d_light_index");
+		filtered_sm_2d_scale_bias_param_ = dr_effect_->ParameterByName("filtered_sm_2d_scale_bias");
+		*(dr_effect_->ParameterByName("sm_atlas_half_texel")) = 0.5f / SM_ATLAS_SIZE;
 		filtered_sm_cube_tex_param_ = dr_effect_->ParameterByName("filtered_sm_cube_tex");
 		inv_width_height_param_ = dr_effect_->ParameterByName("inv_width_height");
-		shadowing_tex_param_ = dr_effect_->ParameterByName("shadowing_tex");
+		shadowing_texs_param_[0] = dr_effect_->ParameterByName("shadowing_tex");
+		shadowing_texs_param_[1] = dr_effect_->ParameterByName("shadowing_1_tex");
 		projective_shadowing_tex_param_ = dr_effect_->ParameterByName("projective_shadowing_tex");
 		shadowing_channel_param_ = dr_effect_->ParameterByName("shadowing_channel");
 		esm_scale_factor_param_ = dr_effect_->ParameterByName("esm_scale_factor");
@@ -793,9 +818,10 @@ namespace KlayGE
 			intersected_light_indices_rw_tex_param_ = dr_effect_->ParameterByName("intersected_light_indices_rw_tex");
 
 			projective_shadowing_rw_tex_param_ = dr_effect_->ParameterByName("projective_shadowing_rw_tex");
-			shadowing_rw_tex_param_ = dr_effect_->ParameterByName("shadowing_rw_tex");
+			shadowing_rw_texs_param_[0] = dr_effect_->ParameterByName("shadowing_rw_tex");
+			shadowing_rw_texs_param_[1] = dr_effect_->ParameterByName("shadowing_1_rw_tex");
 			lights_view_proj_param_ = dr_effect_->ParameterByName("lights_view_proj");
-			filtered_sms_2d_light_index_param_ = dr_effect_->ParameterByName("filtered_sms_2d_light_index");
+			filtered_sms_2d_scale_bias_param_ = dr_effect_->ParameterByName("filtered_sms_2d_scale_bias");
 			esms_scale_factor_param_ = dr_effect_->ParameterByName("esms_scale_factor");
 
 			copy_pp_ = SyncLoadPostProcess("Copy.ppml", "copy");
@@ -860,6 +886,10 @@ namespace KlayGE
 	void DeferredRenderingLayer::Resume()
 	{
 		// TODO
+
+		// The cached shadow maps are gone with the surfaces
+		sm_atlas_->Clear();
+		sm_cube_seeds_.fill(std::make_pair(nullptr, 0));
 	}
 
 	void DeferredRenderingLayer::SSGIEnabled(uint32_t vp, bool ssgi)
@@ -1067,8 +1097,11 @@ namespace KlayGE
 			hint |= EAH_GPU_Unordered;
 		}
 #endif
-		pvp.shadowing_tex = rf.MakeTexture2D(width / 2, height / 2, 1, 1, fmt, 1, 0, hint, nullptr);
-		pvp.shadowing_fb->Attach(FrameBuffer::ATT_Color0, rf.Make2DRenderView(*pvp.shadowing_tex, 0, 1, 0));
+		for (size_t i = 0; i < pvp.shadowing_texs.size(); ++ i)
+		{
+			pvp.shadowing_texs[i] = rf.MakeTexture2D(width / 2, height / 2, 1, 1, fmt, 1, 0, hint, nullptr);
+			pvp.shadowing_fbs[i]->Attach(FrameBuffer::ATT_Color0, rf.Make2DRenderView(*pvp.shadowing_texs[i], 0, 1, 0));
+		}
 
 		if (caps.rendertarget_format_support(EF_B10G11R11F, 1, 0))
 		{
@@ -1263,6 +1296,8 @@ namespace KlayGE
 
 			this->BuildPassScanList(has_opaque_objs, has_transparency_back_objs, has_transparency_front_objs);
 
+			this->ClipViewportViews();
+
 			num_objects_rendered_ = 0;
 			num_renderables_rendered_ = 0;
 			num_primitives_rendered_ = 0;
@@ -1356,7 +1391,10 @@ namespace KlayGE
 				re.ForceLineMode(force_line_mode_);
 
 				CameraPtr const & camera = pvp.frame_buffer->GetViewport()->camera;
-				pvp.shadowing_fb->GetViewport()->camera = camera;
+				for (size_t i = 0; i < pvp.shadowing_fbs.size(); ++ i)
+				{
+					pvp.shadowing_fbs[i]->GetViewport()->camera = camera;
+				}
 				pvp.projective_shadowing_fb->GetViewport()->camera = camera;
 				pvp.reflection_fb->GetViewport()->camera = camera;
 
@@ -1370,7 +1408,10 @@ namespace KlayGE
 				*depth_tex_param_ = pvp.g_buffer_depth_tex;
 				*inv_width_height_param_ = float2(1.0f / pvp.frame_buffer->GetViewport()->width,
 					1.0f / pvp.frame_buffer->GetViewport()->height);
-				*shadowing_tex_param_ = pvp.shadowing_tex;
+				for (size_t i = 0; i < pvp.shadowing_texs.size(); ++ i)
+				{
+					*shadowing_texs_param_[i] = pvp.shadowing_texs[i];
+				}
 				*projective_shadowing_tex_param_ = pvp.projective_shadowing_tex;
 
 				this->GenerateGBuffer(pvp, pass_tb);
@@ -1418,6 +1459,7 @@ namespace KlayGE
 								checked_pointer_cast<SDSMCascadedShadowLayer>(cascaded_shadow_layer_)->DepthTexture(
 									pvp.g_buffer_depth_tex);
 							}
+							this->UpdateShadowReceivers();
 							cascaded_shadow_layer_->UpdateCascades(scene_camera, light_camera.ViewProjMatrix(),
 								cascade_border);
 						}
@@ -1455,30 +1497,52 @@ namespace KlayGE
 		case PC_ShadowMap:
 			{
 				auto const & light = *lights_[org_no];
+				if (0 == index_in_pass)
+				{
+					this->ClipLightViews(pvp, light);
+				}
 				this->PrepareLightCamera(pvp, light, index_in_pass, pass_type);
 
+				bool const sun = (LightSource::LT_Sun == light.Type());
 				if (index_in_pass > 0)
 				{
-					this->PostGenerateShadowMap(pvp, org_no, index_in_pass);
+					if (!sun || !(pvp.reused_cascades & (1UL << (index_in_pass - 1))))
+					{
+						this->PostGenerateShadowMap(pvp, org_no, index_in_pass);
+					}
+					else if (tex_array_support_ && (static_cast<int32_t>(pvp.num_cascades) == index_in_pass)
+						&& (pvp.reused_cascades != (1UL << pvp.num_cascades) - 1))
+					{
+						// The mipmaps of all the cascades in the array are built after the last one
+						pvp.filtered_csm_texs[0]->BuildMipSubLevels();
+					}
 				}
 
 				if ((((LightSource::LT_Point == light.Type()) || (LightSource::LT_SphereArea == light.Type())
 					|| (LightSource::LT_TubeArea == light.Type())) && (6 == index_in_pass))
 					|| ((LightSource::LT_Spot == light.Type()) && (1 == index_in_pass))
-					|| ((LightSource::LT_Sun == light.Type()) && (static_cast<int32_t>(pvp.num_cascades) == index_in_pass)))
+					|| (sun && (static_cast<int32_t>(pvp.num_cascades) == index_in_pass)))
 				{
 					curr_cascade_index_ = -1;
 					urv = 0;
 				}
+				else if (sun && (pvp.reused_cascades & (1UL << index_in_pass)))
+				{
+					urv = 0;
+				}
 				else
 				{
 					urv = App3DFramework::URV_NeedFlush | App3DFramework::URV_OpaqueOnly;
 					switch (pass_rt)
 					{
 					case PRT_ShadowMap:
-						re.BindFrameBuffer(sm_fb_);
-						sm_fb_->Attached(FrameBuffer::ATT_Color0)->Discard();
-						sm_fb_->Attached(FrameBuffer::ATT_DepthStencil)->ClearDepth(1.0f);
+						{
+							FrameBufferPtr const & fb = sm_fbs_[sm_levels_[org_no]];
+							fb->GetViewport()->camera = sm_fb_->GetViewport()->camera;
+							re.BindFrameBuffer(fb);
+							fb->Attached(FrameBuffer::ATT_Color0)->Discard();
+							fb->Attached(FrameBuffer::ATT_DepthStencil)->ClearDepth(1.0f);
+						}
 						break;
 
 					case PRT_CascadedShadowMap:
@@ -1756,7 +1820,7 @@ namespace KlayGE
 		{
 			lights_.push_back(default_ambient_light_.get());
 		}
-		sm_light_indices_.emplace_back(-1, 0);
+		sm_light_indices_.emplace_back(-1, -1);
 
 		uint32_t num_ambient_lights = 0;
 		float3 ambient_clr(0, 0, 0);
@@ -1766,6 +1830,7 @@ namespace KlayGE
 		uint32_t num_sm_lights = 0;
 		uint32_t num_sm_2d_lights = 0;
 		uint32_t num_sm_cube_lights = 0;
+		std::vector<std::pair<float, uint32_t>> sm_candidates;
 		for (uint32_t i = 0; i < num_lights; ++ i)
 		{
 			auto light = scene_mgr.GetLight(i).get();
@@ -1786,7 +1851,7 @@ namespace KlayGE
 						switch (light->Type())
 						{
 						case LightSource::LT_Sun:
-							sm_light_indices_.emplace_back(0, num_sm_lights);
+							sm_light_indices_.emplace_back(0, static_cast<int32_t>(num_sm_lights));
 							++ num_sm_lights;
 							cascaded_shadow_index_ = static_cast<int32_t>(i + 1 - num_ambient_lights);
 							break;
@@ -1795,18 +1860,13 @@ namespace KlayGE
 							if ((projective_light_index_ < 0) && light->ProjectiveTexture())
 							{
 								projective_light_index_ = static_cast<int32_t>(i + 1 - num_ambient_lights);
-								sm_light_indices_.emplace_back(0, 4);
-							}
-							else if ((num_sm_2d_lights < MAX_NUM_SHADOWED_SPOT_LIGHTS)
-								&& (num_sm_lights < MAX_NUM_SHADOWED_LIGHTS))
-							{
-								sm_light_indices_.emplace_back(num_sm_2d_lights, num_sm_lights);
-								++ num_sm_2d_lights;
-								++ num_sm_lights;
+								sm_light_indices_.emplace_back(0, static_cast<int32_t>(PROJECTIVE_SHADOWING_CHANNEL));
 							}
 							else
 							{
-								sm_light_indices_.emplace_back(-1, 0);
+								sm_candidates.emplace_back(this->ShadowMapImportance(*light),
+									static_cast<uint32_t>(sm_light_indices_.size()));
+								sm_light_indices_.emplace_back(-1, -1);
 							}
 							break;
 
@@ -1816,33 +1876,62 @@ namespace KlayGE
 							if ((projective_light_index_ < 0) && light->ProjectiveTexture())
 							{
 								projective_light_index_ = static_cast<int32_t>(i + 1 - num_ambient_lights);
-								sm_light_indices_.emplace_back(0, 4);
-							}
-							else if ((num_sm_cube_lights < MAX_NUM_SHADOWED_POINT_LIGHTS)
-								&& (num_sm_lights < MAX_NUM_SHADOWED_LIGHTS))
-							{
-								sm_light_indices_.emplace_back(num_sm_cube_lights, num_sm_lights);
-								++ num_sm_cube_lights;
-								++ num_sm_lights;
+								sm_light_indices_.emplace_back(0, static_cast<int32_t>(PROJECTIVE_SHADOWING_CHANNEL));
 							}
 							else
 							{
-								sm_light_indices_.emplace_back(-1, 0);
+								sm_candidates.emplace_back(this->ShadowMapImportance(*light),
+									static_cast<uint32_t>(sm_light_indices_.size()));
+								sm_light_indices_.emplace_back(-1, -1);
 							}
 							break;
 
 						default:
-							sm_light_indices_.emplace_back(-1, 0);
+							sm_light_indices_.emplace_back(-1, -1);
 							break;
 						}
 					}
 					else
 					{
-						sm_light_indices_.emplace_back(-1, 0);
+						sm_light_indices_.emplace_back(-1, -1);
 					}
 				}
 			}
 		}
+
+		// The shadowing channels go to the most important lights, instead of the first ones in the scene
+		std::stable_sort(sm_candidates.begin(), sm_candidates.end(),
+			[](std::pair<float, uint32_t> const & lhs, std::pair<float, uint32_t> const & rhs)
+			{
+				return lhs.first > rhs.first;
+			});
+		for (auto const & candidate : sm_candidates)
+		{
+			if (num_sm_lights >= MAX_NUM_SHADOWED_LIGHTS)
+			{
+				break;
+			}
+
+			uint32_t const li = candidate.second;
+			if (LightSource::LT_Spot == lights_[li]->Type())
+			{
+				if (num_sm_2d_lights < MAX_NUM_SHADOWED_SPOT_LIGHTS)
+				{
+					sm_light_indices_[li] = std::make_pair(static_cast<int32_t>(num_sm_2d_lights),
+						static_cast<int32_t>(num_sm_lights));
+					++ num_sm_2d_lights;
+					++ num_sm_lights;
+				}
+			}
+			else if (num_sm_cube_lights < MAX_NUM_SHADOWED_POINT_LIGHTS)
+			{
+				sm_light_indices_[li] = std::make_pair(static_cast<int32_t>(num_sm_cube_lights),
+					static_cast<int32_t>(num_sm_lights));
+				++ num_sm_cube_lights;
+				++ num_sm_lights;
+			}
+		}
+
 		if (0 == num_ambient_lights)
 		{
 			ambient_clr = float3(0.1f, 0.1f, 0.1f);
@@ -1915,6 +2004,8 @@ namespace KlayGE
 	{
 		pass_scaned_.clear();
 
+		this->AllocateShadowMaps();
+
 #ifndef KLAYGE_SHIP
 		pass_scaned_.push_back(this->ComposePassScanCode(0, PT_GenShadowMap, 0, 0, true));
 #endif
@@ -1960,6 +2051,7 @@ namespace KlayGE
 						pvp.light_visibles[li] = false;
 					}
 				}
+				this->ClusterLights(vpi);
 
 				for (uint32_t i = PTB_Opaque; i < PTB_None; ++ i)
 				{
@@ -2068,6 +2160,207 @@ namespace KlayGE
 		}
 	}
 
+	// Fraction of the active view the light volume covers, 1 if the camera is inside
+	float DeferredRenderingLayer::ShadowMapCoverage(LightSource const & light) const
+	{
+		FrameBufferPtr const & fb = viewports_[active_viewport_].frame_buffer;
+		if (!fb)
+		{
+			return 1;
+		}
+
+		Camera const & camera = *fb->GetViewport()->camera;
+		float const range = 100 * std::min(light.Range() * 0.01f, 1.0f) * light_scale_;
+		float3 const center_es = MathLib::transform_coord(light.Position(), camera.ViewMatrix());
+		float const dist_sq = MathLib::length_sq(center_es);
+		if (dist_sq <= range * range)
+		{
+			return 1;
+		}
+		if (center_es.z() < -range)
+		{
+			return 0;
+		}
+		return std::min(range / std::sqrt(dist_sq - range * range) * camera.ProjMatrix()(1, 1), 1.0f);
+	}
+
+	float DeferredRenderingLayer::ShadowMapImportance(LightSource const & light) const
+	{
+		float4 const & clr = light.Color();
+		return this->ShadowMapCoverage(light) * (clr.x() * 0.2126f + clr.y() * 0.7152f + clr.z() * 0.0722f);
+	}
+
+	// Spot lights get atlas tiles sized by their coverage. The maps with unchanged seeds are kept, so are the cube maps.
+	void DeferredRenderingLayer::AllocateShadowMaps()
+	{
+		sm_atlas_->BeginFrame();
+		sm_atlas_rects_.assign(lights_.size(), uint4(0, 0, 0, 0));
+		sm_cached_.assign(lights_.size(), 0);
+		sm_levels_.assign(lights_.size(), 0);
+		for (uint32_t li = 0; li < lights_.size(); ++ li)
+		{
+			auto const & light = *lights_[li];
+			int32_t const sm_index = sm_light_indices_[li].first;
+			if (!light.Enabled() || (light.Attrib() & LightSource::LSA_NoShadow) || (sm_index < 0))
+			{
+				continue;
+			}
+
+			switch (light.Type())
+			{
+			case LightSource::LT_Spot:
+				{
+					bool const full_size = this->NeedsFullShadowMap(light);
+					uint32_t tile_size = SM_SIZE;
+					if (!full_size)
+					{
+						for (float coverage = this->ShadowMapCoverage(light) * 2;
+							(coverage < 1) && (tile_size > sm_atlas_->MinTileSize()); coverage *= 2)
+						{
+							tile_size /= 2;
+						}
+					}
+
+					// Never fails, the atlas is big enough for all the spot lights of a frame at full size
+					bool cached;
+					bool const allocated = sm_atlas_->Request(&light, tile_size, this->ShadowMapSeed(light),
+						sm_atlas_rects_[li], cached);
+					BOOST_ASSERT(allocated);
+					KFL_UNUSED(allocated);
+					sm_cached_[li] = cached;
+
+					// The map is rendered at the size of its tile. Only a map that has to be full size is scaled down.
+					if (!full_size)
+					{
+						uint32_t level = 0;
+						for (uint32_t size = SM_SIZE; (size > sm_atlas_rects_[li].z()) && (level + 1 < NUM_SM_LEVELS); size /= 2)
+						{
+							++ level;
+						}
+						sm_levels_[li] = level;
+					}
+				}
+				break;
+
+			case LightSource::LT_Point:
+			case LightSource::LT_SphereArea:
+			case LightSource::LT_TubeArea:
+				{
+					size_t const seed = this->ShadowMapSeed(light);
+					auto& cube_seed = sm_cube_seeds_[sm_index];
+					sm_cached_[li] = (seed != 0) && (cube_seed.first == &light) && (cube_seed.second == seed);
+					cube_seed = std::make_pair(&light, seed);
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	// The transform of the light and its static casters. 0 if the map has to be rendered every frame.
+	size_t DeferredRenderingLayer::ShadowMapSeed(LightSource const & light) const
+	{
+		if (this->NeedsFullShadowMap(light))
+		{
+			return 0;
+		}
+
+		size_t seed = 0;
+		HashCombine(seed, &light);
+		float4x4 const & light_view_proj = light.SMCamera(0)->ViewProjMatrix();
+		HashRange(seed, &light_view_proj(0, 0), &light_view_proj(0, 0) + 16);
+
+		float const range = 100 * std::min(light.Range() * 0.01f, 1.0f) * light_scale_;
+		AABBox const light_bb(light.Position() - float3(range, range, range), light.Position() + float3(range, range, range));
+		for (auto so : visible_scene_objs_)
+		{
+			if ((0 == so->NumChildren()) && so->GetRenderable() && !(so->Attrib() & SceneObject::SOA_NotCastShadow)
+				&& MathLib::intersect_aabb_aabb(light_bb, so->PosBoundWS()))
+			{
+				if (so->Attrib() & SceneObject::SOA_Moveable)
+				{
+					return 0;
+				}
+				HashCombine(seed, so);
+				HashCombine(seed, so->TransformVersion());
+			}
+		}
+		return (0 == seed) ? 1 : seed;
+	}
+
+	// Indirect lighting needs the RSM, and translucency the unfiltered map, of this frame at full size
+	bool DeferredRenderingLayer::NeedsFullShadowMap(LightSource const & light) const
+	{
+		return (light.Attrib() & LightSource::LSA_IndirectLighting) || (has_sss_objs_ && translucency_enabled_);
+	}
+
+	// Refines the visibility of the local lights by the clusters they touch
+	void DeferredRenderingLayer::ClusterLights(uint32_t vp_index)
+	{
+		PerViewport& pvp = viewports_[vp_index];
+		Camera const & camera = *pvp.frame_buffer->GetViewport()->camera;
+		if (camera.ProjMatrix()(3, 3) != 0)
+		{
+			// The slices are only for perspective views
+			return;
+		}
+
+		uint32_t const tiles_x = (pvp.frame_buffer->Width() + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+		uint32_t const tiles_y = (pvp.frame_buffer->Height() + CLUSTER_TILE_SIZE - 1) / CLUSTER_TILE_SIZE;
+		if (!pvp.light_clusters || (pvp.light_clusters->TilesX() != tiles_x) || (pvp.light_clusters->TilesY() != tiles_y))
+		{
+			pvp.light_clusters = MakeSharedPtr<LightClusterGrid>(tiles_x, tiles_y, CLUSTER_SLICES);
+		}
+
+		cluster_volumes_.clear();
+		cluster_light_indices_.clear();
+		for (uint32_t li = 0; li < lights_.size(); ++ li)
+		{
+			auto const & light = *lights_[li];
+			if (!pvp.light_visibles[li])
+			{
+				continue;
+			}
+
+			// The light volumes are 100 in size before scaling
+			float const range = 100 * std::min(light.Range() * 0.01f, 1.0f) * light_scale_;
+			LightClusterGrid::LightVolume volume;
+			switch (light.Type())
+			{
+			case LightSource::LT_Spot:
+				volume.position = light.Position();
+				volume.range = range;
+				volume.direction = light.Direction();
+				volume.cos_half_angle = light.CosOuterInner().x();
+				break;
+
+			case LightSource::LT_Point:
+			case LightSource::LT_SphereArea:
+			case LightSource::LT_TubeArea:
+				volume.position = light.Position();
+				volume.range = range;
+				volume.direction = float3(0, 0, 1);
+				volume.cos_half_angle = -1;
+				break;
+
+			default:
+				continue;
+			}
+
+			cluster_volumes_.push_back(volume);
+			cluster_light_indices_.push_back(li);
+		}
+
+		pvp.light_clusters->Build(camera.ViewMatrix(), camera.ProjMatrix(), camera.NearPlane(), camera.FarPlane(),
+			cluster_volumes_, &Context::Instance().ThreadPool());
+		for (uint32_t i = 0; i < cluster_light_indices_.size(); ++ i)
+		{
+			pvp.light_visibles[cluster_light_indices_[i]] = pvp.light_clusters->LightVisible(i);
+		}
+	}
+
 	void DeferredRenderingLayer::AppendGBufferPassScanCode(uint32_t vp_index, PassTargetBuffer pass_tb)
 	{
 #ifndef KLAYGE_SHIP
@@ -2116,7 +2409,9 @@ namespace KlayGE
 					}
 				}
 
-				if (sm_seq != 0)
+				// A light without a map only renders its RSM
+				if ((sm_seq != 0) && !sm_cached_[light_index]
+					&& ((sm_light_indices_[light_index].first >= 0) || (PT_GenReflectiveShadowMap == shadow_pt)))
 				{
 					pass_scaned_.push_back(this->ComposePassScanCode(0, shadow_pt, light_index, 0, false));
 					pass_scaned_.push_back(this->ComposePassScanCode(0, shadow_pt, light_index, 1, false));
@@ -2127,7 +2422,8 @@ namespace KlayGE
 		case LightSource::LT_Point:
 		case LightSource::LT_SphereArea:
 		case LightSource::LT_TubeArea:
-			if (0 == (attr & LightSource::LSA_NoShadow))
+			if ((0 == (attr & LightSource::LSA_NoShadow)) && !sm_cached_[light_index]
+				&& (sm_light_indices_[light_index].first >= 0))
 			{
 				for (int j = 0; j < 7; ++ j)
 				{
@@ -2306,6 +2602,165 @@ namespace KlayGE
 		}
 	}
 
+	// Culls all enabled viewports in one traversal, their G-buffer passes pick up the results
+	void DeferredRenderingLayer::ClipViewportViews()
+	{
+		std::vector<SceneManager::CullingView> views;
+		for (auto const & pvp : viewports_)
+		{
+			if (pvp.attrib & VPAM_Enabled)
+			{
+				CameraPtr const & camera = pvp.frame_buffer->GetViewport()->camera;
+				views.push_back({ camera.get(), camera->ViewProjMatrix() });
+			}
+		}
+		if (views.size() > 1)
+		{
+			Context::Instance().SceneManagerInstance().ClipViews(views);
+		}
+	}
+
+	// Culls all cascades or cube faces of a light in one traversal, before its first shadow map pass
+	void DeferredRenderingLayer::ClipLightViews(PerViewport& pvp, LightSource const & light)
+	{
+		std::vector<SceneManager::CullingView> views;
+		switch (light.Type())
+		{
+		case LightSource::LT_Sun:
+			{
+				Camera const & sm_camera = *light.SMCamera(0);
+				for (uint32_t i = 0; i < pvp.num_cascades; ++ i)
+				{
+					views.push_back({ &sm_camera,
+						sm_camera.ViewProjMatrix() * cascaded_shadow_layer_->CascadeCropMatrix(i) });
+				}
+			}
+			break;
+
+		case LightSource::LT_Point:
+		case LightSource::LT_SphereArea:
+		case LightSource::LT_TubeArea:
+			for (int i = 0; i < 6; ++ i)
+			{
+				Camera const & sm_camera = *light.SMCamera(i);
+				views.push_back({ &sm_camera, sm_camera.ViewProjMatrix() });
+			}
+			break;
+
+		default:
+			break;
+		}
+		if (!views.empty())
+		{
+			Context::Instance().SceneManagerInstance().ClipViews(views);
+			if (LightSource::LT_Sun == light.Type())
+			{
+				this->CullCascadeCasters(pvp, *light.SMCamera(0));
+			}
+		}
+	}
+
+	// The visible leaves in the G-buffer pass. A visible one not culled by bounds could be anywhere, so the receivers
+	// are unknown then. The ones not in shadow maps, like the sky box, don't receive shadows either.
+	void DeferredRenderingLayer::UpdateShadowReceivers()
+	{
+		shadow_receivers_.clear();
+		for (auto so : visible_scene_objs_)
+		{
+			if ((so->VisibleMark() != BO_No) && (0 == so->NumChildren()) && so->GetRenderable())
+			{
+				uint32_t const attr = so->Attrib();
+				if (attr & SceneObject::SOA_Cullable)
+				{
+					shadow_receivers_.push_back(so->PosBoundWS());
+				}
+				else if (!(attr & SceneObject::SOA_NotCastShadow))
+				{
+					shadow_receivers_.clear();
+					break;
+				}
+			}
+		}
+		cascaded_shadow_layer_->Receivers(shadow_receivers_);
+	}
+
+	// Drops the casters out of the receiver bounds of a cascade from its bit in the view masks, which are read by the
+	// flush of the cascade. A cascade with the same static casters and projection as last frame isn't rendered again.
+	void DeferredRenderingLayer::CullCascadeCasters(PerViewport& pvp, Camera const & sm_camera)
+	{
+		uint32_t const num_cascades = pvp.num_cascades;
+		uint32_t const all_cascades = (1UL << num_cascades) - 1;
+		float4x4 const & light_view_proj = sm_camera.ViewProjMatrix();
+
+		std::array<size_t, CascadedShadowLayer::MAX_NUM_CASCADES> seeds;
+		uint32_t dynamic_cascades = 0;
+		for (uint32_t i = 0; i < num_cascades; ++ i)
+		{
+			num_cascade_casters_tested_[i] = 0;
+			num_cascade_casters_rendered_[i] = 0;
+
+			size_t seed = 0;
+			HashRange(seed, &light_view_proj(0, 0), &light_view_proj(0, 0) + 16);
+			float4x4 const & crop = cascaded_shadow_layer_->CascadeCropMatrix(i);
+			HashRange(seed, &crop(0, 0), &crop(0, 0) + 16);
+			HashCombine(seed, pvp.filtered_csm_texs[tex_array_support_ ? 0 : i].get());
+			seeds[i] = seed;
+		}
+
+		for (auto so : visible_scene_objs_)
+		{
+			uint32_t mask = so->ViewMask() & all_cascades;
+			if (mask && (0 == so->NumChildren()) && so->GetRenderable())
+			{
+				AABBox const aabb_ls = MathLib::transform_aabb(so->PosBoundWS(), light_view_proj);
+				for (uint32_t i = 0; i < num_cascades; ++ i)
+				{
+					uint32_t const bit = 1UL << i;
+					if (mask & bit)
+					{
+						++ num_cascade_casters_tested_[i];
+
+						AABBox const & receiver_bb = cascaded_shadow_layer_->CascadeReceiverBounds(i);
+						if ((aabb_ls.Min().x() <= receiver_bb.Max().x()) && (aabb_ls.Max().x() >= receiver_bb.Min().x())
+							&& (aabb_ls.Min().y() <= receiver_bb.Max().y()) && (aabb_ls.Max().y() >= receiver_bb.Min().y())
+							&& (aabb_ls.Min().z() <= receiver_bb.Max().z()))
+						{
+							++ num_cascade_casters_rendered_[i];
+							HashCombine(seeds[i], so);
+							HashCombine(seeds[i], so->TransformVersion());
+							if (so->Attrib() & SceneObject::SOA_Moveable)
+							{
+								dynamic_cascades |= bit;
+							}
+						}
+						else
+						{
+							mask &= ~bit;
+						}
+					}
+				}
+				so->ViewMask((so->ViewMask() & ~all_cascades) | mask);
+			}
+		}
+
+		pvp.reused_cascades = 0;
+		for (uint32_t i = 0; i < num_cascades; ++ i)
+		{
+			if (dynamic_cascades & (1UL << i))
+			{
+				pvp.cascade_seeds[i] = 0;
+			}
+			else
+			{
+				if ((pvp.cascade_seeds[i] != 0) && (pvp.cascade_seeds[i] == seeds[i]))
+				{
+					pvp.reused_cascades |= 1UL << i;
+				}
+				pvp.cascade_seeds[i] = seeds[i];
+			}
+		}
+	}
+
 	void DeferredRenderingLayer::PrepareLightCamera(PerViewport const & pvp,
 		LightSource const & light, int32_t index_in_pass, PassType pass_type)
 	{
@@ -2447,11 +2902,22 @@ namespace KlayGE
 	void DeferredRenderingLayer::PostGenerateShadowMap(PerViewport const & pvp, int32_t org_no, int32_t index_in_pass)
 	{
 		LightSource::LightType const type = lights_[org_no]->Type();
+		uint32_t const level = sm_levels_[org_no];
 
 		if (type != LightSource::LT_Sun)
 		{
-			sm_fb_->Attached(FrameBuffer::ATT_Color0)->Discard();
+			sm_fbs_[level]->Attached(FrameBuffer::ATT_Color0)->Discard();
+			if (level != 0)
+			{
+				depth_to_esm_pp_->InputPin(0, sm_depth_texs_[level]);
+				depth_to_esm_pp_->OutputPin(0, sm_texs_[level]);
+			}
 			depth_to_esm_pp_->Apply();
+			if (level != 0)
+			{
+				depth_to_esm_pp_->InputPin(0, sm_depth_tex_);
+				depth_to_esm_pp_->OutputPin(0, sm_tex_);
+			}
 		}
 
 		PostProcessChainPtr pp_chain;
@@ -2469,7 +2935,7 @@ namespace KlayGE
 		}
 		else
 		{
-			pp_chain = checked_pointer_cast<PostProcessChain>(sm_filter_pp_);
+			pp_chain = checked_pointer_cast<PostProcessChain>(sm_filter_pps_[level]);
 			if ((LightSource::LT_Point == type) || (LightSource::LT_SphereArea == type)
 				|| (LightSource::LT_TubeArea == type))
 			{
@@ -2477,15 +2943,8 @@ namespace KlayGE
 			}
 			else 
 			{
-				if (tex_array_support_)
-				{
-					pp_chain->OutputPin(0, filtered_sm_2d_texs_[0], 0, sm_light_indices_[org_no].first);
-				}
-				else
-				{
-					pp_chain->OutputPin(0, filtered_sm_2d_texs_[sm_light_indices_[org_no].first]);
-				}
-				if (has_sss_objs_ && translucency_enabled_)
+				pp_chain->OutputPin(0, filtered_sm_2d_texs_[level]);
+				if (has_sss_objs_ && translucency_enabled_ && (sm_light_indices_[org_no].first >= 0))
 				{
 					sm_tex_->CopyToTexture(*unfiltered_sm_2d_texs_[sm_light_indices_[org_no].first]);
 				}
@@ -2502,8 +2961,9 @@ namespace KlayGE
 		}
 		else
 		{
-			kernel_size.x() = 4;
-			kernel_size.y() = 4;
+			// Keeps the blur in light space the same for the smaller maps
+			kernel_size.x() = std::max(4 >> level, 1);
+			kernel_size.y() = kernel_size.x();
 		}
 		checked_pointer_cast<SeparableLogGaussianFilterPostProcess>(pp_chain->GetPostProcess(0))->KernelRadius(kernel_size.x());
 		checked_pointer_cast<SeparableLogGaussianFilterPostProcess>(pp_chain->GetPostProcess(1))->KernelRadius(kernel_size.y());
@@ -2511,7 +2971,17 @@ namespace KlayGE
 		checked_pointer_cast<LogGaussianBlurPostProcess>(pp_chain)->ESMScaleFactor(ESM_SCALE_FACTOR, *sm_fb_->GetViewport()->camera);
 		pp_chain->Apply();
 
-		if (LightSource::LT_Sun == type)
+		if (LightSource::LT_Spot == type)
+		{
+			if (sm_light_indices_[org_no].first >= 0)
+			{
+				uint4 const & rect = sm_atlas_rects_[org_no];
+				TexturePtr const & filtered_tex = filtered_sm_2d_texs_[level];
+				filtered_tex->CopyToSubTexture2D(*sm_atlas_tex_, 0, 0, rect.x(), rect.y(), rect.z(), rect.w(),
+					0, 0, 0, 0, filtered_tex->Width(0), filtered_tex->Height(0));
+			}
+		}
+		else if (LightSource::LT_Sun == type)
 		{
 			if (tex_array_support_)
 			{
@@ -2529,11 +2999,16 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::UpdateShadowing(PerViewport const & pvp, int32_t index_in_pass)
 	{
+		// The channels are not in the order of the lights, so a buffer is cleared before the first light in it
+		std::array<bool, std::tuple_size<decltype(pvp.shadowing_fbs)>::value> shadowing_cleared;
+		shadowing_cleared.fill(false);
+
 		for (uint32_t li = 0; li < lights_.size(); ++li)
 		{
 			auto const & light = *lights_[li];
 			int32_t const attr = light.Attrib();
-			if (light.Enabled() && (0 == (attr & LightSource::LSA_NoShadow)) && pvp.light_visibles[li])
+			if (light.Enabled() && (0 == (attr & LightSource::LSA_NoShadow)) && pvp.light_visibles[li]
+				&& (sm_light_indices_[li].second >= 0))
 			{
 				LightSource::LightType const type = light.Type();
 
@@ -2567,15 +3042,8 @@ namespace KlayGE
 					{
 					case LightSource::LT_Spot:
 						sm_camera = light.SMCamera(0).get();
-						if (tex_array_support_)
-						{
-							*filtered_sm_2d_tex_array_param_ = filtered_sm_2d_texs_[0];
-							*filtered_sm_2d_light_index_param_ = light_index;
-						}
-						else
-						{
-							*filtered_sm_2d_tex_param_ = filtered_sm_2d_texs_[light_index];
-						}
+						*filtered_sm_2d_tex_param_ = sm_atlas_tex_;
+						*filtered_sm_2d_scale_bias_param_ = sm_atlas_->ScaleBias(sm_atlas_rects_[li]);
 						break;
 
 					case LightSource::LT_Point:
@@ -2626,18 +3094,23 @@ namespace KlayGE
 					}
 				}
 
+				RenderTechnique* tech;
 				if (li == static_cast<uint32_t>(projective_light_index_))
 				{
 					re.BindFrameBuffer(pvp.projective_shadowing_fb);
 					pvp.projective_shadowing_fb->Attached(FrameBuffer::ATT_Color0)->ClearColor(Color(1, 1, 1, 1));
+					tech = technique_shadows_[type][4];
 				}
 				else
 				{
-					re.BindFrameBuffer(pvp.shadowing_fb);
-					if (shadowing_channel <= 0)
+					uint32_t const buffer = shadowing_channel / 4;
+					re.BindFrameBuffer(pvp.shadowing_fbs[buffer]);
+					if (!shadowing_cleared[buffer])
 					{
-						pvp.shadowing_fb->Attached(FrameBuffer::ATT_Color0)->ClearColor(Color(1, 1, 1, 1));
+						pvp.shadowing_fbs[buffer]->Attached(FrameBuffer::ATT_Color0)->ClearColor(Color(1, 1, 1, 1));
+						shadowing_cleared[buffer] = true;
 					}
+					tech = technique_shadows_[type][shadowing_channel % 4];
 				}
 
 				if (sm_camera)
@@ -2645,7 +3118,7 @@ namespace KlayGE
 					*esm_scale_factor_param_ = ESM_SCALE_FACTOR / (sm_camera->FarPlane() - sm_camera->NearPlane());
 				}
 
-				re.Render(*dr_effect_, *technique_shadows_[type][shadowing_channel], *light_volume_rl_[type]);
+				re.Render(*dr_effect_, *tech, *light_volume_rl_[type]);
 			}
 		}
 	}
@@ -2659,10 +3132,13 @@ namespace KlayGE
 		*min_max_depth_tex_param_ = pvp.g_buffer_min_max_depth_texs.back();
 		*lighting_mask_tex_param_ = pvp.lighting_mask_tex;
 		*projective_shadowing_rw_tex_param_ = pvp.projective_shadowing_tex;
-		*shadowing_rw_tex_param_ = pvp.shadowing_tex;
+		for (size_t i = 0; i < pvp.shadowing_texs.size(); ++ i)
+		{
+			*shadowing_rw_texs_param_[i] = pvp.shadowing_texs[i];
+		}
 
-		uint32_t w = pvp.shadowing_tex->Width(0);
-		uint32_t h = pvp.shadowing_tex->Height(0);
+		uint32_t w = pvp.shadowing_texs[0]->Width(0);
+		uint32_t h = pvp.shadowing_texs[0]->Height(0);
 		float2 tile_scale(((w + TILE_SIZE - 1) & ~(TILE_SIZE - 1)) / (2.0f * TILE_SIZE),
 			((h + TILE_SIZE - 1) & ~(TILE_SIZE - 1)) / (2.0f * TILE_SIZE));
 		*tile_scale_param_ = float4(tile_scale.x(), tile_scale.y(), 0, 0);
@@ -2686,14 +3162,23 @@ namespace KlayGE
 		uint8_t* lights_aabb_min = lights_aabb_min_param_->MemoryInCBuff<uint8_t>();
 		uint8_t* lights_aabb_max = lights_aabb_max_param_->MemoryInCBuff<uint8_t>();
 		uint8_t* lights_view_proj = lights_view_proj_param_->MemoryInCBuff<uint8_t>();
-		uint8_t* filtered_sms_2d_light_index = filtered_sms_2d_light_index_param_->MemoryInCBuff<uint8_t>();
+		uint8_t* filtered_sms_2d_scale_bias = filtered_sms_2d_scale_bias_param_->MemoryInCBuff<uint8_t>();
 		uint8_t* esms_scale_factor = esms_scale_factor_param_->MemoryInCBuff<uint8_t>();
 
+		// An unused channel gets an empty spot light behind the camera, which intersects no tile
+		for (uint32_t i = 0; i <= MAX_NUM_SHADOWED_LIGHTS; ++ i)
+		{
+			*reinterpret_cast<uint32_t*>(lights_type + i * lights_type_param_->Stride()) = LightSource::LT_Spot;
+			*reinterpret_cast<float4*>(lights_aabb_min + i * lights_aabb_min_param_->Stride()) = float4(0, 0, -1, 0);
+			*reinterpret_cast<float4*>(lights_aabb_max + i * lights_aabb_max_param_->Stride()) = float4(0, 0, -1, 0);
+		}
+
 		for (uint32_t li = 0; li < lights_.size(); ++ li)
 		{
 			auto const & light = *lights_[li];
 			int32_t const attr = light.Attrib();
-			if (light.Enabled() && (0 == (attr & LightSource::LSA_NoShadow)) && pvp.light_visibles[li])
+			if (light.Enabled() && (0 == (attr & LightSource::LSA_NoShadow)) && pvp.light_visibles[li]
+				&& (sm_light_indices_[li].second >= 0))
 			{
 				LightSource::LightType const type = light.Type();
 
@@ -2707,14 +3192,7 @@ namespace KlayGE
 					{
 					case LightSource::LT_Spot:
 						sm_camera = light.SMCamera(0).get();
-						if (tex_array_support_)
-						{
-							*filtered_sm_2d_tex_array_param_ = filtered_sm_2d_texs_[0];
-						}
-						else
-						{
-							*filtered_sm_2d_tex_param_ = filtered_sm_2d_texs_[light_index];
-						}
+						*filtered_sm_2d_tex_param_ = sm_atlas_tex_;
 						break;
 
 					case LightSource::LT_Point:
@@ -2786,8 +3264,8 @@ namespace KlayGE
 						float3 dir_es = MathLib::transform_normal(light.Direction(), pvp.view);
 						light_dir_es_actived = float4(dir_es.x(), dir_es.y(), dir_es.z(), light.CosOuterInner().y());
 
-						*reinterpret_cast<int32_t*>(filtered_sms_2d_light_index
-							+ shadowing_channel * filtered_sms_2d_light_index_param_->Stride()) = light_index;
+						*reinterpret_cast<float4*>(filtered_sms_2d_scale_bias
+							+ shadowing_channel * filtered_sms_2d_scale_bias_param_->Stride()) = sm_atlas_->ScaleBias(sm_atlas_rects_[li]);
 
 						float4x4 const light_to_view = light.SMCamera(0)->InverseViewMatrix() * pvp.view;
 						float const scale = light.CosOuterInner().w();
@@ -2840,7 +3318,7 @@ namespace KlayGE
 				*reinterpret_cast<float4*>(lights_aabb_max + shadowing_channel * lights_aabb_max_param_->Stride())
 					= float4(aabb.Max().x(), aabb.Max().y(), aabb.Max().z(), 0);
 
-				if (4 == shadowing_channel)
+				if (PROJECTIVE_SHADOWING_CHANNEL == shadowing_channel)
 				{
 					if ((LightSource::LT_Point == type) || (LightSource::LT_SphereArea == type)
 						|| (LightSource::LT_TubeArea == type))
@@ -2863,7 +3341,7 @@ namespace KlayGE
 		lights_aabb_min_param_->CBuffer().Dirty(true);
 		lights_aabb_max_param_->CBuffer().Dirty(true);
 		lights_view_proj_param_->CBuffer().Dirty(true);
-		filtered_sms_2d_light_index_param_->CBuffer().Dirty(true);
+		filtered_sms_2d_scale_bias_param_->CBuffer().Dirty(true);
 		esms_scale_factor_param_->CBuffer().Dirty(true);
 
 		re.Dispatch(*dr_effect_, *technique_tbdr_shadowing_unified_, (w + TILE_SIZE - 1) / TILE_SIZE, (h + TILE_SIZE - 1) / TILE_SIZE, 1);
@@ -3163,6 +3641,11 @@ namespace KlayGE
 			cascaded_shadow_layer_ = MakeSharedPtr<SDSMCascadedShadowLayer>();
 			break;
 		}
+
+		if (CSLT_PSSM == cascaded_shadow_layer_->Type())
+		{
+			checked_pointer_cast<PSSMCascadedShadowLayer>(cascaded_shadow_layer_)->ShadowMapSize(SM_SIZE * 2);
+		}
 	}
 
 	void DeferredRenderingLayer::SetViewportCascades(uint32_t vp, uint32_t num_cascades, float pssm_lambda)
@@ -3592,7 +4075,6 @@ namespace KlayGE
 			if (with_shadow)
 			{
 				BOOST_ASSERT(0 == (light.Attrib() & LightSource::LSA_NoShadow));
-				BOOST_ASSERT(iter - iter_beg < 4);
 				channel = sm_light_indices_[*iter].second;
 			}
 
@@ -3875,8 +4357,6 @@ namespace KlayGE
 			uint8_t* lights_radius_extend = lights_radius_extend_param_->MemoryInCBuff<uint8_t>();
 			uint8_t* lights_aabb_min = lights_aabb_min_param_->MemoryInCBuff<uint8_t>();
 			uint8_t* lights_aabb_max = lights_aabb_max_param_->MemoryInCBuff<uint8_t>();
-			std::array<int, 6> lights_shadowing_channel;
-			lights_shadowing_channel.fill(-1);
 			for (uint32_t t = 0; t < available_lights.size(); ++ t)
 			{
 				for (uint32_t i = 0; i < available_lights[t].size(); ++ i)
@@ -3924,39 +4404,21 @@ namespace KlayGE
 							+ offset * lights_dir_es_param_->Stride())->w() = light.CosOuterInner().y();
 					}
 
+					// The shadowing channel of the light, -1 for none, goes with its own attrib
+					int32_t channel = -1;
+					if (0 == (attr & LightSource::LSA_NoShadow))
+					{
+						channel = sm_light_indices_[available_lights[t][i]].second;
+					}
 					*reinterpret_cast<float4*>(lights_attrib
 						+ offset * lights_attrib_param_->Stride()) = float4(attr & LightSource::LSA_NoDiffuse ? 0.0f : 1.0f,
-						attr & LightSource::LSA_NoSpecular ? 0.0f : 1.0f, 0, 0);
+						attr & LightSource::LSA_NoSpecular ? 0.0f : 1.0f, channel + 0.5f, 0);
 
 					float3 extend_es = MathLib::transform_normal(light.Extend(), pvp.view);
 					*reinterpret_cast<float4*>(lights_radius_extend
 						+ offset * lights_radius_extend_param_->Stride()) = float4(light.Radius(),
 						extend_es.x(), extend_es.y(), extend_es.z());
 
-					if (0 == (attr & LightSource::LSA_NoShadow))
-					{
-						int32_t channel = sm_light_indices_[available_lights[t][i]].second;
-						switch (type)
-						{
-						case LightSource::LT_Sun:
-							lights_shadowing_channel[0] = channel;
-							break;
-
-						case LightSource::LT_Point:
-						case LightSource::LT_SphereArea:
-						case LightSource::LT_TubeArea:
-							lights_shadowing_channel[1] = channel;
-							break;
-
-						case LightSource::LT_Spot:
-							lights_shadowing_channel[2 + i] = channel;
-							break;
-
-						default:
-							break;
-						}
-					}
-
 					float range = light.Range() * light_scale_;
 					AABBox aabb(float3(0, 0, 0), float3(0, 0, 0));
 					if (LightSource::LT_Spot == type)
@@ -3976,12 +4438,6 @@ namespace KlayGE
 				}
 			}
 
-			for (size_t i = 0; i < lights_shadowing_channel.size(); ++ i)
-			{
-				reinterpret_cast<float4*>(lights_attrib
-					+ i * lights_attrib_param_->Stride())->z() = lights_shadowing_channel[i] + 0.5f;
-			}
-
 			lights_type_param_->CBuffer().Dirty(true);
 			lights_color_param_->CBuffer().Dirty(true);
 			lights_pos_es_param_->CBuffer().Dirty(true);
@@ -4129,4 +4585,31 @@ namespace KlayGE
 	{
 		return num_vertices_rendered_;
 	}
+
+	uint32_t DeferredRenderingLayer::NumCascadeCastersTested(uint32_t index) const
+	{
+		BOOST_ASSERT(index < num_cascade_casters_tested_.size());
+		return num_cascade_casters_tested_[index];
+	}
+
+	uint32_t DeferredRenderingLayer::NumCascadeCastersRendered(uint32_t index) const
+	{
+		BOOST_ASSERT(index < num_cascade_casters_rendered_.size());
+		return num_cascade_casters_rendered_[index];
+	}
+
+	LightClusterGridPtr const & DeferredRenderingLayer::LightClusters(uint32_t vp) const
+	{
+		return viewports_[vp].light_clusters;
+	}
+
+	uint32_t DeferredRenderingLayer::NumCascadesReused() const
+	{
+		uint32_t num = 0;
+		for (uint32_t bits = viewports_[active_viewport_].reused_cascades; bits != 0; bits &= bits - 1)
+		{
+			++ num;
+		}
+		return num;
+	}
 }
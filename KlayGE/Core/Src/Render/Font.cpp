@@ -106,8 +106,10 @@ namespace KlayGE
 
 			uint32_t const INDEX_PER_CHAR = restart_ ? 5 : 6;
 			uint32_t const INIT_NUM_CHAR = 1024;
-			tb_vb_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_CHAR * 4 * sizeof(FontVert)), TransientBuffer::BF_Vertex);
-			tb_ib_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_CHAR * INDEX_PER_CHAR * sizeof(uint16_t)), TransientBuffer::BF_Index);
+			tb_vb_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_CHAR * 4 * sizeof(FontVert)), TransientBuffer::BF_Vertex,
+				TransientBuffer::AM_Ring, static_cast<uint32_t>(sizeof(FontVert)));
+			tb_ib_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_CHAR * INDEX_PER_CHAR * sizeof(uint16_t)), TransientBuffer::BF_Index,
+				TransientBuffer::AM_Ring, static_cast<uint32_t>(sizeof(uint16_t)));
 
 			rl_->BindVertexStream(tb_vb_->GetBuffer(), std::make_tuple(vertex_element(VEU_Position, 0, EF_BGR32F),
 											vertex_element(VEU_Diffuse, 0, EF_ABGR8),
@@ -159,6 +161,11 @@ namespace KlayGE
 			tb_ib_->OnPresent();
 		}
 
+		bool Recordable() const
+		{
+			return false;
+		}
+
 		void Render()
 		{
 			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -189,12 +196,7 @@ namespace KlayGE
 				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rl_);
 			}
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
-
+			// The rings reclaim the sub allocs by themselves when the frame retires
 			this->OnRenderEnd();
 		}
 
@@ -385,9 +387,9 @@ namespace KlayGE
 					y += (offset_adv.second >> 16) * rel_size_y;
 				}
 
-				tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
+				SubAlloc const vb_alloc = tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]);
 
-				uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
+				uint16_t last_index = static_cast<uint16_t>(vb_alloc.offset_ / sizeof(FontVert));
 				uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
 				indices.reserve(num_chars * index_per_char);
 				for (uint32_t c = 0; c < num_chars; ++ c)
@@ -410,7 +412,14 @@ namespace KlayGE
 					last_index += 4;
 				}
 				BOOST_ASSERT(last_index + 3 <= 0xFFFF);
-				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+				SubAlloc const ib_alloc = tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]);
+
+				// Only a frame overrunning the ring and its reserve drops text. The ring grows before the next one.
+				if ((vb_alloc.length_ > 0) && (ib_alloc.length_ > 0))
+				{
+					tb_vb_sub_allocs_.push_back(vb_alloc);
+					tb_ib_sub_allocs_.push_back(ib_alloc);
+				}
 
 				pos_aabb_ |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
 			}
@@ -495,9 +504,9 @@ namespace KlayGE
 				}
 			}
 
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
+			SubAlloc const vb_alloc = tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]);
 
-			uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
+			uint16_t last_index = static_cast<uint16_t>(vb_alloc.offset_ / sizeof(FontVert));
 			uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
 			indices.reserve(num_chars * index_per_char);
 			for (uint32_t c = 0; c < num_chars; ++ c)
@@ -519,7 +528,12 @@ namespace KlayGE
 				}
 				last_index += 4;
 			}
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+			SubAlloc const ib_alloc = tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]);
+			if ((vb_alloc.length_ > 0) && (ib_alloc.length_ > 0))
+			{
+				tb_vb_sub_allocs_.push_back(vb_alloc);
+				tb_ib_sub_allocs_.push_back(ib_alloc);
+			}
 
 			pos_aabb_ |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
 		}
@@ -558,30 +558,41 @@ namespace KlayGE
 		return sm_camera_;
 	}
 
+	// The orientation and the size don't follow the rotation of the scene camera, and the position moves in steps.
+	// So the cascades fitted in it stay on the same texels, and don't change at all while the camera moves a little.
 	void SunLightSource::UpdateSMCamera(Camera const & scene_camera)
 	{
 		float3 const dir = this->Direction();
 
-		float3 up_vec;
-		if (MathLib::abs(MathLib::dot(-dir, scene_camera.UpVec())) > 0.95f)
+		float3 up_vec(0, 1, 0);
+		if (MathLib::abs(dir.y()) > 0.95f)
 		{
-			up_vec = scene_camera.RightVec();
-		}
-		else
-		{
-			up_vec = scene_camera.UpVec();
+			up_vec = float3(0, 0, 1);
 		}
 
 		float4x4 light_view = MathLib::look_at_lh(-dir, float3(0, 0, 0), up_vec);
 
 		AABBox const aabb = CalcFrustumExtents(scene_camera, scene_camera.NearPlane(), scene_camera.FarPlane(), light_view);
 
-		float3 const & center = aabb.Center();
-		float3 view_pos = MathLib::transform_coord(float3(center.x(), center.y(), aabb.Min().z()), MathLib::inverse(light_view));
+		// Bounding sphere of the frustum
+		float const near_plane = scene_camera.NearPlane();
+		float const far_plane = scene_camera.FarPlane();
+		float const radius = MathLib::length(float3(far_plane / scene_camera.ProjMatrix()(0, 0),
+			far_plane / scene_camera.ProjMatrix()(1, 1), (far_plane - near_plane) * 0.5f));
+		float3 const center = MathLib::transform_coord(
+			scene_camera.EyePos() + scene_camera.ForwardVec() * ((near_plane + far_plane) * 0.5f), light_view);
+
+		float const step = radius / 8;
+		float const half_size = radius + step;
+		float const center_x = std::floor(center.x() / step) * step;
+		float const center_y = std::floor(center.y() / step) * step;
+		float const min_z = std::floor(aabb.Min().z() / step) * step;
+		float const max_z = std::ceil(aabb.Max().z() / step) * step;
+
+		float3 view_pos = MathLib::transform_coord(float3(center_x, center_y, min_z), MathLib::inverse(light_view));
 		sm_camera_->ViewParams(view_pos, view_pos + dir, up_vec);
 
-		float3 dimensions = aabb.Max() - aabb.Min();
-		sm_camera_->ProjOrthoParams(dimensions.x(), dimensions.y(), 0.0f, dimensions.z());
+		sm_camera_->ProjOrthoParams(half_size * 2, half_size * 2, 0.0f, max_z - min_z);
 	}
 
 
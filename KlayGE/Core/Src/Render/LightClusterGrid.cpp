@@ -0,0 +1,357 @@
+/**
+ * @file LightClusterGrid.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/AlignedAllocator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <KlayGE/LightClusterGrid.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const MIN_SLICES_PER_TASK = 2;
+
+	// The tile containing an NDC coordinate, clamped to the grid
+	uint32_t NdcToTile(float ndc, uint32_t num_tiles)
+	{
+		int32_t const tile = static_cast<int32_t>(std::floor((ndc * 0.5f + 0.5f) * num_tiles));
+		return static_cast<uint32_t>(MathLib::clamp(tile, 0, static_cast<int32_t>(num_tiles) - 1));
+	}
+
+	// NDC range of the coordinates [min_v, max_v] over the depths [min_z, max_z]. The extremes are on the corners.
+	float2 NdcRange(float min_v, float max_v, float min_z, float max_z, float scale, float offset)
+	{
+		float const a = min_v / min_z;
+		float const b = min_v / max_z;
+		float const c = max_v / min_z;
+		float const d = max_v / max_z;
+		return float2(std::min(std::min(a, b), std::min(c, d)) * scale + offset,
+			std::max(std::max(a, b), std::max(c, d)) * scale + offset);
+	}
+
+	// If a sphere touches a cone with a flat cap
+	bool ConeIntersectSphere(float3 const & apex, float3 const & dir, float range, float cos_half_angle,
+		float sin_half_angle, float3 const & center, float radius)
+	{
+		float3 const v = center - apex;
+		float const along = MathLib::dot(v, dir);
+		float const across = std::sqrt(std::max(MathLib::length_sq(v) - along * along, 0.0f));
+		float const closest = cos_half_angle * across - along * sin_half_angle;
+		return (closest <= radius) && (along <= range + radius) && (along >= -radius);
+	}
+}
+
+namespace KlayGE
+{
+	LightClusterGrid::LightClusterGrid(uint32_t tiles_x, uint32_t tiles_y, uint32_t slices)
+		: tiles_x_(tiles_x), tiles_y_(tiles_y), slices_(slices),
+			near_plane_(1), log_far_near_(1), proj_(float4x4::Identity())
+	{
+		BOOST_ASSERT((tiles_x > 0) && (tiles_y > 0) && (slices > 0));
+
+		CPUInfo cpu;
+		num_hw_threads_ = static_cast<uint32_t>(cpu.NumHWThreads());
+
+		slice_depths_.resize(slices + 1);
+		slice_light_indices_.resize(slices);
+		cluster_ranges_.resize(this->NumClusters(), uint2(0, 0));
+	}
+
+	uint32_t LightClusterGrid::Slice(float z) const
+	{
+		if (z <= near_plane_)
+		{
+			return 0;
+		}
+		int32_t const slice = static_cast<int32_t>(std::log(z / near_plane_) / log_far_near_ * slices_);
+		return static_cast<uint32_t>(MathLib::clamp(slice, 0, static_cast<int32_t>(slices_) - 1));
+	}
+
+	void LightClusterGrid::Build(float4x4 const & view, float4x4 const & proj, float near_plane, float far_plane,
+		std::vector<LightVolume> const & lights, thread_pool* tp)
+	{
+		near_plane_ = near_plane;
+		log_far_near_ = std::log(far_plane / near_plane);
+		proj_ = proj;
+		for (uint32_t i = 0; i <= slices_; ++ i)
+		{
+			slice_depths_[i] = near_plane * std::exp(log_far_near_ * i / slices_);
+		}
+
+		uint32_t const num_lights = static_cast<uint32_t>(lights.size());
+		view_lights_.clear();
+		view_light_indices_.clear();
+		light_visibles_.assign(num_lights, 0);
+		for (uint32_t i = 0; i < num_lights; ++ i)
+		{
+			LightVolume const & volume = lights[i];
+
+			ViewLight vl;
+			vl.apex = MathLib::transform_coord(volume.position, view);
+			vl.range = volume.range;
+			vl.cos_half_angle = volume.cos_half_angle;
+			if (volume.cos_half_angle > -1)
+			{
+				vl.direction = MathLib::normalize(MathLib::transform_normal(volume.direction, view));
+				vl.sin_half_angle = std::sqrt(std::max(1 - vl.cos_half_angle * vl.cos_half_angle, 0.0f));
+
+				// Bounding sphere of the cone. It passes the apex and the rim if the cone is narrower than 90 degrees.
+				float const cos_sq = vl.cos_half_angle * vl.cos_half_angle;
+				if (cos_sq >= 0.5f)
+				{
+					vl.radius = volume.range / (2 * cos_sq);
+					vl.center = vl.apex + vl.direction * vl.radius;
+				}
+				else
+				{
+					vl.radius = volume.range * vl.sin_half_angle / std::max(vl.cos_half_angle, 1e-6f);
+					vl.center = vl.apex + vl.direction * volume.range;
+				}
+			}
+			else
+			{
+				vl.direction = float3(0, 0, 1);
+				vl.sin_half_angle = 0;
+				vl.center = vl.apex;
+				vl.radius = volume.range;
+			}
+
+			float const min_z = std::max(vl.center.z() - vl.radius, near_plane);
+			float const max_z = std::min(vl.center.z() + vl.radius, far_plane);
+			if (min_z > max_z)
+			{
+				continue;
+			}
+
+			float2 const x_range = NdcRange(vl.center.x() - vl.radius, vl.center.x() + vl.radius, min_z, max_z,
+				proj(0, 0), proj(2, 0));
+			float2 const y_range = NdcRange(vl.center.y() - vl.radius, vl.center.y() + vl.radius, min_z, max_z,
+				proj(1, 1), proj(2, 1));
+			if ((x_range.x() > 1) || (x_range.y() < -1) || (y_range.x() > 1) || (y_range.y() < -1))
+			{
+				continue;
+			}
+
+			vl.first_slice = this->Slice(min_z);
+			vl.last_slice = this->Slice(max_z);
+			vl.first_tile_x = NdcToTile(x_range.x(), tiles_x_);
+			vl.last_tile_x = NdcToTile(x_range.y(), tiles_x_);
+			vl.first_tile_y = NdcToTile(-y_range.y(), tiles_y_);
+			vl.last_tile_y = NdcToTile(-y_range.x(), tiles_y_);
+
+			view_lights_.push_back(vl);
+			view_light_indices_.push_back(i);
+		}
+
+		uint32_t num_tasks = 1;
+		if (tp)
+		{
+			num_tasks = std::max(std::min(num_hw_threads_, slices_ / MIN_SLICES_PER_TASK), 1U);
+		}
+		uint32_t const slices_per_task = (slices_ + num_tasks - 1) / num_tasks;
+
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_tasks - 1);
+		for (uint32_t i = 1; i < num_tasks; ++ i)
+		{
+			uint32_t const begin = i * slices_per_task;
+			uint32_t const end = std::min(begin + slices_per_task, slices_);
+			if (begin < end)
+			{
+				joiners.push_back((*tp)(std::bind(&LightClusterGrid::BuildSlices, this, begin, end)));
+			}
+		}
+		this->BuildSlices(0, std::min(slices_per_task, slices_));
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+
+		// Slices are concatenated, their clusters only have the offsets in the slices
+		uint32_t const clusters_per_slice = tiles_x_ * tiles_y_;
+		size_t total = 0;
+		for (uint32_t s = 0; s < slices_; ++ s)
+		{
+			total += slice_light_indices_[s].size();
+		}
+		light_indices_.resize(total);
+		uint32_t base = 0;
+		for (uint32_t s = 0; s < slices_; ++ s)
+		{
+			auto const & indices = slice_light_indices_[s];
+			std::copy(indices.begin(), indices.end(), light_indices_.begin() + base);
+			for (uint32_t c = 0; c < clusters_per_slice; ++ c)
+			{
+				cluster_ranges_[s * clusters_per_slice + c].x() += base;
+			}
+			base += static_cast<uint32_t>(indices.size());
+		}
+		for (auto light : light_indices_)
+		{
+			light_visibles_[light] = 1;
+		}
+	}
+
+	// Tests 4 tiles in a row at once against the bounding sphere of a light, and the cone of a spot light after that
+	void LightClusterGrid::BuildSlices(uint32_t begin, uint32_t end)
+	{
+		uint32_t const padded_tiles_x = (tiles_x_ + 3) & ~3U;
+		// Loaded 4 at a time with aligned loads
+		std::vector<float, aligned_allocator<float, 16>> x_mins(padded_tiles_x, std::numeric_limits<float>::max());
+		std::vector<float, aligned_allocator<float, 16>> x_maxs(padded_tiles_x, -std::numeric_limits<float>::max());
+		std::vector<float> y_mins(tiles_y_);
+		std::vector<float> y_maxs(tiles_y_);
+		std::vector<std::pair<uint32_t, uint32_t>> hits;
+
+		uint32_t const clusters_per_slice = tiles_x_ * tiles_y_;
+		SIMDVectorF4 const zero = SIMDMathLib::SetVector(0.0f);
+
+		for (uint32_t s = begin; s < end; ++ s)
+		{
+			float const z0 = slice_depths_[s];
+			float const z1 = slice_depths_[s + 1];
+			float const center_z = (z0 + z1) * 0.5f;
+			float const half_z = (z1 - z0) * 0.5f;
+
+			// View space bounds of the clusters in the slice, x and y are independent
+			for (uint32_t tx = 0; tx < tiles_x_; ++ tx)
+			{
+				float const left = ((-1 + 2.0f * tx / tiles_x_) - proj_(2, 0)) / proj_(0, 0);
+				float const right = ((-1 + 2.0f * (tx + 1) / tiles_x_) - proj_(2, 0)) / proj_(0, 0);
+				x_mins[tx] = std::min(left * z0, left * z1);
+				x_maxs[tx] = std::max(right * z0, right * z1);
+			}
+			for (uint32_t ty = 0; ty < tiles_y_; ++ ty)
+			{
+				float const top = ((1 - 2.0f * ty / tiles_y_) - proj_(2, 1)) / proj_(1, 1);
+				float const bottom = ((1 - 2.0f * (ty + 1) / tiles_y_) - proj_(2, 1)) / proj_(1, 1);
+				y_mins[ty] = std::min(bottom * z0, bottom * z1);
+				y_maxs[ty] = std::max(top * z0, top * z1);
+			}
+
+			hits.clear();
+			for (uint32_t li = 0; li < view_lights_.size(); ++ li)
+			{
+				ViewLight const & vl = view_lights_[li];
+				if ((s < vl.first_slice) || (s > vl.last_slice))
+				{
+					continue;
+				}
+
+				bool const spot = (vl.cos_half_angle > -1);
+				float const radius_sq = vl.radius * vl.radius;
+				float const dz = std::max(std::max(z0 - vl.center.z(), vl.center.z() - z1), 0.0f);
+				SIMDVectorF4 const cx = SIMDMathLib::SetVector(vl.center.x());
+
+				for (uint32_t ty = vl.first_tile_y; ty <= vl.last_tile_y; ++ ty)
+				{
+					float const dy = std::max(std::max(y_mins[ty] - vl.center.y(), vl.center.y() - y_maxs[ty]), 0.0f);
+					float const dyz_sq = dy * dy + dz * dz;
+					if (dyz_sq > radius_sq)
+					{
+						continue;
+					}
+					SIMDVectorF4 const dyz_sq_4 = SIMDMathLib::SetVector(dyz_sq);
+
+					for (uint32_t tx = vl.first_tile_x & ~3U; tx <= vl.last_tile_x; tx += 4)
+					{
+						SIMDVectorF4 const x_min = SIMDMathLib::LoadVector4(&x_mins[tx]);
+						SIMDVectorF4 const x_max = SIMDMathLib::LoadVector4(&x_maxs[tx]);
+						SIMDVectorF4 const dx = SIMDMathLib::Maximize(x_min - cx, zero)
+							+ SIMDMathLib::Maximize(cx - x_max, zero);
+						SIMDVectorF4 const dist_sq = dx * dx + dyz_sq_4;
+
+						for (uint32_t lane = 0; lane < 4; ++ lane)
+						{
+							uint32_t const t = tx + lane;
+							if ((t < vl.first_tile_x) || (t > vl.last_tile_x)
+								|| (SIMDMathLib::GetByIndex(dist_sq, lane) > radius_sq))
+							{
+								continue;
+							}
+							if (spot)
+							{
+								float const half_x = (x_maxs[t] - x_mins[t]) * 0.5f;
+								float const half_y = (y_maxs[ty] - y_mins[ty]) * 0.5f;
+								float3 const cluster_center((x_mins[t] + x_maxs[t]) * 0.5f,
+									(y_mins[ty] + y_maxs[ty]) * 0.5f, center_z);
+								float const cluster_radius = std::sqrt(half_x * half_x + half_y * half_y + half_z * half_z);
+								if (!ConeIntersectSphere(vl.apex, vl.direction, vl.range, vl.cos_half_angle,
+									vl.sin_half_angle, cluster_center, cluster_radius))
+								{
+									continue;
+								}
+							}
+							hits.emplace_back(ty * tiles_x_ + t, view_light_indices_[li]);
+						}
+					}
+				}
+			}
+
+			// Counting sort by cluster keeps the lights in order inside each cluster
+			uint2* ranges = &cluster_ranges_[s * clusters_per_slice];
+			for (uint32_t c = 0; c < clusters_per_slice; ++ c)
+			{
+				ranges[c] = uint2(0, 0);
+			}
+			for (auto const & hit : hits)
+			{
+				++ ranges[hit.first].y();
+			}
+			uint32_t offset = 0;
+			for (uint32_t c = 0; c < clusters_per_slice; ++ c)
+			{
+				ranges[c].x() = offset;
+				offset += ranges[c].y();
+			}
+			auto& indices = slice_light_indices_[s];
+			indices.resize(hits.size());
+			std::vector<uint32_t> cursors(clusters_per_slice);
+			for (uint32_t c = 0; c < clusters_per_slice; ++ c)
+			{
+				cursors[c] = ranges[c].x();
+			}
+			for (auto const & hit : hits)
+			{
+				indices[cursors[hit.first] ++] = hit.second;
+			}
+		}
+	}
+}
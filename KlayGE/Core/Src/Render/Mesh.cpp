@@ -33,6 +33,7 @@
 #include <KlayGE/Light.hpp>
 #include <KlayGE/RenderMaterial.hpp>
 #include <KFL/Hash.hpp>
+#include <KlayGE/TriangleBVH.hpp>
 
 #include <algorithm>
 #include <fstream>
@@ -82,6 +83,8 @@ namespace
 				uint32_t num_frames;
 				uint32_t frame_rate;
 				std::vector<std::shared_ptr<AABBKeyFrames>> frame_pos_bbs;
+				std::vector<TriangleBVHPtr> bvhs;
+				std::vector<std::shared_ptr<SkinnedBindPose>> bind_poses;
 			};
 			std::shared_ptr<ModelData> model_data;
 
@@ -132,6 +135,11 @@ namespace
 				model_desc_.model_data->num_frames, model_desc_.model_data->frame_rate,
 				model_desc_.model_data->frame_pos_bbs);
 
+			if (Context::Instance().Config().mesh_bvh)
+			{
+				this->BuildMeshBVHs();
+			}
+
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 			RenderDeviceCaps const & caps = rf.RenderEngineInstance().DeviceCaps();
 			if (caps.multithread_res_creating_support)
@@ -235,6 +243,12 @@ namespace
 					mesh->NumIndices(rhs_mesh->NumIndices());
 					mesh->StartVertexLocation(rhs_mesh->StartVertexLocation());
 					mesh->StartIndexLocation(rhs_mesh->StartIndexLocation());
+
+					// The tree of a skinned mesh is refitted per instance, so it can't be shared
+					if (rhs_mesh->BVH() && !rhs_model->IsSkinned())
+					{
+						mesh->BVH(rhs_mesh->BVH());
+					}
 				}
 
 				BOOST_ASSERT(model->IsSkinned() == rhs_model->IsSkinned());
@@ -260,6 +274,11 @@ namespace
 						SkinnedMeshPtr rhs_skinned_mesh = checked_pointer_cast<SkinnedMesh>(rhs_skinned_model->Subrenderable(mesh_index));
 						SkinnedMeshPtr skinned_mesh = checked_pointer_cast<SkinnedMesh>(meshes[mesh_index]);
 						skinned_mesh->AttachFramePosBounds(rhs_skinned_mesh->GetFramePosBounds());
+						if (rhs_skinned_mesh->BVH())
+						{
+							skinned_mesh->BVH(MakeSharedPtr<TriangleBVH>(*rhs_skinned_mesh->BVH()));
+							skinned_mesh->AttachBindPose(rhs_skinned_mesh->GetBindPose());
+						}
 					}
 				}
 
@@ -327,6 +346,11 @@ namespace
 				mesh->NumIndices(model_desc_.model_data->mesh_num_indices[mesh_index]);
 				mesh->StartVertexLocation(model_desc_.model_data->mesh_base_vertices[mesh_index]);
 				mesh->StartIndexLocation(model_desc_.model_data->mesh_start_indices[mesh_index]);
+
+				if (!model_desc_.model_data->bvhs.empty())
+				{
+					mesh->BVH(model_desc_.model_data->bvhs[mesh_index]);
+				}
 			}
 
 			if (model_desc_.model_data->kfs && !model_desc_.model_data->kfs->empty())
@@ -345,6 +369,10 @@ namespace
 					{
 						SkinnedMeshPtr skinned_mesh = checked_pointer_cast<SkinnedMesh>(meshes[mesh_index]);
 						skinned_mesh->AttachFramePosBounds(model_desc_.model_data->frame_pos_bbs[mesh_index]);
+						if (!model_desc_.model_data->bind_poses.empty())
+						{
+							skinned_mesh->AttachBindPose(model_desc_.model_data->bind_poses[mesh_index]);
+						}
 					}
 				}
 			}
@@ -352,6 +380,125 @@ namespace
 			model->AssignSubrenderables(meshes.begin(), meshes.end());
 		}
 
+		// The vertices are only on CPU at loading time, so the trees have to be built here
+		void BuildMeshBVHs()
+		{
+			ModelDesc::ModelData& model_data = *model_desc_.model_data;
+			bool const skinned = model_data.kfs && !model_data.kfs->empty() && !model_data.joints.empty();
+
+			uint32_t const num_meshes = static_cast<uint32_t>(model_data.mesh_names.size());
+			model_data.bvhs.resize(num_meshes);
+			if (skinned)
+			{
+				model_data.bind_poses.resize(num_meshes);
+			}
+
+			for (uint32_t mesh_index = 0; mesh_index < num_meshes; ++ mesh_index)
+			{
+				uint32_t const num_vertices = model_data.mesh_num_vertices[mesh_index];
+				uint32_t const base_vertex = model_data.mesh_base_vertices[mesh_index];
+				float3 const pos_center = model_data.pos_bbs[mesh_index].Center();
+				float3 const pos_extent = model_data.pos_bbs[mesh_index].HalfSize();
+
+				std::vector<float3> positions(num_vertices, float3(0, 0, 0));
+				std::shared_ptr<SkinnedBindPose> bind_pose;
+				if (skinned)
+				{
+					bind_pose = MakeSharedPtr<SkinnedBindPose>();
+					bind_pose->blend_indices.assign(num_vertices, 0);
+					bind_pose->blend_weights.assign(num_vertices, float4(1, 0, 0, 0));
+				}
+
+				for (size_t ve = 0; ve < model_data.merged_ves.size(); ++ ve)
+				{
+					vertex_element const & elem = model_data.merged_ves[ve];
+					uint32_t const elem_size = elem.element_size();
+					for (uint32_t v = 0; v < num_vertices; ++ v)
+					{
+						uint8_t const * src = &model_data.merged_buff[ve][(base_vertex + v) * elem_size];
+						switch (elem.usage)
+						{
+						case VEU_Position:
+							switch (elem.format)
+							{
+							case EF_ABGR32F:
+							case EF_BGR32F:
+							case EF_GR32F:
+							case EF_R32F:
+								std::memcpy(&positions[v], src, std::min<int>(elem_size, sizeof(positions[v])));
+								break;
+
+							default:
+								{
+									BOOST_ASSERT(EF_SIGNED_ABGR16 == elem.format);
+
+									int16_t const * p = reinterpret_cast<int16_t const *>(src);
+									positions[v].x() = (((p[0] + 32768) / 65536.0f) * 2 - 1) * pos_extent.x() + pos_center.x();
+									positions[v].y() = (((p[1] + 32768) / 65536.0f) * 2 - 1) * pos_extent.y() + pos_center.y();
+									positions[v].z() = (((p[2] + 32768) / 65536.0f) * 2 - 1) * pos_extent.z() + pos_center.z();
+								}
+								break;
+							}
+							break;
+
+						case VEU_BlendIndex:
+							if (bind_pose)
+							{
+								bind_pose->blend_indices[v] = src[0] | (src[1] << 8) | (src[2] << 16) | (src[3] << 24);
+							}
+							break;
+
+						case VEU_BlendWeight:
+							if (bind_pose)
+							{
+								float4& weight = bind_pose->blend_weights[v];
+								switch (elem.format)
+								{
+								case EF_ABGR32F:
+									weight = float4(reinterpret_cast<float const *>(src));
+									break;
+
+								case EF_ABGR8:
+									weight = float4(src[0] / 255.0f, src[1] / 255.0f, src[2] / 255.0f, src[3] / 255.0f);
+									break;
+
+								default:
+									BOOST_ASSERT(EF_ARGB8 == elem.format);
+
+									weight = float4(src[2] / 255.0f, src[1] / 255.0f, src[0] / 255.0f, src[3] / 255.0f);
+									break;
+								}
+							}
+							break;
+
+						default:
+							break;
+						}
+					}
+				}
+
+				std::vector<uint32_t> indices(model_data.mesh_num_indices[mesh_index]);
+				uint32_t const start_index = model_data.mesh_start_indices[mesh_index];
+				if (model_data.all_is_index_16_bit)
+				{
+					uint16_t const * src = reinterpret_cast<uint16_t const *>(&model_data.merged_indices[0]) + start_index;
+					std::copy(src, src + indices.size(), indices.begin());
+				}
+				else
+				{
+					uint32_t const * src = reinterpret_cast<uint32_t const *>(&model_data.merged_indices[0]) + start_index;
+					std::copy(src, src + indices.size(), indices.begin());
+				}
+
+				if (bind_pose)
+				{
+					bind_pose->positions = positions;
+					model_data.bind_poses[mesh_index] = bind_pose;
+				}
+				model_data.bvhs[mesh_index] = MakeSharedPtr<TriangleBVH>(std::move(positions), std::move(indices));
+			}
+		}
+
 		void AddsSubPath()
 		{
 			std::string sub_path;
@@ -484,6 +631,29 @@ namespace KlayGE
 		return ab;
 	}
 
+	bool RenderModel::RayCast(float3 const & origin, float3 const & dir, float max_dist, float& dist) const
+	{
+		bool hit = false;
+		float closest = max_dist;
+		for (uint32_t i = 0; i < this->NumSubrenderables(); ++ i)
+		{
+			TriangleBVHPtr const & bvh = checked_pointer_cast<StaticMesh>(this->Subrenderable(i))->BVH();
+			float mesh_dist;
+			uint32_t triangle;
+			if (bvh && bvh->RayCast(origin, dir, closest, mesh_dist, triangle))
+			{
+				closest = mesh_dist;
+				hit = true;
+			}
+		}
+
+		if (hit)
+		{
+			dist = closest;
+		}
+		return hit;
+	}
+
 	bool RenderModel::HWResourceReady() const
 	{
 		bool ready = hw_res_ready_;
@@ -871,6 +1041,68 @@ namespace KlayGE
 		frame_pos_aabbs_ = frame_pos_aabbs;
 	}
 
+	void SkinnedMesh::AttachBindPose(std::shared_ptr<SkinnedBindPose> const & bind_pose)
+	{
+		bind_pose_ = bind_pose;
+	}
+
+	// The same dual quaternion skinning as the DQSkinned in the shaders
+	void SkinnedMesh::RefitBVH()
+	{
+		SkinnedModelPtr model = std::dynamic_pointer_cast<SkinnedModel>(model_.lock());
+		if (!bvh_ || !bind_pose_ || !model)
+		{
+			return;
+		}
+
+		SkinnedModel::RotationsType const & bind_reals = model->GetBindRealParts();
+		SkinnedModel::RotationsType const & bind_duals = model->GetBindDualParts();
+
+		std::vector<float3> positions(bind_pose_->positions.size());
+		for (size_t v = 0; v < positions.size(); ++ v)
+		{
+			uint32_t const blend_indices = bind_pose_->blend_indices[v];
+			float4 const & blend_weights = bind_pose_->blend_weights[v];
+			float3 const & pos = bind_pose_->positions[v];
+
+			float4 const & dp0 = bind_reals[blend_indices & 0xFF];
+
+			float3 pos_s(0, 0, 0);
+			Quaternion blend_real(0, 0, 0, 0);
+			Quaternion blend_dual(0, 0, 0, 0);
+			for (int j = 0; j < 4; ++ j)
+			{
+				uint32_t const joint = (blend_indices >> (j * 8)) & 0xFF;
+				float const weight = blend_weights[j];
+
+				float4 const & real = bind_reals[joint];
+				float4 const & dual = bind_duals[joint];
+				Quaternion joint_real(real.x(), real.y(), real.z(), real.w());
+				Quaternion joint_dual(dual.x(), dual.y(), dual.z(), dual.w());
+
+				float const scale = MathLib::length(joint_real);
+				joint_real /= scale;
+				if (MathLib::dot(dp0, real) < 0)
+				{
+					joint_real = -joint_real;
+					joint_dual = -joint_dual;
+				}
+
+				pos_s += pos * scale * weight;
+				blend_real += joint_real * weight;
+				blend_dual += joint_dual * weight;
+			}
+
+			float const len = MathLib::length(blend_real);
+			blend_real /= len;
+			blend_dual /= len;
+
+			positions[v] = MathLib::transform_quat(pos_s, blend_real) + MathLib::udq_to_trans(blend_real, blend_dual);
+		}
+
+		bvh_->Refit(positions);
+	}
+
 
 	std::string const jit_ext_name = ".model_bin";
 
@@ -39,7 +39,9 @@
 #include <KlayGE/ResLoader.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/TransientBuffer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/AlignedAllocator.hpp>
 
 #include <fstream>
 
@@ -423,7 +425,7 @@ namespace
 	class RenderParticles : public RenderableHelper
 	{
 	public:
-		explicit RenderParticles(bool gs_support)
+		RenderParticles(bool gs_support, GraphicsBufferPtr const & instance_vb)
 			: RenderableHelper(L"Particles")
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
@@ -435,9 +437,7 @@ namespace
 			{
 				rl_->TopologyType(RenderLayout::TT_PointList);
 
-				GraphicsBufferPtr pos_vb = rf.MakeVertexBuffer(BU_Dynamic, EAH_GPU_Read | EAH_CPU_Write,
-					sizeof(ParticleInstance), nullptr);
-				rl_->BindVertexStream(pos_vb, std::make_tuple(vertex_element(VEU_Position, 0, EF_ABGR32F),
+				rl_->BindVertexStream(instance_vb, std::make_tuple(vertex_element(VEU_Position, 0, EF_ABGR32F),
 					vertex_element(VEU_TextureCoord, 0, EF_ABGR32F)));
 
 				simple_forward_tech_ = effect_->TechniqueByName("ParticleWithGS");
@@ -465,9 +465,7 @@ namespace
 				rl_->BindVertexStream(tex_vb, std::make_tuple(vertex_element(VEU_Position, 0, EF_GR32F)),
 					RenderLayout::ST_Geometry, 0);
 
-				GraphicsBufferPtr pos_vb = rf.MakeVertexBuffer(BU_Dynamic, EAH_GPU_Read | EAH_CPU_Write,
-					sizeof(ParticleInstance), nullptr);
-				rl_->BindVertexStream(pos_vb,
+				rl_->BindVertexStream(instance_vb,
 					std::make_tuple(vertex_element(VEU_TextureCoord, 0, EF_ABGR32F),
 						vertex_element(VEU_TextureCoord, 1, EF_ABGR32F)),
 					RenderLayout::ST_Instance);
@@ -598,14 +596,18 @@ namespace KlayGE
 
 	ParticleSystem::ParticleSystem(uint32_t max_num_particles)
 		: SceneObjectHelper(SOA_Moveable | SOA_NotCastShadow),
-			particles_(max_num_particles),
+			particles_(max_num_particles), sim_view_mat_(float4x4::Identity()),
 			gravity_(0.5f), force_(0, 0, 0), media_density_(0.0f)
 	{
 		this->ClearParticles();
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		gs_support_ = rf.RenderEngineInstance().DeviceCaps().gs_support;
-		renderable_ = MakeSharedPtr<RenderParticles>(gs_support_);
+
+		// Room for three frames in flight of a full system. The ring grows if that's not enough.
+		tb_instance_ = MakeSharedPtr<TransientBuffer>(static_cast<uint32_t>(max_num_particles * 3 * sizeof(ParticleInstance)),
+			TransientBuffer::BF_Vertex, TransientBuffer::AM_Ring, static_cast<uint32_t>(sizeof(ParticleInstance)));
+		renderable_ = MakeSharedPtr<RenderParticles>(gs_support_, tb_instance_->GetBuffer());
 	}
 
 	ParticleSystemPtr ParticleSystem::Clone()
@@ -717,8 +719,9 @@ namespace KlayGE
 		auto emitter_iter = emitters_.begin();
 		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
 
-		float4x4 const & view_mat = Context::Instance().AppInstance().ActiveCamera().ViewMatrix();
-		std::vector<std::pair<uint32_t, float>> active_particles;
+		float4x4 const & view_mat = sim_view_mat_;
+		std::vector<std::pair<uint32_t, float>, frame_allocator<std::pair<uint32_t, float>>> active_particles;
+		active_particles.reserve(particles_.size());
 
 		float3 min_bb(+1e10f, +1e10f, +1e10f);
 		float3 max_bb(-1e10f, -1e10f, -1e10f);
@@ -774,12 +777,33 @@ namespace KlayGE
 		if (!active_particles.empty())
 		{
 			std::sort(active_particles.begin(), active_particles.end(), ParticleCmp());
+		}
 
-			checked_pointer_cast<RenderParticles>(renderable_)->PosBound(AABBox(min_bb, max_bb));
+		std::lock_guard<std::mutex> lock(update_mutex_);
+		active_particles_.assign(active_particles.begin(), active_particles.end());
+		if (!active_particles.empty())
+		{
+			active_particles_bb_ = AABBox(min_bb, max_bb);
 		}
+	}
+
+	void ParticleSystem::SyncSubThreadState()
+	{
+		SceneObjectHelper::SyncSubThreadState();
+
+		sim_view_mat_ = Context::Instance().AppInstance().ActiveCamera().ViewMatrix();
 
 		std::lock_guard<std::mutex> lock(update_mutex_);
-		active_particles_ = active_particles;
+
+		render_particles_.resize(active_particles_.size());
+		for (size_t i = 0; i < active_particles_.size(); ++ i)
+		{
+			render_particles_[i] = particles_[active_particles_[i].first];
+		}
+		if (!active_particles_.empty())
+		{
+			checked_pointer_cast<RenderParticles>(renderable_)->PosBound(active_particles_bb_);
+		}
 	}
 
 	bool ParticleSystem::MainThreadUpdate(float app_time, float elapsed_time)
@@ -787,64 +811,53 @@ namespace KlayGE
 		KFL_UNUSED(app_time);
 		KFL_UNUSED(elapsed_time);
 
-		std::lock_guard<std::mutex> lock(update_mutex_);
+		uint32_t const num_active_particles = static_cast<uint32_t>(render_particles_.size());
 
-		uint32_t const num_active_particles = static_cast<uint32_t>(active_particles_.size());
+		tb_instance_->OnPresent();
 
 		RenderLayout& rl = renderable_->GetRenderLayout();
-		if (!active_particles_.empty())
+		if (!render_particles_.empty())
 		{
-			GraphicsBufferPtr instance_gb;
-			if (gs_support_)
+			std::vector<ParticleInstance> instances(num_active_particles);
+			for (uint32_t i = 0; i < num_active_particles; ++ i)
 			{
-				instance_gb = rl.GetVertexStream(0);
-			}
-			else
-			{
-				instance_gb = rl.InstanceStream();
+				Particle const & par = render_particles_[i];
+				ParticleInstance& inst = instances[i];
+				inst.pos = par.pos;
+				inst.life = par.life;
+				inst.spin = par.spin;
+				inst.size = par.size;
+				inst.life_factor = (par.init_life - par.life) / par.init_life;
+				inst.alpha = par.alpha;
 			}
 
-			uint32_t const new_instance_size = num_active_particles * sizeof(ParticleInstance);
-			if (!instance_gb || (instance_gb->Size() < new_instance_size))
-			{
-				RenderFactory& rf = Context::Instance().RenderFactoryInstance();
-				instance_gb = rf.MakeVertexBuffer(BU_Dynamic, EAH_GPU_Read | EAH_CPU_Write,
-					new_instance_size, nullptr);
+			// A frame overrunning the ring and its reserve gets an empty alloc, and draws no particles
+			SubAlloc const alloc = tb_instance_->Alloc(num_active_particles * sizeof(ParticleInstance), &instances[0]);
+			tb_instance_->EnsureDataReady();
 
-				if (gs_support_)
-				{
-					rl.SetVertexStream(0, instance_gb);
-				}
-				else
-				{
-					rl.InstanceStream(instance_gb);
-				}
-			}
+			uint32_t const start = alloc.offset_ / sizeof(ParticleInstance);
+			uint32_t const num = alloc.length_ / sizeof(ParticleInstance);
 
+			GraphicsBufferPtr const & instance_gb = tb_instance_->GetBuffer();
 			if (gs_support_)
 			{
-				rl.NumVertices(num_active_particles);
+				if (rl.GetVertexStream(0) != instance_gb)
+				{
+					rl.SetVertexStream(0, instance_gb);
+				}
+				rl.StartVertexLocation(start);
+				rl.NumVertices(num);
 			}
 			else
 			{
-				for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+				if (rl.InstanceStream() != instance_gb)
 				{
-					rl.VertexStreamFrequencyDivider(i, RenderLayout::ST_Geometry, num_active_particles);
+					rl.InstanceStream(instance_gb);
 				}
-			}
-
-			{
-				GraphicsBuffer::Mapper mapper(*instance_gb, BA_Write_Only);
-				ParticleInstance* instance_data = mapper.Pointer<ParticleInstance>();
-				for (uint32_t i = 0; i < num_active_particles; ++ i, ++ instance_data)
+				rl.StartInstanceLocation(start);
+				for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
 				{
-					Particle const & par = particles_[active_particles_[i].first];
-					instance_data->pos = par.pos;
-					instance_data->life = par.life;
-					instance_data->spin = par.spin;
-					instance_data->size = par.size;
-					instance_data->life_factor = (par.init_life - par.life) / par.init_life;
-					instance_data->alpha = par.alpha;
+					rl.VertexStreamFrequencyDivider(i, RenderLayout::ST_Geometry, num);
 				}
 			}
 		}
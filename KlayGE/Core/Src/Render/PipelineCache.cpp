@@ -0,0 +1,378 @@
+/**
+ * @file PipelineCache.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Hash.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+#include <KlayGE/PipelineCache.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const PIPELINE_CACHE_VERSION = 0x0002;
+
+	template <typename T>
+	size_t HashDesc(T const & desc)
+	{
+		char const * desc_begin = reinterpret_cast<char const *>(&desc);
+		char const * desc_end = desc_begin + sizeof(desc);
+		return HashRange(desc_begin, desc_end);
+	}
+
+	size_t HashRenderState(RasterizerStateDesc const & rs_desc, DepthStencilStateDesc const & dss_desc,
+		BlendStateDesc const & bs_desc)
+	{
+		size_t seed = HashDesc(rs_desc);
+		HashCombine(seed, HashDesc(dss_desc));
+		HashCombine(seed, HashDesc(bs_desc));
+		return seed;
+	}
+
+	template <typename T>
+	T ReadValue(ResIdentifierPtr const & res)
+	{
+		T val;
+		res->read(&val, sizeof(val));
+		return LE2Native(val);
+	}
+
+	template <typename T>
+	void WriteValue(std::ostream& os, T val)
+	{
+		val = Native2LE(val);
+		os.write(reinterpret_cast<char const *>(&val), sizeof(val));
+	}
+
+	// Lengths larger than the file come from a broken file
+	bool ReadBlock(ResIdentifierPtr const & res, uint64_t file_size, void* data, uint32_t size)
+	{
+		if ((size > file_size) || !*res)
+		{
+			return false;
+		}
+		if (size > 0)
+		{
+			res->read(data, size);
+		}
+		return !!*res;
+	}
+
+	// Effect names could be longer than a short string
+	bool ReadString(ResIdentifierPtr const & res, uint64_t file_size, std::string& str)
+	{
+		uint32_t const len = ReadValue<uint32_t>(res);
+		if ((len > file_size) || !*res)
+		{
+			return false;
+		}
+		str.resize(len);
+		return ReadBlock(res, file_size, &str[0], len);
+	}
+
+	void WriteString(std::ostream& os, std::string const & str)
+	{
+		WriteValue(os, static_cast<uint32_t>(str.size()));
+		os.write(str.data(), str.size());
+	}
+}
+
+namespace KlayGE
+{
+	PipelineCache::PipelineCache()
+		: dirty_(false), num_program_hits_(0), num_program_misses_(0)
+	{
+	}
+
+	void PipelineCache::Open(std::string const & api_name, std::string const & device_identity)
+	{
+		file_name_ = ResLoader::Instance().LocalFolder() + api_name + "_pipelines.cache";
+		device_identity_ = device_identity;
+
+		ResIdentifierPtr res = ResLoader::Instance().Open(file_name_);
+		if (!res)
+		{
+			return;
+		}
+
+		res->seekg(0, std::ios_base::end);
+		uint64_t const file_size = res->tellg();
+		res->seekg(0, std::ios_base::beg);
+
+		std::string identity;
+		uint32_t const fourcc = ReadValue<uint32_t>(res);
+		uint32_t const ver = ReadValue<uint32_t>(res);
+		bool valid = (MakeFourCC<'K', 'P', 'C', ' '>::value == fourcc) && (PIPELINE_CACHE_VERSION == ver)
+			&& ReadString(res, file_size, identity) && (identity == device_identity_);
+
+		if (valid)
+		{
+			uint32_t const num_effects = ReadValue<uint32_t>(res);
+			for (uint32_t i = 0; valid && (i < num_effects); ++ i)
+			{
+				std::string name;
+				valid = ReadString(res, file_size, name);
+				effect_names_.push_back(name);
+			}
+		}
+
+		if (valid)
+		{
+			uint32_t const num_render_states = ReadValue<uint32_t>(res);
+			for (uint32_t i = 0; valid && (i < num_render_states); ++ i)
+			{
+				RenderStateEntry entry;
+				valid = ReadBlock(res, file_size, &entry.rs_desc, sizeof(entry.rs_desc))
+					&& ReadBlock(res, file_size, &entry.dss_desc, sizeof(entry.dss_desc))
+					&& ReadBlock(res, file_size, &entry.bs_desc, sizeof(entry.bs_desc));
+				render_states_.emplace(HashRenderState(entry.rs_desc, entry.dss_desc, entry.bs_desc), entry);
+			}
+		}
+
+		if (valid)
+		{
+			uint32_t const num_sampler_states = ReadValue<uint32_t>(res);
+			for (uint32_t i = 0; valid && (i < num_sampler_states); ++ i)
+			{
+				SamplerStateDesc desc;
+				valid = ReadBlock(res, file_size, &desc, sizeof(desc));
+				sampler_states_.emplace(HashDesc(desc), desc);
+			}
+		}
+
+		if (valid)
+		{
+			uint32_t const num_programs = ReadValue<uint32_t>(res);
+			for (uint32_t i = 0; valid && (i < num_programs); ++ i)
+			{
+				uint64_t const key = ReadValue<uint64_t>(res);
+				ProgramEntry entry;
+				entry.source_hash = ReadValue<uint64_t>(res);
+				entry.format = ReadValue<uint32_t>(res);
+				uint32_t const size = ReadValue<uint32_t>(res);
+				if (size <= file_size)
+				{
+					entry.binary.resize(size);
+					valid = ReadBlock(res, file_size, entry.binary.data(), size);
+				}
+				else
+				{
+					valid = false;
+				}
+				programs_.emplace(key, std::move(entry));
+			}
+		}
+
+		if (!valid)
+		{
+			// Rebuilt from scratch, and overwritten on Save
+			effect_names_.clear();
+			render_states_.clear();
+			sampler_states_.clear();
+			programs_.clear();
+			dirty_ = true;
+		}
+	}
+
+	void PipelineCache::Save()
+	{
+		if (!this->IsOpen() || !dirty_)
+		{
+			return;
+		}
+
+		std::ofstream ofs(file_name_.c_str(), std::ios_base::binary | std::ios_base::out);
+		if (!ofs)
+		{
+			return;
+		}
+
+		WriteValue(ofs, MakeFourCC<'K', 'P', 'C', ' '>::value);
+		WriteValue(ofs, PIPELINE_CACHE_VERSION);
+		WriteString(ofs, device_identity_);
+
+		WriteValue(ofs, static_cast<uint32_t>(effect_names_.size()));
+		for (auto const & name : effect_names_)
+		{
+			WriteString(ofs, name);
+		}
+
+		WriteValue(ofs, static_cast<uint32_t>(render_states_.size()));
+		for (auto const & rs : render_states_)
+		{
+			ofs.write(reinterpret_cast<char const *>(&rs.second.rs_desc), sizeof(rs.second.rs_desc));
+			ofs.write(reinterpret_cast<char const *>(&rs.second.dss_desc), sizeof(rs.second.dss_desc));
+			ofs.write(reinterpret_cast<char const *>(&rs.second.bs_desc), sizeof(rs.second.bs_desc));
+		}
+
+		WriteValue(ofs, static_cast<uint32_t>(sampler_states_.size()));
+		for (auto const & ss : sampler_states_)
+		{
+			ofs.write(reinterpret_cast<char const *>(&ss.second), sizeof(ss.second));
+		}
+
+		WriteValue(ofs, static_cast<uint32_t>(programs_.size()));
+		for (auto const & program : programs_)
+		{
+			WriteValue(ofs, program.first);
+			WriteValue(ofs, program.second.source_hash);
+			WriteValue(ofs, program.second.format);
+			WriteValue(ofs, static_cast<uint32_t>(program.second.binary.size()));
+			ofs.write(reinterpret_cast<char const *>(program.second.binary.data()), program.second.binary.size());
+		}
+
+		dirty_ = false;
+	}
+
+	void PipelineCache::Close()
+	{
+		this->Save();
+
+		prewarmed_effects_.clear();
+		file_name_.clear();
+	}
+
+	bool PipelineCache::FindProgram(uint64_t key, uint64_t source_hash, uint32_t& format, std::vector<uint8_t>& binary) const
+	{
+		auto iter = programs_.find(key);
+		if ((iter != programs_.end()) && (iter->second.source_hash == source_hash))
+		{
+			format = iter->second.format;
+			binary = iter->second.binary;
+			++ num_program_hits_;
+			return true;
+		}
+		else
+		{
+			++ num_program_misses_;
+			return false;
+		}
+	}
+
+	void PipelineCache::StoreProgram(uint64_t key, uint64_t source_hash, uint32_t format, std::vector<uint8_t> const & binary)
+	{
+		if (!this->IsOpen())
+		{
+			return;
+		}
+
+		ProgramEntry& entry = programs_[key];
+		entry.source_hash = source_hash;
+		entry.format = format;
+		entry.binary = binary;
+		dirty_ = true;
+	}
+
+	void PipelineCache::RecordEffect(std::string const & effect_name)
+	{
+		if (!this->IsOpen())
+		{
+			return;
+		}
+
+		if (std::find(effect_names_.begin(), effect_names_.end(), effect_name) == effect_names_.end())
+		{
+			effect_names_.push_back(effect_name);
+			dirty_ = true;
+		}
+	}
+
+	void PipelineCache::RecordRenderState(RasterizerStateDesc const & rs_desc, DepthStencilStateDesc const & dss_desc,
+		BlendStateDesc const & bs_desc)
+	{
+		if (!this->IsOpen())
+		{
+			return;
+		}
+
+		size_t const seed = HashRenderState(rs_desc, dss_desc, bs_desc);
+		if (render_states_.find(seed) == render_states_.end())
+		{
+			RenderStateEntry entry;
+			entry.rs_desc = rs_desc;
+			entry.dss_desc = dss_desc;
+			entry.bs_desc = bs_desc;
+			render_states_.emplace(seed, entry);
+			dirty_ = true;
+		}
+	}
+
+	void PipelineCache::RecordSamplerState(SamplerStateDesc const & desc)
+	{
+		if (!this->IsOpen())
+		{
+			return;
+		}
+
+		size_t const seed = HashDesc(desc);
+		if (sampler_states_.find(seed) == sampler_states_.end())
+		{
+			sampler_states_.emplace(seed, desc);
+			dirty_ = true;
+		}
+	}
+
+	void PipelineCache::Prewarm()
+	{
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+
+		// Copies, since making the objects records them again
+		auto const render_states = render_states_;
+		for (auto const & rs : render_states)
+		{
+			rf.MakeRenderStateObject(rs.second.rs_desc, rs.second.dss_desc, rs.second.bs_desc);
+		}
+		auto const sampler_states = sampler_states_;
+		for (auto const & ss : sampler_states)
+		{
+			rf.MakeSamplerStateObject(ss.second);
+		}
+
+		// Held for the whole session, so the later loads of the same effects are clones
+		auto const effect_names = effect_names_;
+		for (auto const & name : effect_names)
+		{
+			std::string const kfx_name = name.substr(0, name.rfind(".")) + ".kfx";
+			if (!ResLoader::Instance().Locate(name).empty() || !ResLoader::Instance().Locate(kfx_name).empty())
+			{
+				prewarmed_effects_.push_back(ASyncLoadRenderEffect(name));
+			}
+		}
+	}
+}
@@ -278,7 +278,7 @@ namespace KlayGE
 	PostProcessPtr PostProcess::Clone()
 	{
 		RenderEffectPtr effect = effect_->Clone();
-		RenderTechnique* tech = effect->TechniqueByName(technique_->Name());
+		RenderTechnique* tech = effect->TechniqueByName(EffectNameId(technique_->NameHash()));
 
 		std::vector<std::string> param_names(params_.size());
 		for (size_t i = 0; i < param_names.size(); ++ i)
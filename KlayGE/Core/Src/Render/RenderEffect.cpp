@@ -55,8 +55,11 @@
 #include <KFL/XMLDom.hpp>
 #include <KFL/Thread.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/CustomizedStreamBuf.hpp>
 
 #include <fstream>
+#include <sstream>
 #include <boost/assert.hpp>
 #if defined(KLAYGE_COMPILER_GCC)
 #pragma GCC diagnostic push
@@ -75,7 +78,7 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const KFX_VERSION = 0x0110;
+	uint32_t const KFX_VERSION = 0x0113;
 
 	std::mutex singleton_mutex;
 
@@ -2662,6 +2665,24 @@ namespace
 		}
 	}
 #endif
+
+	// Identifies a pass in the pipeline cache across runs. Hashed in 64 bits from the names, since size_t hashes are
+	// only 32 bits on 32-bit builds.
+	uint64_t PassPipelineKey(RenderEffect const & effect, uint32_t tech_index, uint32_t pass_index)
+	{
+		uint64_t seed = 0;
+		for (char ch : effect.ResName())
+		{
+			HashCombineImpl(seed, static_cast<uint64_t>(ch));
+		}
+		HashCombineImpl(seed, static_cast<uint64_t>(0));
+		for (char ch : effect.TechniqueByIndex(tech_index)->Name())
+		{
+			HashCombineImpl(seed, static_cast<uint64_t>(ch));
+		}
+		HashCombineImpl(seed, static_cast<uint64_t>(pass_index));
+		return seed;
+	}
 }
 
 namespace KlayGE
@@ -2796,9 +2817,16 @@ namespace KlayGE
 		}
 
 		ret->shader_objs_.resize(shader_objs_.size());
+		ret->shader_obj_flags_.resize(shader_objs_.size());
 		for (size_t i = 0; i < shader_objs_.size(); ++ i)
 		{
-			ret->shader_objs_[i] = shader_objs_[i]->Clone(*ret);
+			// The slots not used yet are created by the clone on its own first use
+			ShaderObjectPtr const & shader_obj = this->ShaderObjectByIndex(static_cast<uint32_t>(i));
+			if (std::atomic_load(&shader_obj))
+			{
+				ret->shader_objs_[i] = shader_obj->Clone(*ret);
+			}
+			ret->shader_obj_flags_[i] = MakeUniquePtr<std::once_flag>();
 		}
 
 		return ret;
@@ -2816,41 +2844,38 @@ namespace KlayGE
 
 	RenderEffectParameter* RenderEffect::ParameterByName(std::string const & name) const
 	{
-		size_t const name_hash = HashRange(name.begin(), name.end());
-		for (auto const & param : params_)
-		{
-			if (name_hash == param->NameHash())
-			{
-				return param.get();
-			}
-		}
-		return nullptr;
+		return this->ParameterByName(EffectNameId(name));
+	}
+
+	RenderEffectParameter* RenderEffect::ParameterByName(EffectNameId name) const
+	{
+		auto const & indices = effect_template_->param_name_indices_;
+		auto iter = indices.find(name.Hash());
+		return (iter != indices.end()) ? params_[iter->second].get() : nullptr;
 	}
 
 	RenderEffectParameter* RenderEffect::ParameterBySemantic(std::string const & semantic) const
 	{
-		size_t const semantic_hash = HashRange(semantic.begin(), semantic.end());
-		for (auto const & param : params_)
-		{
-			if (semantic_hash == param->SemanticHash())
-			{
-				return param.get();
-			}
-		}
-		return nullptr;
+		return this->ParameterBySemantic(EffectNameId(semantic));
+	}
+
+	RenderEffectParameter* RenderEffect::ParameterBySemantic(EffectNameId semantic) const
+	{
+		auto const & indices = effect_template_->param_semantic_indices_;
+		auto iter = indices.find(semantic.Hash());
+		return (iter != indices.end()) ? params_[iter->second].get() : nullptr;
 	}
 
 	RenderEffectConstantBuffer* RenderEffect::CBufferByName(std::string const & name) const
 	{
-		size_t const name_hash = HashRange(name.begin(), name.end());
-		for (auto const & cbuffer : cbuffers_)
-		{
-			if (name_hash == cbuffer->NameHash())
-			{
-				return cbuffer.get();
-			}
-		}
-		return nullptr;
+		return this->CBufferByName(EffectNameId(name));
+	}
+
+	RenderEffectConstantBuffer* RenderEffect::CBufferByName(EffectNameId name) const
+	{
+		auto const & indices = effect_template_->cbuffer_name_indices_;
+		auto iter = indices.find(name.Hash());
+		return (iter != indices.end()) ? cbuffers_[iter->second].get() : nullptr;
 	}
 
 	uint32_t RenderEffect::NumTechniques() const
@@ -2863,6 +2888,11 @@ namespace KlayGE
 		return effect_template_->TechniqueByName(name);
 	}
 
+	RenderTechnique* RenderEffect::TechniqueByName(EffectNameId name) const
+	{
+		return effect_template_->TechniqueByName(name);
+	}
+
 	RenderTechnique* RenderEffect::TechniqueByIndex(uint32_t n) const
 	{
 		return effect_template_->TechniqueByIndex(n);
@@ -2907,9 +2937,60 @@ namespace KlayGE
 	{
 		uint32_t index = static_cast<uint32_t>(shader_objs_.size());
 		shader_objs_.push_back(Context::Instance().RenderFactoryInstance().MakeShaderObject());
+		shader_obj_flags_.push_back(MakeUniquePtr<std::once_flag>());
 		return index;
 	}
 
+	void RenderEffect::Prewarm() const
+	{
+		std::vector<std::pair<RenderTechnique const *, uint32_t>> passes;
+		for (uint32_t i = 0; i < this->NumTechniques(); ++ i)
+		{
+			RenderTechnique const * tech = this->TechniqueByIndex(i);
+			for (uint32_t j = 0; j < tech->NumPasses(); ++ j)
+			{
+				passes.emplace_back(tech, j);
+			}
+		}
+		uint32_t const num_passes = static_cast<uint32_t>(passes.size());
+
+		auto prewarm_range = [this, &passes](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; ++ i)
+			{
+				passes[i].first->Pass(passes[i].second).GetShaderObject(*this);
+			}
+		};
+
+		RenderDeviceCaps const & caps = Context::Instance().RenderFactoryInstance().RenderEngineInstance().DeviceCaps();
+		uint32_t num_tasks = 1;
+		if (caps.multithread_res_creating_support)
+		{
+			CPUInfo cpu;
+			num_tasks = std::max(std::min(static_cast<uint32_t>(cpu.NumHWThreads()), num_passes), 1U);
+		}
+		uint32_t const passes_per_task = (num_passes + num_tasks - 1) / num_tasks;
+
+		// A pass attaching the shaders of an earlier one creates that one first, on the same thread
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_tasks - 1);
+		thread_pool& tp = Context::Instance().ThreadPool();
+		for (uint32_t i = 1; i < num_tasks; ++ i)
+		{
+			uint32_t const begin = i * passes_per_task;
+			uint32_t const end = std::min(begin + passes_per_task, num_passes);
+			if (begin < end)
+			{
+				joiners.push_back(tp(std::bind(prewarm_range, begin, end)));
+			}
+		}
+		prewarm_range(0, std::min(passes_per_task, num_passes));
+		for (auto& j : joiners)
+		{
+			j();
+		}
+	}
+
 #if KLAYGE_IS_DEV_PLATFORM
 	void RenderEffect::GenHLSLShaderText()
 	{
@@ -2988,6 +3069,8 @@ namespace KlayGE
 
 		res_name_ = fxml_name;
 		res_name_hash_ = HashRange(fxml_name.begin(), fxml_name.end());
+
+		Context::Instance().RenderFactoryInstance().PipelineCacheInstance().RecordEffect(name);
 #if KLAYGE_IS_DEV_PLATFORM
 		if (source)
 		{
@@ -3022,11 +3105,13 @@ namespace KlayGE
 				effect.params_.clear();
 				effect.cbuffers_.clear();
 				effect.shader_objs_.clear();
+				effect.shader_obj_flags_.clear();
 
 				macros_.reset();
 				shader_frags_.clear();
 				hlsl_shader_.clear();
 				techniques_.clear();
+				technique_name_indices_.clear();
 
 				shader_descs_.resize(1);
 
@@ -3172,6 +3257,7 @@ namespace KlayGE
 					effect.params_.push_back(MakeUniquePtr<RenderEffectParameter>());
 					effect.params_.back()->Load(node);
 				}
+				this->IndexNames(effect);
 
 				for (XMLNodePtr shader_node = root->FirstNode("shader"); shader_node; shader_node = shader_node->NextSibling("shader"))
 				{
@@ -3186,6 +3272,7 @@ namespace KlayGE
 				{
 					techniques_.push_back(MakeUniquePtr<RenderTechnique>());
 					techniques_.back()->Load(effect, node, index);
+					technique_name_indices_.emplace(techniques_.back()->NameHash(), index);
 				}
 			}
 
@@ -3277,6 +3364,7 @@ namespace KlayGE
 								effect.params_[i]->StreamIn(source);
 							}
 						}
+						this->IndexNames(effect);
 
 						{
 							uint16_t num_shader_frags;
@@ -3320,17 +3408,75 @@ namespace KlayGE
 							}
 						}
 
-						ret = true;
 						{
 							uint16_t num_techs;
 							source->read(&num_techs, sizeof(num_techs));
 							num_techs = LE2Native(num_techs);
+
+							// The sizes of the techniques come first, so all of them are read at once, and parsed
+							// in parallel in place
+							std::vector<uint32_t> tech_offsets(num_techs + 1);
+							tech_offsets[0] = 0;
+							for (uint32_t i = 0; i < num_techs; ++ i)
+							{
+								uint32_t size;
+								source->read(&size, sizeof(size));
+								tech_offsets[i + 1] = tech_offsets[i] + LE2Native(size);
+							}
+
+							auto kfx_data = MakeSharedPtr<std::vector<uint8_t>>(tech_offsets[num_techs]);
+							if (!kfx_data->empty())
+							{
+								source->read(kfx_data->data(), kfx_data->size());
+							}
+
 							techniques_.resize(num_techs);
+							auto stream_in_range = [this, &source, &kfx_data, &tech_offsets](uint32_t begin, uint32_t end)
+							{
+								for (uint32_t i = begin; i < end; ++ i)
+								{
+									uint8_t const * tech_data = kfx_data->data();
+									auto tech_buf = MakeSharedPtr<MemStreamBuf>(tech_data + tech_offsets[i],
+										tech_data + tech_offsets[i + 1]);
+									auto tech_source = MakeSharedPtr<ResIdentifier>(source->ResName(), source->Timestamp(),
+										MakeSharedPtr<std::istream>(tech_buf.get()), tech_buf);
+
+									techniques_[i] = MakeUniquePtr<RenderTechnique>();
+									techniques_[i]->StreamIn(tech_source, kfx_data, tech_offsets[i], i);
+								}
+							};
+
+							CPUInfo cpu;
+							uint32_t const num_tasks = std::max(std::min(static_cast<uint32_t>(cpu.NumHWThreads()),
+								static_cast<uint32_t>(num_techs)), 1U);
+							uint32_t const techs_per_task = (num_techs + num_tasks - 1) / num_tasks;
+
+							std::vector<joiner<void>> joiners;
+							joiners.reserve(num_tasks - 1);
+							thread_pool& tp = Context::Instance().ThreadPool();
+							for (uint32_t i = 1; i < num_tasks; ++ i)
+							{
+								uint32_t const begin = i * techs_per_task;
+								uint32_t const end = std::min(begin + techs_per_task, static_cast<uint32_t>(num_techs));
+								if (begin < end)
+								{
+									joiners.push_back(tp(std::bind(stream_in_range, begin, end)));
+								}
+							}
+							stream_in_range(0, std::min(techs_per_task, static_cast<uint32_t>(num_techs)));
+							for (auto& j : joiners)
+							{
+								j();
+							}
+
+							// State objects and shader object slots come from the loading thread, in order
+							technique_name_indices_.clear();
 							for (uint32_t i = 0; i < num_techs; ++ i)
 							{
-								techniques_[i] = MakeUniquePtr<RenderTechnique>();
-								ret &= techniques_[i]->StreamIn(effect, source, i);
+								techniques_[i]->Resolve(effect);
+								technique_name_indices_.emplace(techniques_[i]->NameHash(), i);
 							}
+							ret = true;
 						}
 					}
 				}
@@ -3448,9 +3594,20 @@ namespace KlayGE
 		{
 			uint16_t num_techs = Native2LE(static_cast<uint16_t>(techniques_.size()));
 			os.write(reinterpret_cast<char const *>(&num_techs), sizeof(num_techs));
+
+			std::vector<std::string> techs_data(techniques_.size());
 			for (uint32_t i = 0; i < techniques_.size(); ++ i)
 			{
-				techniques_[i]->StreamOut(effect, os, i);
+				std::ostringstream oss(std::ios_base::binary | std::ios_base::out);
+				techniques_[i]->StreamOut(effect, oss, i);
+				techs_data[i] = oss.str();
+
+				uint32_t size = Native2LE(static_cast<uint32_t>(techs_data[i].size()));
+				os.write(reinterpret_cast<char const *>(&size), sizeof(size));
+			}
+			for (auto const & tech_data : techs_data)
+			{
+				os.write(tech_data.data(), tech_data.size());
 			}
 		}
 	}
@@ -3458,15 +3615,35 @@ namespace KlayGE
 
 	RenderTechnique* RenderEffectTemplate::TechniqueByName(std::string const & name) const
 	{
-		size_t const name_hash = HashRange(name.begin(), name.end());
-		for (auto const & tech : techniques_)
+		return this->TechniqueByName(EffectNameId(name));
+	}
+
+	RenderTechnique* RenderEffectTemplate::TechniqueByName(EffectNameId name) const
+	{
+		auto iter = technique_name_indices_.find(name.Hash());
+		return (iter != technique_name_indices_.end()) ? techniques_[iter->second].get() : nullptr;
+	}
+
+	// Parameters and cbuffers are indexed before the techniques are loaded, since linking the shaders looks them up.
+	// The first one wins if names collide, as the linear search did.
+	void RenderEffectTemplate::IndexNames(RenderEffect const & effect)
+	{
+		param_name_indices_.clear();
+		param_semantic_indices_.clear();
+		for (uint32_t i = 0; i < effect.params_.size(); ++ i)
 		{
-			if (name_hash == tech->NameHash())
+			param_name_indices_.emplace(effect.params_[i]->NameHash(), i);
+			if (effect.params_[i]->HasSemantic())
 			{
-				return tech.get();
+				param_semantic_indices_.emplace(effect.params_[i]->SemanticHash(), i);
 			}
 		}
-		return nullptr;
+
+		cbuffer_name_indices_.clear();
+		for (uint32_t i = 0; i < effect.cbuffers_.size(); ++ i)
+		{
+			cbuffer_name_indices_.emplace(effect.cbuffers_[i]->NameHash(), i);
+		}
 	}
 
 	uint32_t RenderEffectTemplate::AddShaderDesc(ShaderDesc const & sd)
@@ -3943,7 +4120,8 @@ namespace KlayGE
 	}
 #endif
 
-	bool RenderTechnique::StreamIn(RenderEffect& effect, ResIdentifierPtr const & res, uint32_t tech_index)
+	void RenderTechnique::StreamIn(ResIdentifierPtr const & res, std::shared_ptr<std::vector<uint8_t>> const & kfx_data,
+		uint32_t offset, uint32_t tech_index)
 	{
 		name_ = ReadShortString(res);
 		name_hash_ = HashRange(name_.begin(), name_.end());
@@ -3977,16 +4155,15 @@ namespace KlayGE
 			}
 		}
 
-		is_validate_ = true;
-
-		has_discard_ = false;
-		has_tessellation_ = false;
-		
 		res->read(&transparent_, sizeof(transparent_));
 		res->read(&weight_, sizeof(weight_));
 		weight_ = LE2Native(weight_);
 
-		bool ret = true;
+		// Stored instead of asking the shader objects, which don't exist yet
+		res->read(&is_validate_, sizeof(is_validate_));
+		res->read(&has_discard_, sizeof(has_discard_));
+		res->read(&has_tessellation_, sizeof(has_tessellation_));
+
 		uint8_t num_passes;
 		res->read(&num_passes, sizeof(num_passes));
 		passes_.resize(num_passes);
@@ -3995,15 +4172,24 @@ namespace KlayGE
 			RenderPassPtr pass = MakeSharedPtr<RenderPass>();
 			passes_[pass_index] = pass;
 
-			ret &= pass->StreamIn(effect, res, tech_index, pass_index);
-
-			is_validate_ &= pass->Validate();
+			pass->StreamIn(res, kfx_data, offset, tech_index, pass_index);
+		}
+	}
 
-			has_discard_ |= pass->GetShaderObject(effect)->HasDiscard();
-			has_tessellation_ |= pass->GetShaderObject(effect)->HasTessellation();
+	void RenderTechnique::Resolve(RenderEffect& effect)
+	{
+		for (auto const & pass : passes_)
+		{
+			pass->Resolve(effect);
 		}
+	}
 
-		return ret;
+	void RenderTechnique::Prewarm(RenderEffect const & effect) const
+	{
+		for (auto const & pass : passes_)
+		{
+			pass->GetShaderObject(effect);
+		}
 	}
 
 #if KLAYGE_IS_DEV_PLATFORM
@@ -4049,6 +4235,10 @@ namespace KlayGE
 		float w = Native2LE(weight_);
 		os.write(reinterpret_cast<char const *>(&w), sizeof(w));
 
+		os.write(reinterpret_cast<char const *>(&is_validate_), sizeof(is_validate_));
+		os.write(reinterpret_cast<char const *>(&has_discard_), sizeof(has_discard_));
+		os.write(reinterpret_cast<char const *>(&has_tessellation_), sizeof(has_tessellation_));
+
 		uint8_t num_passes = static_cast<uint8_t>(passes_.size());
 		os.write(reinterpret_cast<char const *>(&num_passes), sizeof(num_passes));
 		for (uint32_t pass_index = 0; pass_index < num_passes; ++ pass_index)
@@ -4550,6 +4740,7 @@ namespace KlayGE
 			}
 		}
 
+		shader_obj->PipelineKey(PassPipelineKey(effect, tech_index, pass_index));
 		shader_obj->LinkShaders(effect);
 
 		is_validate_ = shader_obj->Validate();
@@ -4606,17 +4797,23 @@ namespace KlayGE
 			}
 		}
 
+		shader_obj->PipelineKey(PassPipelineKey(effect, tech_index, pass_index));
 		shader_obj->LinkShaders(effect);
 
 		is_validate_ = shader_obj->Validate();
 	}
 #endif
 
-	bool RenderPass::StreamIn(RenderEffect& effect,
-		ResIdentifierPtr const & res, uint32_t tech_index, uint32_t pass_index)
+	struct RenderPass::StateDescs
 	{
-		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+		RasterizerStateDesc rs_desc;
+		DepthStencilStateDesc dss_desc;
+		BlendStateDesc bs_desc;
+	};
 
+	void RenderPass::StreamIn(ResIdentifierPtr const & res, std::shared_ptr<std::vector<uint8_t>> const & kfx_data,
+		uint32_t offset, uint32_t tech_index, uint32_t pass_index)
+	{
 		name_ = ReadShortString(res);
 		name_hash_ = HashRange(name_.begin(), name_.end());
 
@@ -4649,9 +4846,10 @@ namespace KlayGE
 			}
 		}
 
-		RasterizerStateDesc rs_desc;
-		DepthStencilStateDesc dss_desc;
-		BlendStateDesc bs_desc;
+		state_descs_ = MakeSharedPtr<StateDescs>();
+		RasterizerStateDesc& rs_desc = state_descs_->rs_desc;
+		DepthStencilStateDesc& dss_desc = state_descs_->dss_desc;
+		BlendStateDesc& bs_desc = state_descs_->bs_desc;
 
 		res->read(&rs_desc, sizeof(rs_desc));
 		rs_desc.polygon_mode = LE2Native(rs_desc.polygon_mode);
@@ -4692,8 +4890,6 @@ namespace KlayGE
 			bs_desc.src_blend_alpha[i] = LE2Native(bs_desc.src_blend_alpha[i]);
 			bs_desc.dest_blend_alpha[i] = LE2Native(bs_desc.dest_blend_alpha[i]);
 		}
-		
-		render_state_obj_ = rf.MakeRenderStateObject(rs_desc, dss_desc, bs_desc);
 
 		res->read(&shader_desc_ids_[0], shader_desc_ids_.size() * sizeof(shader_desc_ids_[0]));
 		for (int i = 0; i < ShaderObject::ST_NumShaderTypes; ++ i)
@@ -4701,9 +4897,57 @@ namespace KlayGE
 			shader_desc_ids_[i] = LE2Native(shader_desc_ids_[i]);
 		}
 
-		
-		shader_obj_index_ = effect.AddShaderObject();
-		auto const & shader_obj = this->GetShaderObject(effect);
+		res->read(&is_validate_, sizeof(is_validate_));
+
+		// The native shaders stay in the kfx data until the shader object is created
+		uint32_t size;
+		res->read(&size, sizeof(size));
+		kfx_data_ = kfx_data;
+		native_offset_ = offset + static_cast<uint32_t>(res->tellg());
+		native_size_ = LE2Native(size);
+		res->seekg(native_size_, std::ios_base::cur);
+
+		tech_index_ = tech_index;
+		pass_index_ = pass_index;
+	}
+
+	void RenderPass::Resolve(RenderEffect& effect)
+	{
+		BOOST_ASSERT(state_descs_);
+
+		render_state_obj_ = Context::Instance().RenderFactoryInstance().MakeRenderStateObject(
+			state_descs_->rs_desc, state_descs_->dss_desc, state_descs_->bs_desc);
+		state_descs_.reset();
+
+		shader_obj_index_ = static_cast<uint32_t>(effect.shader_objs_.size());
+		effect.shader_objs_.push_back(ShaderObjectPtr());
+		effect.shader_obj_flags_.push_back(MakeUniquePtr<std::once_flag>());
+	}
+
+	ShaderObjectPtr const & RenderPass::GetShaderObject(RenderEffect const & effect) const
+	{
+		if (kfx_data_)
+		{
+			std::call_once(*effect.shader_obj_flags_[shader_obj_index_], [this, &effect]
+				{
+					// Filled already in an effect cloned after the first use
+					if (!effect.ShaderObjectByIndex(shader_obj_index_))
+					{
+						this->CreateShaderObject(effect);
+					}
+				});
+		}
+		return effect.ShaderObjectByIndex(shader_obj_index_);
+	}
+
+	void RenderPass::CreateShaderObject(RenderEffect const & effect) const
+	{
+		ShaderObjectPtr shader_obj = Context::Instance().RenderFactoryInstance().MakeShaderObject();
+
+		uint8_t const * native_shaders = kfx_data_->data() + native_offset_;
+		auto native_buf = MakeSharedPtr<MemStreamBuf>(native_shaders, native_shaders + native_size_);
+		ResIdentifierPtr res = MakeSharedPtr<ResIdentifier>(effect.ResName(), 0,
+			MakeSharedPtr<std::istream>(native_buf.get()), native_buf);
 
 		bool native_accepted = true;
 
@@ -4715,7 +4959,7 @@ namespace KlayGE
 				ShaderObject::ShaderType st = static_cast<ShaderObject::ShaderType>(type);
 
 				bool this_native_accepted;
-				if (sd.tech_pass_type != (tech_index << 16) + (pass_index << 8) + type)
+				if (sd.tech_pass_type != (tech_index_ << 16) + (pass_index_ << 8) + type)
 				{
 					auto const & tech = *effect.TechniqueByIndex(sd.tech_pass_type >> 16);
 					auto const & pass = tech.Pass((sd.tech_pass_type >> 8) & 0xFF);
@@ -4724,19 +4968,24 @@ namespace KlayGE
 				}
 				else
 				{
-					this_native_accepted = shader_obj->StreamIn(res, static_cast<ShaderObject::ShaderType>(type),
-						effect, shader_desc_ids_);
+					this_native_accepted = shader_obj->StreamIn(res, st, effect, shader_desc_ids_);
 				}
 
 				native_accepted &= this_native_accepted;
 			}
 		}
 
+		shader_obj->PipelineKey(PassPipelineKey(effect, tech_index_, pass_index_));
 		shader_obj->LinkShaders(effect);
 
-		is_validate_ = shader_obj->Validate();
+		// Too late to fall back to the fxml here
+		if (!native_accepted)
+		{
+			LogError("Native shaders of %s are rejected. Delete the kfx to rebuild it.", effect.ResName().c_str());
+		}
 
-		return native_accepted;
+		// Clone reads the slots of the effect it's cloned from, maybe while another thread creates them
+		std::atomic_store(&effect.shader_objs_[shader_obj_index_], shader_obj);
 	}
 
 #if KLAYGE_IS_DEV_PLATFORM
@@ -4828,6 +5077,9 @@ namespace KlayGE
 			os.write(reinterpret_cast<char const *>(&tmp), sizeof(tmp));
 		}
 
+		os.write(reinterpret_cast<char const *>(&is_validate_), sizeof(is_validate_));
+
+		std::ostringstream oss(std::ios_base::binary | std::ios_base::out);
 		for (int type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
 		{
 			ShaderDesc const & sd = effect.GetShaderDesc(shader_desc_ids_[type]);
@@ -4835,10 +5087,15 @@ namespace KlayGE
 			{
 				if (sd.tech_pass_type == (tech_index << 16) + (pass_index << 8) + type)
 				{
-					this->GetShaderObject(effect)->StreamOut(os, static_cast<ShaderObject::ShaderType>(type));
+					this->GetShaderObject(effect)->StreamOut(oss, static_cast<ShaderObject::ShaderType>(type));
 				}
 			}
 		}
+		std::string const native_shaders = oss.str();
+
+		uint32_t size = Native2LE(static_cast<uint32_t>(native_shaders.size()));
+		os.write(reinterpret_cast<char const *>(&size), sizeof(size));
+		os.write(native_shaders.data(), native_shaders.size());
 	}
 #endif
 
@@ -4905,8 +5162,11 @@ namespace KlayGE
 
 		ret->name_ = name_;
 		ret->param_indices_ = param_indices_;
+		ret->hw_buff_ = hw_buff_;
+		ret->hw_buff_shared_ = hw_buff_shared_;
 		ret->buff_ = buff_;
-		ret->Resize(static_cast<uint32_t>(buff_.size()));
+		ret->dirty_begin_ = dirty_begin_;
+		ret->dirty_end_ = dirty_end_;
 
 		for (size_t i = 0; i < param_indices_->size(); ++ i)
 		{
@@ -4928,33 +5188,89 @@ namespace KlayGE
 
 	void RenderEffectConstantBuffer::Resize(uint32_t size)
 	{
-		buff_.resize(size);
+		if (size != buff_->size())
+		{
+			if (buff_.use_count() > 1)
+			{
+				buff_ = MakeSharedPtr<std::vector<uint8_t>>(*buff_);
+				hw_buff_.reset();
+			}
+			buff_->resize(size);
+		}
 		if (size > 0)
 		{
 			if (!hw_buff_ || (size > hw_buff_->Size()))
 			{
 				RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 				hw_buff_ = rf.MakeConstantBuffer(BU_Dynamic, 0, size, nullptr);
+				hw_buff_shared_ = false;
 			}
 		}
 
-		dirty_ = true;
+		this->Dirty(true);
 	}
 
+	// Only the dirty span is uploaded if the device could update a part of a cbuffer. Otherwise it's the whole buffer,
+	// but still nothing when all the writes since last Update kept the values.
 	void RenderEffectConstantBuffer::Update()
 	{
-		if (dirty_)
+		if (hw_buff_shared_)
 		{
-			hw_buff_->UpdateSubresource(0, static_cast<uint32_t>(buff_.size()), &buff_[0]);
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			hw_buff_ = rf.MakeConstantBuffer(BU_Dynamic, 0, hw_buff_->Size(), nullptr);
+			hw_buff_shared_ = false;
+		}
 
-			dirty_ = false;
+		uint32_t const size = static_cast<uint32_t>(buff_->size());
+		uint32_t const dirty_end = std::min(dirty_end_, size);
+		uint32_t bytes_uploaded = 0;
+		if (dirty_begin_ < dirty_end)
+		{
+			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			if (re.DeviceCaps().cbuffer_partial_update_support)
+			{
+				bytes_uploaded = dirty_end - dirty_begin_;
+				hw_buff_->UpdateSubresource(dirty_begin_, bytes_uploaded, &(*buff_)[dirty_begin_]);
+			}
+			else
+			{
+				bytes_uploaded = size;
+				hw_buff_->UpdateSubresource(0, size, &(*buff_)[0]);
+			}
 		}
+
+		if ((bytes_uploaded > 0) || (bytes_written_ > 0))
+		{
+			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			re.OnCBufferUpdated(bytes_written_, bytes_uploaded);
+		}
+
+		this->Dirty(false);
+		bytes_written_ = 0;
 	}
 
 	void RenderEffectConstantBuffer::BindHWBuff(GraphicsBufferPtr const & buff)
 	{
+		if (buff_.use_count() > 1)
+		{
+			buff_ = MakeSharedPtr<std::vector<uint8_t>>(*buff_);
+		}
 		hw_buff_ = buff;
-		buff_.resize(buff->Size());
+		hw_buff_shared_ = false;
+		buff_->resize(buff->Size());
+	}
+
+	// The clones sharing the memory keep the old hardware buffer, so a new one is needed with the new memory. Writes
+	// could come from the recording threads, so it's made in Update.
+	void RenderEffectConstantBuffer::CopyOnWrite()
+	{
+		buff_ = MakeSharedPtr<std::vector<uint8_t>>(*buff_);
+		if (hw_buff_)
+		{
+			hw_buff_shared_ = true;
+		}
+
+		this->Dirty(true);
 	}
 
 
@@ -5167,7 +5483,15 @@ namespace KlayGE
 		ret->semantic_ = semantic_;
 
 		ret->type_ = type_;
-		ret->var_ = var_->Clone();
+		if (var_->InCBuffer())
+		{
+			// Rebound to the cbuffer of the clone later
+			ret->var_ = var_->Clone();
+		}
+		else
+		{
+			ret->var_ = var_;
+		}
 		ret->array_size_ = array_size_;
 
 		ret->annotations_ = annotations_;
@@ -5195,6 +5519,11 @@ namespace KlayGE
 
 	void RenderEffectParameter::BindToCBuffer(RenderEffectConstantBuffer& cbuff, uint32_t offset, uint32_t stride)
 	{
+		if (var_.use_count() > 1)
+		{
+			this->CopyVarOnWrite();
+		}
+
 		cbuff_ = &cbuff;
 		var_->BindToCBuffer(cbuff, offset, stride);
 	}
@@ -5205,6 +5534,11 @@ namespace KlayGE
 		var_->RebindToCBuffer(cbuff);
 	}
 
+	void RenderEffectParameter::CopyVarOnWrite()
+	{
+		var_ = var_->Clone();
+	}
+
 
 #if KLAYGE_IS_DEV_PLATFORM
 	void RenderShaderFragment::Load(XMLNodePtr const & node)
@@ -5748,15 +6082,26 @@ namespace KlayGE
 	{
 		if (in_cbuff_)
 		{
-			float4x4* target = data_.cbuff_desc.cbuff->VariableInBuff<float4x4>(data_.cbuff_desc.offset);
+			RenderEffectConstantBuffer const & const_cbuff = *data_.cbuff_desc.cbuff;
+			float4x4 const * current = const_cbuff.VariableInBuff<float4x4>(data_.cbuff_desc.offset);
+			float4x4* target = nullptr;
 
 			size_ = static_cast<uint32_t>(value.size());
-			for (size_t i = 0; i < value.size(); ++ i)
+			for (uint32_t i = 0; i < size_; ++ i)
 			{
-				target[i] = MathLib::transpose(value[i]);
+				float4x4 const mat = MathLib::transpose(value[i]);
+				if (current[i] != mat)
+				{
+					if (!target)
+					{
+						target = data_.cbuff_desc.cbuff->VariableInBuff<float4x4>(data_.cbuff_desc.offset);
+						current = target;
+					}
+					target[i] = mat;
+					data_.cbuff_desc.cbuff->Dirty(data_.cbuff_desc.offset + i * sizeof(float4x4), sizeof(float4x4));
+				}
 			}
-
-			data_.cbuff_desc.cbuff->Dirty(true);
+			data_.cbuff_desc.cbuff->AddBytesWritten(size_ * static_cast<uint32_t>(sizeof(float4x4)));
 		}
 		else
 		{
@@ -5769,7 +6114,8 @@ namespace KlayGE
 	{
 		if (in_cbuff_)
 		{
-			float4x4 const * src = data_.cbuff_desc.cbuff->VariableInBuff<float4x4>(data_.cbuff_desc.offset);
+			RenderEffectConstantBuffer const & const_cbuff = *data_.cbuff_desc.cbuff;
+			float4x4 const * src = const_cbuff.VariableInBuff<float4x4>(data_.cbuff_desc.offset);
 
 			val.resize(size_);
 			for (size_t i = 0; i < size_; ++ i)
@@ -66,6 +66,7 @@ namespace KlayGE
 	RenderEngine::RenderEngine()
 		: num_primitives_just_rendered_(0), num_vertices_just_rendered_(0),
 			num_draws_just_called_(0), num_dispatches_just_called_(0),
+			num_cbuffer_bytes_just_written_(0), num_cbuffer_bytes_just_uploaded_(0),
 			default_fov_(PI / 4), default_render_width_scale_(1), default_render_height_scale_(1),
 			motion_frames_(0),
 			stereo_method_(STM_None), stereo_separation_(0),
@@ -456,6 +457,9 @@ namespace KlayGE
 		resize_pp_perf_ = profiler.CreatePerfRange(0, "Resize PP");
 		stereoscopic_pp_perf_ = profiler.CreatePerfRange(0, "Stereoscopic PP");
 #endif
+
+		// The pipelines of the last session are ready before the app asks for them
+		rf.PipelineCacheInstance().Prewarm();
 	}
 
 	void RenderEngine::DestroyRenderWindow()
@@ -508,7 +512,9 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void RenderEngine::SetStateObject(RenderStateObjectPtr const & rs_obj)
 	{
-		if (cur_rs_obj_ != rs_obj)
+		bool const changed = (cur_rs_obj_ != rs_obj);
+		binding_cache_.Count(BindingCache::BT_StateObject, changed);
+		if (changed)
 		{
 			if (force_line_mode_)
 			{
@@ -594,6 +600,18 @@ namespace KlayGE
 		this->DoRender(effect, tech, rl);
 	}
 
+	void RenderEngine::PrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
+	{
+		this->DoPrepareDraw(effect, tech, rl);
+	}
+
+	void RenderEngine::DoPrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
+	{
+		KFL_UNUSED(effect);
+		KFL_UNUSED(tech);
+		KFL_UNUSED(rl);
+	}
+
 	void RenderEngine::Dispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz)
 	{
 		this->DoDispatch(effect, tech, tgx, tgy, tgz);
@@ -637,6 +655,34 @@ namespace KlayGE
 		return ret;
 	}
 
+	uint32_t RenderEngine::NumBindsJustIssued()
+	{
+		uint32_t const ret = binding_cache_.NumIssued();
+		binding_cache_.ResetNumIssued();
+		return ret;
+	}
+
+	uint32_t RenderEngine::NumBindsJustSkipped()
+	{
+		uint32_t const ret = binding_cache_.NumSkipped();
+		binding_cache_.ResetNumSkipped();
+		return ret;
+	}
+
+	uint32_t RenderEngine::NumCBufferBytesJustWritten()
+	{
+		uint32_t const ret = num_cbuffer_bytes_just_written_;
+		num_cbuffer_bytes_just_written_ = 0;
+		return ret;
+	}
+
+	uint32_t RenderEngine::NumCBufferBytesJustUploaded()
+	{
+		uint32_t const ret = num_cbuffer_bytes_just_uploaded_;
+		num_cbuffer_bytes_just_uploaded_ = 0;
+		return ret;
+	}
+
 	// ȡȾ豸
 	/////////////////////////////////////////////////////////////////////////////////
 	RenderDeviceCaps const & RenderEngine::DeviceCaps() const
@@ -1248,6 +1294,7 @@ namespace KlayGE
 
 		cur_rs_obj_.reset();
 		cur_line_rs_obj_.reset();
+		binding_cache_.Invalidate();
 
 		pp_rl_.reset();
 		vpp_rl_.reset();
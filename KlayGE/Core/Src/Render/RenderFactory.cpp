@@ -35,6 +35,9 @@ namespace KlayGE
 {
 	RenderFactory::~RenderFactory()
 	{
+		// The prewarmed effects hold shader objects of the engine
+		pipeline_cache_.Close();
+
 		for (auto& rs : rs_pool_)
 		{
 			rs.second.reset();
@@ -59,6 +62,9 @@ namespace KlayGE
 	
 	void RenderFactory::Suspend()
 	{
+		// The process might not come back from suspension
+		pipeline_cache_.Save();
+
 		if (re_)
 		{
 			re_->Suspend();
@@ -149,6 +155,7 @@ namespace KlayGE
 		{
 			ret = this->DoMakeRenderStateObject(rs_desc, dss_desc, bs_desc);
 			rs_pool_.emplace(seed, ret);
+			pipeline_cache_.RecordRenderState(rs_desc, dss_desc, bs_desc);
 		}
 		else
 		{
@@ -172,6 +179,7 @@ namespace KlayGE
 		{
 			ret = this->DoMakeSamplerStateObject(desc);
 			ss_pool_.emplace(seed, ret);
+			pipeline_cache_.RecordSamplerState(desc);
 		}
 		else
 		{
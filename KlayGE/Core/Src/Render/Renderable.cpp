@@ -28,14 +28,67 @@
 #include <KlayGE/Camera.hpp>
 #include <KlayGE/RenderMaterial.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/RenderLayout.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/CommandList.hpp>
+#include <KFL/Hash.hpp>
+
+#include <cstring>
+#include <typeinfo>
 
 #include <KlayGE/Renderable.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// The name doesn't matter, models loaded twice have the same values in different materials
+	bool SameMaterial(RenderMaterialPtr const & lhs, RenderMaterialPtr const & rhs)
+	{
+		if (lhs == rhs)
+		{
+			return true;
+		}
+		if (!lhs || !rhs)
+		{
+			return false;
+		}
+
+		return (lhs->albedo == rhs->albedo) && (lhs->metalness == rhs->metalness) && (lhs->glossiness == rhs->glossiness)
+			&& (lhs->emissive == rhs->emissive) && (lhs->transparent == rhs->transparent)
+			&& (lhs->alpha_test == rhs->alpha_test) && (lhs->sss == rhs->sss) && (lhs->tex_names == rhs->tex_names)
+			&& (lhs->detail_mode == rhs->detail_mode) && (lhs->height_offset_scale == rhs->height_offset_scale)
+			&& (lhs->tess_factors == rhs->tess_factors);
+	}
+
+	// Used by the renderables without a material. It's only packed on the render thread, like the others.
+	RenderMaterial& DefaultMaterial()
+	{
+		static RenderMaterial mtl = []
+			{
+				RenderMaterial ret;
+				ret.albedo = float4(0, 0, 0, 1);
+				ret.metalness = 0;
+				ret.glossiness = 0;
+				ret.emissive = float3(0, 0, 0);
+				ret.transparent = false;
+				ret.alpha_test = 0;
+				ret.sss = false;
+				ret.detail_mode = RenderMaterial::SDM_Parallax;
+				ret.height_offset_scale = float2(-0.5f, 0.06f);
+				ret.tess_factors = float4(5, 5, 1, 9);
+				ret.cbuffer_texture_mask = 0;
+				return ret;
+			}();
+		return mtl;
+	}
+}
+
 namespace KlayGE
 {
 	Renderable::Renderable()
-		: select_mode_on_(false),
-			model_mat_(float4x4::Identity()), effect_attrs_(0)
+		: shared_inst_stream_(false), select_mode_on_(false),
+			model_mat_(float4x4::Identity()), effect_attrs_(0), mtl_cbuff_(nullptr)
 	{
 		auto drl = Context::Instance().DeferredRenderingLayerInstance();
 		if (drl)
@@ -86,17 +139,14 @@ namespace KlayGE
 			FrameBufferPtr const & fb = re.CurFrameBuffer();
 			*frame_size_param_ = int2(fb->Width(), fb->Height());
 
-			*height_offset_scale_param_ = mtl_ ? mtl_->height_offset_scale : float2(-0.5f, 0.06f);
-			*tess_factors_param_ = mtl_ ? mtl_->tess_factors : float4(5, 5, 1, 9);
-
 			*pos_center_param_ = pos_bb.Center();
 			*pos_extent_param_ = pos_bb.HalfSize();
 			*tc_center_param_ = float2(tc_bb.Center().x(), tc_bb.Center().y());
 			*tc_extent_param_ = float2(tc_bb.HalfSize().x(), tc_bb.HalfSize().y());
 
+			this->BindMaterialCBuffer();
+
 			*albedo_tex_param_ = textures_[RenderMaterial::TS_Albedo];
-			*albedo_clr_param_ = mtl_ ? mtl_->albedo : float4(0, 0, 0, 1);
-			*albedo_map_enabled_param_ = static_cast<int32_t>(!!textures_[RenderMaterial::TS_Albedo]);
 
 			switch (type_)
 			{
@@ -104,59 +154,25 @@ namespace KlayGE
 			case PT_TransparencyBackGBufferMRT:
 			case PT_TransparencyFrontGBufferMRT:
 			case PT_GenReflectiveShadowMap:
-				*metalness_clr_param_ = float2(mtl_ ? mtl_->metalness : 0, static_cast<float>(!!textures_[RenderMaterial::TS_Metalness]));
 				*metalness_tex_param_ = textures_[RenderMaterial::TS_Metalness];
-				*alpha_test_threshold_param_ = mtl_ ? mtl_->alpha_test : 0;
-				*normal_map_enabled_param_ = static_cast<int32_t>(!!textures_[RenderMaterial::TS_Normal]);
 				*normal_tex_param_ = textures_[RenderMaterial::TS_Normal];
-				if (!mtl_ || (RenderMaterial::SDM_Parallax == mtl_->detail_mode))
-				{
-					*height_map_parallax_enabled_param_ = static_cast<int32_t>(!!textures_[RenderMaterial::TS_Height]);
-				}
-				else
-				{
-					*height_map_tess_enabled_param_ = static_cast<int32_t>(!!textures_[RenderMaterial::TS_Height]);
-				}
 				*height_tex_param_ = textures_[RenderMaterial::TS_Height];
-				*glossiness_clr_param_ = float2(MathLib::clamp(mtl_ ? mtl_->glossiness : 0, 1e-6f, 0.999f),
-					static_cast<float>(!!textures_[RenderMaterial::TS_Glossiness]));
 				*glossiness_tex_param_ = textures_[RenderMaterial::TS_Glossiness];
 				*opaque_depth_tex_param_ = drl->CurrFrameDepthTex(drl->ActiveViewport());
 				break;
 
-			case PT_GenShadowMap:
-			case PT_GenCascadedShadowMap:
-				*alpha_test_threshold_param_ = mtl_ ? mtl_->alpha_test : 0;
-				break;
-
 			case PT_OpaqueShading:
 			case PT_TransparencyBackShading:
 			case PT_TransparencyFrontShading:
-				*glossiness_clr_param_ = float2(MathLib::clamp(mtl_ ? mtl_->glossiness : 0, 1e-6f, 0.999f),
-					static_cast<float>(!!textures_[RenderMaterial::TS_Glossiness]));
 				*glossiness_tex_param_ = textures_[RenderMaterial::TS_Glossiness];
-				*metalness_clr_param_ = float2(mtl_ ? mtl_->metalness : 0, static_cast<float>(!!textures_[RenderMaterial::TS_Metalness]));
 				*metalness_tex_param_ = textures_[RenderMaterial::TS_Metalness];
-				*alpha_test_threshold_param_ = mtl_ ? mtl_->alpha_test : 0;
 				*emissive_tex_param_ = textures_[RenderMaterial::TS_Emissive];
-				*emissive_clr_param_ = float4(
-					mtl_ ? mtl_->emissive.x() : 0, mtl_ ? mtl_->emissive.y() : 0, mtl_ ? mtl_->emissive.z() : 0,
-					static_cast<float>(!!textures_[RenderMaterial::TS_Emissive]));
-				break;
-
-			case PT_OpaqueReflection:
-			case PT_TransparencyBackReflection:
-			case PT_TransparencyFrontReflection:
 				break;
 
 			case PT_OpaqueSpecialShading:
 			case PT_TransparencyBackSpecialShading:
 			case PT_TransparencyFrontSpecialShading:
-				*alpha_test_threshold_param_ = mtl_ ? mtl_->alpha_test : 0;
 				*emissive_tex_param_ = textures_[RenderMaterial::TS_Emissive];
-				*emissive_clr_param_ = float4(
-					mtl_ ? mtl_->emissive.x() : 0, mtl_ ? mtl_->emissive.y() : 0, mtl_ ? mtl_->emissive.z() : 0,
-					static_cast<float>(!!textures_[RenderMaterial::TS_Emissive]));
 				if (reflection_tex_param_)
 				{
 					*reflection_tex_param_ = drl->ReflectionTex(drl->ActiveViewport());
@@ -189,19 +205,126 @@ namespace KlayGE
 	void Renderable::Render()
 	{
 		this->UpdateInstanceStream();
+		this->PackMaterialCBuffer();
+		this->DoRender(nullptr);
+	}
 
+	void Renderable::PrepareRecord()
+	{
+		this->UpdateInstanceStream();
+		this->PackMaterialCBuffer();
+
+		// Shader objects are created on first use, which has to be here instead of in the recording
+		this->GetRenderTechnique()->Prewarm(*this->GetRenderEffect());
+	}
+
+	uint32_t Renderable::TextureMask() const
+	{
+		uint32_t mask = 0;
+		for (size_t i = 0; i < textures_.size(); ++ i)
+		{
+			if (textures_[i])
+			{
+				mask |= 1UL << i;
+			}
+		}
+		return mask;
+	}
+
+	// Packs the material into its cbuffer data when it's changed. The material is shared by many renderables, so it's
+	// only written here, never in the parallel recording.
+	void Renderable::PackMaterialCBuffer()
+	{
+		if (mtl_cbuff_ && Context::Instance().DeferredRenderingLayerInstance())
+		{
+			RenderMaterial& mtl = mtl_ ? *mtl_ : DefaultMaterial();
+			uint32_t const tex_mask = this->TextureMask();
+			if ((mtl.cbuffer_data.size() != mtl_cbuff_->Size()) || (mtl.cbuffer_texture_mask != tex_mask))
+			{
+				this->WriteMaterialParams(mtl, tex_mask);
+
+				RenderEffectConstantBuffer const & mtl_cbuff = *mtl_cbuff_;
+				uint8_t const * data = mtl_cbuff.VariableInBuff<uint8_t>(0);
+				mtl.cbuffer_data.assign(data, data + mtl_cbuff.Size());
+				mtl.cbuffer_texture_mask = tex_mask;
+			}
+		}
+	}
+
+	// The cbuffer only changes when the last draw of this effect used another material
+	void Renderable::BindMaterialCBuffer()
+	{
+		RenderMaterial const & mtl = mtl_ ? *mtl_ : DefaultMaterial();
+		uint32_t const tex_mask = this->TextureMask();
+		if (mtl_cbuff_ && (mtl.cbuffer_data.size() == mtl_cbuff_->Size()) && (mtl.cbuffer_texture_mask == tex_mask))
+		{
+			RenderEffectConstantBuffer const & const_mtl_cbuff = *mtl_cbuff_;
+			if (memcmp(const_mtl_cbuff.VariableInBuff<uint8_t>(0), mtl.cbuffer_data.data(), mtl.cbuffer_data.size()) != 0)
+			{
+				memcpy(mtl_cbuff_->VariableInBuff<uint8_t>(0), mtl.cbuffer_data.data(), mtl.cbuffer_data.size());
+				mtl_cbuff_->Dirty(true);
+			}
+		}
+		else
+		{
+			this->WriteMaterialParams(mtl, tex_mask);
+		}
+	}
+
+	void Renderable::WriteMaterialParams(RenderMaterial const & mtl, uint32_t tex_mask)
+	{
+		bool const has_height = (tex_mask & (1UL << RenderMaterial::TS_Height)) ? true : false;
+		bool const parallax = (RenderMaterial::SDM_Parallax == mtl.detail_mode);
+
+		*albedo_clr_param_ = mtl.albedo;
+		*albedo_map_enabled_param_ = static_cast<int32_t>((tex_mask >> RenderMaterial::TS_Albedo) & 1);
+		*metalness_clr_param_ = float2(mtl.metalness, static_cast<float>((tex_mask >> RenderMaterial::TS_Metalness) & 1));
+		*glossiness_clr_param_ = float2(MathLib::clamp(mtl.glossiness, 1e-6f, 0.999f),
+			static_cast<float>((tex_mask >> RenderMaterial::TS_Glossiness) & 1));
+		*emissive_clr_param_ = float4(mtl.emissive.x(), mtl.emissive.y(), mtl.emissive.z(),
+			static_cast<float>((tex_mask >> RenderMaterial::TS_Emissive) & 1));
+		*normal_map_enabled_param_ = static_cast<int32_t>((tex_mask >> RenderMaterial::TS_Normal) & 1);
+		*height_map_parallax_enabled_param_ = static_cast<int32_t>(has_height && parallax);
+		*height_map_tess_enabled_param_ = static_cast<int32_t>(has_height && !parallax);
+		*alpha_test_threshold_param_ = mtl.alpha_test;
+		*height_offset_scale_param_ = mtl.height_offset_scale;
+		*tess_factors_param_ = mtl.tess_factors;
+	}
+
+	void Renderable::Record(CommandList& cmd_list)
+	{
+		this->DoRender(&cmd_list);
+	}
+
+	void Renderable::DoRender(CommandList* cmd_list)
+	{
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
 		RenderLayout const & layout = this->GetRenderLayout();
 		GraphicsBufferPtr const & inst_stream = layout.InstanceStream();
 		RenderTechnique const & tech = *this->GetRenderTechnique();
 		auto const & effect = *this->GetRenderEffect();
+		if (cmd_list)
+		{
+			re.PrepareDraw(effect, tech, layout);
+		}
+		auto draw = [&re, &effect, &tech, &layout, cmd_list]()
+			{
+				if (cmd_list)
+				{
+					cmd_list->Draw(effect, tech, layout);
+				}
+				else
+				{
+					re.Render(effect, tech, layout);
+				}
+			};
 		if (inst_stream)
 		{
 			if (layout.NumInstances() > 0)
 			{
 				this->OnRenderBegin();
-				re.Render(effect, tech, layout);
+				draw();
 				this->OnRenderEnd();
 			}
 		}
@@ -210,14 +333,14 @@ namespace KlayGE
 			this->OnRenderBegin();
 			if (instances_.empty())
 			{
-				re.Render(effect, tech, layout);
+				draw();
 			}
 			else
 			{
 				for (uint32_t i = 0; i < instances_.size(); ++ i)
 				{
 					this->OnInstanceBegin(i);
-					re.Render(effect, tech, layout);
+					draw();
 					this->OnInstanceEnd(i);
 				}
 			}
@@ -233,10 +356,97 @@ namespace KlayGE
 	void Renderable::ClearInstances()
 	{
 		instances_.resize(0);
+
+		if (shared_inst_stream_)
+		{
+			// The shared buffer is owned by SceneManager. An own one is made again when needed.
+			RenderLayout& rl = this->GetRenderLayout();
+			rl.InstanceStream(GraphicsBufferPtr());
+			rl.StartInstanceLocation(0);
+			shared_inst_stream_ = false;
+		}
+	}
+
+	bool Renderable::InstanceCompatible(Renderable const & rhs) const
+	{
+		if (this == &rhs)
+		{
+			return true;
+		}
+
+		if ((typeid(*this) != typeid(rhs)) || (this->GetRenderEffect() != rhs.GetRenderEffect())
+			|| (this->GetRenderTechnique() != rhs.GetRenderTechnique()) || (effect_attrs_ != rhs.effect_attrs_)
+			|| (textures_ != rhs.textures_) || !SameMaterial(mtl_, rhs.mtl_))
+		{
+			return false;
+		}
+
+		RenderLayout const & lhs_rl = this->GetRenderLayout();
+		RenderLayout const & rhs_rl = rhs.GetRenderLayout();
+		if ((lhs_rl.TopologyType() != rhs_rl.TopologyType()) || (lhs_rl.NumVertexStreams() != rhs_rl.NumVertexStreams())
+			|| (lhs_rl.NumVertices() != rhs_rl.NumVertices()) || (lhs_rl.NumIndices() != rhs_rl.NumIndices())
+			|| (lhs_rl.StartVertexLocation() != rhs_rl.StartVertexLocation())
+			|| (lhs_rl.StartIndexLocation() != rhs_rl.StartIndexLocation())
+			|| (lhs_rl.InstanceStreamFormat() != rhs_rl.InstanceStreamFormat()))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < lhs_rl.NumVertexStreams(); ++ i)
+		{
+			if (lhs_rl.GetVertexStream(i) != rhs_rl.GetVertexStream(i))
+			{
+				return false;
+			}
+		}
+		return !lhs_rl.UseIndices() || (lhs_rl.GetIndexStream() == rhs_rl.GetIndexStream());
+	}
+
+	size_t Renderable::InstanceBatchHash() const
+	{
+		RenderLayout const & rl = this->GetRenderLayout();
+
+		size_t seed = 0;
+		HashCombine(seed, this->GetRenderTechnique());
+		HashCombine(seed, rl.NumVertexStreams());
+		for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+		{
+			HashCombine(seed, rl.GetVertexStream(i).get());
+		}
+		if (rl.UseIndices())
+		{
+			HashCombine(seed, rl.GetIndexStream().get());
+		}
+		HashCombine(seed, rl.StartVertexLocation());
+		HashCombine(seed, rl.StartIndexLocation());
+		for (auto const & tex : textures_)
+		{
+			HashCombine(seed, tex.get());
+		}
+		return seed;
+	}
+
+	void Renderable::BindSharedInstanceStream(GraphicsBufferPtr const & buffer, vertex_elements_type const & vet,
+		uint32_t start, uint32_t num)
+	{
+		RenderLayout& rl = this->GetRenderLayout();
+		rl.BindVertexStream(buffer, vet, RenderLayout::ST_Instance, 1);
+		rl.InstanceStream(buffer);
+		rl.StartInstanceLocation(start);
+		for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+		{
+			rl.VertexStreamFrequencyDivider(i, RenderLayout::ST_Geometry, num);
+		}
+
+		shared_inst_stream_ = true;
 	}
 
 	void Renderable::UpdateInstanceStream()
 	{
+		if (shared_inst_stream_)
+		{
+			return;
+		}
+
 		if (!instances_.empty() && !instances_[0]->InstanceFormat().empty())
 		{
 			vertex_elements_type const & vet = instances_[0]->InstanceFormat();
@@ -270,7 +480,7 @@ namespace KlayGE
 				GraphicsBuffer::Mapper mapper(*inst_stream, BA_Write_Only);
 				for (size_t i = 0; i < instances_.size(); ++ i)
 				{
-					uint8_t const * src = static_cast<uint8_t const *>(instances_[i]->InstanceData());
+					uint8_t const * src = static_cast<uint8_t const *>(instances_[i]->RenderInstanceData());
 					std::copy(src, src + size, mapper.Pointer<uint8_t>() + i * size);
 				}
 			}
@@ -332,34 +542,35 @@ namespace KlayGE
 
 		this->UpdateTechniques();
 
-		mvp_param_ = deferred_effect_->ParameterByName("mvp");
-		model_view_param_ = deferred_effect_->ParameterByName("model_view");
-		forward_vec_param_ = deferred_effect_->ParameterByName("forward_vec");
-		frame_size_param_ = deferred_effect_->ParameterByName("frame_size");
-		height_offset_scale_param_ = deferred_effect_->ParameterByName("height_offset_scale");
-		tess_factors_param_ = deferred_effect_->ParameterByName("tess_factors");
-		pos_center_param_ = deferred_effect_->ParameterByName("pos_center");
-		pos_extent_param_ = deferred_effect_->ParameterByName("pos_extent");
-		tc_center_param_ = deferred_effect_->ParameterByName("tc_center");
-		tc_extent_param_ = deferred_effect_->ParameterByName("tc_extent");
-		albedo_map_enabled_param_ = deferred_effect_->ParameterByName("albedo_map_enabled");
-		albedo_tex_param_ = deferred_effect_->ParameterByName("albedo_tex");
-		albedo_clr_param_ = deferred_effect_->ParameterByName("albedo_clr");
-		metalness_clr_param_ = deferred_effect_->ParameterByName("metalness_clr");
-		metalness_tex_param_ = deferred_effect_->ParameterByName("metalness_tex");
-		glossiness_clr_param_ = deferred_effect_->ParameterByName("glossiness_clr");
-		glossiness_tex_param_ = deferred_effect_->ParameterByName("glossiness_tex");
-		emissive_tex_param_ = deferred_effect_->ParameterByName("emissive_tex");
-		emissive_clr_param_ = deferred_effect_->ParameterByName("emissive_clr");
-		normal_map_enabled_param_ = deferred_effect_->ParameterByName("normal_map_enabled");
-		normal_tex_param_ = deferred_effect_->ParameterByName("normal_tex");
-		height_map_parallax_enabled_param_ = deferred_effect_->ParameterByName("height_map_parallax_enabled");
-		height_map_tess_enabled_param_ = deferred_effect_->ParameterByName("height_map_tess_enabled");
-		height_tex_param_ = deferred_effect_->ParameterByName("height_tex");
-		opaque_depth_tex_param_ = deferred_effect_->ParameterByName("opaque_depth_tex");
+		mvp_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("mvp")));
+		model_view_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("model_view")));
+		forward_vec_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("forward_vec")));
+		frame_size_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("frame_size")));
+		height_offset_scale_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("height_offset_scale")));
+		tess_factors_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("tess_factors")));
+		pos_center_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("pos_center")));
+		pos_extent_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("pos_extent")));
+		tc_center_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("tc_center")));
+		tc_extent_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("tc_extent")));
+		albedo_map_enabled_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("albedo_map_enabled")));
+		albedo_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("albedo_tex")));
+		albedo_clr_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("albedo_clr")));
+		metalness_clr_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("metalness_clr")));
+		metalness_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("metalness_tex")));
+		glossiness_clr_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("glossiness_clr")));
+		glossiness_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("glossiness_tex")));
+		emissive_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("emissive_tex")));
+		emissive_clr_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("emissive_clr")));
+		normal_map_enabled_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("normal_map_enabled")));
+		normal_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("normal_tex")));
+		height_map_parallax_enabled_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("height_map_parallax_enabled")));
+		height_map_tess_enabled_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("height_map_tess_enabled")));
+		height_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("height_tex")));
+		opaque_depth_tex_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("opaque_depth_tex")));
 		reflection_tex_param_ = nullptr;
-		alpha_test_threshold_param_ = deferred_effect_->ParameterByName("alpha_test_threshold");
-		select_mode_object_id_param_ = deferred_effect_->ParameterByName("object_id");
+		alpha_test_threshold_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("alpha_test_threshold")));
+		select_mode_object_id_param_ = deferred_effect_->ParameterByName(EffectNameId(CT_HASH("object_id")));
+		mtl_cbuff_ = deferred_effect_->CBufferByName(EffectNameId(CT_HASH("per_material")));
 	}
 
 	void Renderable::UpdateTechniques()
@@ -384,29 +595,29 @@ namespace KlayGE
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferAlphaTestMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferAlphaTestMRTTech")));
 				}
 			}
 			else
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferMRTTech")));
 				}
 			}
-			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferAlphaBlendBackMRTTech");
-			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferAlphaBlendFrontMRTTech");
-			special_shading_tech_ = deferred_effect_->TechniqueByName("SpecialShadingTech");
-			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName("SpecialShadingAlphaBlendBackTech");
-			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName("SpecialShadingAlphaBlendFrontTech");
+			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferAlphaBlendBackMRTTech")));
+			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferAlphaBlendFrontMRTTech")));
+			special_shading_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingTech")));
+			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingAlphaBlendBackTech")));
+			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingAlphaBlendFrontTech")));
 			break;
 		
 		case RenderMaterial::SDM_FlatTessellation:
@@ -414,29 +625,29 @@ namespace KlayGE
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferFlatTessAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferFlatTessAlphaTestMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferFlatTessAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferFlatTessAlphaTestMRTTech")));
 				}
 			}
 			else
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferFlatTessMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferFlatTessMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferFlatTessMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferFlatTessMRTTech")));
 				}
 			}
-			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferFlatTessAlphaBlendBackMRTTech");
-			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferFlatTessAlphaBlendFrontMRTTech");
-			special_shading_tech_ = deferred_effect_->TechniqueByName("SpecialShadingFlatTessTech");
-			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName("SpecialShadingFlatTessAlphaBlendBackTech");
-			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName("SpecialShadingFlatTessAlphaBlendFrontTech");
+			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferFlatTessAlphaBlendBackMRTTech")));
+			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferFlatTessAlphaBlendFrontMRTTech")));
+			special_shading_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingFlatTessTech")));
+			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingFlatTessAlphaBlendBackTech")));
+			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingFlatTessAlphaBlendFrontTech")));
 			break;
 
 		case RenderMaterial::SDM_SmoothTessellation:
@@ -444,29 +655,29 @@ namespace KlayGE
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferSmoothTessAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferSmoothTessAlphaTestMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferSmoothTessAlphaTestMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferSmoothTessAlphaTestMRTTech")));
 				}
 			}
 			else
 			{
 				if (sss)
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("SSSGBufferSmoothTessMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGBufferSmoothTessMRTTech")));
 				}
 				else
 				{
-					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferSmoothTessMRTTech");
+					gbuffer_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferSmoothTessMRTTech")));
 				}
 			}
-			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferSmoothTessAlphaBlendBackMRTTech");
-			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName("GBufferSmoothTessAlphaBlendFrontMRTTech");
-			special_shading_tech_ = deferred_effect_->TechniqueByName("SpecialShadingSmoothTessTech");
-			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName("SpecialShadingSmoothTessAlphaBlendBackTech");
-			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName("SpecialShadingSmoothTessAlphaBlendFrontTech");
+			gbuffer_alpha_blend_back_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferSmoothTessAlphaBlendBackMRTTech")));
+			gbuffer_alpha_blend_front_mrt_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GBufferSmoothTessAlphaBlendFrontMRTTech")));
+			special_shading_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingSmoothTessTech")));
+			special_shading_alpha_blend_back_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingSmoothTessAlphaBlendBackTech")));
+			special_shading_alpha_blend_front_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SpecialShadingSmoothTessAlphaBlendFrontTech")));
 			break;
 
 		default:
@@ -476,34 +687,34 @@ namespace KlayGE
 
 		if (this->AlphaTest())
 		{
-			gen_rsm_tech_ = deferred_effect_->TechniqueByName("GenReflectiveShadowMapAlphaTestTech");
+			gen_rsm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenReflectiveShadowMapAlphaTestTech")));
 			if (sss)
 			{
-				gen_sm_tech_ = deferred_effect_->TechniqueByName("SSSGenShadowMapAlphaTestTech");
-				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName("SSSGenCascadedShadowMapAlphaTestTech");
+				gen_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGenShadowMapAlphaTestTech")));
+				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGenCascadedShadowMapAlphaTestTech")));
 			}
 			else
 			{
-				gen_sm_tech_ = deferred_effect_->TechniqueByName("GenShadowMapAlphaTestTech");
-				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName("GenCascadedShadowMapAlphaTestTech");
+				gen_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenShadowMapAlphaTestTech")));
+				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenCascadedShadowMapAlphaTestTech")));
 			}
 		}
 		else
 		{
-			gen_rsm_tech_ = deferred_effect_->TechniqueByName("GenReflectiveShadowMapTech");
+			gen_rsm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenReflectiveShadowMapTech")));
 			if (sss)
 			{
-				gen_sm_tech_ = deferred_effect_->TechniqueByName("SSSGenShadowMapTech");
-				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName("SSSGenCascadedShadowMapTech");
+				gen_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGenShadowMapTech")));
+				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SSSGenCascadedShadowMapTech")));
 			}
 			else
 			{
-				gen_sm_tech_ = deferred_effect_->TechniqueByName("GenShadowMapTech");
-				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName("GenCascadedShadowMapTech");
+				gen_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenShadowMapTech")));
+				gen_cascaded_sm_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("GenCascadedShadowMapTech")));
 			}
 		}
 
-		select_mode_tech_ = deferred_effect_->TechniqueByName("SelectModeTech");
+		select_mode_tech_ = deferred_effect_->TechniqueByName(EffectNameId(CT_HASH("SelectModeTech")));
 	}
 
 	RenderTechnique* Renderable::PassTech(PassType type) const
@@ -289,7 +289,8 @@ namespace KlayGE
 {
 	ShaderObject::ShaderObject()
 		: has_discard_(false), has_tessellation_(false),
-			cs_block_size_x_(0), cs_block_size_y_(0), cs_block_size_z_(0)
+			cs_block_size_x_(0), cs_block_size_y_(0), cs_block_size_z_(0),
+			pipeline_key_(0)
 	{
 	}
 
@@ -0,0 +1,296 @@
+/**
+ * @file ShadowMapAtlas.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+
+#include <algorithm>
+
+#include <boost/assert.hpp>
+
+#include <KlayGE/ShadowMapAtlas.hpp>
+
+namespace KlayGE
+{
+	ShadowMapAtlas::ShadowMapAtlas(uint32_t size, uint32_t min_tile_size)
+		: size_(size), min_tile_size_(min_tile_size), num_levels_(1), frame_(0)
+	{
+		BOOST_ASSERT((size & (size - 1)) == 0);
+		BOOST_ASSERT((min_tile_size > 0) && ((min_tile_size & (min_tile_size - 1)) == 0));
+		BOOST_ASSERT(min_tile_size <= size);
+
+		for (uint32_t s = size; s > min_tile_size; s /= 2)
+		{
+			++ num_levels_;
+		}
+
+		this->Clear();
+	}
+
+	void ShadowMapAtlas::BeginFrame()
+	{
+		++ frame_;
+	}
+
+	bool ShadowMapAtlas::Request(void const * key, uint32_t tile_size, size_t seed, uint4& rect, bool& cached)
+	{
+		uint32_t const level = this->Level(tile_size);
+
+		cached = false;
+		auto iter = entries_.find(key);
+		if (iter != entries_.end())
+		{
+			Entry& entry = iter->second;
+			uint32_t const curr_level = nodes_[entry.node].level;
+			// A tile within a factor of 2 is kept, so a light near a threshold doesn't keep moving
+			if ((curr_level + 1 >= level) && (curr_level <= level + 1))
+			{
+				Node const & node = nodes_[entry.node];
+				rect = uint4(node.x, node.y, node.size, node.size);
+				cached = (seed != 0) && (entry.seed == seed);
+				entry.seed = seed;
+				entry.last_frame = frame_;
+				return true;
+			}
+
+			this->FreeNode(entry.node);
+			entries_.erase(iter);
+		}
+
+		for (uint32_t l = level; l < num_levels_; ++ l)
+		{
+			int32_t node = this->AllocateNode(l);
+			while ((node < 0) && this->EvictOldest())
+			{
+				node = this->AllocateNode(l);
+			}
+			if (node >= 0)
+			{
+				Entry entry;
+				entry.node = node;
+				entry.seed = seed;
+				entry.last_frame = frame_;
+				entries_.emplace(key, entry);
+
+				rect = uint4(nodes_[node].x, nodes_[node].y, nodes_[node].size, nodes_[node].size);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ShadowMapAtlas::Invalidate(void const * key)
+	{
+		auto iter = entries_.find(key);
+		if (iter != entries_.end())
+		{
+			iter->second.seed = 0;
+		}
+	}
+
+	void ShadowMapAtlas::Release(void const * key)
+	{
+		auto iter = entries_.find(key);
+		if (iter != entries_.end())
+		{
+			this->FreeNode(iter->second.node);
+			entries_.erase(iter);
+		}
+	}
+
+	void ShadowMapAtlas::Clear()
+	{
+		entries_.clear();
+		recycled_children_.clear();
+		free_nodes_.assign(num_levels_, std::vector<int32_t>());
+
+		Node root;
+		root.x = 0;
+		root.y = 0;
+		root.size = size_;
+		root.level = 0;
+		root.parent = -1;
+		root.first_child = -1;
+		root.state = NS_Free;
+		nodes_.assign(1, root);
+		free_nodes_[0].push_back(0);
+	}
+
+	float4 ShadowMapAtlas::ScaleBias(uint4 const & rect) const
+	{
+		float const inv_size = 1.0f / size_;
+		return float4(rect.z() * inv_size, rect.w() * inv_size, rect.x() * inv_size, rect.y() * inv_size);
+	}
+
+	// Rounds down to a power of 2 in [min_tile_size_, size_]
+	uint32_t ShadowMapAtlas::Level(uint32_t tile_size) const
+	{
+		uint32_t level = 0;
+		for (uint32_t s = size_; (s > tile_size) && (level + 1 < num_levels_); s /= 2)
+		{
+			++ level;
+		}
+		return level;
+	}
+
+	int32_t ShadowMapAtlas::AllocateNode(uint32_t level)
+	{
+		// The deepest free node above the level is split down to it
+		int32_t l = static_cast<int32_t>(level);
+		while ((l >= 0) && free_nodes_[l].empty())
+		{
+			-- l;
+		}
+		if (l < 0)
+		{
+			return -1;
+		}
+
+		int32_t node = free_nodes_[l].back();
+		free_nodes_[l].pop_back();
+		for (; static_cast<uint32_t>(l) < level; ++ l)
+		{
+			int32_t first;
+			if (recycled_children_.empty())
+			{
+				first = static_cast<int32_t>(nodes_.size());
+				nodes_.resize(nodes_.size() + 4);
+			}
+			else
+			{
+				first = recycled_children_.back();
+				recycled_children_.pop_back();
+			}
+
+			uint32_t const half = nodes_[node].size / 2;
+			for (int32_t i = 0; i < 4; ++ i)
+			{
+				Node& child = nodes_[first + i];
+				child.x = nodes_[node].x + (i & 1) * half;
+				child.y = nodes_[node].y + (i >> 1) * half;
+				child.size = half;
+				child.level = l + 1;
+				child.parent = node;
+				child.first_child = -1;
+				child.state = NS_Free;
+			}
+			nodes_[node].first_child = first;
+			nodes_[node].state = NS_Split;
+
+			for (int32_t i = 1; i < 4; ++ i)
+			{
+				free_nodes_[l + 1].push_back(first + i);
+			}
+			node = first;
+		}
+
+		nodes_[node].state = NS_Used;
+		return node;
+	}
+
+	void ShadowMapAtlas::FreeNode(int32_t node)
+	{
+		BOOST_ASSERT(NS_Used == nodes_[node].state);
+
+		nodes_[node].state = NS_Free;
+		for (;;)
+		{
+			int32_t const parent = nodes_[node].parent;
+			if (parent < 0)
+			{
+				break;
+			}
+
+			int32_t const first = nodes_[parent].first_child;
+			bool all_free = true;
+			for (int32_t i = 0; i < 4; ++ i)
+			{
+				if (nodes_[first + i].state != NS_Free)
+				{
+					all_free = false;
+					break;
+				}
+			}
+			if (!all_free)
+			{
+				break;
+			}
+
+			// Merges the siblings back to the parent
+			for (int32_t i = 0; i < 4; ++ i)
+			{
+				if (first + i != node)
+				{
+					this->RemoveFree(first + i);
+				}
+				nodes_[first + i].state = NS_Recycled;
+			}
+			recycled_children_.push_back(first);
+			nodes_[parent].first_child = -1;
+			nodes_[parent].state = NS_Free;
+			node = parent;
+		}
+
+		free_nodes_[nodes_[node].level].push_back(node);
+	}
+
+	void ShadowMapAtlas::RemoveFree(int32_t node)
+	{
+		auto& free_nodes = free_nodes_[nodes_[node].level];
+		auto iter = std::find(free_nodes.begin(), free_nodes.end(), node);
+		BOOST_ASSERT(iter != free_nodes.end());
+		*iter = free_nodes.back();
+		free_nodes.pop_back();
+	}
+
+	// Frees the tile of the light requested longest ago, but never one of this frame
+	bool ShadowMapAtlas::EvictOldest()
+	{
+		auto oldest = entries_.end();
+		for (auto iter = entries_.begin(); iter != entries_.end(); ++ iter)
+		{
+			if ((iter->second.last_frame != frame_)
+				&& ((oldest == entries_.end()) || (iter->second.last_frame < oldest->second.last_frame)))
+			{
+				oldest = iter;
+			}
+		}
+		if (oldest == entries_.end())
+		{
+			return false;
+		}
+
+		this->FreeNode(oldest->second.node);
+		entries_.erase(oldest);
+		return true;
+	}
+}
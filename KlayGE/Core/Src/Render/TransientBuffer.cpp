@@ -33,20 +33,62 @@
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/App3D.hpp>
 
+#include <algorithm>
 #include <cstring>
 
 #include <KlayGE/TransientBuffer.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Elements in a sub-block a thread grabs from a ring
+	uint32_t const RING_BLOCK_ELEMENTS = 256;
+
+	// The sub-block a thread is filling in one ring
+	struct RingBlock
+	{
+		uint32_t ring_id;
+		uint32_t epoch;
+		uint64_t cur;
+		uint64_t end;
+	};
+
+	// A thread rarely writes to more than a few rings at the same time, e.g. the vertex and index rings of a font
+	uint32_t const NUM_THREAD_RING_BLOCKS = 4;
+
+	thread_local RingBlock thread_ring_blocks[NUM_THREAD_RING_BLOCKS] = {};
+	thread_local uint32_t thread_ring_block_victim = 0;
+
+	// 0 marks an unused RingBlock
+	std::atomic<uint32_t> next_ring_id(1);
+}
+
 namespace KlayGE
 {
-	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag)
-		: bind_flag_(bind_flag)
+	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag,
+			TransientBuffer::AllocMode mode, uint32_t stride)
+		: mode_(mode), bind_flag_(bind_flag),
+			ring_id_(0), stride_(stride), block_size_(0), ring_size_(0), reserve_size_(0),
+			head_(0), tail_(0), reserve_head_(0), uploaded_(0), epoch_(0)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine const & re = rf.RenderEngineInstance();
 		RenderDeviceCaps const & caps = re.DeviceCaps();
 		use_no_overwrite_ = caps.no_overwrite_support;
 
+		if (AM_Ring == mode_)
+		{
+			BOOST_ASSERT(stride_ > 0);
+
+			// Wrapping to the start keeps the offsets multiples of stride
+			size_in_byte = std::max((size_in_byte + stride_ - 1) / stride_, 1U) * stride_;
+
+			ring_size_ = size_in_byte;
+			reserve_size_ = this->RingReserveSize(ring_size_);
+			size_in_byte += static_cast<uint32_t>(reserve_size_);
+		}
+
 		buffer_ = this->DoCreateBuffer(bind_flag_, size_in_byte);
 		if (use_no_overwrite_)
 		{
@@ -60,11 +102,23 @@ namespace KlayGE
 			valid_max_ = 0;
 		}
 
-		SubAlloc alloc(0, size_in_byte);
-		free_list_.push_back(alloc);
+		if (AM_Ring == mode_)
+		{
+			// Ring allocs are always written to the CPU copy, so no thread but the uploading one maps the buffer
+			simulate_buffer_.resize(size_in_byte);
 
-		App3DFramework const & app = Context::Instance().AppInstance();
-		retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+			ring_id_ = next_ring_id.fetch_add(1, std::memory_order_relaxed);
+			block_size_ = stride_ * RING_BLOCK_ELEMENTS;
+			frame_fences_.fill(0);
+		}
+		else
+		{
+			SubAlloc alloc(0, size_in_byte);
+			free_list_.push_back(alloc);
+
+			App3DFramework const & app = Context::Instance().AppInstance();
+			retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+		}
 	}
 
 	GraphicsBufferPtr TransientBuffer::DoCreateBuffer(TransientBuffer::BindFlag bind_flag, uint32_t size_in_byte)
@@ -90,6 +144,11 @@ namespace KlayGE
 
 	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, void const * data)
 	{
+		if (AM_Ring == mode_)
+		{
+			return this->RingAlloc(size_in_byte, data);
+		}
+
 		SubAlloc ret;
 
 		// Use first fit method to find a free sub alloc
@@ -165,7 +224,7 @@ namespace KlayGE
 
 	void TransientBuffer::Dealloc(SubAlloc const & alloc)
 	{
-		if ((alloc.length_ > 0) && !retired_frames_.empty())
+		if ((AM_FreeList == mode_) && (alloc.length_ > 0) && !retired_frames_.empty())
 		{
 			RetiredFrame& frame = retired_frames_.back();
 			frame.pending_frees_.push_back(alloc);
@@ -186,11 +245,18 @@ namespace KlayGE
 
 	void TransientBuffer::OnPresent()
 	{
-		if (!retired_frames_.empty())
-		{
-			App3DFramework const & app = Context::Instance().AppInstance();
-			uint32_t const frame_id = app.TotalNumFrames();
+		App3DFramework const & app = Context::Instance().AppInstance();
+		this->OnPresent(app.TotalNumFrames());
+	}
 
+	void TransientBuffer::OnPresent(uint32_t frame_id)
+	{
+		if (AM_Ring == mode_)
+		{
+			this->RingOnPresent(frame_id);
+		}
+		else if (!retired_frames_.empty())
+		{
 			// First, deal with deletes from this frame
 			RetiredFrame& ret_frame = retired_frames_.back();
 			if (!ret_frame.pending_frees_.empty()) 
@@ -284,11 +350,196 @@ namespace KlayGE
 
 	void TransientBuffer::EnsureDataReady()
 	{
-		if (!use_no_overwrite_)
+		if (AM_Ring == mode_)
+		{
+			this->RingUpload();
+		}
+		else if (!use_no_overwrite_)
 		{
 			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_Only);
 			memcpy(mapper.Pointer<uint8_t>() + valid_min_, &simulate_buffer_[valid_min_],
 				valid_max_ - valid_min_);
 		}
 	}
+
+	SubAlloc TransientBuffer::RingAlloc(uint32_t size_in_byte, void const * data)
+	{
+		uint64_t const size = (size_in_byte + stride_ - 1) / stride_ * stride_;
+		if (0 == size)
+		{
+			return SubAlloc(0, 0);
+		}
+
+		RingBlock* block = nullptr;
+		for (auto& b : thread_ring_blocks)
+		{
+			if (b.ring_id == ring_id_)
+			{
+				block = &b;
+				break;
+			}
+		}
+		if (nullptr == block)
+		{
+			block = &thread_ring_blocks[thread_ring_block_victim];
+			thread_ring_block_victim = (thread_ring_block_victim + 1) % NUM_THREAD_RING_BLOCKS;
+			block->ring_id = ring_id_;
+			block->cur = 0;
+			block->end = 0;
+		}
+
+		// Blocks from before the last upload or present belong to retired frames
+		uint32_t const epoch = epoch_.load(std::memory_order_relaxed);
+		bool fits = (block->epoch == epoch) && (block->cur + size <= block->end);
+		if (!fits)
+		{
+			uint64_t start;
+			uint64_t const grab_size = std::max<uint64_t>(size, block_size_);
+			if (this->RingGrab(grab_size, start))
+			{
+				block->end = start + grab_size;
+				fits = true;
+			}
+			else if ((grab_size != size) && this->RingGrab(size, start))
+			{
+				block->end = start + size;
+				fits = true;
+			}
+			if (fits)
+			{
+				block->epoch = epoch;
+				block->cur = start;
+			}
+		}
+
+		SubAlloc ret;
+		if (fits)
+		{
+			ret = SubAlloc(static_cast<uint32_t>(block->cur % ring_size_), size_in_byte);
+			block->cur += size;
+		}
+		else
+		{
+			// The ring is full. The reserve takes the rest of the frame, and the ring grows in EnsureDataReady.
+			uint64_t const offset = reserve_head_.fetch_add(size, std::memory_order_relaxed);
+			if (offset + size > reserve_size_)
+			{
+				return SubAlloc(0, 0);
+			}
+			ret = SubAlloc(static_cast<uint32_t>(ring_size_ + offset), size_in_byte);
+		}
+
+		memcpy(&simulate_buffer_[ret.offset_], data, size_in_byte);
+		return ret;
+	}
+
+	bool TransientBuffer::RingGrab(uint64_t size, uint64_t& start)
+	{
+		uint64_t const capacity = ring_size_;
+		if (size > capacity)
+		{
+			return false;
+		}
+
+		uint64_t head = head_.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			start = head;
+			if (head % capacity + size > capacity)
+			{
+				start = (head / capacity + 1) * capacity;
+			}
+			if (start + size - tail_.load(std::memory_order_relaxed) > capacity)
+			{
+				return false;
+			}
+			if (head_.compare_exchange_weak(head, start + size, std::memory_order_relaxed))
+			{
+				return true;
+			}
+		}
+	}
+
+	void TransientBuffer::RingUpload()
+	{
+		uint64_t const reserve_used = reserve_head_.load(std::memory_order_relaxed);
+		if (reserve_used > 0)
+		{
+			this->RingGrow(reserve_used);
+		}
+
+		if (buffer_->Size() != simulate_buffer_.size())
+		{
+			// The frames in flight keep the old buffer alive
+			buffer_ = this->DoCreateBuffer(bind_flag_, static_cast<uint32_t>(simulate_buffer_.size()));
+		}
+
+		uint64_t const capacity = ring_size_;
+
+		uint64_t const head = head_.load(std::memory_order_relaxed);
+		uint64_t const tail = tail_.load(std::memory_order_relaxed);
+
+		// Discarding a buffer loses everything in it, so all the live data is uploaded again
+		uint64_t pos = use_no_overwrite_ ? std::max(uploaded_, tail) : tail;
+		if (pos < head)
+		{
+			GraphicsBuffer::Mapper mapper(*buffer_, use_no_overwrite_ ? BA_Write_No_Overwrite : BA_Write_Only);
+			uint8_t* buffer_data = mapper.Pointer<uint8_t>();
+			while (pos < head)
+			{
+				uint32_t const offset = static_cast<uint32_t>(pos % capacity);
+				uint32_t const length = static_cast<uint32_t>(std::min(capacity - offset, head - pos));
+				memcpy(buffer_data + offset, &simulate_buffer_[offset], length);
+				pos += length;
+			}
+		}
+		uploaded_ = head;
+
+		// Anything written into the current sub-blocks from now on would be missed by the upload
+		++ epoch_;
+	}
+
+	void TransientBuffer::RingOnPresent(uint32_t frame_id)
+	{
+		// A slot not written in the last frames holds an older fence, which is conservative
+		frame_fences_[frame_id % MAX_FRAMES_IN_FLIGHT] = head_.load(std::memory_order_relaxed);
+		if (frame_id >= num_pre_frames_)
+		{
+			uint64_t const fence = frame_fences_[(frame_id - num_pre_frames_) % MAX_FRAMES_IN_FLIGHT];
+			if (fence > tail_.load(std::memory_order_relaxed))
+			{
+				tail_.store(fence, std::memory_order_relaxed);
+			}
+		}
+
+		++ epoch_;
+	}
+
+	void TransientBuffer::RingGrow(uint64_t reserve_used)
+	{
+		// Room for the frame that overran, with the old contents still in it. All are multiples of stride.
+		uint64_t const old_size = simulate_buffer_.size();
+		uint64_t const new_ring_size = 2 * std::max(old_size, ring_size_ + reserve_used);
+		uint64_t const new_reserve_size = this->RingReserveSize(new_ring_size);
+		simulate_buffer_.resize(static_cast<size_t>(new_ring_size + new_reserve_size));
+
+		// The old ring and reserve are kept as they are at the start of the new ring, so the offsets handed out so far
+		// stay valid. They are in use until the current frame retires, and the ring goes on after them.
+		uint64_t const start = (head_.load(std::memory_order_relaxed) / new_ring_size + 1) * new_ring_size;
+		tail_.store(start, std::memory_order_relaxed);
+		head_.store(start + old_size, std::memory_order_relaxed);
+		reserve_head_.store(0, std::memory_order_relaxed);
+		uploaded_ = start;
+		frame_fences_.fill(start);
+		ring_size_ = new_ring_size;
+		reserve_size_ = new_reserve_size;
+
+		++ epoch_;
+	}
+
+	// Half of the ring, as a multiple of stride
+	uint64_t TransientBuffer::RingReserveSize(uint64_t ring_size) const
+	{
+		return (ring_size / 2 + stride_ - 1) / stride_ * stride_;
+	}
 }
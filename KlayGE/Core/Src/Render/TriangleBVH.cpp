@@ -0,0 +1,321 @@
+/**
+ * @file TriangleBVH.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+
+#include <algorithm>
+
+#include <KlayGE/TriangleBVH.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const MAX_LEAF_TRIANGLES = 4;
+
+	// Determinants smaller than this are parallel to the ray
+	float const DET_EPSILON = 1e-12f;
+
+	// Entry distance of the ray into the box, or a negative number if it misses within max_dist
+	float RayAABBDistance(float3 const & origin, float3 const & inv_dir, float max_dist, AABBox const & aabb)
+	{
+		float t_min = 0;
+		float t_max = max_dist;
+		for (int i = 0; i < 3; ++ i)
+		{
+			float t0 = (aabb.Min()[i] - origin[i]) * inv_dir[i];
+			float t1 = (aabb.Max()[i] - origin[i]) * inv_dir[i];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			// NaN comes from 0 * inf when the ray lies on a slab plane, and doesn't shrink the range
+			t_min = (t0 > t_min) ? t0 : t_min;
+			t_max = (t1 < t_max) ? t1 : t_max;
+			if (t_min > t_max)
+			{
+				return -1;
+			}
+		}
+		return t_min;
+	}
+}
+
+namespace KlayGE
+{
+	TriangleBVH::TriangleBVH(std::vector<float3> positions, std::vector<uint32_t> indices)
+		: positions_(std::move(positions)), indices_(std::move(indices))
+	{
+		uint32_t const num_tris = this->NumTriangles();
+
+		std::vector<uint32_t> tris(num_tris);
+		std::vector<float3> centroids(num_tris);
+		for (uint32_t i = 0; i < num_tris; ++ i)
+		{
+			tris[i] = i;
+			centroids[i] = (positions_[indices_[i * 3 + 0]] + positions_[indices_[i * 3 + 1]]
+				+ positions_[indices_[i * 3 + 2]]) / 3.0f;
+		}
+
+		if (num_tris > 0)
+		{
+			nodes_.reserve(num_tris * 2 / MAX_LEAF_TRIANGLES + 1);
+			this->BuildNode(tris, 0, num_tris, centroids);
+			this->RefitNodes();
+		}
+		else
+		{
+			bb_ = AABBox(float3(0, 0, 0), float3(0, 0, 0));
+		}
+	}
+
+	void TriangleBVH::Refit(std::vector<float3> const & positions)
+	{
+		BOOST_ASSERT(positions.size() == positions_.size());
+
+		positions_ = positions;
+		this->RefitNodes();
+	}
+
+	// Median split along the longest axis of the centroids
+	uint32_t TriangleBVH::BuildNode(std::vector<uint32_t>& tris, uint32_t begin, uint32_t end,
+		std::vector<float3> const & centroids)
+	{
+		uint32_t const index = static_cast<uint32_t>(nodes_.size());
+		nodes_.push_back(Node());
+
+		if (end - begin <= MAX_LEAF_TRIANGLES)
+		{
+			uint32_t const packet = static_cast<uint32_t>(packets_.size());
+			packets_.push_back(TrianglePacket());
+			for (uint32_t i = 0; i < MAX_LEAF_TRIANGLES; ++ i)
+			{
+				packet_tris_.push_back((begin + i < end) ? tris[begin + i] : ~0U);
+			}
+
+			nodes_[index].first = packet;
+			nodes_[index].count = end - begin;
+		}
+		else
+		{
+			float3 c_min = centroids[tris[begin]];
+			float3 c_max = c_min;
+			for (uint32_t i = begin + 1; i < end; ++ i)
+			{
+				c_min = MathLib::minimize(c_min, centroids[tris[i]]);
+				c_max = MathLib::maximize(c_max, centroids[tris[i]]);
+			}
+			float3 const extent = c_max - c_min;
+			int axis = (extent.x() > extent.y()) ? 0 : 1;
+			axis = (extent.z() > extent[axis]) ? 2 : axis;
+
+			uint32_t const mid = (begin + end) / 2;
+			std::nth_element(tris.begin() + begin, tris.begin() + mid, tris.begin() + end,
+				[&centroids, axis](uint32_t lhs, uint32_t rhs)
+				{
+					return centroids[lhs][axis] < centroids[rhs][axis];
+				});
+
+			this->BuildNode(tris, begin, mid, centroids);
+			uint32_t const second = this->BuildNode(tris, mid, end, centroids);
+
+			nodes_[index].first = second;
+			nodes_[index].count = 0;
+		}
+
+		return index;
+	}
+
+	void TriangleBVH::FillPacket(uint32_t packet)
+	{
+		TrianglePacket& tp = packets_[packet];
+		for (uint32_t lane = 0; lane < MAX_LEAF_TRIANGLES; ++ lane)
+		{
+			uint32_t const tri = packet_tris_[packet * MAX_LEAF_TRIANGLES + lane];
+			float3 v0(0, 0, 0);
+			float3 e1(0, 0, 0);
+			float3 e2(0, 0, 0);
+			if (tri != ~0U)
+			{
+				v0 = positions_[indices_[tri * 3 + 0]];
+				e1 = positions_[indices_[tri * 3 + 1]] - v0;
+				e2 = positions_[indices_[tri * 3 + 2]] - v0;
+			}
+			for (int c = 0; c < 3; ++ c)
+			{
+				tp.v0[c][lane] = v0[c];
+				tp.e1[c][lane] = e1[c];
+				tp.e2[c][lane] = e2[c];
+			}
+		}
+	}
+
+	// Children always come after their parent, so walking backward visits them first
+	void TriangleBVH::RefitNodes()
+	{
+		for (uint32_t i = static_cast<uint32_t>(nodes_.size()); i > 0; -- i)
+		{
+			Node& node = nodes_[i - 1];
+			if (node.count > 0)
+			{
+				this->FillPacket(node.first);
+
+				uint32_t const* tris = &packet_tris_[node.first * MAX_LEAF_TRIANGLES];
+				float3 const & p = positions_[indices_[tris[0] * 3]];
+				float3 bb_min = p;
+				float3 bb_max = p;
+				for (uint32_t j = 0; j < node.count; ++ j)
+				{
+					for (int k = 0; k < 3; ++ k)
+					{
+						float3 const & v = positions_[indices_[tris[j] * 3 + k]];
+						bb_min = MathLib::minimize(bb_min, v);
+						bb_max = MathLib::maximize(bb_max, v);
+					}
+				}
+				node.bb = AABBox(bb_min, bb_max);
+			}
+			else
+			{
+				node.bb = nodes_[i].bb | nodes_[node.first].bb;
+			}
+		}
+
+		bb_ = nodes_[0].bb;
+	}
+
+	bool TriangleBVH::RayCast(float3 const & origin, float3 const & dir, float max_dist,
+		float& dist, uint32_t& triangle) const
+	{
+		if (nodes_.empty())
+		{
+			return false;
+		}
+
+		float3 const inv_dir(1 / dir.x(), 1 / dir.y(), 1 / dir.z());
+
+		SIMDVectorF4 const ox = SIMDMathLib::SetVector(origin.x());
+		SIMDVectorF4 const oy = SIMDMathLib::SetVector(origin.y());
+		SIMDVectorF4 const oz = SIMDMathLib::SetVector(origin.z());
+		SIMDVectorF4 const dx = SIMDMathLib::SetVector(dir.x());
+		SIMDVectorF4 const dy = SIMDMathLib::SetVector(dir.y());
+		SIMDVectorF4 const dz = SIMDMathLib::SetVector(dir.z());
+		SIMDVectorF4 const one = SIMDMathLib::SetVector(1.0f);
+
+		bool hit = false;
+		float closest = max_dist;
+
+		uint32_t stack[64];
+		uint32_t stack_size = 0;
+		stack[stack_size ++] = 0;
+		while (stack_size > 0)
+		{
+			Node const & node = nodes_[stack[-- stack_size]];
+			if (RayAABBDistance(origin, inv_dir, closest, node.bb) < 0)
+			{
+				continue;
+			}
+
+			if (node.count > 0)
+			{
+				// Moller-Trumbore on 4 triangles at once
+				TrianglePacket const & tp = packets_[node.first];
+				SIMDVectorF4 const e1x = SIMDMathLib::LoadVector4(tp.e1[0]);
+				SIMDVectorF4 const e1y = SIMDMathLib::LoadVector4(tp.e1[1]);
+				SIMDVectorF4 const e1z = SIMDMathLib::LoadVector4(tp.e1[2]);
+				SIMDVectorF4 const e2x = SIMDMathLib::LoadVector4(tp.e2[0]);
+				SIMDVectorF4 const e2y = SIMDMathLib::LoadVector4(tp.e2[1]);
+				SIMDVectorF4 const e2z = SIMDMathLib::LoadVector4(tp.e2[2]);
+
+				SIMDVectorF4 const px = dy * e2z - dz * e2y;
+				SIMDVectorF4 const py = dz * e2x - dx * e2z;
+				SIMDVectorF4 const pz = dx * e2y - dy * e2x;
+				SIMDVectorF4 const det = e1x * px + e1y * py + e1z * pz;
+				SIMDVectorF4 const inv_det = one / det;
+
+				SIMDVectorF4 const tx = ox - SIMDMathLib::LoadVector4(tp.v0[0]);
+				SIMDVectorF4 const ty = oy - SIMDMathLib::LoadVector4(tp.v0[1]);
+				SIMDVectorF4 const tz = oz - SIMDMathLib::LoadVector4(tp.v0[2]);
+				SIMDVectorF4 const u = (tx * px + ty * py + tz * pz) * inv_det;
+
+				SIMDVectorF4 const qx = ty * e1z - tz * e1y;
+				SIMDVectorF4 const qy = tz * e1x - tx * e1z;
+				SIMDVectorF4 const qz = tx * e1y - ty * e1x;
+				SIMDVectorF4 const v = (dx * qx + dy * qy + dz * qz) * inv_det;
+				SIMDVectorF4 const t = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+				for (uint32_t lane = 0; lane < node.count; ++ lane)
+				{
+					float const lane_det = SIMDMathLib::GetByIndex(det, lane);
+					float const lane_u = SIMDMathLib::GetByIndex(u, lane);
+					float const lane_v = SIMDMathLib::GetByIndex(v, lane);
+					float const lane_t = SIMDMathLib::GetByIndex(t, lane);
+					if ((MathLib::abs(lane_det) > DET_EPSILON) && (lane_u >= 0) && (lane_v >= 0) && (lane_u + lane_v <= 1)
+						&& (lane_t >= 0) && (lane_t < closest))
+					{
+						closest = lane_t;
+						triangle = packet_tris_[node.first * MAX_LEAF_TRIANGLES + lane];
+						hit = true;
+					}
+				}
+			}
+			else
+			{
+				// Push the farther child first, so the nearer one is popped first
+				uint32_t const first = static_cast<uint32_t>(&node - &nodes_[0]) + 1;
+				uint32_t const second = node.first;
+				float const d0 = RayAABBDistance(origin, inv_dir, closest, nodes_[first].bb);
+				float const d1 = RayAABBDistance(origin, inv_dir, closest, nodes_[second].bb);
+				BOOST_ASSERT(stack_size + 2 <= sizeof(stack) / sizeof(stack[0]));
+				if ((d0 >= 0) && (d1 >= 0))
+				{
+					stack[stack_size ++] = (d0 <= d1) ? second : first;
+					stack[stack_size ++] = (d0 <= d1) ? first : second;
+				}
+				else if (d0 >= 0)
+				{
+					stack[stack_size ++] = first;
+				}
+				else if (d1 >= 0)
+				{
+					stack[stack_size ++] = second;
+				}
+			}
+		}
+
+		if (hit)
+		{
+			dist = closest;
+		}
+		return hit;
+	}
+}
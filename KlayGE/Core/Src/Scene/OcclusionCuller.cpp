@@ -0,0 +1,398 @@
+/**
+ * @file OcclusionCuller.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/SIMDMath.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Thread.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <KlayGE/OcclusionCuller.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	// Vertices closer than this in clip space w are treated as crossing the near plane
+	float const W_EPSILON = 1e-4f;
+
+	// Height of the smallest band of rows a worker thread is given
+	uint32_t const MIN_BAND_HEIGHT = 8;
+
+	SIMDMatrixF4 ToSIMDMatrix(float4x4 const & m)
+	{
+		return SIMDMatrixF4(m(0, 0), m(0, 1), m(0, 2), m(0, 3),
+			m(1, 0), m(1, 1), m(1, 2), m(1, 3),
+			m(2, 0), m(2, 1), m(2, 2), m(2, 3),
+			m(3, 0), m(3, 1), m(3, 2), m(3, 3));
+	}
+}
+
+namespace KlayGE
+{
+	OccluderMesh::OccluderMesh(std::vector<float3> positions, std::vector<uint32_t> indices)
+		: positions_(std::move(positions)), indices_(std::move(indices))
+	{
+		BOOST_ASSERT(indices_.size() % 3 == 0);
+
+		if (!positions_.empty())
+		{
+			pos_aabb_ = MathLib::compute_aabbox(positions_.begin(), positions_.end());
+		}
+	}
+
+
+	OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+		: width_(width), height_(height)
+	{
+		BOOST_ASSERT((width_ & 3) == 0);
+
+		uint32_t w = width_;
+		uint32_t h = height_;
+		for (;;)
+		{
+			hiz_.emplace_back(w * h, 1.0f);
+			if ((1 == w) && (1 == h))
+			{
+				break;
+			}
+
+			w = std::max(w / 2, 1U);
+			h = std::max(h / 2, 1U);
+		}
+	}
+
+	void OcclusionCuller::Begin(float4x4 const & view_proj)
+	{
+		view_proj_ = view_proj;
+		triangles_.clear();
+	}
+
+	void OcclusionCuller::AddOccluder(OccluderMesh const & mesh, float4x4 const & model)
+	{
+		SIMDMatrixF4 const mvp = ToSIMDMatrix(model * view_proj_);
+
+		float const half_width = width_ * 0.5f;
+		float const half_height = height_ * 0.5f;
+
+		auto const & positions = mesh.Positions();
+		auto const & indices = mesh.Indices();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			float2 v[3];
+			float z[3];
+			bool clipped = false;
+			for (int j = 0; j < 3; ++ j)
+			{
+				float3 const & pos = positions[indices[i + j]];
+				SIMDVectorF4 const p = SIMDMathLib::TransformVector4(SIMDMathLib::SetVector(pos.x(), pos.y(), pos.z(), 1),
+					mvp);
+				float const w = SIMDMathLib::GetW(p);
+				if (w < W_EPSILON)
+				{
+					clipped = true;
+					break;
+				}
+
+				float const inv_w = 1 / w;
+				z[j] = SIMDMathLib::GetZ(p) * inv_w;
+				if ((z[j] < 0) || (z[j] > 1))
+				{
+					clipped = true;
+					break;
+				}
+				v[j] = float2((SIMDMathLib::GetX(p) * inv_w + 1) * half_width, (1 - SIMDMathLib::GetY(p) * inv_w) * half_height);
+			}
+
+			// Triangles crossing the near or far plane are dropped. It only makes the culling less aggressive.
+			if (clipped)
+			{
+				continue;
+			}
+
+			float area = (v[1].x() - v[0].x()) * (v[2].y() - v[0].y()) - (v[2].x() - v[0].x()) * (v[1].y() - v[0].y());
+			if (MathLib::abs(area) < 1e-6f)
+			{
+				continue;
+			}
+			if (area < 0)
+			{
+				std::swap(v[1], v[2]);
+				std::swap(z[1], z[2]);
+				area = -area;
+			}
+
+			float const y_min = std::min(std::min(v[0].y(), v[1].y()), v[2].y());
+			float const y_max = std::max(std::max(v[0].y(), v[1].y()), v[2].y());
+			float const x_min = std::min(std::min(v[0].x(), v[1].x()), v[2].x());
+			float const x_max = std::max(std::max(v[0].x(), v[1].x()), v[2].x());
+			if ((y_max < 0) || (y_min > height_) || (x_max < 0) || (x_min > width_))
+			{
+				continue;
+			}
+
+			ScreenTriangle tri;
+			tri.v[0] = v[0];
+			tri.v[1] = v[1];
+			tri.v[2] = v[2];
+			float const inv_area = 1 / area;
+			float const dz1 = z[1] - z[0];
+			float const dz2 = z[2] - z[0];
+			tri.dzdx = (dz1 * (v[2].y() - v[0].y()) - dz2 * (v[1].y() - v[0].y())) * inv_area;
+			tri.dzdy = (dz2 * (v[1].x() - v[0].x()) - dz1 * (v[2].x() - v[0].x())) * inv_area;
+			tri.z0 = z[0];
+			tri.y_min = std::max(static_cast<int>(std::ceil(y_min - 0.5f)), 0);
+			tri.y_max = std::min(static_cast<int>(std::floor(y_max - 0.5f)), static_cast<int>(height_) - 1);
+			if (tri.y_min <= tri.y_max)
+			{
+				triangles_.push_back(tri);
+			}
+		}
+	}
+
+	void OcclusionCuller::Rasterize()
+	{
+		CPUInfo cpu;
+		uint32_t const num_bands = std::max(std::min(static_cast<uint32_t>(cpu.NumHWThreads()), height_ / MIN_BAND_HEIGHT), 1U);
+		uint32_t const band_height = (height_ + num_bands - 1) / num_bands;
+
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_bands - 1);
+		thread_pool& tp = Context::Instance().ThreadPool();
+		for (uint32_t i = 1; i < num_bands; ++ i)
+		{
+			uint32_t const y_begin = i * band_height;
+			uint32_t const y_end = std::min(y_begin + band_height, height_);
+			if (y_begin < y_end)
+			{
+				joiners.push_back(tp(std::bind(&OcclusionCuller::RasterizeBand, this, y_begin, y_end)));
+			}
+		}
+		this->RasterizeBand(0, std::min(band_height, height_));
+		for (auto& j : joiners)
+		{
+			j();
+		}
+
+		this->BuildHiZ();
+	}
+
+	// Each band owns a range of rows, so workers never write to the same texel
+	void OcclusionCuller::RasterizeBand(uint32_t y_begin, uint32_t y_end)
+	{
+		auto& depth = hiz_[0];
+		std::fill(depth.begin() + y_begin * width_, depth.begin() + y_end * width_, 1.0f);
+
+		int const width = static_cast<int>(width_);
+		for (auto const & tri : triangles_)
+		{
+			int const y_first = std::max(tri.y_min, static_cast<int>(y_begin));
+			int const y_last = std::min(tri.y_max, static_cast<int>(y_end) - 1);
+			if (y_first > y_last)
+			{
+				continue;
+			}
+
+			SIMDVectorF4 const lane_dz = SIMDMathLib::Multiply(SIMDMathLib::SetVector(tri.dzdx),
+				SIMDMathLib::SetVector(0.5f, 1.5f, 2.5f, 3.5f));
+
+			for (int y = y_first; y <= y_last; ++ y)
+			{
+				float const py = y + 0.5f;
+
+				// Intersects the row with the 3 edge half planes to get the covered span
+				float x_lo = -0.5f;
+				float x_hi = width - 0.5f;
+				bool empty = false;
+				for (int e = 0; e < 3; ++ e)
+				{
+					float2 const & v0 = tri.v[e];
+					float2 const & v1 = tri.v[(e + 1) % 3];
+					float const a = v0.y() - v1.y();
+					float const b = (v1.x() - v0.x()) * (py - v0.y()) - a * v0.x();
+					if (a > 0)
+					{
+						x_lo = std::max(x_lo, -b / a);
+					}
+					else if (a < 0)
+					{
+						x_hi = std::min(x_hi, -b / a);
+					}
+					else if (b < 0)
+					{
+						empty = true;
+						break;
+					}
+				}
+				if (empty)
+				{
+					continue;
+				}
+
+				int const x_first = std::max(static_cast<int>(std::ceil(x_lo - 0.5f)), 0);
+				int const x_last = std::min(static_cast<int>(std::floor(x_hi - 0.5f)), width - 1);
+				if (x_first > x_last)
+				{
+					continue;
+				}
+
+				float* row = &depth[y * width_];
+				float const z_row = tri.z0 + tri.dzdy * (py - tri.v[0].y()) - tri.dzdx * tri.v[0].x();
+
+				int x = x_first;
+				for (; (x <= x_last) && (x & 3); ++ x)
+				{
+					row[x] = std::min(row[x], z_row + tri.dzdx * (x + 0.5f));
+				}
+				for (; x + 3 <= x_last; x += 4)
+				{
+					SIMDVectorF4 const z4 = SIMDMathLib::Add(SIMDMathLib::SetVector(z_row + tri.dzdx * x), lane_dz);
+					SIMDMathLib::StoreVector4(*reinterpret_cast<float4*>(&row[x]),
+						SIMDMathLib::Minimize(SIMDMathLib::LoadVector4(&row[x]), z4));
+				}
+				for (; x <= x_last; ++ x)
+				{
+					row[x] = std::min(row[x], z_row + tri.dzdx * (x + 0.5f));
+				}
+			}
+		}
+	}
+
+	// Each level keeps the farthest occluder depth of the 2x2 texels below it
+	void OcclusionCuller::BuildHiZ()
+	{
+		uint32_t src_w = width_;
+		uint32_t src_h = height_;
+		for (size_t level = 1; level < hiz_.size(); ++ level)
+		{
+			uint32_t const dst_w = std::max(src_w / 2, 1U);
+			uint32_t const dst_h = std::max(src_h / 2, 1U);
+			auto const & src = hiz_[level - 1];
+			auto& dst = hiz_[level];
+			for (uint32_t y = 0; y < dst_h; ++ y)
+			{
+				uint32_t const y0 = std::min(y * 2, src_h - 1);
+				uint32_t const y1 = std::min(y * 2 + 1, src_h - 1);
+				for (uint32_t x = 0; x < dst_w; ++ x)
+				{
+					uint32_t const x0 = std::min(x * 2, src_w - 1);
+					uint32_t const x1 = std::min(x * 2 + 1, src_w - 1);
+					dst[y * dst_w + x] = std::max(std::max(src[y0 * src_w + x0], src[y0 * src_w + x1]),
+						std::max(src[y1 * src_w + x0], src[y1 * src_w + x1]));
+				}
+			}
+
+			src_w = dst_w;
+			src_h = dst_h;
+		}
+	}
+
+	bool OcclusionCuller::Occluded(AABBox const & aabb) const
+	{
+		if (triangles_.empty())
+		{
+			return false;
+		}
+
+		SIMDMatrixF4 const view_proj = ToSIMDMatrix(view_proj_);
+
+		float x_min = 1e10f;
+		float x_max = -1e10f;
+		float y_min = 1e10f;
+		float y_max = -1e10f;
+		float z_min = 1e10f;
+		for (int i = 0; i < 8; ++ i)
+		{
+			float3 const corner = aabb.Corner(i);
+			SIMDVectorF4 const p = SIMDMathLib::TransformVector4(
+				SIMDMathLib::SetVector(corner.x(), corner.y(), corner.z(), 1), view_proj);
+			float const w = SIMDMathLib::GetW(p);
+			if (w < W_EPSILON)
+			{
+				// The box crosses the near plane, so it can't be hidden
+				return false;
+			}
+
+			float const inv_w = 1 / w;
+			float const x = SIMDMathLib::GetX(p) * inv_w;
+			float const y = SIMDMathLib::GetY(p) * inv_w;
+			x_min = std::min(x_min, x);
+			x_max = std::max(x_max, x);
+			y_min = std::min(y_min, y);
+			y_max = std::max(y_max, y);
+			z_min = std::min(z_min, SIMDMathLib::GetZ(p) * inv_w);
+		}
+		if (z_min <= 0)
+		{
+			return false;
+		}
+
+		int const width = static_cast<int>(width_);
+		int const height = static_cast<int>(height_);
+		int x0 = std::max(static_cast<int>((x_min + 1) * 0.5f * width), 0);
+		int x1 = std::min(static_cast<int>((x_max + 1) * 0.5f * width), width - 1);
+		int y0 = std::max(static_cast<int>((1 - y_max) * 0.5f * height), 0);
+		int y1 = std::min(static_cast<int>((1 - y_min) * 0.5f * height), height - 1);
+		if ((x0 > x1) || (y0 > y1))
+		{
+			return false;
+		}
+
+		// Picks the level where the rectangle covers at most a few texels in each direction
+		size_t level = 0;
+		while ((level + 1 < hiz_.size()) && (std::max(x1 - x0, y1 - y0) >> level) > 3)
+		{
+			++ level;
+		}
+		x0 >>= level;
+		x1 >>= level;
+		y0 >>= level;
+		y1 >>= level;
+
+		uint32_t const level_width = std::max(width_ >> level, 1U);
+		auto const & depth = hiz_[level];
+		for (int y = y0; y <= y1; ++ y)
+		{
+			for (int x = x0; x <= x1; ++ x)
+			{
+				if (z_min <= depth[y * level_width + x])
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+}
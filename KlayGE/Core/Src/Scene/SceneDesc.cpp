@@ -0,0 +1,627 @@
+/**
+ * @file SceneDesc.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/XMLDom.hpp>
+#include <KlayGE/ResLoader.hpp>
+#include <KlayGE/Light.hpp>
+#include <KlayGE/SceneObject.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <boost/assert.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+#include <KlayGE/SceneDesc.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const SCENE_BIN_VERSION = 1;
+	std::string const SCENE_BIN_EXT_NAME = ".scene_bin";
+
+	float3 ReadFloat3(XMLNodePtr const & node, char const * name, float3 const & default_value)
+	{
+		float3 ret = default_value;
+		XMLNodePtr child = node->FirstNode(name);
+		if (child)
+		{
+			std::istringstream attr_ss(child->Attrib("v")->ValueString());
+			attr_ss >> ret.x() >> ret.y() >> ret.z();
+		}
+		return ret;
+	}
+
+	float ReadFloat(XMLNodePtr const & node, char const * name, float default_value)
+	{
+		XMLNodePtr child = node->FirstNode(name);
+		if (child)
+		{
+			return child->Attrib("s")->ValueFloat();
+		}
+		return default_value;
+	}
+
+	uint32_t ReadUpdateScript(XMLNodePtr const & node, SceneDesc& desc)
+	{
+		XMLNodePtr update_node = node->FirstNode("update");
+		if (update_node)
+		{
+			update_node = update_node->FirstNode();
+			if (update_node && (XNT_CData == update_node->Type()))
+			{
+				std::string const script = update_node->ValueString();
+				if (!script.empty())
+				{
+					return desc.AddScript(script);
+				}
+			}
+		}
+		return SceneDesc::NO_INDEX;
+	}
+
+	uint32_t ReadModelAttrib(XMLNodePtr const & model_node)
+	{
+		uint32_t obj_attr = SceneObject::SOA_Cullable;
+
+		XMLNodePtr attribute_node = model_node->FirstNode("attr");
+		if (attribute_node)
+		{
+			XMLAttributePtr attr = attribute_node->Attrib("value");
+			if (attr)
+			{
+				if (!attr->TryConvert(obj_attr))
+				{
+					obj_attr = SceneObject::SOA_Cullable;
+
+					std::vector<std::string> tokens;
+					boost::algorithm::split(tokens, attr->ValueString(), boost::is_any_of(" \t|"));
+					for (auto& token : tokens)
+					{
+						boost::algorithm::trim(token);
+						if ("cullable" == token)
+						{
+							obj_attr |= SceneObject::SOA_Cullable;
+						}
+						else if ("overlay" == token)
+						{
+							obj_attr |= SceneObject::SOA_Overlay;
+						}
+						else if ("moveable" == token)
+						{
+							obj_attr |= SceneObject::SOA_Moveable;
+						}
+						else if ("invisible" == token)
+						{
+							obj_attr |= SceneObject::SOA_Invisible;
+						}
+					}
+				}
+			}
+		}
+
+		return obj_attr;
+	}
+
+	uint32_t ReadLightAttrib(XMLNodePtr const & light_node)
+	{
+		uint32_t light_attr = 0;
+
+		XMLNodePtr attr_node = light_node->FirstNode("attr");
+		if (attr_node)
+		{
+			std::vector<std::string> tokens;
+			boost::algorithm::split(tokens, attr_node->Attrib("value")->ValueString(), boost::is_any_of(" \t|"));
+			for (auto& token : tokens)
+			{
+				boost::algorithm::trim(token);
+
+				if ("no_shadow" == token)
+				{
+					light_attr |= LightSource::LSA_NoShadow;
+				}
+				else if ("no_diffuse" == token)
+				{
+					light_attr |= LightSource::LSA_NoDiffuse;
+				}
+				else if ("no_specular" == token)
+				{
+					light_attr |= LightSource::LSA_NoSpecular;
+				}
+				else if ("indirect" == token)
+				{
+					light_attr |= LightSource::LSA_IndirectLighting;
+				}
+			}
+		}
+
+		return light_attr;
+	}
+
+	LightSource::LightType ReadLightType(std::string const & lt_str)
+	{
+		if ("ambient" == lt_str)
+		{
+			return LightSource::LT_Ambient;
+		}
+		else if ("sun" == lt_str)
+		{
+			return LightSource::LT_Sun;
+		}
+		else if ("directional" == lt_str)
+		{
+			return LightSource::LT_Directional;
+		}
+		else if ("point" == lt_str)
+		{
+			return LightSource::LT_Point;
+		}
+		else if ("spot" == lt_str)
+		{
+			return LightSource::LT_Spot;
+		}
+		else if ("sphere_area" == lt_str)
+		{
+			return LightSource::LT_SphereArea;
+		}
+		else
+		{
+			BOOST_ASSERT("tube_area" == lt_str);
+			return LightSource::LT_TubeArea;
+		}
+	}
+
+	void WriteUInt32(std::ostream& os, uint32_t value)
+	{
+		value = Native2LE(value);
+		os.write(reinterpret_cast<char const *>(&value), sizeof(value));
+	}
+
+	void WriteString(std::ostream& os, std::string const & str)
+	{
+		WriteUInt32(os, static_cast<uint32_t>(str.size()));
+		os.write(str.data(), str.size());
+	}
+
+	// All the fields are 4 bytes, so the records are written word by word in little endian
+	template <typename T>
+	void WriteRecords(std::ostream& os, std::vector<T> const & records)
+	{
+		static_assert(sizeof(T) % sizeof(uint32_t) == 0, "Records must be made of 4-byte fields.");
+
+#ifdef KLAYGE_LITTLE_ENDIAN
+		if (!records.empty())
+		{
+			os.write(reinterpret_cast<char const *>(&records[0]), records.size() * sizeof(T));
+		}
+#else
+		for (auto const & record : records)
+		{
+			uint32_t const * words = reinterpret_cast<uint32_t const *>(&record);
+			for (size_t i = 0; i < sizeof(T) / sizeof(uint32_t); ++ i)
+			{
+				WriteUInt32(os, words[i]);
+			}
+		}
+#endif
+	}
+
+	class BinReader
+	{
+	public:
+		BinReader(uint8_t const * data, size_t size)
+			: cur_(data), end_(data + size), failed_(false)
+		{
+		}
+
+		// Set once a read runs past the end. The reads after it return zeros.
+		bool Failed() const
+		{
+			return failed_;
+		}
+
+		uint32_t ReadUInt32()
+		{
+			uint32_t value;
+			this->ReadBytes(&value, sizeof(value));
+			return LE2Native(value);
+		}
+
+		std::string ReadString()
+		{
+			uint32_t const len = this->ReadUInt32();
+			std::string str;
+			if (!this->CanRead(len))
+			{
+				failed_ = true;
+			}
+			else if (len > 0)
+			{
+				str.resize(len);
+				this->ReadBytes(&str[0], len);
+			}
+			return str;
+		}
+
+		template <typename T>
+		void ReadRecords(std::vector<T>& records, uint32_t num)
+		{
+			if (!this->CanRead(static_cast<uint64_t>(num) * sizeof(T)))
+			{
+				failed_ = true;
+				num = 0;
+			}
+			records.resize(num);
+			if (num > 0)
+			{
+				this->ReadBytes(&records[0], num * sizeof(T));
+#ifndef KLAYGE_LITTLE_ENDIAN
+				uint32_t* words = reinterpret_cast<uint32_t*>(&records[0]);
+				for (size_t i = 0; i < num * sizeof(T) / sizeof(uint32_t); ++ i)
+				{
+					words[i] = LE2Native(words[i]);
+				}
+#endif
+			}
+		}
+
+		// Counts are checked against what is left before anything is allocated for them
+		bool CanRead(uint64_t size) const
+		{
+			return !failed_ && (size <= static_cast<uint64_t>(end_ - cur_));
+		}
+
+	private:
+		void ReadBytes(void* dst, size_t size)
+		{
+			if (!this->CanRead(size))
+			{
+				failed_ = true;
+				std::memset(dst, 0, size);
+				return;
+			}
+
+			std::memcpy(dst, cur_, size);
+			cur_ += size;
+		}
+
+	private:
+		uint8_t const * cur_;
+		uint8_t const * end_;
+		bool failed_;
+	};
+
+	bool SceneBinUpToDate(std::string const & name)
+	{
+		ResIdentifierPtr bin_file = ResLoader::Instance().Open(name + SCENE_BIN_EXT_NAME);
+		if (!bin_file)
+		{
+			return false;
+		}
+
+		uint32_t fourcc;
+		bin_file->read(&fourcc, sizeof(fourcc));
+		fourcc = LE2Native(fourcc);
+		uint32_t ver;
+		bin_file->read(&ver, sizeof(ver));
+		ver = LE2Native(ver);
+		if ((fourcc != MakeFourCC<'K', 'G', 'S', ' '>::value) || (ver != SCENE_BIN_VERSION))
+		{
+			return false;
+		}
+
+		ResIdentifierPtr xml_file = ResLoader::Instance().Open(name);
+		return !xml_file || (bin_file->Timestamp() >= xml_file->Timestamp());
+	}
+}
+
+namespace KlayGE
+{
+	SceneDesc::SceneDesc()
+	{
+		streaming.enabled = 0;
+		streaming.cell_size = 100;
+		streaming.load_radius = 200;
+		streaming.unload_radius = 250;
+		streaming.budget_mb = 1024;
+	}
+
+	uint32_t SceneDesc::AddResource(ResourceType type, std::string const & name)
+	{
+		for (size_t i = 0; i < resources.size(); ++ i)
+		{
+			if ((resources[i].type == type) && (resources[i].name == name))
+			{
+				return static_cast<uint32_t>(i);
+			}
+		}
+
+		Resource res;
+		res.type = type;
+		res.name = name;
+		resources.push_back(res);
+		return static_cast<uint32_t>(resources.size() - 1);
+	}
+
+	uint32_t SceneDesc::AddScript(std::string const & script)
+	{
+		scripts.push_back(script);
+		return static_cast<uint32_t>(scripts.size() - 1);
+	}
+
+	void LoadSceneXML(ResIdentifierPtr const & res, SceneDesc& desc)
+	{
+		desc = SceneDesc();
+
+		KlayGE::XMLDocument doc;
+		XMLNodePtr root = doc.Parse(res);
+
+		{
+			XMLAttributePtr attr = root->Attrib("skybox");
+			if (attr)
+			{
+				desc.skybox = attr->ValueString();
+			}
+		}
+
+		XMLNodePtr streaming_node = root->FirstNode("streaming");
+		if (streaming_node)
+		{
+			desc.streaming.enabled = 1;
+			streaming_node->TryConvertAttrib("cell_size", desc.streaming.cell_size, desc.streaming.cell_size);
+			streaming_node->TryConvertAttrib("load_radius", desc.streaming.load_radius, desc.streaming.load_radius);
+			streaming_node->TryConvertAttrib("unload_radius", desc.streaming.unload_radius, desc.streaming.unload_radius);
+			streaming_node->TryConvertAttrib("budget_mb", desc.streaming.budget_mb, desc.streaming.budget_mb);
+		}
+
+		for (XMLNodePtr light_node = root->FirstNode("light"); light_node; light_node = light_node->NextSibling("light"))
+		{
+			SceneDesc::Light light;
+			light.type = ReadLightType(light_node->Attrib("type")->ValueString());
+			light.attrib = ReadLightAttrib(light_node);
+			light.color = ReadFloat3(light_node, "color", float3(0, 0, 0));
+			light.dir = ReadFloat3(light_node, "dir", float3(0, 0, 1));
+			light.pos = ReadFloat3(light_node, "pos", float3(0, 0, 0));
+			light.falloff = ReadFloat3(light_node, "fall_off", float3(1, 0, 0));
+			light.inner_angle = PI / 6;
+			light.outer_angle = PI / 4;
+			light.projective_tex = SceneDesc::NO_INDEX;
+
+			XMLNodePtr projective_node = light_node->FirstNode("projective");
+			if (projective_node)
+			{
+				XMLAttributePtr attr = projective_node->Attrib("name");
+				if (attr)
+				{
+					light.projective_tex = desc.AddResource(SceneDesc::RT_Texture, attr->ValueString());
+				}
+			}
+
+			XMLNodePtr angle_node = light_node->FirstNode("angle");
+			if (angle_node)
+			{
+				light.inner_angle = angle_node->Attrib("inner")->ValueFloat();
+				light.outer_angle = angle_node->Attrib("outer")->ValueFloat();
+			}
+
+			light.update_script = ReadUpdateScript(light_node, desc);
+
+			XMLNodePtr scale_node = light_node->FirstNode("scale");
+			light.proxy_scale = scale_node ? ReadFloat3(light_node, "scale", float3(1, 1, 1)) : float3(0, 0, 0);
+
+			desc.lights.push_back(light);
+		}
+
+		for (XMLNodePtr model_node = root->FirstNode("model"); model_node; model_node = model_node->NextSibling("model"))
+		{
+			float3 const scale = ReadFloat3(model_node, "scale", float3(1, 1, 1));
+			float3 const translate = ReadFloat3(model_node, "translate", float3(0, 0, 0));
+			Quaternion rotate = Quaternion::Identity();
+			XMLNodePtr rotate_node = model_node->FirstNode("rotate");
+			if (rotate_node)
+			{
+				std::istringstream attr_ss(rotate_node->Attrib("v")->ValueString());
+				attr_ss >> rotate.x() >> rotate.y() >> rotate.z() >> rotate.w();
+			}
+
+			XMLAttributePtr attr = model_node->Attrib("meshml");
+			BOOST_ASSERT(attr);
+
+			SceneDesc::Model model;
+			model.transform = MathLib::transformation<float>(nullptr, nullptr, &scale, nullptr, &rotate, &translate);
+			model.resource = desc.AddResource(SceneDesc::RT_Model, attr->ValueString());
+			model.attrib = ReadModelAttrib(model_node);
+			model.update_script = ReadUpdateScript(model_node, desc);
+			desc.models.push_back(model);
+		}
+
+		for (XMLNodePtr camera_node = root->FirstNode("camera"); camera_node; camera_node = camera_node->NextSibling("camera"))
+		{
+			SceneDesc::Camera camera;
+			camera.eye_pos = ReadFloat3(camera_node, "eye_pos", float3(0, 0, -1));
+			camera.look_at = ReadFloat3(camera_node, "look_at", float3(0, 0, 0));
+			camera.up = ReadFloat3(camera_node, "up", float3(0, 1, 0));
+			camera.fov = ReadFloat(camera_node, "fov", PI / 4);
+			camera.aspect = ReadFloat(camera_node, "aspect", 0);
+			camera.near_plane = ReadFloat(camera_node, "near", 1);
+			camera.far_plane = ReadFloat(camera_node, "far", 1000);
+			camera.update_script = ReadUpdateScript(camera_node, desc);
+			desc.cameras.push_back(camera);
+		}
+	}
+
+	bool LoadSceneBin(ResIdentifierPtr const & res, SceneDesc& desc)
+	{
+		desc = SceneDesc();
+
+		if (!res)
+		{
+			return false;
+		}
+
+		// One read for the whole file, the arrays are copied out of it directly
+		res->seekg(0, std::ios_base::end);
+		int64_t const file_size = res->tellg();
+		res->seekg(0, std::ios_base::beg);
+		if (!*res || (file_size < static_cast<int64_t>(2 * sizeof(uint32_t))))
+		{
+			return false;
+		}
+		size_t const size = static_cast<size_t>(file_size);
+		std::vector<uint8_t> data(size);
+		res->read(&data[0], size);
+		if (!*res)
+		{
+			return false;
+		}
+
+		BinReader reader(&data[0], size);
+
+		uint32_t const fourcc = reader.ReadUInt32();
+		uint32_t const ver = reader.ReadUInt32();
+		if ((fourcc != MakeFourCC<'K', 'G', 'S', ' '>::value) || (ver != SCENE_BIN_VERSION))
+		{
+			return false;
+		}
+
+		uint32_t const num_resources = reader.ReadUInt32();
+		uint32_t const num_scripts = reader.ReadUInt32();
+		uint32_t const num_models = reader.ReadUInt32();
+		uint32_t const num_lights = reader.ReadUInt32();
+		uint32_t const num_cameras = reader.ReadUInt32();
+
+		std::vector<SceneDesc::Streaming> streaming;
+		reader.ReadRecords(streaming, 1);
+		if (reader.Failed())
+		{
+			return false;
+		}
+		desc.streaming = streaming[0];
+
+		desc.skybox = reader.ReadString();
+
+		// Each resource and script takes at least its length word
+		if (!reader.CanRead((static_cast<uint64_t>(num_resources) * 2 + num_scripts) * sizeof(uint32_t)))
+		{
+			desc = SceneDesc();
+			return false;
+		}
+		desc.resources.resize(num_resources);
+		for (auto& res_desc : desc.resources)
+		{
+			res_desc.type = static_cast<SceneDesc::ResourceType>(reader.ReadUInt32());
+			res_desc.name = reader.ReadString();
+		}
+		desc.scripts.resize(num_scripts);
+		for (auto& script : desc.scripts)
+		{
+			script = reader.ReadString();
+		}
+
+		reader.ReadRecords(desc.models, num_models);
+		reader.ReadRecords(desc.lights, num_lights);
+		reader.ReadRecords(desc.cameras, num_cameras);
+
+		if (reader.Failed())
+		{
+			desc = SceneDesc();
+			return false;
+		}
+		return true;
+	}
+
+	void SaveSceneBin(SceneDesc const & desc, std::ostream& os)
+	{
+		WriteUInt32(os, MakeFourCC<'K', 'G', 'S', ' '>::value);
+		WriteUInt32(os, SCENE_BIN_VERSION);
+
+		WriteUInt32(os, static_cast<uint32_t>(desc.resources.size()));
+		WriteUInt32(os, static_cast<uint32_t>(desc.scripts.size()));
+		WriteUInt32(os, static_cast<uint32_t>(desc.models.size()));
+		WriteUInt32(os, static_cast<uint32_t>(desc.lights.size()));
+		WriteUInt32(os, static_cast<uint32_t>(desc.cameras.size()));
+
+		WriteRecords(os, std::vector<SceneDesc::Streaming>(1, desc.streaming));
+
+		WriteString(os, desc.skybox);
+
+		for (auto const & res : desc.resources)
+		{
+			WriteUInt32(os, res.type);
+			WriteString(os, res.name);
+		}
+		for (auto const & script : desc.scripts)
+		{
+			WriteString(os, script);
+		}
+
+		WriteRecords(os, desc.models);
+		WriteRecords(os, desc.lights);
+		WriteRecords(os, desc.cameras);
+	}
+
+	void LoadSceneDesc(std::string const & name, SceneDesc& desc)
+	{
+		std::string xml_name = name;
+		if ((name.size() > SCENE_BIN_EXT_NAME.size())
+			&& (name.rfind(SCENE_BIN_EXT_NAME) == name.size() - SCENE_BIN_EXT_NAME.size()))
+		{
+			if (LoadSceneBin(ResLoader::Instance().Open(name), desc))
+			{
+				return;
+			}
+			xml_name = name.substr(0, name.size() - SCENE_BIN_EXT_NAME.size());
+		}
+		else if (SceneBinUpToDate(name))
+		{
+			if (LoadSceneBin(ResLoader::Instance().Open(name + SCENE_BIN_EXT_NAME), desc))
+			{
+				return;
+			}
+		}
+
+		// A truncated or corrupt binary falls back to the xml it was compiled from
+		ResIdentifierPtr xml_file = ResLoader::Instance().Open(xml_name);
+		if (xml_file)
+		{
+			LoadSceneXML(xml_file, desc);
+		}
+		else
+		{
+			LogError("Could not load scene %s.", name.c_str());
+			desc = SceneDesc();
+		}
+	}
+}
@@ -45,6 +45,8 @@
 #include <KlayGE/Camera.hpp>
 #include <KlayGE/RenderEngine.hpp>
 #include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderLayout.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/Light.hpp>
@@ -53,13 +55,103 @@
 #include <KlayGE/InputFactory.hpp>
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/OcclusionCuller.hpp>
+#include <KlayGE/FrameTaskGraph.hpp>
+#include <KlayGE/CommandList.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/AlignedAllocator.hpp>
+#include <KFL/CpuInfo.hpp>
 
 #include <map>
 #include <algorithm>
 
 #include <KlayGE/SceneManager.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Fewer objects than this per worker aren't worth a task
+	uint32_t const MIN_SUB_THREAD_UPDATE_OBJECTS = 16;
+	// Shorter runs of the render queue are drawn directly, cheaper than waking the workers
+	uint32_t const MIN_RECORD_RUN_ITEMS = 64;
+	uint32_t const MIN_RECORD_ITEMS_PER_LIST = 32;
+
+	// LSD radix sort on 8-bit digits. It's stable, and skips the digits shared by all keys.
+	template <typename T>
+	void RadixSortByKey(std::vector<T>& items, std::vector<T>& scratch)
+	{
+		if (items.size() < 2)
+		{
+			return;
+		}
+
+		uint32_t histograms[8][256] = {};
+		for (auto const & item : items)
+		{
+			for (uint32_t d = 0; d < 8; ++ d)
+			{
+				++ histograms[d][(item.key >> (d * 8)) & 0xFF];
+			}
+		}
+
+		scratch.resize(items.size());
+		for (uint32_t d = 0; d < 8; ++ d)
+		{
+			uint32_t const shift = d * 8;
+			uint32_t* histogram = histograms[d];
+			if (histogram[(items[0].key >> shift) & 0xFF] == items.size())
+			{
+				continue;
+			}
+
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < 256; ++ i)
+			{
+				uint32_t const count = histogram[i];
+				histogram[i] = offset;
+				offset += count;
+			}
+			for (auto const & item : items)
+			{
+				scratch[histogram[(item.key >> shift) & 0xFF] ++] = item;
+			}
+			items.swap(scratch);
+		}
+	}
+
+	// Maps a float to an uint32_t with the same ordering
+	uint32_t OrderedFloatBits(float v)
+	{
+		union FNU
+		{
+			float f;
+			uint32_t u;
+		} fnu;
+		fnu.f = v;
+		return (fnu.u & 0x80000000U) ? ~fnu.u : (fnu.u | 0x80000000U);
+	}
+
+	// The nearest view space depth of all the instances' bounding boxes
+	float MinViewDepth(Renderable const & renderable, float4 const & view_mat_z)
+	{
+		AABBox const & box = renderable.PosBound();
+		float3 const center = box.Center();
+		float3 const half_size = box.HalfSize();
+		uint32_t const num = renderable.NumInstances();
+		float md = 1e10f;
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			float4x4 const & mat = renderable.GetInstance(i)->ModelMatrix();
+			float3 const zvec(MathLib::dot(mat.Row(0), view_mat_z), MathLib::dot(mat.Row(1), view_mat_z),
+				MathLib::dot(mat.Row(2), view_mat_z));
+			float const zw = MathLib::dot(mat.Row(3), view_mat_z);
+			md = std::min(md, MathLib::dot(center, zvec) + zw - MathLib::dot(half_size, MathLib::abs(zvec)));
+		}
+		return md;
+	}
+}
+
 namespace KlayGE
 {
 	// 캯
@@ -68,11 +160,25 @@ namespace KlayGE
 		: frustum_(nullptr),
 			small_obj_threshold_(0),
 			update_elapse_(1.0f / 60),
+			inst_buffer_size_(1024 * 1024), inst_buffer_offset_(0), max_instances_per_batch_(1024),
 			num_objects_rendered_(0), num_renderables_rendered_(0),
 			num_primitives_rendered_(0), num_vertices_rendered_(0),
-			num_draw_calls_(0), num_dispatch_calls_(0),
-			quit_(false), deferred_mode_(false)
+			num_draw_calls_(0), num_dispatch_calls_(0), num_binds_issued_(0), num_binds_skipped_(0),
+			num_cbuffer_bytes_written_(0), num_cbuffer_bytes_uploaded_(0),
+			num_objects_occluded_(0),
+			num_visible_marks_reused_(0), num_visible_marks_tested_(0),
+			scene_version_(0), visibility_cache_threshold_(0),
+			culling_views_frame_(0xFFFFFFFF), culling_views_scene_version_(0), culling_views_visible_seed_(0),
+			query_snapshot_scene_version_(0),
+			quit_(false), sub_thread_synced_(true),
+			main_thread_lock_wait_(0), main_thread_lock_wait_accum_(0), sub_thread_lock_wait_(0),
+			pipelined_frame_(false), frame_app_time_(0), frame_elapsed_time_(0),
+			sub_thread_tick_time_(0), published_sim_time_(0), rendered_sim_time_(0),
+			frame_latency_(0), frame_throughput_(0), throughput_window_start_(0), throughput_window_frames_(0),
+			deferred_mode_(false)
 	{
+		CPUInfo cpu;
+		num_hw_threads_ = std::max(static_cast<uint32_t>(cpu.NumHWThreads()), 1U);
 	}
 
 	// 
@@ -80,7 +186,10 @@ namespace KlayGE
 	SceneManager::~SceneManager()
 	{
 		quit_ = true;
-		(*update_thread_)();
+		if (update_thread_)
+		{
+			(*update_thread_)();
+		}
 
 		this->ClearLight();
 		this->ClearCamera();
@@ -107,6 +216,27 @@ namespace KlayGE
 		update_elapse_ = elapse;
 	}
 
+	void SceneManager::VisibilityCacheThreshold(float threshold)
+	{
+		visibility_cache_threshold_ = threshold;
+	}
+
+	void SceneManager::MaxInstancesPerBatch(uint32_t max_instances)
+	{
+		BOOST_ASSERT(max_instances > 0);
+		max_instances_per_batch_ = max_instances;
+	}
+
+	void SceneManager::InstanceBufferSize(uint32_t size)
+	{
+		inst_buffer_size_ = size;
+		if (inst_buffer_ && (inst_buffer_->Size() != size))
+		{
+			inst_buffer_.reset();
+			inst_buffer_offset_ = 0;
+		}
+	}
+
 	// ü
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::ClipScene()
@@ -114,6 +244,127 @@ namespace KlayGE
 		App3DFramework& app = Context::Instance().AppInstance();
 		Camera& camera = app.ActiveCamera();
 
+		float4x4 const view_proj = this->CullingViewProj(camera);
+		for (auto const & obj : scene_objs_)
+		{
+			auto so = obj.get();
+			so->VisibleMark(this->ObjectVisible(so, camera, view_proj));
+		}
+	}
+
+	void SceneManager::ClipViews(std::vector<CullingView> const & views)
+	{
+		this->BeginClipViews(views);
+
+		uint32_t const all_views = (culling_views_.size() < 32)
+			? ((1UL << culling_views_.size()) - 1) : 0xFFFFFFFF;
+		for (auto const & obj : scene_objs_)
+		{
+			auto so = obj.get();
+			so->ViewMask(this->ObjectViewMask(so, all_views, 0));
+		}
+	}
+
+	void SceneManager::BeginClipViews(std::vector<CullingView> const & views)
+	{
+		BOOST_ASSERT(views.size() <= MAX_NUM_CULLING_VIEWS);
+
+		culling_views_.resize(views.size());
+		for (size_t i = 0; i < views.size(); ++ i)
+		{
+			CullingViewInfo& info = culling_views_[i];
+			info.camera = views[i].camera;
+			info.view_proj = views[i].view_proj;
+			info.frustum.ClipMatrix(info.view_proj, MathLib::inverse(info.view_proj));
+		}
+
+		culling_views_frame_ = Context::Instance().AppInstance().TotalNumFrames();
+		culling_views_scene_version_ = scene_version_;
+		culling_views_visible_seed_ = this->VisibleSeed(scene_objs_);
+	}
+
+	// Tests one object against the views in test_mask, and the views in inside_mask without the frustum test.
+	// A child is only tested in the views its parent is visible in, so parents have to be tested first.
+	uint32_t SceneManager::ObjectViewMask(SceneObject* so, uint32_t test_mask, uint32_t inside_mask)
+	{
+		if (!so->Visible())
+		{
+			return 0;
+		}
+
+		uint32_t const attr = so->Attrib();
+		if (attr & SceneObject::SOA_Moveable)
+		{
+			so->UpdateAbsModelMatrix();
+		}
+
+		uint32_t mask = test_mask | inside_mask;
+		if (so->Parent())
+		{
+			mask &= so->Parent()->ViewMask();
+		}
+		if (attr & SceneObject::SOA_Cullable)
+		{
+			AABBox const & aabb_ws = so->PosBoundWS();
+			for (uint32_t i = 0; i < culling_views_.size(); ++ i)
+			{
+				uint32_t const bit = 1UL << i;
+				if (mask & bit)
+				{
+					CullingViewInfo const & view = culling_views_[i];
+					bool visible = (small_obj_threshold_ <= 0)
+						|| ((MathLib::ortho_area(view.camera->ForwardVec(), aabb_ws) > small_obj_threshold_)
+							&& (MathLib::perspective_area(view.camera->EyePos(), view.view_proj, aabb_ws) > small_obj_threshold_));
+					if (visible && (test_mask & bit) && !so->Parent() && !view.camera->OmniDirectionalMode())
+					{
+						visible = (view.frustum.Intersect(aabb_ws) != BO_No);
+					}
+					if (!visible)
+					{
+						mask &= ~bit;
+					}
+				}
+			}
+		}
+
+		return mask;
+	}
+
+	size_t SceneManager::VisibleSeed(std::vector<SceneObjectPtr> const & scene_objs) const
+	{
+		std::vector<uint32_t, frame_allocator<uint32_t>> visible_list((scene_objs.size() + 31) / 32, 0);
+		for (size_t i = 0; i < scene_objs.size(); ++ i)
+		{
+			if (scene_objs[i]->Visible())
+			{
+				visible_list[i / 32] |= (1UL << (i & 31));
+			}
+		}
+		size_t seed = 0;
+		HashRange(seed, visible_list.begin(), visible_list.end());
+		return seed;
+	}
+
+	int32_t SceneManager::CullingViewIndex(Camera const & camera, float4x4 const & view_proj, uint32_t frame,
+		size_t visible_seed) const
+	{
+		if ((culling_views_frame_ == frame) && (culling_views_scene_version_ == scene_version_)
+			&& (culling_views_visible_seed_ == visible_seed))
+		{
+			for (size_t i = 0; i < culling_views_.size(); ++ i)
+			{
+				if ((culling_views_[i].camera == &camera) && (culling_views_[i].view_proj == view_proj))
+				{
+					return static_cast<int32_t>(i);
+				}
+			}
+		}
+		return -1;
+	}
+
+	// The view_proj used in culling, including the crop of current cascade
+	float4x4 SceneManager::CullingViewProj(Camera const & camera) const
+	{
 		float4x4 view_proj = camera.ViewProjMatrix();
 		auto drl = Context::Instance().DeferredRenderingLayerInstance();
 		if (drl)
@@ -124,54 +375,104 @@ namespace KlayGE
 				view_proj *= drl->GetCascadedShadowLayer()->CascadeCropMatrix(cas_index);
 			}
 		}
+		return view_proj;
+	}
 
-		for (auto const & obj : scene_objs_)
+	// Tests one object against the frustum_ without any help from a spatial structure
+	BoundOverlap SceneManager::ObjectVisible(SceneObject* so, Camera const & camera, float4x4 const & view_proj)
+	{
+		BoundOverlap visible;
+		uint32_t const attr = so->Attrib();
+		if (so->Visible())
 		{
-			auto so = obj.get();
-			BoundOverlap visible;
-			uint32_t const attr = so->Attrib();
-			if (so->Visible())
+			visible = this->VisibleTestFromParent(so, camera.ForwardVec(), camera.EyePos(), view_proj);
+			if (BO_Partial == visible)
 			{
-				visible = this->VisibleTestFromParent(so, camera.ForwardVec(), camera.EyePos(), view_proj);
-				if (BO_Partial == visible)
+				if (attr & SceneObject::SOA_Moveable)
 				{
-					if (attr & SceneObject::SOA_Moveable)
-					{
-						so->UpdateAbsModelMatrix();
-					}
+					so->UpdateAbsModelMatrix();
+				}
 
-					if (attr & SceneObject::SOA_Cullable)
+				if (attr & SceneObject::SOA_Cullable)
+				{
+					if (small_obj_threshold_ > 0)
 					{
-						if (small_obj_threshold_ > 0)
-						{
-							visible = ((MathLib::ortho_area(camera.ForwardVec(), so->PosBoundWS()) > small_obj_threshold_)
-								&& (MathLib::perspective_area(camera.EyePos(), view_proj, so->PosBoundWS()) > small_obj_threshold_))
-								? BO_Yes : BO_No;
-						}
-						else
-						{
-							visible = BO_Yes;
-						}
+						visible = ((MathLib::ortho_area(camera.ForwardVec(), so->PosBoundWS()) > small_obj_threshold_)
+							&& (MathLib::perspective_area(camera.EyePos(), view_proj, so->PosBoundWS()) > small_obj_threshold_))
+							? BO_Yes : BO_No;
 					}
 					else
 					{
 						visible = BO_Yes;
 					}
+				}
+				else
+				{
+					visible = BO_Yes;
+				}
 
-					if (!camera.OmniDirectionalMode() && (attr & SceneObject::SOA_Cullable)
-						&& (BO_Yes == visible))
-					{
-						visible = this->AABBVisible(so->PosBoundWS());
-					}
+				if (!camera.OmniDirectionalMode() && (attr & SceneObject::SOA_Cullable)
+					&& (BO_Yes == visible))
+				{
+					visible = this->SceneManager::AABBVisible(so->PosBoundWS());
 				}
 			}
-			else
+		}
+		else
+		{
+			visible = BO_No;
+		}
+
+		return visible;
+	}
+
+	// Rasterizes the occluders and hides the objects fully behind them
+	void SceneManager::OcclusionCullScene()
+	{
+		App3DFramework& app = Context::Instance().AppInstance();
+		if (!this->RasterizeOccluders(this->CullingViewProj(app.ActiveCamera())))
+		{
+			return;
+		}
+
+		for (auto const & obj : scene_objs_)
+		{
+			auto so = obj.get();
+			if ((so->VisibleMark() != BO_No) && !so->Occluder() && (so->Attrib() & SceneObject::SOA_Cullable))
 			{
-				visible = BO_No;
+				if (occlusion_culler_->Occluded(so->PosBoundWS()))
+				{
+					so->VisibleMark(BO_No);
+					++ num_objects_occluded_;
+				}
 			}
+		}
+	}
+
+	// Returns false if no visible occluder has any triangle, and nothing can be occluded
+	bool SceneManager::RasterizeOccluders(float4x4 const & view_proj)
+	{
+		if (!occlusion_culler_)
+		{
+			occlusion_culler_ = MakeUniquePtr<OcclusionCuller>(256, 128);
+		}
 
-			so->VisibleMark(visible);
+		occlusion_culler_->Begin(view_proj);
+		for (auto const & obj : scene_objs_)
+		{
+			auto so = obj.get();
+			if (so->Occluder() && (so->VisibleMark() != BO_No))
+			{
+				occlusion_culler_->AddOccluder(*so->Occluder(), so->AbsModelMatrix());
+			}
 		}
+		if (0 == occlusion_culler_->NumOccluderTriangles())
+		{
+			return false;
+		}
+
+		occlusion_culler_->Rasterize();
+		return true;
 	}
 
 	void SceneManager::AddCamera(CameraPtr const & camera)
@@ -267,6 +568,7 @@ namespace KlayGE
 			}
 
 			scene_objs_.push_back(obj);
+			++ scene_version_;
 			this->OnAddSceneObject(obj);
 		}
 	}
@@ -300,6 +602,7 @@ namespace KlayGE
 	std::vector<SceneObjectPtr>::iterator SceneManager::DelSceneObjectLocked(std::vector<SceneObjectPtr>::iterator iter)
 	{
 		this->OnDelSceneObject(iter);
+		++ scene_version_;
 		return scene_objs_.erase(iter);
 	}
 
@@ -357,20 +660,15 @@ namespace KlayGE
 			{
 				RenderTechnique const * obj_tech = obj->GetRenderTechnique();
 				BOOST_ASSERT(obj_tech);
-				bool found = false;
-				for (auto& items : render_queue_)
-				{
-					if (items.first == obj_tech)
-					{
-						items.second.push_back(obj);
-						found = true;
-						break;
-					}
-				}
-				if (!found)
+				auto iter = std::find(render_techs_.begin(), render_techs_.end(), obj_tech);
+				uint64_t const tech_index = iter - render_techs_.begin();
+				if (iter == render_techs_.end())
 				{
-					render_queue_.emplace_back(obj_tech, std::vector<Renderable*>(1, obj));
+					render_techs_.push_back(obj_tech);
 				}
+
+				// The key holds the technique index until SortRenderQueue packs the real one
+				render_queue_.push_back({ tech_index, obj });
 			}
 		}
 	}
@@ -453,6 +751,7 @@ namespace KlayGE
 		std::lock_guard<std::mutex> lock(update_mutex_);
 		scene_objs_.resize(0);
 		overlay_scene_objs_.resize(0);
+		++ scene_version_;
 	}
 
 	// ³
@@ -461,24 +760,91 @@ namespace KlayGE
 	{
 		deferred_mode_ = !!Context::Instance().DeferredRenderingLayerInstance();
 
+		main_thread_lock_wait_ = main_thread_lock_wait_accum_;
+		main_thread_lock_wait_accum_ = 0;
+
 		App3DFramework& app = Context::Instance().AppInstance();
-		float const app_time = app.AppTime();
-		float const frame_time = app.FrameTime();
+		frame_app_time_ = app.AppTime();
+		frame_elapsed_time_ = app.FrameTime();
 
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 		re.BeginFrame();
 
-		this->FlushScene();
-
-		if (!update_thread_ && !quit_)
+		pipelined_frame_ = Context::Instance().Config().pipelined_frame;
+		if (pipelined_frame_)
+		{
+			if (!frame_graph_)
+			{
+				this->BuildFrameGraph();
+			}
+			frame_graph_->Run();
+		}
+		else
 		{
-			update_thread_ = MakeUniquePtr<joiner<void>>(Context::Instance().ThreadPool()(
-				std::bind(&SceneManager::UpdateThreadFunc, this)));
+			this->RenderFrame();
+
+			if (!update_thread_ && !quit_)
+			{
+				update_thread_ = MakeUniquePtr<joiner<void>>(Context::Instance().ThreadPool()(
+					std::bind(&SceneManager::UpdateThreadFunc, this)));
+			}
+
+			this->UpdateScene();
+			this->PresentFrame();
+			this->UpdateViews();
 		}
 
+		FrameBuffer& fb = *re.ScreenFrameBuffer();
+		fb.WaitOnSwapBuffers();
+
+		re.EndFrame();
+	}
+
+	// Rendering and presenting this frame overlap with simulating the objects for the next one. SubThreadUpdate only
+	// writes the update side of the objects, and RenderFrame only reads the render side. The simulated state is
+	// published when both are done, and rendered in the next frame.
+	void SceneManager::BuildFrameGraph()
+	{
+		frame_graph_ = MakeUniquePtr<FrameTaskGraph>(Context::Instance().ThreadPool());
+
+		uint32_t const render = frame_graph_->AddTask(std::bind(&SceneManager::RenderFrame, this),
+			FrameTaskGraph::TA_MainThread);
+		uint32_t const simulate = frame_graph_->AddTask(std::bind(&SceneManager::SimulateFrame, this),
+			FrameTaskGraph::TA_Worker);
+		uint32_t const present = frame_graph_->AddTask(std::bind(&SceneManager::PresentFrame, this),
+			FrameTaskGraph::TA_MainThread, { render });
+		uint32_t const update = frame_graph_->AddTask(std::bind(&SceneManager::UpdateScene, this),
+			FrameTaskGraph::TA_MainThread, { simulate, present });
+		frame_graph_->AddTask(std::bind(&SceneManager::UpdateViews, this), FrameTaskGraph::TA_MainThread, { update });
+	}
+
+	// App updates, culling, render queue building and draw submission of all the passes
+	void SceneManager::RenderFrame()
+	{
+		rendered_sim_time_ = published_sim_time_;
+		this->FlushScene();
+	}
+
+	void SceneManager::SimulateFrame()
+	{
+		std::lock_guard<std::mutex> lock(sub_thread_mutex_);
+		sub_thread_tick_time_ = frame_timer_.current_time();
+		this->SubThreadUpdateObjects(frame_app_time_, frame_elapsed_time_);
+		sub_thread_synced_ = false;
+	}
+
+	void SceneManager::UpdateScene()
+	{
+		float const app_time = frame_app_time_;
+		float const frame_time = frame_elapsed_time_;
+
 		std::vector<SceneObjectPtr> added_scene_objs;
 		{
+			Timer lock_timer;
 			std::lock_guard<std::mutex> lock(update_mutex_);
+			main_thread_lock_wait_accum_ += static_cast<float>(lock_timer.elapsed());
+
+			this->SyncSubThreadState();
 
 			for (auto const & scene_obj : scene_objs_)
 			{
@@ -506,10 +872,39 @@ namespace KlayGE
 				scene_obj->OnAttachRenderable(true);
 				this->OnAddSceneObject(scene_obj);
 			}
+			if (!added_scene_objs.empty())
+			{
+				++ scene_version_;
+			}
+
+			this->UpdateQuerySnapshot();
 		}
+	}
 
-		FrameBuffer& fb = *re.ScreenFrameBuffer();
-		fb.SwapBuffers();
+	void SceneManager::PresentFrame()
+	{
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		re.ScreenFrameBuffer()->SwapBuffers();
+
+		double const now = frame_timer_.current_time();
+		if (rendered_sim_time_ > 0)
+		{
+			frame_latency_ = static_cast<float>(now - rendered_sim_time_);
+		}
+
+		++ throughput_window_frames_;
+		if (now - throughput_window_start_ >= 1)
+		{
+			frame_throughput_ = static_cast<float>(throughput_window_frames_ / (now - throughput_window_start_));
+			throughput_window_start_ = now;
+			throughput_window_frames_ = 0;
+		}
+	}
+
+	void SceneManager::UpdateViews()
+	{
+		float const app_time = frame_app_time_;
+		float const frame_time = frame_elapsed_time_;
 
 		InputEngine& ie = Context::Instance().InputFactoryInstance().InputEngineInstance();
 		ie.Update();
@@ -526,17 +921,15 @@ namespace KlayGE
 				light->Update(app_time, frame_time);
 			}
 		}
-
-		fb.WaitOnSwapBuffers();
-
-		re.EndFrame();
 	}
 
 	// ȾеȾ
 	/////////////////////////////////////////////////////////////////////////////////
 	void SceneManager::Flush(uint32_t urt)
 	{
+		Timer lock_timer;
 		std::lock_guard<std::mutex> lock(update_mutex_);
+		main_thread_lock_wait_accum_ += static_cast<float>(lock_timer.elapsed());
 
 		urt_ = urt;
 
@@ -561,38 +954,58 @@ namespace KlayGE
 		{
 			frustum_ = &camera.ViewFrustum();
 
-			std::vector<uint32_t> visible_list((scene_objs.size() + 31) / 32, 0);
-			for (size_t i = 0; i < scene_objs.size(); ++ i)
-			{
-				if (scene_objs[i]->Visible())
-				{
-					visible_list[i / 32] |= (1UL << (i & 31));
-				}
-			}
-			size_t seed = 0;
-			HashRange(seed, visible_list.begin(), visible_list.end());
+			size_t const visible_seed = this->VisibleSeed(scene_objs);
+			size_t seed = visible_seed;
 			HashCombine(seed, camera.OmniDirectionalMode());
 			HashCombine(seed, &camera);
 
+			uint32_t const frame = app.TotalNumFrames();
+			float4x4 const view_proj = this->CullingViewProj(camera);
+			bool const occlusion = Context::Instance().Config().occlusion_culling && !camera.OmniDirectionalMode();
+			int32_t const view_index = (urt & App3DFramework::URV_Overlay)
+				? -1 : this->CullingViewIndex(camera, view_proj, frame, visible_seed);
 			auto vmiter = visible_marks_map_.find(seed);
-			if (vmiter == visible_marks_map_.end())
+			if (view_index >= 0)
 			{
-				this->ClipScene();
-
-				auto visible_marks = MakeUniquePtr<std::vector<BoundOverlap>>(scene_objs.size());
+				uint32_t const bit = 1UL << view_index;
+				for (auto const & scene_obj : scene_objs)
+				{
+					scene_obj->VisibleMark((scene_obj->ViewMask() & bit) ? BO_Yes : BO_No);
+				}
+				if (occlusion)
+				{
+					this->OcclusionCullScene();
+				}
+				num_visible_marks_reused_ += static_cast<uint32_t>(scene_objs.size());
+			}
+			else if ((vmiter != visible_marks_map_.end()) && (vmiter->second.frame == frame))
+			{
+				auto const & visible_marks = vmiter->second.marks;
 				for (size_t i = 0; i < scene_objs.size(); ++ i)
 				{
-					(*visible_marks)[i] = scene_objs[i]->VisibleMark();
+					scene_objs[i]->VisibleMark(visible_marks[i]);
 				}
-
-				visible_marks_map_.emplace(seed, std::move(visible_marks));
+				num_visible_marks_reused_ += static_cast<uint32_t>(scene_objs.size());
+			}
+			else if ((vmiter != visible_marks_map_.end())
+				&& this->UpdateVisibleMarks(vmiter->second, camera, view_proj, occlusion))
+			{
+				vmiter->second.frame = frame;
 			}
 			else
 			{
-				for (size_t i = 0; i < scene_objs.size(); ++ i)
+				this->ClipScene();
+				if (occlusion)
+				{
+					this->OcclusionCullScene();
+				}
+
+				if (vmiter == visible_marks_map_.end())
 				{
-					scene_objs[i]->VisibleMark((*vmiter->second)[i]);
+					vmiter = visible_marks_map_.emplace(seed, VisibleMarks()).first;
 				}
+				this->StoreVisibleMarks(vmiter->second, frame, view_proj);
+				num_visible_marks_tested_ += static_cast<uint32_t>(scene_objs.size());
 			}
 		}
 		if (urt & App3DFramework::URV_Overlay)
@@ -625,76 +1038,275 @@ namespace KlayGE
 				auto renderable = so->GetRenderable().get();
 				if (renderable)
 				{
-					if (0 == renderable->NumInstances())
+					if (!so->InstanceFormat().empty())
+					{
+						inst_objs_.push_back(so);
+					}
+					else
 					{
-						renderable->AddToRenderQueue();
+						if (0 == renderable->NumInstances())
+						{
+							renderable->AddToRenderQueue();
+						}
+						renderable->AddInstance(so);
+						++ num_objects_rendered_;
 					}
-					renderable->AddInstance(so);
-					++ num_objects_rendered_;
 				}
 			}
 		}
-
-		std::sort(render_queue_.begin(), render_queue_.end(),
-			[](std::pair<RenderTechnique const *, std::vector<Renderable*>> const & lhs,
-				std::pair<RenderTechnique const *, std::vector<Renderable*>> const & rhs)
+		for (;;)
+		{
+			if (!inst_objs_.empty())
 			{
-				BOOST_ASSERT(lhs.first);
-				BOOST_ASSERT(rhs.first);
+				this->BatchInstances();
+			}
 
-				return lhs.first->Weight() < rhs.first->Weight();
-			});
+			this->SortRenderQueue();
 
-		float4 const & view_mat_z = camera.ViewMatrix().Col(2);
-		for (auto& items : render_queue_)
-		{
-			if (!items.first->Transparent() && !items.first->HasDiscard() && (items.second.size() > 1))
+			// OnRenderBegin and Record run on the workers, which GL and GLES contexts can't be used from
+			if (Context::Instance().Config().parallel_draw_recording
+				&& Context::Instance().RenderFactoryInstance().RenderEngineInstance().DeviceCaps().multithread_rendering_support)
+			{
+				this->RecordRenderQueue();
+			}
+			else
 			{
-				std::vector<std::pair<float, uint32_t>> min_depths(items.second.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
+				for (auto const & item : render_queue_)
 				{
-					Renderable const * renderable = items.second[j];
-					AABBox const & box = renderable->PosBound();
-					uint32_t const num = renderable->NumInstances();
-					float md = 1e10f;
-					for (uint32_t i = 0; i < num; ++ i)
-					{
-						float4x4 const & mat = renderable->GetInstance(i)->ModelMatrix();
-						float4 const zvec(MathLib::dot(mat.Row(0), view_mat_z),
-							MathLib::dot(mat.Row(1), view_mat_z), MathLib::dot(mat.Row(2), view_mat_z),
-							MathLib::dot(mat.Row(3), view_mat_z));
-						for (int k = 0; k < 8; ++ k)
-						{
-							float3 const v = box.Corner(k);
-							md = std::min(md, v.x() * zvec.x() + v.y() * zvec.y() + v.z() * zvec.z() + zvec.w());
-						}
+					item.renderable->Render();
+				}
+			}
+			num_renderables_rendered_ += static_cast<uint32_t>(render_queue_.size());
+			render_queue_.resize(0);
+			render_techs_.resize(0);
+
+			if (inst_overflow_objs_.empty())
+			{
+				inst_batches_.resize(0);
+				break;
+			}
+
+			for (auto batch : inst_batches_)
+			{
+				batch->ClearInstances();
+			}
+			inst_batches_.resize(0);
+			inst_objs_.swap(inst_overflow_objs_);
+		}
+
+		num_primitives_rendered_ += re.NumPrimitivesJustRendered();
+		num_vertices_rendered_ += re.NumVerticesJustRendered();
+
+		urt_ = 0;
+	}
+
+	// Groups the instanced objects by compatible renderables, and uploads the instance data of all batches in one map.
+	// The first renderable of a batch draws it, with the instances the others would have drawn.
+	void SceneManager::BatchInstances()
+	{
+		for (auto so : inst_objs_)
+		{
+			Renderable* renderable = so->GetRenderable().get();
+			Renderable* batch = nullptr;
+			if ((renderable->NumInstances() > 0) && (renderable->NumInstances() < max_instances_per_batch_))
+			{
+				// Already drawing a batch, which can't be split
+				batch = renderable;
+			}
+			else
+			{
+				auto const range = inst_batch_map_.equal_range(renderable->InstanceBatchHash());
+				for (auto iter = range.first; iter != range.second; ++ iter)
+				{
+					Renderable* candidate = iter->second;
+					if ((candidate->NumInstances() < max_instances_per_batch_)
+						&& (candidate->GetInstance(0)->InstanceFormat() == so->InstanceFormat())
+						&& candidate->InstanceCompatible(*renderable))
+					{
+						batch = candidate;
+						break;
+					}
+				}
+				if (!batch)
+				{
+					if (renderable->NumInstances() > 0)
+					{
+						// Its own batch is full and drawn this round, so it waits for the next one
+						inst_overflow_objs_.push_back(so);
+						continue;
 					}
 
-					min_depths[j] = std::make_pair(md, static_cast<uint32_t>(j));
+					batch = renderable;
+					batch->AddToRenderQueue();
+					inst_batches_.push_back(batch);
+					inst_batch_map_.emplace(renderable->InstanceBatchHash(), batch);
 				}
+			}
 
-				std::sort(min_depths.begin(), min_depths.end());
+			batch->AddInstance(so);
+			++ num_objects_rendered_;
+		}
 
-				std::vector<Renderable*> sorted_items(min_depths.size());
-				for (size_t j = 0; j < min_depths.size(); ++ j)
+		std::vector<uint32_t> strides(inst_batches_.size());
+		uint32_t total_size = 0;
+		for (size_t i = 0; i < inst_batches_.size(); ++ i)
+		{
+			uint32_t stride = 0;
+			for (auto const & ve : inst_batches_[i]->GetInstance(0)->InstanceFormat())
+			{
+				stride += ve.element_size();
+			}
+			strides[i] = stride;
+			// Worst case of the alignment padding included
+			total_size += stride * (inst_batches_[i]->NumInstances() + 1);
+		}
+
+		if (!inst_buffer_ || (inst_buffer_->Size() < total_size))
+		{
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			inst_buffer_size_ = std::max(inst_buffer_size_, total_size);
+			inst_buffer_ = rf.MakeVertexBuffer(BU_Dynamic, EAH_CPU_Write | EAH_GPU_Read, inst_buffer_size_, nullptr);
+			inst_buffer_offset_ = inst_buffer_size_;
+		}
+
+		// Without no-overwrite maps, as in OpenGL, each flush orphans the buffer and writes from the beginning
+		RenderEngine const & re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		BufferAccess access = BA_Write_No_Overwrite;
+		if (!re.DeviceCaps().no_overwrite_support || (inst_buffer_offset_ + total_size > inst_buffer_->Size()))
+		{
+			access = BA_Write_Only;
+			inst_buffer_offset_ = 0;
+		}
+
+		{
+			GraphicsBuffer::Mapper mapper(*inst_buffer_, access);
+			for (size_t i = 0; i < inst_batches_.size(); ++ i)
+			{
+				Renderable* batch = inst_batches_[i];
+				uint32_t const stride = strides[i];
+				uint32_t const num = batch->NumInstances();
+
+				// Instance locations are in elements, so the offset has to be a multiple of the stride
+				uint32_t const start = (inst_buffer_offset_ + stride - 1) / stride;
+				uint8_t* dst = mapper.Pointer<uint8_t>() + start * stride;
+				for (uint32_t j = 0; j < num; ++ j)
+				{
+					uint8_t const * src = static_cast<uint8_t const *>(batch->GetInstance(j)->RenderInstanceData());
+					std::copy(src, src + stride, dst + j * stride);
+				}
+				inst_buffer_offset_ = (start + num) * stride;
+
+				batch->BindSharedInstanceStream(inst_buffer_, batch->GetInstance(0)->InstanceFormat(), start, num);
+			}
+		}
+
+		inst_objs_.resize(0);
+		inst_batch_map_.clear();
+	}
+
+	// Cuts the sorted queue into runs of recordable renderables with distinct effects. A run is recorded in parallel
+	// and replayed before the next one starts, so an effect shared by several renderables never has two draws pending.
+	void SceneManager::RecordRenderQueue()
+	{
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		if (!cmd_recorder_)
+		{
+			cmd_recorder_ = MakeUniquePtr<CommandRecorder>(Context::Instance().ThreadPool());
+		}
+
+		size_t const num_items = render_queue_.size();
+		size_t begin = 0;
+		while (begin < num_items)
+		{
+			record_effects_.clear();
+			size_t end = begin;
+			while ((end < num_items) && render_queue_[end].renderable->Recordable()
+				&& record_effects_.insert(render_queue_[end].renderable->GetRenderEffect().get()).second)
+			{
+				++ end;
+			}
+
+			if (end - begin < MIN_RECORD_RUN_ITEMS)
+			{
+				end = std::max(end, begin + 1);
+				for (size_t i = begin; i < end; ++ i)
+				{
+					render_queue_[i].renderable->Render();
+				}
+			}
+			else
+			{
+				for (size_t i = begin; i < end; ++ i)
 				{
-					sorted_items[j] = items.second[min_depths[j].second];
+					render_queue_[i].renderable->PrepareRecord();
 				}
-				items.second.swap(sorted_items);
+
+				RenderQueueItem const * items = &render_queue_[begin];
+				cmd_recorder_->Record(static_cast<uint32_t>(end - begin), num_hw_threads_, MIN_RECORD_ITEMS_PER_LIST,
+					[items](CommandList& cmd_list, uint32_t first, uint32_t last)
+					{
+						for (uint32_t i = first; i < last; ++ i)
+						{
+							items[i].renderable->Record(cmd_list);
+						}
+					});
+				cmd_recorder_->Execute(re);
 			}
 
-			for (auto const & item : items.second)
+			begin = end;
+		}
+	}
+
+	// Packs the keys and sorts the queue by technique weight, then by material or depth inside a technique.
+	// Opaque ones go front to back, alpha tested ones are grouped by material, and transparent ones keep their order.
+	void SceneManager::SortRenderQueue()
+	{
+		if (render_queue_.empty())
+		{
+			return;
+		}
+
+		// Usually only a handful of techniques, so a stable rank is computed in place
+		size_t const num_techs = render_techs_.size();
+		render_tech_ranks_.resize(num_techs);
+		for (size_t i = 0; i < num_techs; ++ i)
+		{
+			float const weight = render_techs_[i]->Weight();
+			uint32_t rank = 0;
+			for (size_t j = 0; j < num_techs; ++ j)
 			{
-				item->Render();
+				float const w = render_techs_[j]->Weight();
+				if ((w < weight) || ((w == weight) && (j < i)))
+				{
+					++ rank;
+				}
 			}
-			num_renderables_rendered_ += static_cast<uint32_t>(items.second.size());
+			render_tech_ranks_[i] = rank;
 		}
-		render_queue_.resize(0);
 
-		num_primitives_rendered_ += re.NumPrimitivesJustRendered();
-		num_vertices_rendered_ += re.NumVerticesJustRendered();
+		App3DFramework& app = Context::Instance().AppInstance();
+		float4 const view_mat_z = app.ActiveCamera().ViewMatrix().Col(2);
+		for (auto& item : render_queue_)
+		{
+			uint32_t const tech_index = static_cast<uint32_t>(item.key);
+			RenderTechnique const * tech = render_techs_[tech_index];
+			uint64_t key = static_cast<uint64_t>(render_tech_ranks_[tech_index]) << 48;
+			if (!tech->Transparent())
+			{
+				if (tech->HasDiscard())
+				{
+					uint64_t const mtl_hash = std::hash<RenderMaterial const *>()(item.renderable->GetMaterial().get());
+					key |= ((mtl_hash ^ (mtl_hash >> 16) ^ (mtl_hash >> 32)) & 0xFFFF) << 32;
+				}
+				else
+				{
+					key |= OrderedFloatBits(MinViewDepth(*item.renderable, view_mat_z));
+				}
+			}
+			item.key = key;
+		}
 
-		urt_ = 0;
+		RadixSortByKey(render_queue_, render_queue_scratch_);
 	}
 
 	// ȡȾ
@@ -735,14 +1347,276 @@ namespace KlayGE
 		return num_dispatch_calls_;
 	}
 
+	uint32_t SceneManager::NumBindsIssued() const
+	{
+		return num_binds_issued_;
+	}
+
+	uint32_t SceneManager::NumBindsSkipped() const
+	{
+		return num_binds_skipped_;
+	}
+
+	uint32_t SceneManager::NumCBufferBytesWritten() const
+	{
+		return num_cbuffer_bytes_written_;
+	}
+
+	uint32_t SceneManager::NumCBufferBytesUploaded() const
+	{
+		return num_cbuffer_bytes_uploaded_;
+	}
+
+	uint32_t SceneManager::NumObjectsOccluded() const
+	{
+		return num_objects_occluded_;
+	}
+
+	uint32_t SceneManager::NumVisibleMarksReused() const
+	{
+		return num_visible_marks_reused_;
+	}
+
+	uint32_t SceneManager::NumVisibleMarksTested() const
+	{
+		return num_visible_marks_tested_;
+	}
+
+	float SceneManager::MainThreadLockWaitTime() const
+	{
+		return main_thread_lock_wait_;
+	}
+
+	float SceneManager::SubThreadLockWaitTime() const
+	{
+		return sub_thread_lock_wait_;
+	}
+
+	float SceneManager::FrameLatency() const
+	{
+		return frame_latency_;
+	}
+
+	float SceneManager::FrameThroughput() const
+	{
+		return frame_throughput_;
+	}
+
+	SceneQuerySnapshotPtr SceneManager::QuerySnapshot() const
+	{
+		return std::atomic_load(&query_snapshot_);
+	}
+
+	SceneRayHit SceneManager::RayCast(float3 const & origin, float3 const & dir, float max_dist,
+		SceneQueryFilter const & filter) const
+	{
+		auto snapshot = this->QuerySnapshot();
+		if (snapshot)
+		{
+			return snapshot->RayCast(origin, dir, max_dist, filter);
+		}
+		else
+		{
+			return SceneRayHit{ SceneObjectPtr(), max_dist };
+		}
+	}
+
+	void SceneManager::RayCast(std::vector<SceneRay> const & rays, SceneQueryFilter const & filter,
+		std::vector<SceneRayHit>& hits) const
+	{
+		auto snapshot = this->QuerySnapshot();
+		if (snapshot)
+		{
+			snapshot->RayCast(rays, filter, hits);
+		}
+		else
+		{
+			hits.resize(rays.size());
+			for (size_t i = 0; i < rays.size(); ++ i)
+			{
+				hits[i].obj.reset();
+				hits[i].dist = rays[i].max_dist;
+			}
+		}
+	}
+
+	void SceneManager::QueryAABB(AABBox const & aabb, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		auto snapshot = this->QuerySnapshot();
+		if (snapshot)
+		{
+			snapshot->QueryAABB(aabb, filter, objs);
+		}
+	}
+
+	void SceneManager::QuerySphere(Sphere const & sphere, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		auto snapshot = this->QuerySnapshot();
+		if (snapshot)
+		{
+			snapshot->QuerySphere(sphere, filter, objs);
+		}
+	}
+
+	void SceneManager::QueryFrustum(Frustum const & frustum, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		auto snapshot = this->QuerySnapshot();
+		if (snapshot)
+		{
+			snapshot->QueryFrustum(frustum, filter, objs);
+		}
+	}
+
+	SceneQuerySnapshotPtr SceneManager::MakeQuerySnapshot()
+	{
+		return MakeSharedPtr<SceneQuerySnapshot>(scene_objs_);
+	}
+
+	// Takes a new snapshot only if objects were added, removed or moved since the last one
+	void SceneManager::UpdateQuerySnapshot()
+	{
+		bool dirty = !query_snapshot_ || (query_snapshot_scene_version_ != scene_version_)
+			|| (query_transform_versions_.size() != scene_objs_.size());
+		for (size_t i = 0; i < scene_objs_.size(); ++ i)
+		{
+			SceneObject* so = scene_objs_[i].get();
+			if (so->Attrib() & SceneObject::SOA_Moveable)
+			{
+				so->UpdateAbsModelMatrix();
+			}
+			if (!dirty && (so->TransformVersion() != query_transform_versions_[i]))
+			{
+				dirty = true;
+			}
+		}
+
+		if (dirty)
+		{
+			std::atomic_store(&query_snapshot_, this->MakeQuerySnapshot());
+
+			query_snapshot_scene_version_ = scene_version_;
+			query_transform_versions_.resize(scene_objs_.size());
+			for (size_t i = 0; i < scene_objs_.size(); ++ i)
+			{
+				query_transform_versions_[i] = scene_objs_[i]->TransformVersion();
+			}
+		}
+	}
+
+	void SceneManager::StoreVisibleMarks(VisibleMarks& vm, uint32_t frame, float4x4 const & view_proj)
+	{
+		vm.frame = frame;
+		vm.scene_version = scene_version_;
+		vm.view_proj = view_proj;
+		vm.marks.resize(scene_objs_.size());
+		vm.transform_versions.resize(scene_objs_.size());
+		for (size_t i = 0; i < scene_objs_.size(); ++ i)
+		{
+			vm.marks[i] = scene_objs_[i]->VisibleMark();
+			vm.transform_versions[i] = scene_objs_[i]->TransformVersion();
+		}
+	}
+
+	// Brings the marks of an earlier frame up to date by testing only the objects moved since then.
+	// Returns false if the camera or the scene changed too much, and a full clip is needed.
+	bool SceneManager::UpdateVisibleMarks(VisibleMarks& vm, Camera const & camera, float4x4 const & view_proj, bool occlusion)
+	{
+		if ((vm.scene_version != scene_version_) || (vm.marks.size() != scene_objs_.size()))
+		{
+			return false;
+		}
+		for (size_t i = 0; i < float4x4::elem_num; ++ i)
+		{
+			if (MathLib::abs(view_proj[i] - vm.view_proj[i]) > visibility_cache_threshold_)
+			{
+				return false;
+			}
+		}
+
+		// Refreshing the transforms bumps the versions of the objects really moved
+		for (size_t i = 0; i < scene_objs_.size(); ++ i)
+		{
+			SceneObject* so = scene_objs_[i].get();
+			if (so->Attrib() & SceneObject::SOA_Moveable)
+			{
+				so->UpdateAbsModelMatrix();
+			}
+
+			// A moved, hidden or shown occluder makes every occlusion result stale
+			if (occlusion && so->Occluder() && (so->TransformVersion() != vm.transform_versions[i]))
+			{
+				return false;
+			}
+		}
+
+		// Parents are always in front of their children, so a child is tested after its parent's mark is updated
+		std::vector<uint32_t> retested;
+		for (size_t i = 0; i < scene_objs_.size(); ++ i)
+		{
+			SceneObject* so = scene_objs_[i].get();
+			if (so->Parent() || (so->TransformVersion() != vm.transform_versions[i]))
+			{
+				vm.marks[i] = this->ObjectVisible(so, camera, view_proj);
+				vm.transform_versions[i] = so->TransformVersion();
+				++ num_visible_marks_tested_;
+
+				if (occlusion && (vm.marks[i] != BO_No) && !so->Occluder() && (so->Attrib() & SceneObject::SOA_Cullable))
+				{
+					retested.push_back(static_cast<uint32_t>(i));
+				}
+			}
+			else
+			{
+				++ num_visible_marks_reused_;
+			}
+			so->VisibleMark(vm.marks[i]);
+		}
+
+		// The occluders haven't changed, but the objects moved behind or out of them have to be tested again
+		if (!retested.empty() && this->RasterizeOccluders(view_proj))
+		{
+			for (auto i : retested)
+			{
+				SceneObject* so = scene_objs_[i].get();
+				if (occlusion_culler_->Occluded(so->PosBoundWS()))
+				{
+					vm.marks[i] = BO_No;
+					so->VisibleMark(BO_No);
+					++ num_objects_occluded_;
+				}
+			}
+		}
+
+		return true;
+	}
+
 	void SceneManager::FlushScene()
 	{
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
-		visible_marks_map_.clear();
+		num_objects_occluded_ = 0;
+		num_visible_marks_reused_ = 0;
+		num_visible_marks_tested_ = 0;
 
 		uint32_t urt;
 		App3DFramework& app = Context::Instance().AppInstance();
+
+		// Drops the marks not used recently. The rest are overwritten in place when they are hit again.
+		uint32_t const last_frame = app.TotalNumFrames();
+		for (auto iter = visible_marks_map_.begin(); iter != visible_marks_map_.end();)
+		{
+			if (iter->second.frame + 1 < last_frame)
+			{
+				iter = visible_marks_map_.erase(iter);
+			}
+			else
+			{
+				++ iter;
+			}
+		}
 		for (uint32_t pass = 0;; ++ pass)
 		{
 			re.BeginPass();
@@ -775,34 +1649,133 @@ namespace KlayGE
 
 		num_draw_calls_ = re.NumDrawsJustCalled();
 		num_dispatch_calls_ = re.NumDispatchesJustCalled();
+		num_binds_issued_ = re.NumBindsJustIssued();
+		num_binds_skipped_ = re.NumBindsJustSkipped();
+		num_cbuffer_bytes_written_ = re.NumCBufferBytesJustWritten();
+		num_cbuffer_bytes_uploaded_ = re.NumCBufferBytesJustUploaded();
+	}
+
+	// The sync point with the update thread. It's skipped while a tick is running, so the main thread never waits for
+	// one, and the results of that tick are published in the next frame.
+	void SceneManager::SyncSubThreadState()
+	{
+		std::unique_lock<std::mutex> lock(sub_thread_mutex_, std::try_to_lock);
+		if (lock.owns_lock())
+		{
+			if (!sub_thread_synced_)
+			{
+				published_sim_time_ = sub_thread_tick_time_;
+			}
+
+			sub_thread_objs_.clear();
+			sub_thread_serial_objs_.clear();
+			for (auto const * objs : { &scene_objs_, &overlay_scene_objs_ })
+			{
+				for (auto const & scene_obj : *objs)
+				{
+					scene_obj->SyncSubThreadState();
+					if (scene_obj->Attrib() & SceneObject::SOA_SerialUpdate)
+					{
+						sub_thread_serial_objs_.push_back(scene_obj);
+					}
+					else
+					{
+						sub_thread_objs_.push_back(scene_obj);
+					}
+				}
+			}
+
+			sub_thread_synced_ = true;
+		}
+	}
+
+	void SceneManager::SubThreadUpdateObjects(float app_time, float elapsed_time)
+	{
+		uint32_t const num_objs = static_cast<uint32_t>(sub_thread_objs_.size());
+		uint32_t const num_tasks = std::max(std::min(num_hw_threads_,
+			num_objs / MIN_SUB_THREAD_UPDATE_OBJECTS), 1U);
+		uint32_t const objs_per_task = (num_objs + num_tasks - 1) / num_tasks;
+
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_tasks - 1);
+		thread_pool& tp = Context::Instance().ThreadPool();
+		for (uint32_t i = 1; i < num_tasks; ++ i)
+		{
+			uint32_t const begin = i * objs_per_task;
+			uint32_t const end = std::min(begin + objs_per_task, num_objs);
+			if (begin < end)
+			{
+				joiners.push_back(tp(std::bind(&SceneManager::SubThreadUpdateRange, this, begin, end, app_time, elapsed_time)));
+			}
+		}
+		this->SubThreadUpdateRange(0, std::min(objs_per_task, num_objs), app_time, elapsed_time);
+
+		SceneObject::SubThreadUpdating(true);
+		for (auto const & scene_obj : sub_thread_serial_objs_)
+		{
+			scene_obj->SubThreadUpdate(app_time, elapsed_time);
+		}
+		SceneObject::SubThreadUpdating(false);
+
+		for (auto& j : joiners)
+		{
+			j();
+		}
+	}
+
+	void SceneManager::SubThreadUpdateRange(uint32_t begin, uint32_t end, float app_time, float elapsed_time)
+	{
+		// Scratch data of SubThreadUpdate doesn't outlive the call
+		FrameArena::ThreadInstance().Reset();
+
+		SceneObject::SubThreadUpdating(true);
+		for (uint32_t i = begin; i < end; ++ i)
+		{
+			sub_thread_objs_[i]->SubThreadUpdate(app_time, elapsed_time);
+		}
+		SceneObject::SubThreadUpdating(false);
 	}
 
 	void SceneManager::UpdateThreadFunc()
 	{
 		Timer timer;
 		float app_time = 0;
+		float elapsed_time = 0;
 		while (!quit_)
 		{
 			float const frame_time = static_cast<float>(timer.elapsed());
 			timer.restart();
 			app_time += frame_time;
+			elapsed_time += frame_time;
 
 			if (Context::Instance().AppValid())
 			{
 				WindowPtr const & win = Context::Instance().AppInstance().MainWnd();
 				if (win && win->Active())
 				{
-					std::lock_guard<std::mutex> lock(update_mutex_);
-
-					for (auto const & scene_obj : scene_objs_)
-					{
-						scene_obj->SubThreadUpdate(app_time, frame_time);
-					}
-					for (auto const & scene_obj : overlay_scene_objs_)
+					// A new tick waits until the last one is published. Otherwise the main thread could keep missing
+					// the sync point when ticks are longer than update_elapse_.
+					if (sub_thread_synced_ && !pipelined_frame_)
 					{
-						scene_obj->SubThreadUpdate(app_time, frame_time);
+						// Each tick is a frame of this thread
+						FrameArena::ThreadInstance().Reset();
+
+						// SubThreadUpdate only writes the update side, so the tick overlaps Flush. The main thread takes
+						// this mutex only to swap the sides.
+						Timer lock_timer;
+						std::lock_guard<std::mutex> lock(sub_thread_mutex_);
+						sub_thread_lock_wait_ = static_cast<float>(lock_timer.elapsed());
+						sub_thread_tick_time_ = frame_timer_.current_time();
+
+						this->SubThreadUpdateObjects(app_time, elapsed_time);
+						elapsed_time = 0;
+						sub_thread_synced_ = false;
 					}
 				}
+				else
+				{
+					elapsed_time = 0;
+				}
 
 				if (frame_time < update_elapse_)
 				{
@@ -22,14 +22,25 @@
 
 #include <boost/assert.hpp>
 
+#include <atomic>
+
 #include <KlayGE/SceneObject.hpp>
 
+namespace
+{
+	thread_local bool sub_thread_updating = false;
+
+	// Orders the model matrix writes of both sides
+	std::atomic<uint64_t> model_write_seq(0);
+}
+
 namespace KlayGE
 {
 	SceneObject::SceneObject(uint32_t attrib)
 		: attrib_(attrib), parent_(nullptr), renderable_hw_res_ready_(false),
-			model_(float4x4::Identity()), abs_model_(float4x4::Identity()),
-			visible_mark_(BO_No)
+			model_(float4x4::Identity()), render_model_(float4x4::Identity()), model_seq_(0), render_model_seq_(0),
+			abs_model_(float4x4::Identity()),
+			transform_version_(0), visible_mark_(BO_No), view_mask_(0)
 	{
 		if (!(attrib & SOA_Overlay) && (attrib & (SOA_Cullable | SOA_Moveable)))
 		{
@@ -69,12 +80,23 @@ namespace KlayGE
 
 	void SceneObject::ModelMatrix(float4x4 const & mat)
 	{
-		model_ = mat;
+		uint64_t const seq = ++ model_write_seq;
+		if (sub_thread_updating)
+		{
+			model_ = mat;
+			model_seq_ = seq;
+		}
+		else
+		{
+			// A running tick could be reading the update side
+			render_model_ = mat;
+			render_model_seq_ = seq;
+		}
 	}
 
 	float4x4 const & SceneObject::ModelMatrix() const
 	{
-		return model_;
+		return sub_thread_updating ? model_ : render_model_;
 	}
 
 	float4x4 const & SceneObject::AbsModelMatrix() const
@@ -89,24 +111,38 @@ namespace KlayGE
 
 	void SceneObject::UpdateAbsModelMatrix()
 	{
+		float4x4 const old_abs_model = abs_model_;
 		if (parent_)
 		{
-			abs_model_ = parent_->ModelMatrix() * model_;
+			abs_model_ = parent_->ModelMatrix() * render_model_;
 		}
 		else
 		{
-			abs_model_ = model_;
+			abs_model_ = render_model_;
 		}
+		bool moved = !(abs_model_ == old_abs_model);
 
 		if (renderable_)
 		{
 			if (pos_aabb_ws_)
 			{
-				*pos_aabb_ws_ = MathLib::transform_aabb(renderable_->PosBound(), abs_model_);
+				AABBox const aabb_ws = MathLib::transform_aabb(renderable_->PosBound(), abs_model_);
+				moved |= !(aabb_ws == *pos_aabb_ws_);
+				*pos_aabb_ws_ = aabb_ws;
 			}
 
 			renderable_->ModelMatrix(abs_model_);
 		}
+
+		if (moved)
+		{
+			++ transform_version_;
+		}
+	}
+
+	uint32_t SceneObject::TransformVersion() const
+	{
+		return transform_version_;
 	}
 
 	void SceneObject::VisibleMark(BoundOverlap vm)
@@ -119,6 +155,26 @@ namespace KlayGE
 		return visible_mark_;
 	}
 
+	void SceneObject::ViewMask(uint32_t mask)
+	{
+		view_mask_ = mask;
+	}
+
+	uint32_t SceneObject::ViewMask() const
+	{
+		return view_mask_;
+	}
+
+	void SceneObject::Occluder(OccluderMeshPtr const & mesh)
+	{
+		occluder_ = mesh;
+	}
+
+	OccluderMeshPtr const & SceneObject::Occluder() const
+	{
+		return occluder_;
+	}
+
 	void SceneObject::BindSubThreadUpdateFunc(std::function<void(SceneObject&, float, float)> const & update_func)
 	{
 		sub_thread_update_func_ = update_func;
@@ -137,6 +193,43 @@ namespace KlayGE
 		}
 	}
 
+	void SceneObject::SyncSubThreadState()
+	{
+		// When both sides were written since the last sync, the later write wins
+		if (render_model_seq_ > model_seq_)
+		{
+			model_ = render_model_;
+			model_seq_ = render_model_seq_;
+		}
+		else
+		{
+			render_model_ = model_;
+			render_model_seq_ = model_seq_;
+		}
+
+		void const * data = this->InstanceData();
+		if (data)
+		{
+			uint32_t size = 0;
+			for (auto const & ve : instance_format_)
+			{
+				size += ve.element_size();
+			}
+			uint8_t const * src = static_cast<uint8_t const *>(data);
+			render_instance_data_.assign(src, src + size);
+		}
+	}
+
+	void SceneObject::SubThreadUpdating(bool updating)
+	{
+		sub_thread_updating = updating;
+	}
+
+	bool SceneObject::SubThreadUpdating()
+	{
+		return sub_thread_updating;
+	}
+
 	bool SceneObject::MainThreadUpdate(float app_time, float elapsed_time)
 	{
 		bool refreshed = false;
@@ -204,6 +297,7 @@ namespace KlayGE
 
 	void SceneObject::Visible(bool vis)
 	{
+		uint32_t const old_attrib = attrib_;
 		if (vis)
 		{
 			attrib_ &= ~SOA_Invisible;
@@ -213,6 +307,12 @@ namespace KlayGE
 			attrib_ |= SOA_Invisible;
 		}
 
+		// So the visible marks cached with an unchanged camera test it again
+		if (attrib_ != old_attrib)
+		{
+			++ transform_version_;
+		}
+
 		for (auto const & child : children_)
 		{
 			child->Visible(vis);
@@ -229,6 +329,11 @@ namespace KlayGE
 		return nullptr;
 	}
 
+	void const * SceneObject::RenderInstanceData() const
+	{
+		return render_instance_data_.empty() ? this->InstanceData() : &render_instance_data_[0];
+	}
+
 	void SceneObject::SelectMode(bool select_mode)
 	{
 		if (renderable_)
@@ -0,0 +1,213 @@
+/**
+ * @file SceneQuery.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/SceneObject.hpp>
+
+#include <algorithm>
+
+#include <KlayGE/SceneQuery.hpp>
+
+namespace KlayGE
+{
+	SceneQuerySnapshot::SceneQuerySnapshot(std::vector<SceneObjectPtr> const & scene_objs)
+	{
+		entries_.reserve(scene_objs.size());
+		for (auto const & obj : scene_objs)
+		{
+			// Only these objects have a world space bound
+			uint32_t const attr = obj->Attrib();
+			if ((attr & (SceneObject::SOA_Cullable | SceneObject::SOA_Moveable)) && !(attr & SceneObject::SOA_Overlay)
+				&& obj->GetRenderable())
+			{
+				entries_.push_back({ obj, obj->PosBoundWS() });
+			}
+		}
+	}
+
+	SceneQuerySnapshot::~SceneQuerySnapshot()
+	{
+	}
+
+	SceneRayHit SceneQuerySnapshot::RayCast(float3 const & origin, float3 const & dir, float max_dist,
+		SceneQueryFilter const & filter) const
+	{
+		SceneRay const ray = { origin, MathLib::normalize(dir), max_dist };
+		SceneRayHit hit = { SceneObjectPtr(), max_dist };
+		this->DoRayCast(&ray, 1, filter, &hit);
+		return hit;
+	}
+
+	void SceneQuerySnapshot::RayCast(std::vector<SceneRay> const & rays, SceneQueryFilter const & filter,
+		std::vector<SceneRayHit>& hits) const
+	{
+		hits.resize(rays.size());
+		for (size_t i = 0; i < rays.size(); ++ i)
+		{
+			hits[i].obj.reset();
+			hits[i].dist = rays[i].max_dist;
+		}
+		if (!rays.empty())
+		{
+			this->DoRayCast(&rays[0], static_cast<uint32_t>(rays.size()), filter, &hits[0]);
+		}
+	}
+
+	void SceneQuerySnapshot::QueryAABB(AABBox const & aabb, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		this->DoQuery([&aabb](AABBox const & bb)
+			{
+				if (!MathLib::intersect_aabb_aabb(aabb, bb))
+				{
+					return BO_No;
+				}
+				return (aabb.VecInBound(bb.Min()) && aabb.VecInBound(bb.Max())) ? BO_Yes : BO_Partial;
+			},
+			filter, objs);
+	}
+
+	void SceneQuerySnapshot::QuerySphere(Sphere const & sphere, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		this->DoQuery([&sphere](AABBox const & bb)
+			{
+				if (!MathLib::intersect_aabb_sphere(bb, sphere))
+				{
+					return BO_No;
+				}
+				for (size_t i = 0; i < 8; ++ i)
+				{
+					if (!sphere.VecInBound(bb.Corner(i)))
+					{
+						return BO_Partial;
+					}
+				}
+				return BO_Yes;
+			},
+			filter, objs);
+	}
+
+	void SceneQuerySnapshot::QueryFrustum(Frustum const & frustum, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		this->DoQuery([&frustum](AABBox const & bb)
+			{
+				return frustum.Intersect(bb);
+			},
+			filter, objs);
+	}
+
+	void SceneQuerySnapshot::DoRayCast(SceneRay const * rays, uint32_t num_rays, SceneQueryFilter const & filter,
+		SceneRayHit* hits) const
+	{
+		std::vector<uint32_t> ray_indices(num_rays);
+		for (uint32_t i = 0; i < num_rays; ++ i)
+		{
+			ray_indices[i] = i;
+		}
+		for (auto const & entry : entries_)
+		{
+			this->RayCastEntry(entry, rays, &ray_indices[0], num_rays, filter, hits);
+		}
+	}
+
+	void SceneQuerySnapshot::DoQuery(BoundTest const & test, SceneQueryFilter const & filter,
+		std::vector<SceneObjectPtr>& objs) const
+	{
+		for (auto const & entry : entries_)
+		{
+			if ((test(entry.aabb) != BO_No) && (!filter || filter(*entry.obj)))
+			{
+				objs.push_back(entry.obj);
+			}
+		}
+	}
+
+	void SceneQuerySnapshot::RayCastEntry(Entry const & entry, SceneRay const * rays, uint32_t const * ray_indices,
+		uint32_t num_indices, SceneQueryFilter const & filter, SceneRayHit* hits) const
+	{
+		// The filter is only called once an object is hit, and at most once per object
+		int accepted = -1;
+		for (uint32_t i = 0; i < num_indices; ++ i)
+		{
+			uint32_t const ri = ray_indices[i];
+			float const dist = RayAABBDistance(rays[ri], entry.aabb);
+			if ((dist >= 0) && (dist < hits[ri].dist))
+			{
+				if (accepted < 0)
+				{
+					accepted = (!filter || filter(*entry.obj)) ? 1 : 0;
+				}
+				if (!accepted)
+				{
+					return;
+				}
+
+				hits[ri].obj = entry.obj;
+				hits[ri].dist = dist;
+			}
+		}
+	}
+
+	float SceneQuerySnapshot::RayAABBDistance(SceneRay const & ray, AABBox const & aabb)
+	{
+		float t_min = 0;
+		float t_max = ray.max_dist;
+		for (int i = 0; i < 3; ++ i)
+		{
+			if (MathLib::abs(ray.dir[i]) < 1e-12f)
+			{
+				if ((ray.origin[i] < aabb.Min()[i]) || (ray.origin[i] > aabb.Max()[i]))
+				{
+					return -1;
+				}
+			}
+			else
+			{
+				float const inv_dir = 1 / ray.dir[i];
+				float t0 = (aabb.Min()[i] - ray.origin[i]) * inv_dir;
+				float t1 = (aabb.Max()[i] - ray.origin[i]) * inv_dir;
+				if (t0 > t1)
+				{
+					std::swap(t0, t1);
+				}
+				t_min = std::max(t_min, t0);
+				t_max = std::min(t_max, t1);
+				if (t_min > t_max)
+				{
+					return -1;
+				}
+			}
+		}
+		return t_min;
+	}
+}
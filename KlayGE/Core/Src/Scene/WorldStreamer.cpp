@@ -0,0 +1,348 @@
+/**
+ * @file WorldStreamer.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/ResLoader.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/Texture.hpp>
+#include <KlayGE/SceneObjectHelper.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <KlayGE/WorldStreamer.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint64_t CellKey(int32_t x, int32_t z)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+	}
+
+	// Distance from a point to a square on the xz plane, 0 inside
+	float DistanceToCell(float2 const & pt, float2 const & center, float half_size)
+	{
+		float const dx = std::max(MathLib::abs(pt.x() - center.x()) - half_size, 0.0f);
+		float const dz = std::max(MathLib::abs(pt.y() - center.y()) - half_size, 0.0f);
+		return MathLib::sqrt(dx * dx + dz * dz);
+	}
+}
+
+namespace KlayGE
+{
+	WorldStreamer::WorldStreamer(float cell_size, float load_radius, float unload_radius, uint64_t memory_budget)
+		: cell_size_(cell_size), load_radius_(load_radius), unload_radius_(std::max(unload_radius, load_radius)),
+			memory_budget_(memory_budget), lookahead_(1), max_loading_cells_(4),
+			memory_usage_(0)
+	{
+		BOOST_ASSERT(cell_size > 0);
+	}
+
+	WorldStreamer::~WorldStreamer()
+	{
+	}
+
+	void WorldStreamer::AddObject(std::string const & meshml, float4x4 const & model, uint32_t attrib)
+	{
+		Cell& cell = this->CellAt(float3(model(3, 0), model(3, 1), model(3, 2)));
+		BOOST_ASSERT(CS_Unloaded == cell.state);
+
+		CellObject obj;
+		obj.meshml = meshml;
+		obj.model = model;
+		obj.attrib = attrib;
+		cell.objects.push_back(obj);
+
+		if (std::find(cell.models.begin(), cell.models.end(), meshml) == cell.models.end())
+		{
+			cell.models.push_back(meshml);
+			cell.memory_size += this->ResourceSize(meshml);
+		}
+	}
+
+	void WorldStreamer::AddTexture(float3 const & pos, std::string const & tex_name)
+	{
+		Cell& cell = this->CellAt(pos);
+		BOOST_ASSERT(CS_Unloaded == cell.state);
+
+		if (std::find(cell.textures.begin(), cell.textures.end(), tex_name) == cell.textures.end())
+		{
+			cell.textures.push_back(tex_name);
+			cell.memory_size += this->ResourceSize(tex_name);
+		}
+	}
+
+	void WorldStreamer::Update(float3 const & eye_pos, float3 const & velocity)
+	{
+		float3 const predicted_pos = eye_pos + velocity * lookahead_;
+		float2 const eye_xz(eye_pos.x(), eye_pos.z());
+		float2 const predicted_xz(predicted_pos.x(), predicted_pos.z());
+		float const half_size = cell_size_ / 2;
+
+		uint32_t num_loading = 0;
+		sorted_cells_.clear();
+		for (uint32_t i = 0; i < cells_.size(); ++ i)
+		{
+			Cell& cell = cells_[i];
+			cell.distance = std::min(DistanceToCell(eye_xz, cell.center, half_size),
+				DistanceToCell(predicted_xz, cell.center, half_size));
+
+			if ((cell.state != CS_Unloaded) && (cell.distance > unload_radius_))
+			{
+				this->Unload(cell);
+			}
+
+			switch (cell.state)
+			{
+			case CS_Unloaded:
+				if (cell.distance <= load_radius_)
+				{
+					sorted_cells_.push_back(i);
+				}
+				break;
+
+			case CS_Loading:
+				if (this->CellReady(cell))
+				{
+					this->ActivateCell(cell);
+					cell.state = CS_Loaded;
+				}
+				else
+				{
+					++ num_loading;
+				}
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		std::sort(sorted_cells_.begin(), sorted_cells_.end(),
+			[this](uint32_t lhs, uint32_t rhs)
+			{
+				return cells_[lhs].distance < cells_[rhs].distance;
+			});
+
+		std::vector<uint32_t> victims;
+		for (auto index : sorted_cells_)
+		{
+			if (num_loading >= max_loading_cells_)
+			{
+				break;
+			}
+
+			Cell& cell = cells_[index];
+			if (memory_usage_ + cell.memory_size > memory_budget_)
+			{
+				// Make room from the resident cells farther than this one, farthest first
+				victims.clear();
+				for (uint32_t i = 0; i < cells_.size(); ++ i)
+				{
+					if ((cells_[i].state != CS_Unloaded) && (cells_[i].distance > cell.distance))
+					{
+						victims.push_back(i);
+					}
+				}
+				std::sort(victims.begin(), victims.end(),
+					[this](uint32_t lhs, uint32_t rhs)
+					{
+						return cells_[lhs].distance > cells_[rhs].distance;
+					});
+
+				uint64_t freeable = 0;
+				for (auto victim : victims)
+				{
+					freeable += cells_[victim].memory_size;
+				}
+				if (memory_usage_ - freeable + cell.memory_size > memory_budget_)
+				{
+					continue;
+				}
+
+				for (auto victim : victims)
+				{
+					if (memory_usage_ + cell.memory_size <= memory_budget_)
+					{
+						break;
+					}
+					if (CS_Loading == cells_[victim].state)
+					{
+						-- num_loading;
+					}
+					this->Unload(cells_[victim]);
+				}
+			}
+
+			this->LoadCell(cell);
+			cell.state = CS_Loading;
+			memory_usage_ += cell.memory_size;
+			++ num_loading;
+		}
+	}
+
+	void WorldStreamer::UnloadAll()
+	{
+		for (auto& cell : cells_)
+		{
+			if (cell.state != CS_Unloaded)
+			{
+				this->Unload(cell);
+			}
+		}
+	}
+
+	uint32_t WorldStreamer::NumCells(CellState state) const
+	{
+		uint32_t num = 0;
+		for (auto const & cell : cells_)
+		{
+			if (cell.state == state)
+			{
+				++ num;
+			}
+		}
+		return num;
+	}
+
+	uint64_t WorldStreamer::EstimateMemorySize(std::string const & res_name)
+	{
+		ResIdentifierPtr res = ResLoader::Instance().Open(res_name);
+		if (res)
+		{
+			res->seekg(0, std::ios_base::end);
+			return static_cast<uint64_t>(res->tellg());
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
+	void WorldStreamer::LoadCell(Cell& cell)
+	{
+		for (auto const & name : cell.models)
+		{
+			cell.loaded_models.push_back(ASyncLoadModel(name, EAH_GPU_Read | EAH_Immutable));
+		}
+		for (auto const & name : cell.textures)
+		{
+			cell.loaded_textures.push_back(ASyncLoadTexture(name, EAH_GPU_Read | EAH_Immutable));
+		}
+	}
+
+	bool WorldStreamer::CellReady(Cell const & cell)
+	{
+		for (auto const & model : cell.loaded_models)
+		{
+			if (!model->HWResourceReady())
+			{
+				return false;
+			}
+		}
+		for (auto const & tex : cell.loaded_textures)
+		{
+			if (!tex->HWResourceReady())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void WorldStreamer::ActivateCell(Cell& cell)
+	{
+		for (auto const & obj : cell.objects)
+		{
+			size_t const model_index = std::find(cell.models.begin(), cell.models.end(), obj.meshml) - cell.models.begin();
+			SceneObjectPtr scene_obj = MakeSharedPtr<SceneObjectHelper>(cell.loaded_models[model_index], obj.attrib);
+			scene_obj->ModelMatrix(obj.model);
+			scene_obj->AddToSceneManager();
+			cell.scene_objs.push_back(scene_obj);
+		}
+	}
+
+	// Dropping the last references lets ResLoader release the resources
+	void WorldStreamer::UnloadCell(Cell& cell)
+	{
+		for (auto const & scene_obj : cell.scene_objs)
+		{
+			scene_obj->DelFromSceneManager();
+		}
+		cell.scene_objs.clear();
+		cell.loaded_models.clear();
+		cell.loaded_textures.clear();
+	}
+
+	WorldStreamer::Cell& WorldStreamer::CellAt(float3 const & pos)
+	{
+		int32_t const x = static_cast<int32_t>(std::floor(pos.x() / cell_size_));
+		int32_t const z = static_cast<int32_t>(std::floor(pos.z() / cell_size_));
+		uint64_t const key = CellKey(x, z);
+
+		auto iter = cell_map_.find(key);
+		if (iter == cell_map_.end())
+		{
+			Cell cell;
+			cell.coord = int2(x, z);
+			cell.center = float2((x + 0.5f) * cell_size_, (z + 0.5f) * cell_size_);
+			cell.memory_size = 0;
+			cell.state = CS_Unloaded;
+			cell.distance = 0;
+
+			iter = cell_map_.emplace(key, static_cast<uint32_t>(cells_.size())).first;
+			cells_.push_back(cell);
+		}
+		return cells_[iter->second];
+	}
+
+	uint64_t WorldStreamer::ResourceSize(std::string const & res_name)
+	{
+		auto iter = res_sizes_.find(res_name);
+		if (iter == res_sizes_.end())
+		{
+			iter = res_sizes_.emplace(res_name, this->EstimateMemorySize(res_name)).first;
+		}
+		return iter->second;
+	}
+
+	void WorldStreamer::Unload(Cell& cell)
+	{
+		BOOST_ASSERT(memory_usage_ >= cell.memory_size);
+
+		this->UnloadCell(cell);
+		cell.state = CS_Unloaded;
+		memory_usage_ -= cell.memory_size;
+	}
+}
@@ -106,8 +106,10 @@ namespace KlayGE
 
 			uint32_t const INDEX_PER_QUAD = restart_ ? 5 : 6;
 			uint32_t const INIT_NUM_QUAD = 1024;
-			tb_vb_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * 4 * sizeof(UIManager::VertexFormat)), TransientBuffer::BF_Vertex);
-			tb_ib_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * INDEX_PER_QUAD * sizeof(uint16_t)), TransientBuffer::BF_Index);
+			tb_vb_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * 4 * sizeof(UIManager::VertexFormat)), TransientBuffer::BF_Vertex,
+				TransientBuffer::AM_Ring, static_cast<uint32_t>(sizeof(UIManager::VertexFormat)));
+			tb_ib_ = MakeUniquePtr<TransientBuffer>(static_cast<uint32_t>(INIT_NUM_QUAD * INDEX_PER_QUAD * sizeof(uint16_t)), TransientBuffer::BF_Index,
+				TransientBuffer::AM_Ring, static_cast<uint32_t>(sizeof(uint16_t)));
 
 			rl_->BindVertexStream(tb_vb_->GetBuffer(), std::make_tuple(vertex_element(VEU_Position, 0, EF_BGR32F),
 												vertex_element(VEU_Diffuse, 0, EF_ABGR32F),
@@ -191,20 +193,15 @@ namespace KlayGE
 				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rl_);
 			}
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
-
+			// The rings reclaim the sub allocs by themselves when the frame retires
 			this->OnRenderEnd();
 		}
 
 		void AddQuad(std::vector<UIManager::VertexFormat> const & vertices)
 		{
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
+			SubAlloc const vb_alloc = tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]);
 			
-			uint16_t const last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(UIManager::VertexFormat));
+			uint16_t const last_index = static_cast<uint16_t>(vb_alloc.offset_ / sizeof(UIManager::VertexFormat));
 			std::vector<uint16_t> indices;
 			indices.resize(restart_ ? 5 : 6);
 			indices[0] = last_index + 0;
@@ -224,7 +221,14 @@ namespace KlayGE
 			}
 			BOOST_ASSERT(last_index + 3 <= 0xFFFF);
 
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+			SubAlloc const ib_alloc = tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]);
+
+			// Only a frame overrunning the ring and its reserve drops quads. The ring grows before the next one.
+			if ((vb_alloc.length_ > 0) && (ib_alloc.length_ > 0))
+			{
+				tb_vb_sub_allocs_.push_back(vb_alloc);
+				tb_ib_sub_allocs_.push_back(ib_alloc);
+			}
 		}
 
 	private:
@@ -152,6 +152,7 @@ namespace KlayGE
 		virtual void DoBindFrameBuffer(FrameBufferPtr const & fb) override;
 		virtual void DoBindSOBuffers(RenderLayoutPtr const & rl) override;
 		virtual void DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl) override;
+		virtual void DoPrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl) override;
 		virtual void DoDispatch(RenderEffect const & effect, RenderTechnique const & tech,
 			uint32_t tgx, uint32_t tgy, uint32_t tgz) override;
 		virtual void DoDispatchIndirect(RenderEffect const & effect, RenderTechnique const & tech,
@@ -220,12 +221,6 @@ namespace KlayGE
 		ID3D11BlendState* blend_state_cache_;
 		Color blend_factor_cache_;
 		uint32_t sample_mask_cache_;
-		ID3D11VertexShader* vertex_shader_cache_;
-		ID3D11PixelShader* pixel_shader_cache_;
-		ID3D11GeometryShader* geometry_shader_cache_;
-		ID3D11ComputeShader* compute_shader_cache_;
-		ID3D11HullShader* hull_shader_cache_;
-		ID3D11DomainShader* domain_shader_cache_;
 		RenderLayout::topology_type topology_type_cache_;
 		ID3D11InputLayout* input_layout_cache_;
 		D3D11_VIEWPORT viewport_cache_;
@@ -233,7 +228,6 @@ namespace KlayGE
 		std::vector<ID3D11Buffer*> vb_cache_;
 		std::vector<UINT> vb_stride_cache_;
 		std::vector<UINT> vb_offset_cache_;
-		ID3D11Buffer* ib_cache_;
 
 		std::array<std::vector<std::tuple<void*, uint32_t, uint32_t>>, ShaderObject::ST_NumShaderTypes> shader_srvsrc_cache_;
 		std::array<std::vector<ID3D11ShaderResourceView*>, ShaderObject::ST_NumShaderTypes> shader_srv_ptr_cache_;
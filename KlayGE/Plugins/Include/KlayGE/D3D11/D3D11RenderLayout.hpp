@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <vector>
 
 #include <KlayGE/RenderLayout.hpp>
@@ -29,6 +30,8 @@ namespace KlayGE
 
 		void Active() const;
 		ID3D11InputLayout* InputLayout(ShaderObject const * so) const;
+		// Active and InputLayout from a recording thread
+		void Prepare(ShaderObject const * so) const;
 
 		std::vector<ID3D11Buffer*> const & VBs() const
 		{
@@ -50,6 +53,9 @@ namespace KlayGE
 		mutable std::vector<ID3D11Buffer*> vbs_;
 		mutable std::vector<UINT> strides_;
 		mutable std::vector<UINT> offsets_;
+
+		// A layout can be drawn by renderables recorded on different threads
+		mutable std::mutex prepare_mutex_;
 	};
 }
 
@@ -156,6 +156,7 @@ namespace KlayGE
 		std::array<std::vector<ID3D11UnorderedAccessView*>, ST_NumShaderTypes> uavs_;
 		std::array<std::shared_ptr<std::vector<uint8_t>>, ST_NumShaderTypes> cbuff_indices_;
 		std::array<std::vector<ID3D11Buffer*>, ST_NumShaderTypes> d3d11_cbuffs_;
+		std::array<std::vector<RenderEffectConstantBuffer*>, ST_NumShaderTypes> stage_cbuffs_;
 
 		std::vector<RenderEffectConstantBuffer*> all_cbuffs_;
 
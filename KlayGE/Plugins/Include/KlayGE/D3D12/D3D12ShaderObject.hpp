@@ -221,6 +221,7 @@ namespace KlayGE
 		std::array<std::vector<D3D12UnorderedAccessViewSimulation*>, ST_NumShaderTypes> uavs_;
 		std::array<std::shared_ptr<std::vector<uint8_t>>, ST_NumShaderTypes> cbuff_indices_;
 		std::array<std::vector<GraphicsBuffer*>, ST_NumShaderTypes> d3d_cbuffs_;
+		std::array<std::vector<RenderEffectConstantBuffer*>, ST_NumShaderTypes> stage_cbuffs_;
 		bool vs_so_;
 		bool ds_so_;
 		std::vector<D3D12_SO_DECLARATION_ENTRY> so_decl_;
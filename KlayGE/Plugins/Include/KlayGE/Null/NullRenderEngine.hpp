@@ -0,0 +1,134 @@
+/**
+ * @file NullRenderEngine.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _NULLRENDERENGINE_HPP
+#define _NULLRENDERENGINE_HPP
+
+#pragma once
+
+#include <KlayGE/RenderEngine.hpp>
+
+#include <atomic>
+
+namespace KlayGE
+{
+	// Goes through all the CPU work of a frame but never submits anything. What would have reached the device is counted
+	// instead, and could be read by GetCustomAttrib with "NUM_DRAWS", "NUM_DISPATCHES", "NUM_STATE_CHANGES",
+	// "NUM_SHADER_BINDS" and "NUM_BYTES_UPLOADED" as uint64_t. SetCustomAttrib with "RESET_STATS" zeros them.
+	class NullRenderEngine : public RenderEngine
+	{
+	public:
+		NullRenderEngine();
+		virtual ~NullRenderEngine();
+
+		virtual std::wstring const & Name() const override;
+
+		virtual bool RequiresFlipping() const override
+		{
+			return false;
+		}
+
+		virtual void ForceFlush() override;
+
+		virtual TexturePtr const & ScreenDepthStencilTexture() const override;
+
+		virtual void ScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
+
+		virtual void GetCustomAttrib(std::string const & name, void* value) override;
+		virtual void SetCustomAttrib(std::string const & name, void* value) override;
+
+		virtual bool FullScreen() const override;
+		virtual void FullScreen(bool fs) override;
+
+		void OnStateChange()
+		{
+			++ num_state_changes_;
+		}
+		void OnShaderBind()
+		{
+			++ num_shader_binds_;
+		}
+		// Resources could be filled on the loading threads
+		void OnBytesUploaded(uint64_t bytes)
+		{
+			num_bytes_uploaded_ += bytes;
+		}
+
+		uint64_t NumDraws() const
+		{
+			return num_draws_;
+		}
+		uint64_t NumDispatches() const
+		{
+			return num_dispatches_;
+		}
+		uint64_t NumStateChanges() const
+		{
+			return num_state_changes_;
+		}
+		uint64_t NumShaderBinds() const
+		{
+			return num_shader_binds_;
+		}
+		uint64_t NumBytesUploaded() const
+		{
+			return num_bytes_uploaded_;
+		}
+		void ResetStats();
+
+	private:
+		virtual void DoCreateRenderWindow(std::string const & name, RenderSettings const & settings) override;
+		virtual void DoBindFrameBuffer(FrameBufferPtr const & fb) override;
+		virtual void DoBindSOBuffers(RenderLayoutPtr const & rl) override;
+		virtual void DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl) override;
+		virtual void DoDispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz) override;
+		virtual void DoDispatchIndirect(RenderEffect const & effect, RenderTechnique const & tech,
+			GraphicsBufferPtr const & buff_args, uint32_t offset) override;
+		virtual void DoResize(uint32_t width, uint32_t height) override;
+		virtual void DoDestroy() override;
+
+		virtual void DoSuspend() override;
+		virtual void DoResume() override;
+
+		void FillRenderDeviceCaps();
+
+	private:
+		bool full_screen_;
+
+		uint64_t num_draws_;
+		uint64_t num_dispatches_;
+		uint64_t num_state_changes_;
+		uint64_t num_shader_binds_;
+		std::atomic<uint64_t> num_bytes_uploaded_;
+	};
+}
+
+#endif			// _NULLRENDERENGINE_HPP
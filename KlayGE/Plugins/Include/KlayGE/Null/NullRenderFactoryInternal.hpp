@@ -0,0 +1,116 @@
+/**
+ * @file NullRenderFactoryInternal.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _NULLRENDERFACTORYINTERNAL_HPP
+#define _NULLRENDERFACTORYINTERNAL_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KlayGE/RenderFactory.hpp>
+
+namespace KlayGE
+{
+	// Makes resources that live in the CPU memory only. No device, driver or window is touched, so the CPU side of the
+	// engine could be run and measured on the machines without a GPU.
+	class NullRenderFactory : public RenderFactory
+	{
+	public:
+		NullRenderFactory();
+
+		virtual std::wstring const & Name() const override;
+
+		virtual TexturePtr MakeDelayCreationTexture1D(uint32_t width, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint) override;
+		virtual TexturePtr MakeDelayCreationTexture2D(uint32_t width, uint32_t height, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint) override;
+		virtual TexturePtr MakeDelayCreationTexture3D(uint32_t width, uint32_t height, uint32_t depth, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint) override;
+		virtual TexturePtr MakeDelayCreationTextureCube(uint32_t size, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint) override;
+
+		virtual FrameBufferPtr MakeFrameBuffer() override;
+
+		virtual RenderLayoutPtr MakeRenderLayout() override;
+
+		virtual GraphicsBufferPtr MakeDelayCreationVertexBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt = EF_Unknown) override;
+		virtual GraphicsBufferPtr MakeDelayCreationIndexBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt = EF_Unknown) override;
+		virtual GraphicsBufferPtr MakeDelayCreationConstantBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt = EF_Unknown) override;
+
+		virtual QueryPtr MakeOcclusionQuery() override;
+		virtual QueryPtr MakeConditionalRender() override;
+		virtual QueryPtr MakeTimerQuery() override;
+		virtual QueryPtr MakeSOStatisticsQuery() override;
+
+		virtual FencePtr MakeFence() override;
+
+		virtual RenderViewPtr Make1DRenderView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual RenderViewPtr Make2DRenderView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual RenderViewPtr Make2DRenderView(Texture& texture, int array_index, Texture::CubeFaces face, int level) override;
+		virtual RenderViewPtr Make2DRenderView(Texture& texture, int array_index, uint32_t slice, int level) override;
+		virtual RenderViewPtr MakeCubeRenderView(Texture& texture, int array_index, int level) override;
+		virtual RenderViewPtr Make3DRenderView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level) override;
+		virtual RenderViewPtr MakeGraphicsBufferRenderView(GraphicsBuffer& gbuffer, uint32_t width, uint32_t height, ElementFormat pf) override;
+		virtual RenderViewPtr Make2DDepthStencilRenderView(uint32_t width, uint32_t height, ElementFormat pf,
+			uint32_t sample_count, uint32_t sample_quality) override;
+		virtual RenderViewPtr Make1DDepthStencilRenderView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual RenderViewPtr Make2DDepthStencilRenderView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual RenderViewPtr Make2DDepthStencilRenderView(Texture& texture, int array_index, Texture::CubeFaces face, int level) override;
+		virtual RenderViewPtr Make2DDepthStencilRenderView(Texture& texture, int array_index, uint32_t slice, int level) override;
+		virtual RenderViewPtr MakeCubeDepthStencilRenderView(Texture& texture, int array_index, int level) override;
+		virtual RenderViewPtr Make3DDepthStencilRenderView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level) override;
+
+		virtual UnorderedAccessViewPtr Make1DUnorderedAccessView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual UnorderedAccessViewPtr Make2DUnorderedAccessView(Texture& texture, int first_array_index, int array_size, int level) override;
+		virtual UnorderedAccessViewPtr Make2DUnorderedAccessView(Texture& texture, int array_index, Texture::CubeFaces face, int level) override;
+		virtual UnorderedAccessViewPtr Make2DUnorderedAccessView(Texture& texture, int array_index, uint32_t slice, int level) override;
+		virtual UnorderedAccessViewPtr MakeCubeUnorderedAccessView(Texture& texture, int array_index, int level) override;
+		virtual UnorderedAccessViewPtr Make3DUnorderedAccessView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level) override;
+		virtual UnorderedAccessViewPtr MakeGraphicsBufferUnorderedAccessView(GraphicsBuffer& gbuffer, ElementFormat pf) override;
+
+		virtual ShaderObjectPtr MakeShaderObject() override;
+
+	private:
+		virtual std::unique_ptr<RenderEngine> DoMakeRenderEngine() override;
+
+		virtual RenderStateObjectPtr DoMakeRenderStateObject(RasterizerStateDesc const & rs_desc, DepthStencilStateDesc const & dss_desc,
+			BlendStateDesc const & bs_desc) override;
+		virtual SamplerStateObjectPtr DoMakeSamplerStateObject(SamplerStateDesc const & desc) override;
+
+		virtual void DoSuspend() override;
+		virtual void DoResume() override;
+	};
+}
+
+#endif			// _NULLRENDERFACTORYINTERNAL_HPP
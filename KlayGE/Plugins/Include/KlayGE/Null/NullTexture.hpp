@@ -0,0 +1,136 @@
+/**
+ * @file NullTexture.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#ifndef _NULLTEXTURE_HPP
+#define _NULLTEXTURE_HPP
+
+#pragma once
+
+#include <KlayGE/Texture.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// One class for all the texture types. Every subresource is a tightly packed block of CPU memory, so mapping and
+	// updating work as usual. Copies only happen between the same formats and sizes, there is no scaling.
+	class NullTexture : public Texture
+	{
+	public:
+		NullTexture(TextureType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint);
+
+		virtual std::wstring const & Name() const override;
+
+		virtual uint32_t Width(uint32_t level) const override;
+		virtual uint32_t Height(uint32_t level) const override;
+		virtual uint32_t Depth(uint32_t level) const override;
+
+		virtual void CopyToTexture(Texture& target) override;
+		virtual void CopyToSubTexture1D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_width,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_width) override;
+		virtual void CopyToSubTexture2D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_width, uint32_t dst_height,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_width, uint32_t src_height) override;
+		virtual void CopyToSubTexture3D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_z_offset, uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_z_offset, uint32_t src_width, uint32_t src_height, uint32_t src_depth) override;
+		virtual void CopyToSubTextureCube(Texture& target,
+			uint32_t dst_array_index, CubeFaces dst_face, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_width, uint32_t dst_height,
+			uint32_t src_array_index, CubeFaces src_face, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_width, uint32_t src_height) override;
+
+		virtual void BuildMipSubLevels() override;
+
+		virtual void Map1D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t width,
+			void*& data) override;
+		virtual void Map2D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void*& data, uint32_t& row_pitch) override;
+		virtual void Map3D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth,
+			void*& data, uint32_t& row_pitch, uint32_t& slice_pitch) override;
+		virtual void MapCube(uint32_t array_index, CubeFaces face, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void*& data, uint32_t& row_pitch) override;
+
+		virtual void Unmap1D(uint32_t array_index, uint32_t level) override;
+		virtual void Unmap2D(uint32_t array_index, uint32_t level) override;
+		virtual void Unmap3D(uint32_t array_index, uint32_t level) override;
+		virtual void UnmapCube(uint32_t array_index, CubeFaces face, uint32_t level) override;
+
+		virtual void CreateHWResource(ElementInitData const * init_data) override;
+		virtual void DeleteHWResource() override;
+		virtual bool HWResourceReady() const override;
+
+		virtual void UpdateSubresource1D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t width,
+			void const * data) override;
+		virtual void UpdateSubresource2D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void const * data, uint32_t row_pitch) override;
+		virtual void UpdateSubresource3D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth,
+			void const * data, uint32_t row_pitch, uint32_t slice_pitch) override;
+		virtual void UpdateSubresourceCube(uint32_t array_index, CubeFaces face, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void const * data, uint32_t row_pitch) override;
+
+	private:
+		uint32_t SubresourceIndex(uint32_t array_index, uint32_t face, uint32_t level) const;
+		uint32_t RowPitch(uint32_t level) const;
+		uint32_t SlicePitch(uint32_t level) const;
+		// Byte offset of a texel in a subresource. Offsets of the compressed formats are in texels, and rounded to blocks.
+		uint32_t Offset(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const;
+		uint32_t RegionBytes(uint32_t width, uint32_t height, uint32_t depth) const;
+
+		void Map(uint32_t sub_res, uint32_t level, TextureMapAccess tma, uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth, void*& data, uint32_t& row_pitch, uint32_t& slice_pitch);
+		void Update(uint32_t sub_res, uint32_t level, uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth, void const * data, uint32_t row_pitch, uint32_t slice_pitch);
+		void CopyToSub(Texture& target, uint32_t dst_sub_res, uint32_t dst_level,
+			uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_z_offset,
+			uint32_t src_sub_res, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_z_offset,
+			uint32_t width, uint32_t height, uint32_t depth);
+
+	private:
+		uint32_t width_;
+		uint32_t height_;
+		uint32_t depth_;
+
+		std::vector<std::vector<uint8_t>> subres_data_;
+	};
+}
+
+#endif			// _NULLTEXTURE_HPP
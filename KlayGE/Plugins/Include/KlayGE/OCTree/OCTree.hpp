@@ -42,6 +42,7 @@ namespace KlayGE
 		uint32_t MaxTreeDepth() const;
 
 		virtual void ClipScene() override;
+		virtual void ClipViews(std::vector<CullingView> const & views) override;
 
 		virtual BoundOverlap AABBVisible(AABBox const & aabb) const override;
 		virtual BoundOverlap OBBVisible(OBBox const & obb) const override;
@@ -54,10 +55,13 @@ namespace KlayGE
 		virtual void OnDelSceneObject(std::vector<SceneObjectPtr>::iterator iter) override;
 		virtual void DoSuspend() override;
 		virtual void DoResume() override;
+		virtual SceneQuerySnapshotPtr MakeQuerySnapshot() override;
 
+		void RebuildTree();
 		void DivideNode(size_t index, uint32_t curr_depth);
 		void NodeVisible(size_t index);
 		void MarkNodeObjs(size_t index, bool force);
+		void NodeViewMask(size_t index, uint32_t test_mask, uint32_t inside_mask);
 
 		BoundOverlap BoundVisible(size_t index, AABBox const & aabb) const;
 		BoundOverlap BoundVisible(size_t index, OBBox const & obb) const;
@@ -69,6 +73,8 @@ namespace KlayGE
 		OCTree& operator=(OCTree const & rhs);
 
 	private:
+		class QuerySnapshot;
+
 		struct octree_node_t
 		{
 			AABBox bb;
@@ -436,12 +436,7 @@ namespace KlayGE
 		DepthStencilStateDesc default_dss_desc;
 		BlendStateDesc default_bs_desc;
 
-		vertex_shader_cache_ = nullptr;
-		pixel_shader_cache_ = nullptr;
-		geometry_shader_cache_ = nullptr;
-		compute_shader_cache_ = nullptr;
-		hull_shader_cache_ = nullptr;
-		domain_shader_cache_ = nullptr;
+		binding_cache_.Invalidate();
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		cur_rs_obj_ = rf.MakeRenderStateObject(default_rs_desc, default_dss_desc, default_bs_desc);
@@ -478,8 +473,8 @@ namespace KlayGE
 			vb_offset_cache_.clear();
 		}
 
-		ib_cache_ = nullptr;
-		d3d_imm_ctx_->IASetIndexBuffer(ib_cache_, DXGI_FORMAT_R16_UINT, 0);
+		binding_cache_.Bind(BindingCache::BT_IndexBuffer, 0, 0, nullptr);
+		d3d_imm_ctx_->IASetIndexBuffer(nullptr, DXGI_FORMAT_R16_UINT, 0);
 
 		for (uint32_t i = 0; i < ShaderObject::ST_NumShaderTypes; ++ i)
 		{
@@ -557,6 +552,13 @@ namespace KlayGE
 		}
 	}
 
+	// The vertex elements and the input layout, made on the free threaded device, are ready before the replay
+	void D3D11RenderEngine::DoPrepareDraw(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
+	{
+		D3D11RenderLayout const & d3d_rl = *checked_cast<D3D11RenderLayout const *>(&rl);
+		d3d_rl.Prepare(tech.Pass(0).GetShaderObject(effect).get());
+	}
+
 	// Ⱦ
 	/////////////////////////////////////////////////////////////////////////////////
 	void D3D11RenderEngine::DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
@@ -572,8 +574,10 @@ namespace KlayGE
 		auto const & offsets = d3d_rl.Offsets();
 		if (all_num_vertex_stream != 0)
 		{
-			if ((vb_cache_.size() != all_num_vertex_stream) || (vb_cache_ != vbs)
-				|| (vb_stride_cache_ != strides) || (vb_offset_cache_ != offsets))
+			bool const vb_changed = (vb_cache_.size() != all_num_vertex_stream) || (vb_cache_ != vbs)
+				|| (vb_stride_cache_ != strides) || (vb_offset_cache_ != offsets);
+			binding_cache_.Count(BindingCache::BT_VertexBuffer, vb_changed);
+			if (vb_changed)
 			{
 				d3d_imm_ctx_->IASetVertexBuffers(0, all_num_vertex_stream, &vbs[0], &strides[0], &offsets[0]);
 				vb_cache_ = vbs;
@@ -684,18 +688,16 @@ namespace KlayGE
 		if (rl.UseIndices())
 		{
 			ID3D11Buffer* d3dib = checked_cast<D3D11GraphicsBuffer*>(rl.GetIndexStream().get())->D3DBuffer();
-			if (ib_cache_ != d3dib)
+			if (binding_cache_.Bind(BindingCache::BT_IndexBuffer, 0, 0, d3dib))
 			{
 				d3d_imm_ctx_->IASetIndexBuffer(d3dib, D3D11Mapping::MappingFormat(rl.IndexStreamFormat()), 0);
-				ib_cache_ = d3dib;
 			}
 		}
 		else
 		{
-			if (ib_cache_)
+			if (binding_cache_.Bind(BindingCache::BT_IndexBuffer, 0, 0, nullptr))
 			{
 				d3d_imm_ctx_->IASetIndexBuffer(nullptr, DXGI_FORMAT_R16_UINT, 0);
-				ib_cache_ = nullptr;
 			}
 		}
 
@@ -890,15 +892,9 @@ namespace KlayGE
 		rasterizer_state_cache_ = nullptr;
 		depth_stencil_state_cache_ = nullptr;
 		blend_state_cache_ = nullptr;
-		vertex_shader_cache_ = nullptr;
-		pixel_shader_cache_ = nullptr;
-		geometry_shader_cache_ = nullptr;
-		compute_shader_cache_ = nullptr;
-		hull_shader_cache_ = nullptr;
-		domain_shader_cache_ = nullptr;
 		input_layout_cache_ = nullptr;
 		vb_cache_.clear();
-		ib_cache_ = nullptr;
+		binding_cache_.Invalidate();
 
 		for (size_t i = 0; i < ShaderObject::ST_NumShaderTypes; ++ i)
 		{
@@ -1124,6 +1120,8 @@ namespace KlayGE
 		}
 		caps_.render_to_texture_array_support = true;
 		caps_.load_from_buffer_support = true;
+		// Constant buffers could only be updated as a whole before D3D11.1
+		caps_.cbuffer_partial_update_support = false;
 		caps_.gs_support = true;
 		caps_.hs_support = true;
 		caps_.ds_support = true;
@@ -1506,55 +1504,49 @@ namespace KlayGE
 
 	void D3D11RenderEngine::VSSetShader(ID3D11VertexShader* shader)
 	{
-		if (vertex_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_VertexShader, 0, shader))
 		{
 			d3d_imm_ctx_->VSSetShader(shader, nullptr, 0);
-			vertex_shader_cache_ = shader;
 		}
 	}
 
 	void D3D11RenderEngine::PSSetShader(ID3D11PixelShader* shader)
 	{
-		if (pixel_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_PixelShader, 0, shader))
 		{
 			d3d_imm_ctx_->PSSetShader(shader, nullptr, 0);
-			pixel_shader_cache_ = shader;
 		}
 	}
 
 	void D3D11RenderEngine::GSSetShader(ID3D11GeometryShader* shader)
 	{
-		if (geometry_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_GeometryShader, 0, shader))
 		{
 			d3d_imm_ctx_->GSSetShader(shader, nullptr, 0);
-			geometry_shader_cache_ = shader;
 		}
 	}
 
 	void D3D11RenderEngine::CSSetShader(ID3D11ComputeShader* shader)
 	{
-		if (compute_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_ComputeShader, 0, shader))
 		{
 			d3d_imm_ctx_->CSSetShader(shader, nullptr, 0);
-			compute_shader_cache_ = shader;
 		}
 	}
 
 	void D3D11RenderEngine::HSSetShader(ID3D11HullShader* shader)
 	{
-		if (hull_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_HullShader, 0, shader))
 		{
 			d3d_imm_ctx_->HSSetShader(shader, nullptr, 0);
-			hull_shader_cache_ = shader;
 		}
 	}
 
 	void D3D11RenderEngine::DSSetShader(ID3D11DomainShader* shader)
 	{
-		if (domain_shader_cache_ != shader)
+		if (binding_cache_.Bind(BindingCache::BT_Shader, ShaderObject::ST_DomainShader, 0, shader))
 		{
 			d3d_imm_ctx_->DSSetShader(shader, nullptr, 0);
-			domain_shader_cache_ = shader;
 		}
 	}
 
@@ -1640,28 +1632,37 @@ namespace KlayGE
 			std::vector<std::tuple<void*, uint32_t, uint32_t>> const & srvsrcs,
 			std::vector<ID3D11ShaderResourceView*> const & srvs)
 	{
-		if (shader_srv_ptr_cache_[st] != srvs)
+		// The slots only used by the last bind are cleared too
+		auto& srv_cache = shader_srv_ptr_cache_[st];
+		size_t const old_size = srv_cache.size();
+		srv_cache = srvs;
+		if (old_size > srvs.size())
 		{
-			size_t const old_size = shader_srv_ptr_cache_[st].size();
-			shader_srv_ptr_cache_[st] = srvs;
-			if (old_size > srvs.size())
-			{
-				shader_srv_ptr_cache_[st].resize(old_size, nullptr);
-			}
-
-			ShaderSetShaderResources[st](d3d_imm_ctx_.get(), 0,
-				static_cast<UINT>(shader_srv_ptr_cache_[st].size()), &shader_srv_ptr_cache_[st][0]);
+			srv_cache.resize(old_size, nullptr);
+		}
 
+		uint32_t first;
+		uint32_t const num = binding_cache_.Bind(BindingCache::BT_ShaderResource, st, 0,
+			static_cast<uint32_t>(srv_cache.size()), srv_cache.data(), first);
+		if (num > 0)
+		{
+			ShaderSetShaderResources[st](d3d_imm_ctx_.get(), first, num, &srv_cache[first]);
+		}
+		if ((num > 0) || (shader_srvsrc_cache_[st].size() != srvsrcs.size()))
+		{
 			shader_srvsrc_cache_[st] = srvsrcs;
-			shader_srv_ptr_cache_[st].resize(srvs.size());
 		}
+		srv_cache.resize(srvs.size());
 	}
 
 	void D3D11RenderEngine::SetSamplers(ShaderObject::ShaderType st, std::vector<ID3D11SamplerState*> const & samplers)
 	{
-		if (shader_sampler_ptr_cache_[st] != samplers)
+		uint32_t first;
+		uint32_t const num = binding_cache_.Bind(BindingCache::BT_Sampler, st, 0,
+			static_cast<uint32_t>(samplers.size()), samplers.data(), first);
+		if (num > 0)
 		{
-			ShaderSetSamplers[st](d3d_imm_ctx_.get(), 0, static_cast<UINT>(samplers.size()), &samplers[0]);
+			ShaderSetSamplers[st](d3d_imm_ctx_.get(), first, num, &samplers[first]);
 
 			shader_sampler_ptr_cache_[st] = samplers;
 		}
@@ -1669,9 +1670,12 @@ namespace KlayGE
 
 	void D3D11RenderEngine::SetConstantBuffers(ShaderObject::ShaderType st, std::vector<ID3D11Buffer*> const & cbs)
 	{
-		if (shader_cb_ptr_cache_[st] != cbs)
+		uint32_t first;
+		uint32_t const num = binding_cache_.Bind(BindingCache::BT_ConstantBuffer, st, 0,
+			static_cast<uint32_t>(cbs.size()), cbs.data(), first);
+		if (num > 0)
 		{
-			ShaderSetConstantBuffers[st](d3d_imm_ctx_.get(), 0, static_cast<UINT>(cbs.size()), &cbs[0]);
+			ShaderSetConstantBuffers[st](d3d_imm_ctx_.get(), first, num, &cbs[first]);
 
 			shader_cb_ptr_cache_[st] = cbs;
 		}
@@ -1698,6 +1702,7 @@ namespace KlayGE
 							|| ((rt_last >= first) && (rt_last < last)))
 						{
 							shader_srv_ptr_cache_[st][i] = nullptr;
+							binding_cache_.Bind(BindingCache::BT_ShaderResource, st, i, nullptr);
 							cleared = true;
 						}
 					}
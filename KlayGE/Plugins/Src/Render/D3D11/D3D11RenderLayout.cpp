@@ -111,4 +111,11 @@ namespace KlayGE
 			return nullptr;
 		}
 	}
+
+	void D3D11RenderLayout::Prepare(ShaderObject const * so) const
+	{
+		std::lock_guard<std::mutex> lock(prepare_mutex_);
+		this->Active();
+		this->InputLayout(so);
+	}
 }
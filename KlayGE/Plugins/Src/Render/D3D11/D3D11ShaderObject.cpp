@@ -1036,6 +1036,7 @@ namespace KlayGE
 				cbuff_indices_[type] = MakeSharedPtr<std::vector<uint8_t>>(shader_desc_[type]->cb_desc.size());
 			}
 			d3d11_cbuffs_[type].resize(shader_desc_[type]->cb_desc.size());
+			stage_cbuffs_[type].resize(shader_desc_[type]->cb_desc.size());
 			for (size_t c = 0; c < shader_desc_[type]->cb_desc.size(); ++ c)
 			{
 				uint32_t i = 0;
@@ -1171,6 +1172,7 @@ namespace KlayGE
 
 			cbuff_indices_[type] = so.cbuff_indices_[type];
 			d3d11_cbuffs_[type].resize(so.d3d11_cbuffs_[type].size());
+			stage_cbuffs_[type].resize(so.stage_cbuffs_[type].size());
 
 			param_binds_[type].reserve(so.param_binds_[type].size());
 			for (auto const & pb : so.param_binds_[type])
@@ -1227,6 +1229,7 @@ namespace KlayGE
 					}
 
 					d3d11_cbuffs_[type][i] = checked_cast<D3D11GraphicsBuffer*>(cbuff->HWBuff().get())->D3DBuffer();
+					stage_cbuffs_[type][i] = cbuff;
 				}
 			}
 		}
@@ -1275,18 +1278,20 @@ namespace KlayGE
 			if (cbuff_indices_[i] && !cbuff_indices_[i]->empty())
 			{
 				ret->d3d11_cbuffs_[i].resize(d3d11_cbuffs_[i].size());
+				ret->stage_cbuffs_[i].resize(stage_cbuffs_[i].size());
 				all_cbuff_indices.insert(all_cbuff_indices.end(), cbuff_indices_[i]->begin(), cbuff_indices_[i]->end());
 				for (size_t j = 0; j < cbuff_indices_[i]->size(); ++ j)
 				{
 					auto cbuff = effect.CBufferByIndex((*cbuff_indices_[i])[j]);
 					ret->d3d11_cbuffs_[i][j] = checked_cast<D3D11GraphicsBuffer*>(cbuff->HWBuff().get())->D3DBuffer();
+					ret->stage_cbuffs_[i][j] = cbuff;
 				}
 			}
 
 			ret->param_binds_[i].reserve(param_binds_[i].size());
 			for (auto const & pb : param_binds_[i])
 			{
-				ret->param_binds_[i].push_back(ret->GetBindFunc(pb.p_handle, effect.ParameterByName(pb.param->Name())));
+				ret->param_binds_[i].push_back(ret->GetBindFunc(pb.p_handle, effect.ParameterByName(EffectNameId(pb.param->NameHash()))));
 			}
 		}
 
@@ -1407,6 +1412,11 @@ namespace KlayGE
 
 			if (!d3d11_cbuffs_[st].empty())
 			{
+				// A cbuffer of a cloned effect gets its own hardware buffer when first written
+				for (size_t i = 0; i < stage_cbuffs_[st].size(); ++ i)
+				{
+					d3d11_cbuffs_[st][i] = checked_cast<D3D11GraphicsBuffer*>(stage_cbuffs_[st][i]->HWBuff().get())->D3DBuffer();
+				}
 				re.SetConstantBuffers(static_cast<ShaderObject::ShaderType>(st), d3d11_cbuffs_[st]);
 			}
 		}
@@ -1378,6 +1378,8 @@ namespace KlayGE
 		caps_.full_npot_texture_support = true;
 		caps_.render_to_texture_array_support = true;
 		caps_.load_from_buffer_support = true;
+		// Mapping a cbuffer could rename it, the bytes not written are lost
+		caps_.cbuffer_partial_update_support = false;
 		caps_.gs_support = true;
 		caps_.hs_support = true;
 		caps_.ds_support = true;
@@ -0,0 +1,107 @@
+/**
+ * @file NullGraphicsBuffer.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/Null/NullRenderEngine.hpp>
+#include <KlayGE/Null/NullGraphicsBuffer.hpp>
+
+namespace KlayGE
+{
+	NullGraphicsBuffer::NullGraphicsBuffer(BufferUsage usage, uint32_t access_hint, uint32_t size_in_byte)
+		: GraphicsBuffer(usage, access_hint, size_in_byte)
+	{
+	}
+
+	void NullGraphicsBuffer::CopyToBuffer(GraphicsBuffer& rhs)
+	{
+		auto& null_gb = *checked_cast<NullGraphicsBuffer*>(&rhs);
+		uint32_t const size = std::min(size_in_byte_, rhs.Size());
+		if ((size > 0) && !data_.empty() && !null_gb.data_.empty())
+		{
+			std::memcpy(&null_gb.data_[0], &data_[0], size);
+		}
+	}
+
+	void NullGraphicsBuffer::CreateHWResource(void const * init_data)
+	{
+		data_.assign(size_in_byte_, 0);
+		if ((init_data != nullptr) && (size_in_byte_ > 0))
+		{
+			std::memcpy(&data_[0], init_data, size_in_byte_);
+
+			auto& re = *checked_cast<NullRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
+			re.OnBytesUploaded(size_in_byte_);
+		}
+	}
+
+	void NullGraphicsBuffer::DeleteHWResource()
+	{
+		data_.clear();
+	}
+
+	void NullGraphicsBuffer::UpdateSubresource(uint32_t offset, uint32_t size, void const * data)
+	{
+		BOOST_ASSERT(offset + size <= data_.size());
+
+		if (size > 0)
+		{
+			std::memcpy(&data_[offset], data, size);
+
+			auto& re = *checked_cast<NullRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
+			re.OnBytesUploaded(size);
+		}
+	}
+
+	void* NullGraphicsBuffer::Map(BufferAccess ba)
+	{
+		BOOST_ASSERT(!data_.empty());
+
+		// The whole buffer is counted, the engine can't tell how much of it is touched
+		if (ba != BA_Read_Only)
+		{
+			auto& re = *checked_cast<NullRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
+			re.OnBytesUploaded(size_in_byte_);
+		}
+
+		return &data_[0];
+	}
+
+	void NullGraphicsBuffer::Unmap()
+	{
+	}
+}
@@ -0,0 +1,112 @@
+/**
+ * @file NullQuery.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <KlayGE/Null/NullQuery.hpp>
+
+namespace KlayGE
+{
+	void NullOcclusionQuery::Begin()
+	{
+	}
+
+	void NullOcclusionQuery::End()
+	{
+	}
+
+	uint64_t NullOcclusionQuery::SamplesPassed()
+	{
+		return 1;
+	}
+
+
+	void NullConditionalRender::Begin()
+	{
+	}
+
+	void NullConditionalRender::End()
+	{
+	}
+
+	void NullConditionalRender::BeginConditionalRender()
+	{
+	}
+
+	void NullConditionalRender::EndConditionalRender()
+	{
+	}
+
+	bool NullConditionalRender::AnySamplesPassed()
+	{
+		return true;
+	}
+
+
+	NullTimerQuery::NullTimerQuery()
+		: elapsed_(0)
+	{
+	}
+
+	void NullTimerQuery::Begin()
+	{
+		timer_.restart();
+	}
+
+	void NullTimerQuery::End()
+	{
+		elapsed_ = timer_.elapsed();
+	}
+
+	double NullTimerQuery::TimeElapsed()
+	{
+		return elapsed_;
+	}
+
+
+	void NullSOStatisticsQuery::Begin()
+	{
+	}
+
+	void NullSOStatisticsQuery::End()
+	{
+	}
+
+	uint64_t NullSOStatisticsQuery::NumPrimitivesWritten()
+	{
+		return 0;
+	}
+
+	uint64_t NullSOStatisticsQuery::PrimitivesGenerated()
+	{
+		return 0;
+	}
+}
@@ -0,0 +1,321 @@
+/**
+ * @file NullRenderEngine.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KFL/Hash.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/RenderLayout.hpp>
+
+#include <KlayGE/Null/NullRenderWindow.hpp>
+#include <KlayGE/Null/NullRenderEngine.hpp>
+
+namespace KlayGE
+{
+	NullRenderEngine::NullRenderEngine()
+		: full_screen_(false),
+			num_draws_(0), num_dispatches_(0), num_state_changes_(0), num_shader_binds_(0), num_bytes_uploaded_(0)
+	{
+		native_shader_fourcc_ = MakeFourCC<'N', 'U', 'L', 'L'>::value;
+		native_shader_version_ = 1;
+		native_shader_platform_name_ = "null";
+
+		this->FillRenderDeviceCaps();
+	}
+
+	NullRenderEngine::~NullRenderEngine()
+	{
+		this->Destroy();
+	}
+
+	std::wstring const & NullRenderEngine::Name() const
+	{
+		static std::wstring const name(L"Null Render Engine");
+		return name;
+	}
+
+	void NullRenderEngine::ForceFlush()
+	{
+	}
+
+	TexturePtr const & NullRenderEngine::ScreenDepthStencilTexture() const
+	{
+		return checked_cast<NullRenderWindow*>(screen_frame_buffer_.get())->DepthStencilTexture();
+	}
+
+	void NullRenderEngine::ScissorRect(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+	{
+		KFL_UNUSED(x);
+		KFL_UNUSED(y);
+		KFL_UNUSED(width);
+		KFL_UNUSED(height);
+	}
+
+	void NullRenderEngine::GetCustomAttrib(std::string const & name, void* value)
+	{
+		size_t const name_hash = RT_HASH(name.c_str());
+		if (CT_HASH("NUM_DRAWS") == name_hash)
+		{
+			*static_cast<uint64_t*>(value) = num_draws_;
+		}
+		else if (CT_HASH("NUM_DISPATCHES") == name_hash)
+		{
+			*static_cast<uint64_t*>(value) = num_dispatches_;
+		}
+		else if (CT_HASH("NUM_STATE_CHANGES") == name_hash)
+		{
+			*static_cast<uint64_t*>(value) = num_state_changes_;
+		}
+		else if (CT_HASH("NUM_SHADER_BINDS") == name_hash)
+		{
+			*static_cast<uint64_t*>(value) = num_shader_binds_;
+		}
+		else if (CT_HASH("NUM_BYTES_UPLOADED") == name_hash)
+		{
+			*static_cast<uint64_t*>(value) = num_bytes_uploaded_;
+		}
+	}
+
+	void NullRenderEngine::SetCustomAttrib(std::string const & name, void* value)
+	{
+		KFL_UNUSED(value);
+
+		size_t const name_hash = RT_HASH(name.c_str());
+		if (CT_HASH("RESET_STATS") == name_hash)
+		{
+			this->ResetStats();
+		}
+	}
+
+	bool NullRenderEngine::FullScreen() const
+	{
+		return full_screen_;
+	}
+
+	void NullRenderEngine::FullScreen(bool fs)
+	{
+		full_screen_ = fs;
+	}
+
+	void NullRenderEngine::ResetStats()
+	{
+		num_draws_ = 0;
+		num_dispatches_ = 0;
+		num_state_changes_ = 0;
+		num_shader_binds_ = 0;
+		num_bytes_uploaded_ = 0;
+	}
+
+	void NullRenderEngine::DoCreateRenderWindow(std::string const & name, RenderSettings const & settings)
+	{
+		motion_frames_ = settings.motion_frames;
+		full_screen_ = settings.full_screen;
+
+		this->BindFrameBuffer(MakeSharedPtr<NullRenderWindow>(name, settings));
+	}
+
+	void NullRenderEngine::DoBindFrameBuffer(FrameBufferPtr const & fb)
+	{
+		KFL_UNUSED(fb);
+		this->OnStateChange();
+	}
+
+	void NullRenderEngine::DoBindSOBuffers(RenderLayoutPtr const & rl)
+	{
+		KFL_UNUSED(rl);
+		this->OnStateChange();
+	}
+
+	void NullRenderEngine::DoRender(RenderEffect const & effect, RenderTechnique const & tech, RenderLayout const & rl)
+	{
+		uint32_t const vertex_count = rl.UseIndices() ? rl.NumIndices() : rl.NumVertices();
+
+		uint32_t prim_count;
+		RenderLayout::topology_type const tt = rl.TopologyType();
+		switch (tt)
+		{
+		case RenderLayout::TT_PointList:
+			prim_count = vertex_count;
+			break;
+
+		case RenderLayout::TT_LineList:
+		case RenderLayout::TT_LineList_Adj:
+			prim_count = vertex_count / 2;
+			break;
+
+		case RenderLayout::TT_LineStrip:
+		case RenderLayout::TT_LineStrip_Adj:
+			prim_count = vertex_count - 1;
+			break;
+
+		case RenderLayout::TT_TriangleList:
+		case RenderLayout::TT_TriangleList_Adj:
+			prim_count = vertex_count / 3;
+			break;
+
+		case RenderLayout::TT_TriangleStrip:
+		case RenderLayout::TT_TriangleStrip_Adj:
+			prim_count = vertex_count - 2;
+			break;
+
+		default:
+			prim_count = vertex_count / (tt - RenderLayout::TT_1_Ctrl_Pt_PatchList + 1);
+			break;
+		}
+
+		uint32_t const num_instances = rl.NumInstances();
+		num_primitives_just_rendered_ += num_instances * prim_count;
+		num_vertices_just_rendered_ += num_instances * vertex_count;
+
+		uint32_t const num_passes = tech.NumPasses();
+		for (uint32_t i = 0; i < num_passes; ++ i)
+		{
+			auto& pass = tech.Pass(i);
+
+			pass.Bind(effect);
+			pass.Unbind(effect);
+		}
+
+		num_draws_just_called_ += num_passes;
+		num_draws_ += num_passes;
+	}
+
+	void NullRenderEngine::DoDispatch(RenderEffect const & effect, RenderTechnique const & tech, uint32_t tgx, uint32_t tgy, uint32_t tgz)
+	{
+		KFL_UNUSED(tgx);
+		KFL_UNUSED(tgy);
+		KFL_UNUSED(tgz);
+
+		uint32_t const num_passes = tech.NumPasses();
+		for (uint32_t i = 0; i < num_passes; ++ i)
+		{
+			auto& pass = tech.Pass(i);
+
+			pass.Bind(effect);
+			pass.Unbind(effect);
+		}
+
+		num_dispatches_just_called_ += num_passes;
+		num_dispatches_ += num_passes;
+	}
+
+	void NullRenderEngine::DoDispatchIndirect(RenderEffect const & effect, RenderTechnique const & tech,
+		GraphicsBufferPtr const & buff_args, uint32_t offset)
+	{
+		KFL_UNUSED(buff_args);
+		KFL_UNUSED(offset);
+
+		this->DoDispatch(effect, tech, 1, 1, 1);
+	}
+
+	void NullRenderEngine::DoResize(uint32_t width, uint32_t height)
+	{
+		checked_cast<NullRenderWindow*>(screen_frame_buffer_.get())->Resize(width, height);
+	}
+
+	void NullRenderEngine::DoDestroy()
+	{
+	}
+
+	void NullRenderEngine::DoSuspend()
+	{
+	}
+
+	void NullRenderEngine::DoResume()
+	{
+	}
+
+	// Reports a D3D11 class device, so the engine takes the same paths as on a desktop GPU
+	void NullRenderEngine::FillRenderDeviceCaps()
+	{
+		caps_.max_shader_model = ShaderModel(5, 0);
+
+		caps_.max_texture_width = caps_.max_texture_height = 16384;
+		caps_.max_texture_depth = 2048;
+		caps_.max_texture_cube_size = 16384;
+		caps_.max_texture_array_length = 2048;
+		caps_.max_vertex_texture_units = 16;
+		caps_.max_pixel_texture_units = 16;
+		caps_.max_geometry_texture_units = 16;
+		caps_.max_simultaneous_rts = 8;
+		caps_.max_simultaneous_uavs = 8;
+		caps_.max_vertex_streams = 16;
+		caps_.max_texture_anisotropy = 16;
+
+		caps_.is_tbdr = false;
+
+		caps_.hw_instancing_support = true;
+		caps_.instance_id_support = true;
+		caps_.stream_output_support = true;
+		caps_.alpha_to_coverage_support = true;
+		caps_.primitive_restart_support = true;
+		caps_.multithread_rendering_support = true;
+		caps_.multithread_res_creating_support = true;
+		caps_.mrt_independent_bit_depths_support = true;
+		caps_.standard_derivatives_support = true;
+		caps_.shader_texture_lod_support = true;
+		caps_.logic_op_support = true;
+		caps_.independent_blend_support = true;
+		caps_.depth_texture_support = true;
+		caps_.fp_color_support = true;
+		caps_.pack_to_rgba_required = false;
+		caps_.draw_indirect_support = true;
+		caps_.no_overwrite_support = true;
+		caps_.full_npot_texture_support = true;
+		caps_.render_to_texture_array_support = true;
+		caps_.load_from_buffer_support = true;
+		caps_.cbuffer_partial_update_support = true;
+
+		caps_.gs_support = true;
+		caps_.cs_support = true;
+		caps_.hs_support = true;
+		caps_.ds_support = true;
+		caps_.tess_method = TM_Hardware;
+
+		caps_.vertex_format_support = [](ElementFormat elem_fmt)
+			{
+				return !IsCompressedFormat(elem_fmt);
+			};
+		caps_.texture_format_support = [](ElementFormat elem_fmt)
+			{
+				KFL_UNUSED(elem_fmt);
+				return true;
+			};
+		caps_.rendertarget_format_support = [](ElementFormat elem_fmt, uint32_t sample_count, uint32_t sample_quality)
+			{
+				KFL_UNUSED(sample_count);
+				KFL_UNUSED(sample_quality);
+				return !IsCompressedFormat(elem_fmt);
+			};
+	}
+}
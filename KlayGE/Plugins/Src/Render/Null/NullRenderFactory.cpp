@@ -0,0 +1,324 @@
+/**
+ * @file NullRenderFactory.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KFL/Math.hpp>
+
+#include <KlayGE/Null/NullRenderEngine.hpp>
+#include <KlayGE/Null/NullTexture.hpp>
+#include <KlayGE/Null/NullFrameBuffer.hpp>
+#include <KlayGE/Null/NullRenderLayout.hpp>
+#include <KlayGE/Null/NullGraphicsBuffer.hpp>
+#include <KlayGE/Null/NullQuery.hpp>
+#include <KlayGE/Null/NullRenderView.hpp>
+#include <KlayGE/Null/NullRenderStateObject.hpp>
+#include <KlayGE/Null/NullShaderObject.hpp>
+#include <KlayGE/Null/NullFence.hpp>
+
+#include <KlayGE/Null/NullRenderFactory.hpp>
+#include <KlayGE/Null/NullRenderFactoryInternal.hpp>
+
+namespace KlayGE
+{
+	NullRenderFactory::NullRenderFactory()
+	{
+	}
+
+	std::wstring const & NullRenderFactory::Name() const
+	{
+		static std::wstring const name(L"Null Render Factory");
+		return name;
+	}
+
+	TexturePtr NullRenderFactory::MakeDelayCreationTexture1D(uint32_t width, uint32_t num_mip_maps, uint32_t array_size,
+				ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+	{
+		return MakeSharedPtr<NullTexture>(Texture::TT_1D, width, 1, 1, num_mip_maps, array_size,
+			format, sample_count, sample_quality, access_hint);
+	}
+
+	TexturePtr NullRenderFactory::MakeDelayCreationTexture2D(uint32_t width, uint32_t height, uint32_t num_mip_maps, uint32_t array_size,
+				ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+	{
+		return MakeSharedPtr<NullTexture>(Texture::TT_2D, width, height, 1, num_mip_maps, array_size,
+			format, sample_count, sample_quality, access_hint);
+	}
+
+	TexturePtr NullRenderFactory::MakeDelayCreationTexture3D(uint32_t width, uint32_t height, uint32_t depth, uint32_t num_mip_maps, uint32_t array_size,
+				ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+	{
+		return MakeSharedPtr<NullTexture>(Texture::TT_3D, width, height, depth, num_mip_maps, array_size,
+			format, sample_count, sample_quality, access_hint);
+	}
+
+	TexturePtr NullRenderFactory::MakeDelayCreationTextureCube(uint32_t size, uint32_t num_mip_maps, uint32_t array_size,
+				ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+	{
+		return MakeSharedPtr<NullTexture>(Texture::TT_Cube, size, size, 1, num_mip_maps, array_size,
+			format, sample_count, sample_quality, access_hint);
+	}
+
+	FrameBufferPtr NullRenderFactory::MakeFrameBuffer()
+	{
+		return MakeSharedPtr<NullFrameBuffer>();
+	}
+
+	RenderLayoutPtr NullRenderFactory::MakeRenderLayout()
+	{
+		return MakeSharedPtr<NullRenderLayout>();
+	}
+
+	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationVertexBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt)
+	{
+		KFL_UNUSED(fmt);
+		return MakeSharedPtr<NullGraphicsBuffer>(usage, access_hint, size_in_byte);
+	}
+
+	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationIndexBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt)
+	{
+		KFL_UNUSED(fmt);
+		return MakeSharedPtr<NullGraphicsBuffer>(usage, access_hint, size_in_byte);
+	}
+
+	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationConstantBuffer(BufferUsage usage, uint32_t access_hint,
+			uint32_t size_in_byte, ElementFormat fmt)
+	{
+		KFL_UNUSED(fmt);
+		return MakeSharedPtr<NullGraphicsBuffer>(usage, access_hint, size_in_byte);
+	}
+
+	QueryPtr NullRenderFactory::MakeOcclusionQuery()
+	{
+		return MakeSharedPtr<NullOcclusionQuery>();
+	}
+
+	QueryPtr NullRenderFactory::MakeConditionalRender()
+	{
+		return MakeSharedPtr<NullConditionalRender>();
+	}
+
+	QueryPtr NullRenderFactory::MakeTimerQuery()
+	{
+		return MakeSharedPtr<NullTimerQuery>();
+	}
+
+	QueryPtr NullRenderFactory::MakeSOStatisticsQuery()
+	{
+		return MakeSharedPtr<NullSOStatisticsQuery>();
+	}
+
+	FencePtr NullRenderFactory::MakeFence()
+	{
+		return MakeSharedPtr<NullFence>();
+	}
+
+	RenderViewPtr NullRenderFactory::Make1DRenderView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), 1, texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DRenderView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DRenderView(Texture& texture, int array_index, Texture::CubeFaces face, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(face);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DRenderView(Texture& texture, int array_index, uint32_t slice, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(slice);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::MakeCubeRenderView(Texture& texture, int array_index, int level)
+	{
+		KFL_UNUSED(array_index);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make3DRenderView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(first_slice);
+		KFL_UNUSED(num_slices);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::MakeGraphicsBufferRenderView(GraphicsBuffer& gbuffer, uint32_t width, uint32_t height, ElementFormat pf)
+	{
+		KFL_UNUSED(gbuffer);
+		return MakeSharedPtr<NullRenderView>(width, height, pf);
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DDepthStencilRenderView(uint32_t width, uint32_t height, ElementFormat pf,
+		uint32_t sample_count, uint32_t sample_quality)
+	{
+		KFL_UNUSED(sample_count);
+		KFL_UNUSED(sample_quality);
+		return MakeSharedPtr<NullRenderView>(width, height, pf);
+	}
+
+	RenderViewPtr NullRenderFactory::Make1DDepthStencilRenderView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), 1, texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DDepthStencilRenderView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DDepthStencilRenderView(Texture& texture, int array_index, Texture::CubeFaces face, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(face);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make2DDepthStencilRenderView(Texture& texture, int array_index, uint32_t slice, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(slice);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::MakeCubeDepthStencilRenderView(Texture& texture, int array_index, int level)
+	{
+		KFL_UNUSED(array_index);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	RenderViewPtr NullRenderFactory::Make3DDepthStencilRenderView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(first_slice);
+		KFL_UNUSED(num_slices);
+		return MakeSharedPtr<NullRenderView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::Make1DUnorderedAccessView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), 1, texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::Make2DUnorderedAccessView(Texture& texture, int first_array_index, int array_size, int level)
+	{
+		KFL_UNUSED(first_array_index);
+		KFL_UNUSED(array_size);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::Make2DUnorderedAccessView(Texture& texture, int array_index, Texture::CubeFaces face, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(face);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::Make2DUnorderedAccessView(Texture& texture, int array_index, uint32_t slice, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(slice);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::MakeCubeUnorderedAccessView(Texture& texture, int array_index, int level)
+	{
+		KFL_UNUSED(array_index);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::Make3DUnorderedAccessView(Texture& texture, int array_index, uint32_t first_slice, uint32_t num_slices, int level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(first_slice);
+		KFL_UNUSED(num_slices);
+		return MakeSharedPtr<NullUnorderedAccessView>(texture.Width(level), texture.Height(level), texture.Format());
+	}
+
+	UnorderedAccessViewPtr NullRenderFactory::MakeGraphicsBufferUnorderedAccessView(GraphicsBuffer& gbuffer, ElementFormat pf)
+	{
+		return MakeSharedPtr<NullUnorderedAccessView>(gbuffer.Size() / NumFormatBytes(pf), 1, pf);
+	}
+
+	ShaderObjectPtr NullRenderFactory::MakeShaderObject()
+	{
+		return MakeSharedPtr<NullShaderObject>();
+	}
+
+	std::unique_ptr<RenderEngine> NullRenderFactory::DoMakeRenderEngine()
+	{
+		return MakeUniquePtr<NullRenderEngine>();
+	}
+
+	RenderStateObjectPtr NullRenderFactory::DoMakeRenderStateObject(RasterizerStateDesc const & rs_desc,
+		DepthStencilStateDesc const & dss_desc, BlendStateDesc const & bs_desc)
+	{
+		return MakeSharedPtr<NullRenderStateObject>(rs_desc, dss_desc, bs_desc);
+	}
+
+	SamplerStateObjectPtr NullRenderFactory::DoMakeSamplerStateObject(SamplerStateDesc const & desc)
+	{
+		return MakeSharedPtr<NullSamplerStateObject>(desc);
+	}
+
+	void NullRenderFactory::DoSuspend()
+	{
+	}
+
+	void NullRenderFactory::DoResume()
+	{
+	}
+}
+
+void MakeRenderFactory(std::unique_ptr<KlayGE::RenderFactory>& ptr)
+{
+	ptr = KlayGE::MakeUniquePtr<KlayGE::NullRenderFactory>();
+}
@@ -0,0 +1,118 @@
+/**
+ * @file NullRenderView.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Color.hpp>
+
+#include <KlayGE/Null/NullRenderView.hpp>
+
+namespace KlayGE
+{
+	NullRenderView::NullRenderView(uint32_t width, uint32_t height, ElementFormat pf)
+	{
+		width_ = width;
+		height_ = height;
+		pf_ = pf;
+	}
+
+	void NullRenderView::ClearColor(Color const & clr)
+	{
+		KFL_UNUSED(clr);
+	}
+
+	void NullRenderView::ClearDepth(float depth)
+	{
+		KFL_UNUSED(depth);
+	}
+
+	void NullRenderView::ClearStencil(int32_t stencil)
+	{
+		KFL_UNUSED(stencil);
+	}
+
+	void NullRenderView::ClearDepthStencil(float depth, int32_t stencil)
+	{
+		KFL_UNUSED(depth);
+		KFL_UNUSED(stencil);
+	}
+
+	void NullRenderView::Discard()
+	{
+	}
+
+	void NullRenderView::OnAttached(FrameBuffer& fb, uint32_t att)
+	{
+		KFL_UNUSED(fb);
+		KFL_UNUSED(att);
+	}
+
+	void NullRenderView::OnDetached(FrameBuffer& fb, uint32_t att)
+	{
+		KFL_UNUSED(fb);
+		KFL_UNUSED(att);
+	}
+
+
+	NullUnorderedAccessView::NullUnorderedAccessView(uint32_t width, uint32_t height, ElementFormat pf)
+	{
+		width_ = width;
+		height_ = height;
+		pf_ = pf;
+	}
+
+	void NullUnorderedAccessView::Clear(float4 const & val)
+	{
+		KFL_UNUSED(val);
+	}
+
+	void NullUnorderedAccessView::Clear(uint4 const & val)
+	{
+		KFL_UNUSED(val);
+	}
+
+	void NullUnorderedAccessView::Discard()
+	{
+	}
+
+	void NullUnorderedAccessView::OnAttached(FrameBuffer& fb, uint32_t att)
+	{
+		KFL_UNUSED(fb);
+		KFL_UNUSED(att);
+	}
+
+	void NullUnorderedAccessView::OnDetached(FrameBuffer& fb, uint32_t att)
+	{
+		KFL_UNUSED(fb);
+		KFL_UNUSED(att);
+	}
+}
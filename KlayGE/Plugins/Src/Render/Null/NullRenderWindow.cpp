@@ -0,0 +1,72 @@
+/**
+ * @file NullRenderWindow.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/Texture.hpp>
+
+#include <KlayGE/Null/NullRenderWindow.hpp>
+
+namespace KlayGE
+{
+	NullRenderWindow::NullRenderWindow(std::string const & name, RenderSettings const & settings)
+		: color_fmt_(settings.color_fmt),
+			ds_fmt_((settings.depth_stencil_fmt != EF_Unknown) ? settings.depth_stencil_fmt : EF_D24S8)
+	{
+		Convert(description_, name);
+		description_ = L"Null Render Window - " + description_;
+
+		this->CreateBuffers(settings.width, settings.height);
+	}
+
+	std::wstring const & NullRenderWindow::Description() const
+	{
+		return description_;
+	}
+
+	void NullRenderWindow::Resize(uint32_t width, uint32_t height)
+	{
+		this->CreateBuffers(width, height);
+	}
+
+	void NullRenderWindow::CreateBuffers(uint32_t width, uint32_t height)
+	{
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+
+		color_tex_ = rf.MakeTexture2D(width, height, 1, 1, color_fmt_, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
+		ds_tex_ = rf.MakeTexture2D(width, height, 1, 1, ds_fmt_, 1, 0, EAH_GPU_Read | EAH_GPU_Write, nullptr);
+
+		this->Attach(ATT_Color0, rf.Make2DRenderView(*color_tex_, 0, 1, 0));
+		this->Attach(ATT_DepthStencil, rf.Make2DDepthStencilRenderView(*ds_tex_, 0, 1, 0));
+	}
+}
@@ -0,0 +1,314 @@
+/**
+ * @file NullShaderObject.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/RenderEffect.hpp>
+
+#include <algorithm>
+
+#include <boost/lexical_cast.hpp>
+
+#include <KlayGE/Null/NullRenderEngine.hpp>
+#include <KlayGE/Null/NullShaderObject.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const REGISTER_SIZE = 16;
+
+	// Number of rows and bytes in a row, or 0 rows for the types can't be in a cbuffer
+	void NumericTypeShape(uint32_t type, uint32_t& rows, uint32_t& row_size)
+	{
+		rows = 1;
+		switch (type)
+		{
+		case REDT_bool:
+		case REDT_uint:
+		case REDT_int:
+		case REDT_float:
+			row_size = 4;
+			break;
+
+		case REDT_uint2:
+		case REDT_int2:
+		case REDT_float2:
+			row_size = 8;
+			break;
+
+		case REDT_uint3:
+		case REDT_int3:
+		case REDT_float3:
+			row_size = 12;
+			break;
+
+		case REDT_uint4:
+		case REDT_int4:
+		case REDT_float4:
+			row_size = 16;
+			break;
+
+		case REDT_float2x2:
+		case REDT_float2x3:
+		case REDT_float2x4:
+			rows = 2;
+			row_size = (type - REDT_float2x2 + 2) * 4;
+			break;
+
+		case REDT_float3x2:
+		case REDT_float3x3:
+		case REDT_float3x4:
+			rows = 3;
+			row_size = (type - REDT_float3x2 + 2) * 4;
+			break;
+
+		case REDT_float4x2:
+		case REDT_float4x3:
+		case REDT_float4x4:
+			rows = 4;
+			row_size = (type - REDT_float4x2 + 2) * 4;
+			break;
+
+		default:
+			rows = 0;
+			row_size = 0;
+			break;
+		}
+	}
+
+	// The array size could be a number or a macro of the effect
+	uint32_t ArrayLength(RenderEffect const & effect, std::string const & array_size)
+	{
+		std::string value = array_size;
+		for (uint32_t i = 0; i < effect.NumMacros(); ++ i)
+		{
+			auto const & macro = effect.MacroByIndex(i);
+			if (macro.first == array_size)
+			{
+				value = macro.second;
+				break;
+			}
+		}
+
+		try
+		{
+			return std::max(boost::lexical_cast<uint32_t>(value), 1U);
+		}
+		catch (boost::bad_lexical_cast const &)
+		{
+			return 1;
+		}
+	}
+
+	// Packs the parameters the way fxc does: a variable never straddles a register, and matrices and arrays elements
+	// start at a new one. Matrices are row major.
+	void LayoutCBuffer(RenderEffect const & effect, RenderEffectConstantBuffer& cbuff)
+	{
+		struct Binding
+		{
+			RenderEffectParameter* param;
+			uint32_t offset;
+			uint32_t stride;
+		};
+		std::vector<Binding> bindings;
+
+		uint32_t offset = 0;
+		for (uint32_t i = 0; i < cbuff.NumParameters(); ++ i)
+		{
+			RenderEffectParameter* param = effect.ParameterByIndex(cbuff.ParameterIndex(i));
+
+			uint32_t rows;
+			uint32_t row_size;
+			NumericTypeShape(param->Type(), rows, row_size);
+			if (0 == rows)
+			{
+				continue;
+			}
+
+			uint32_t const elem_size = (rows - 1) * REGISTER_SIZE + row_size;
+			uint32_t size;
+			uint32_t stride;
+			if (param->ArraySize())
+			{
+				uint32_t const elem_stride = (elem_size + REGISTER_SIZE - 1) / REGISTER_SIZE * REGISTER_SIZE;
+				size = (ArrayLength(effect, *param->ArraySize()) - 1) * elem_stride + elem_size;
+				stride = elem_stride;
+			}
+			else
+			{
+				size = elem_size;
+				stride = (REDT_float4x4 == param->Type()) ? REGISTER_SIZE : 4;
+			}
+
+			if ((rows > 1) || param->ArraySize() || (offset % REGISTER_SIZE + size > REGISTER_SIZE))
+			{
+				offset = (offset + REGISTER_SIZE - 1) / REGISTER_SIZE * REGISTER_SIZE;
+			}
+
+			bindings.push_back({ param, offset, stride });
+			offset += size;
+		}
+
+		uint32_t const cbuff_size = (offset + REGISTER_SIZE - 1) / REGISTER_SIZE * REGISTER_SIZE;
+		if (cbuff_size > 0)
+		{
+			cbuff.Resize(cbuff_size);
+			for (auto const & binding : bindings)
+			{
+				binding.param->BindToCBuffer(cbuff, binding.offset, binding.stride);
+			}
+		}
+	}
+}
+
+namespace KlayGE
+{
+	NullShaderObject::NullShaderObject()
+	{
+		is_validate_ = true;
+		is_shader_validate_.fill(true);
+		cs_block_size_x_ = cs_block_size_y_ = cs_block_size_z_ = 1;
+	}
+
+	bool NullShaderObject::AttachNativeShader(ShaderType type, RenderEffect const & effect,
+			std::array<uint32_t, ST_NumShaderTypes> const & shader_desc_ids, std::vector<uint8_t> const & native_shader_block)
+	{
+		KFL_UNUSED(effect);
+		KFL_UNUSED(shader_desc_ids);
+		KFL_UNUSED(native_shader_block);
+
+		is_shader_validate_[type] = true;
+		if ((ST_HullShader == type) || (ST_DomainShader == type))
+		{
+			has_tessellation_ = true;
+		}
+		return true;
+	}
+
+	// There is no native code, so nothing is in the stream
+	bool NullShaderObject::StreamIn(ResIdentifierPtr const & res, ShaderType type, RenderEffect const & effect,
+			std::array<uint32_t, ST_NumShaderTypes> const & shader_desc_ids)
+	{
+		KFL_UNUSED(res);
+
+		return this->AttachNativeShader(type, effect, shader_desc_ids, std::vector<uint8_t>());
+	}
+
+	void NullShaderObject::StreamOut(std::ostream& os, ShaderType type)
+	{
+		KFL_UNUSED(os);
+		KFL_UNUSED(type);
+	}
+
+	void NullShaderObject::AttachShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, std::array<uint32_t, ST_NumShaderTypes> const & shader_desc_ids)
+	{
+		KFL_UNUSED(tech);
+		KFL_UNUSED(pass);
+
+		this->AttachNativeShader(type, effect, shader_desc_ids, std::vector<uint8_t>());
+	}
+
+	void NullShaderObject::AttachShader(ShaderType type, RenderEffect const & effect,
+			RenderTechnique const & tech, RenderPass const & pass, ShaderObjectPtr const & shared_so)
+	{
+		KFL_UNUSED(effect);
+		KFL_UNUSED(tech);
+		KFL_UNUSED(pass);
+
+		if (shared_so)
+		{
+			is_shader_validate_[type] = shared_so->ShaderValidate(type);
+			if ((ST_HullShader == type) || (ST_DomainShader == type))
+			{
+				has_tessellation_ = true;
+			}
+		}
+	}
+
+	void NullShaderObject::LinkShaders(RenderEffect const & effect)
+	{
+		is_validate_ = true;
+		for (size_t type = 0; type < ST_NumShaderTypes; ++ type)
+		{
+			is_validate_ &= is_shader_validate_[type];
+		}
+
+		this->AttachCBuffers(effect);
+	}
+
+	ShaderObjectPtr NullShaderObject::Clone(RenderEffect const & effect)
+	{
+		auto ret = MakeSharedPtr<NullShaderObject>();
+		ret->is_validate_ = is_validate_;
+		ret->is_shader_validate_ = is_shader_validate_;
+		ret->has_discard_ = has_discard_;
+		ret->has_tessellation_ = has_tessellation_;
+		ret->AttachCBuffers(effect);
+		return ret;
+	}
+
+	void NullShaderObject::Bind()
+	{
+		auto& re = *checked_cast<NullRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
+		re.OnShaderBind();
+
+		for (auto cbuff : all_cbuffs_)
+		{
+			cbuff->Update();
+		}
+	}
+
+	void NullShaderObject::Unbind()
+	{
+	}
+
+	// Without reflection every cbuffer of the effect is treated as used by the pass
+	void NullShaderObject::AttachCBuffers(RenderEffect const & effect)
+	{
+		all_cbuffs_.clear();
+		for (uint32_t i = 0; i < effect.NumCBuffers(); ++ i)
+		{
+			RenderEffectConstantBuffer* cbuff = effect.CBufferByIndex(i);
+			if (!cbuff->HWBuff())
+			{
+				LayoutCBuffer(effect, *cbuff);
+			}
+			if (cbuff->HWBuff())
+			{
+				all_cbuffs_.push_back(cbuff);
+			}
+		}
+	}
+}
@@ -0,0 +1,413 @@
+/**
+ * @file NullTexture.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/RenderFactory.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#include <KlayGE/Null/NullRenderEngine.hpp>
+#include <KlayGE/Null/NullTexture.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	void AddUploadedBytes(uint64_t bytes)
+	{
+		auto& re = *checked_cast<NullRenderEngine*>(&Context::Instance().RenderFactoryInstance().RenderEngineInstance());
+		re.OnBytesUploaded(bytes);
+	}
+}
+
+namespace KlayGE
+{
+	NullTexture::NullTexture(TextureType type, uint32_t width, uint32_t height, uint32_t depth, uint32_t num_mip_maps,
+			uint32_t array_size, ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+		: Texture(type, sample_count, sample_quality, access_hint),
+			width_(width), height_(height), depth_(depth)
+	{
+		if (0 == num_mip_maps)
+		{
+			num_mip_maps = 1;
+			uint32_t w = width;
+			uint32_t h = height;
+			uint32_t d = depth;
+			while ((w > 1) || (h > 1) || (d > 1))
+			{
+				++ num_mip_maps;
+
+				w = std::max<uint32_t>(1U, w / 2);
+				h = std::max<uint32_t>(1U, h / 2);
+				d = std::max<uint32_t>(1U, d / 2);
+			}
+		}
+
+		num_mip_maps_ = num_mip_maps;
+		array_size_ = array_size;
+		format_ = format;
+	}
+
+	std::wstring const & NullTexture::Name() const
+	{
+		static const std::wstring name(L"Null Texture");
+		return name;
+	}
+
+	uint32_t NullTexture::Width(uint32_t level) const
+	{
+		BOOST_ASSERT(level < num_mip_maps_);
+		return std::max<uint32_t>(1U, width_ >> level);
+	}
+
+	uint32_t NullTexture::Height(uint32_t level) const
+	{
+		BOOST_ASSERT(level < num_mip_maps_);
+		return std::max<uint32_t>(1U, height_ >> level);
+	}
+
+	uint32_t NullTexture::Depth(uint32_t level) const
+	{
+		BOOST_ASSERT(level < num_mip_maps_);
+		return std::max<uint32_t>(1U, depth_ >> level);
+	}
+
+	void NullTexture::CopyToTexture(Texture& target)
+	{
+		BOOST_ASSERT(type_ == target.Type());
+
+		uint32_t const num_faces = (TT_Cube == type_) ? 6 : 1;
+		uint32_t const num_levels = std::min(num_mip_maps_, target.NumMipMaps());
+		uint32_t const num_arrays = std::min(array_size_, target.ArraySize());
+		for (uint32_t index = 0; index < num_arrays; ++ index)
+		{
+			for (uint32_t face = 0; face < num_faces; ++ face)
+			{
+				for (uint32_t level = 0; level < num_levels; ++ level)
+				{
+					this->CopyToSub(target, (index * num_faces + face) * target.NumMipMaps() + level, level, 0, 0, 0,
+						this->SubresourceIndex(index, face, level), level, 0, 0, 0,
+						this->Width(level), this->Height(level), this->Depth(level));
+				}
+			}
+		}
+	}
+
+	void NullTexture::CopyToSubTexture1D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_width,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_width)
+	{
+		if (dst_width == src_width)
+		{
+			this->CopyToSub(target, dst_array_index * target.NumMipMaps() + dst_level, dst_level, dst_x_offset, 0, 0,
+				this->SubresourceIndex(src_array_index, 0, src_level), src_level, src_x_offset, 0, 0,
+				src_width, 1, 1);
+		}
+	}
+
+	void NullTexture::CopyToSubTexture2D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_width, uint32_t dst_height,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_width, uint32_t src_height)
+	{
+		if ((dst_width == src_width) && (dst_height == src_height))
+		{
+			this->CopyToSub(target, dst_array_index * target.NumMipMaps() + dst_level, dst_level, dst_x_offset, dst_y_offset, 0,
+				this->SubresourceIndex(src_array_index, 0, src_level), src_level, src_x_offset, src_y_offset, 0,
+				src_width, src_height, 1);
+		}
+	}
+
+	void NullTexture::CopyToSubTexture3D(Texture& target,
+			uint32_t dst_array_index, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_z_offset, uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
+			uint32_t src_array_index, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_z_offset, uint32_t src_width, uint32_t src_height, uint32_t src_depth)
+	{
+		if ((dst_width == src_width) && (dst_height == src_height) && (dst_depth == src_depth))
+		{
+			this->CopyToSub(target, dst_array_index * target.NumMipMaps() + dst_level, dst_level, dst_x_offset, dst_y_offset, dst_z_offset,
+				this->SubresourceIndex(src_array_index, 0, src_level), src_level, src_x_offset, src_y_offset, src_z_offset,
+				src_width, src_height, src_depth);
+		}
+	}
+
+	void NullTexture::CopyToSubTextureCube(Texture& target,
+			uint32_t dst_array_index, CubeFaces dst_face, uint32_t dst_level, uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_width, uint32_t dst_height,
+			uint32_t src_array_index, CubeFaces src_face, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_width, uint32_t src_height)
+	{
+		if ((dst_width == src_width) && (dst_height == src_height))
+		{
+			uint32_t const dst_faces = (TT_Cube == target.Type()) ? 6 : 1;
+			uint32_t const dst_sub_res = (dst_array_index * dst_faces + (dst_faces > 1 ? dst_face : 0)) * target.NumMipMaps() + dst_level;
+			this->CopyToSub(target, dst_sub_res, dst_level, dst_x_offset, dst_y_offset, 0,
+				this->SubresourceIndex(src_array_index, src_face, src_level), src_level, src_x_offset, src_y_offset, 0,
+				src_width, src_height, 1);
+		}
+	}
+
+	void NullTexture::BuildMipSubLevels()
+	{
+	}
+
+	void NullTexture::Map1D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t width,
+			void*& data)
+	{
+		uint32_t row_pitch;
+		uint32_t slice_pitch;
+		this->Map(this->SubresourceIndex(array_index, 0, level), level, tma, x_offset, 0, 0, width, 1, 1,
+			data, row_pitch, slice_pitch);
+	}
+
+	void NullTexture::Map2D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void*& data, uint32_t& row_pitch)
+	{
+		uint32_t slice_pitch;
+		this->Map(this->SubresourceIndex(array_index, 0, level), level, tma, x_offset, y_offset, 0, width, height, 1,
+			data, row_pitch, slice_pitch);
+	}
+
+	void NullTexture::Map3D(uint32_t array_index, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth,
+			void*& data, uint32_t& row_pitch, uint32_t& slice_pitch)
+	{
+		this->Map(this->SubresourceIndex(array_index, 0, level), level, tma, x_offset, y_offset, z_offset, width, height, depth,
+			data, row_pitch, slice_pitch);
+	}
+
+	void NullTexture::MapCube(uint32_t array_index, CubeFaces face, uint32_t level, TextureMapAccess tma,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void*& data, uint32_t& row_pitch)
+	{
+		uint32_t slice_pitch;
+		this->Map(this->SubresourceIndex(array_index, face, level), level, tma, x_offset, y_offset, 0, width, height, 1,
+			data, row_pitch, slice_pitch);
+	}
+
+	void NullTexture::Unmap1D(uint32_t array_index, uint32_t level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(level);
+	}
+
+	void NullTexture::Unmap2D(uint32_t array_index, uint32_t level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(level);
+	}
+
+	void NullTexture::Unmap3D(uint32_t array_index, uint32_t level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(level);
+	}
+
+	void NullTexture::UnmapCube(uint32_t array_index, CubeFaces face, uint32_t level)
+	{
+		KFL_UNUSED(array_index);
+		KFL_UNUSED(face);
+		KFL_UNUSED(level);
+	}
+
+	void NullTexture::CreateHWResource(ElementInitData const * init_data)
+	{
+		uint32_t const num_faces = (TT_Cube == type_) ? 6 : 1;
+		subres_data_.resize(array_size_ * num_faces * num_mip_maps_);
+		for (uint32_t index = 0; index < array_size_; ++ index)
+		{
+			for (uint32_t face = 0; face < num_faces; ++ face)
+			{
+				for (uint32_t level = 0; level < num_mip_maps_; ++ level)
+				{
+					uint32_t const sub_res = this->SubresourceIndex(index, face, level);
+					subres_data_[sub_res].assign(this->SlicePitch(level) * this->Depth(level), 0);
+					if (init_data != nullptr)
+					{
+						this->Update(sub_res, level, 0, 0, 0, this->Width(level), this->Height(level), this->Depth(level),
+							init_data[sub_res].data, init_data[sub_res].row_pitch, init_data[sub_res].slice_pitch);
+						AddUploadedBytes(this->RegionBytes(this->Width(level), this->Height(level), this->Depth(level)));
+					}
+				}
+			}
+		}
+	}
+
+	void NullTexture::DeleteHWResource()
+	{
+		subres_data_.clear();
+	}
+
+	bool NullTexture::HWResourceReady() const
+	{
+		return !subres_data_.empty();
+	}
+
+	void NullTexture::UpdateSubresource1D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t width,
+			void const * data)
+	{
+		uint32_t const row_pitch = this->RowPitch(level);
+		this->Update(this->SubresourceIndex(array_index, 0, level), level, x_offset, 0, 0, width, 1, 1,
+			data, row_pitch, row_pitch);
+		AddUploadedBytes(this->RegionBytes(width, 1, 1));
+	}
+
+	void NullTexture::UpdateSubresource2D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void const * data, uint32_t row_pitch)
+	{
+		this->Update(this->SubresourceIndex(array_index, 0, level), level, x_offset, y_offset, 0, width, height, 1,
+			data, row_pitch, row_pitch * height);
+		AddUploadedBytes(this->RegionBytes(width, height, 1));
+	}
+
+	void NullTexture::UpdateSubresource3D(uint32_t array_index, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth,
+			void const * data, uint32_t row_pitch, uint32_t slice_pitch)
+	{
+		this->Update(this->SubresourceIndex(array_index, 0, level), level, x_offset, y_offset, z_offset, width, height, depth,
+			data, row_pitch, slice_pitch);
+		AddUploadedBytes(this->RegionBytes(width, height, depth));
+	}
+
+	void NullTexture::UpdateSubresourceCube(uint32_t array_index, CubeFaces face, uint32_t level,
+			uint32_t x_offset, uint32_t y_offset, uint32_t width, uint32_t height,
+			void const * data, uint32_t row_pitch)
+	{
+		this->Update(this->SubresourceIndex(array_index, face, level), level, x_offset, y_offset, 0, width, height, 1,
+			data, row_pitch, row_pitch * height);
+		AddUploadedBytes(this->RegionBytes(width, height, 1));
+	}
+
+	uint32_t NullTexture::SubresourceIndex(uint32_t array_index, uint32_t face, uint32_t level) const
+	{
+		uint32_t const num_faces = (TT_Cube == type_) ? 6 : 1;
+		return (array_index * num_faces + face) * num_mip_maps_ + level;
+	}
+
+	uint32_t NullTexture::RowPitch(uint32_t level) const
+	{
+		if (IsCompressedFormat(format_))
+		{
+			return (this->Width(level) + 3) / 4 * NumFormatBytes(format_) * 4;
+		}
+		else
+		{
+			return this->Width(level) * NumFormatBytes(format_);
+		}
+	}
+
+	uint32_t NullTexture::SlicePitch(uint32_t level) const
+	{
+		uint32_t const num_rows = IsCompressedFormat(format_) ? (this->Height(level) + 3) / 4 : this->Height(level);
+		return this->RowPitch(level) * num_rows;
+	}
+
+	uint32_t NullTexture::Offset(uint32_t level, uint32_t x, uint32_t y, uint32_t z) const
+	{
+		if (IsCompressedFormat(format_))
+		{
+			return z * this->SlicePitch(level) + y / 4 * this->RowPitch(level) + x / 4 * NumFormatBytes(format_) * 4;
+		}
+		else
+		{
+			return z * this->SlicePitch(level) + y * this->RowPitch(level) + x * NumFormatBytes(format_);
+		}
+	}
+
+	uint32_t NullTexture::RegionBytes(uint32_t width, uint32_t height, uint32_t depth) const
+	{
+		if (IsCompressedFormat(format_))
+		{
+			return (width + 3) / 4 * ((height + 3) / 4) * depth * NumFormatBytes(format_) * 4;
+		}
+		else
+		{
+			return width * height * depth * NumFormatBytes(format_);
+		}
+	}
+
+	void NullTexture::Map(uint32_t sub_res, uint32_t level, TextureMapAccess tma, uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth, void*& data, uint32_t& row_pitch, uint32_t& slice_pitch)
+	{
+		BOOST_ASSERT(sub_res < subres_data_.size());
+
+		data = &subres_data_[sub_res][this->Offset(level, x_offset, y_offset, z_offset)];
+		row_pitch = this->RowPitch(level);
+		slice_pitch = this->SlicePitch(level);
+
+		if (tma != TMA_Read_Only)
+		{
+			AddUploadedBytes(this->RegionBytes(width, height, depth));
+		}
+	}
+
+	void NullTexture::Update(uint32_t sub_res, uint32_t level, uint32_t x_offset, uint32_t y_offset, uint32_t z_offset,
+			uint32_t width, uint32_t height, uint32_t depth, void const * data, uint32_t row_pitch, uint32_t slice_pitch)
+	{
+		BOOST_ASSERT(sub_res < subres_data_.size());
+
+		uint32_t const row_bytes = this->RegionBytes(width, 1, 1);
+		uint32_t const num_rows = IsCompressedFormat(format_) ? (height + 3) / 4 : height;
+
+		uint8_t const * src = static_cast<uint8_t const *>(data);
+		for (uint32_t z = 0; z < depth; ++ z)
+		{
+			for (uint32_t y = 0; y < num_rows; ++ y)
+			{
+				uint8_t* dst = &subres_data_[sub_res][this->Offset(level, x_offset, y_offset, z_offset + z)]
+					+ y * this->RowPitch(level);
+				std::memcpy(dst, src + z * slice_pitch + y * row_pitch, row_bytes);
+			}
+		}
+	}
+
+	void NullTexture::CopyToSub(Texture& target, uint32_t dst_sub_res, uint32_t dst_level,
+			uint32_t dst_x_offset, uint32_t dst_y_offset, uint32_t dst_z_offset,
+			uint32_t src_sub_res, uint32_t src_level, uint32_t src_x_offset, uint32_t src_y_offset, uint32_t src_z_offset,
+			uint32_t width, uint32_t height, uint32_t depth)
+	{
+		if ((format_ != target.Format()) || subres_data_.empty())
+		{
+			return;
+		}
+
+		auto& dst_tex = *checked_cast<NullTexture*>(&target);
+		uint32_t const row_pitch = this->RowPitch(src_level);
+		uint32_t const slice_pitch = this->SlicePitch(src_level);
+		dst_tex.Update(dst_sub_res, dst_level, dst_x_offset, dst_y_offset, dst_z_offset, width, height, depth,
+			&subres_data_[src_sub_res][this->Offset(src_level, src_x_offset, src_y_offset, src_z_offset)], row_pitch, slice_pitch);
+	}
+}
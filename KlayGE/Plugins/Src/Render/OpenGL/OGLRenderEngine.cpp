@@ -268,6 +268,21 @@ namespace KlayGE
 		this->FillRenderDeviceCaps();
 		this->InitRenderStates();
 
+		{
+			GLint num = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num);
+			if (num > 0)
+			{
+				// GL_VERSION carries the driver version, so the binaries are dropped after a driver update
+				std::string identity = reinterpret_cast<char const *>(glGetString(GL_VENDOR));
+				identity += '/';
+				identity += reinterpret_cast<char const *>(glGetString(GL_RENDERER));
+				identity += '/';
+				identity += reinterpret_cast<char const *>(glGetString(GL_VERSION));
+				Context::Instance().RenderFactoryInstance().PipelineCacheInstance().Open(native_shader_platform_name_, identity);
+			}
+		}
+
 #ifdef KLAYGE_PLATFORM_DARWIN
 		Context::Instance().AppInstance().MainWnd()->BindListeners();
 #endif
@@ -362,6 +377,7 @@ namespace KlayGE
 			binded_textures_.resize(binded_targets_.size(), 0xFFFFFFFF);
 		}
 
+		uint32_t const num_slots = static_cast<uint32_t>(count);
 		bool dirty = force;
 		if (!dirty)
 		{
@@ -383,6 +399,8 @@ namespace KlayGE
 			dirty = (count > 0);
 		}
 
+		uint32_t const num_issued = dirty ? static_cast<uint32_t>(count) : 0;
+		binding_cache_.Count(BindingCache::BT_ShaderResource, num_issued, num_slots - num_issued);
 		if (dirty)
 		{
 			if (glloader_GL_VERSION_4_4() || glloader_GL_ARB_multi_bind())
@@ -427,6 +445,11 @@ namespace KlayGE
 			dirty = (memcmp(&binded[first], buffers, count * sizeof(buffers[0])) != 0);
 		}
 
+		if (GL_UNIFORM_BUFFER == target)
+		{
+			uint32_t const num_slots = static_cast<uint32_t>(count);
+			binding_cache_.Count(BindingCache::BT_ConstantBuffer, dirty ? num_slots : 0, dirty ? 0 : num_slots);
+		}
 		if (dirty)
 		{
 			if (glloader_GL_VERSION_4_4() || glloader_GL_ARB_multi_bind())
@@ -527,7 +550,9 @@ namespace KlayGE
 
 	void OGLRenderEngine::UseProgram(GLuint program)
 	{
-		if (program != cur_program_)
+		bool const changed = (program != cur_program_);
+		binding_cache_.Count(BindingCache::BT_Shader, changed);
+		if (changed)
 		{
 			glUseProgram(program);
 			cur_program_ = program;
@@ -1612,6 +1637,7 @@ namespace KlayGE
 			caps_.render_to_texture_array_support = false;
 		}
 		caps_.load_from_buffer_support = true;
+		caps_.cbuffer_partial_update_support = true;
 
 		caps_.gs_support = true;
 
@@ -335,7 +335,6 @@ namespace KlayGE
 			}
 
 			this->FillTFBVaryings(sd);
-			this->AttachGLSL(type);
 
 			ret = is_shader_validate_[type];
 		}
@@ -861,7 +860,6 @@ namespace KlayGE
 		if (is_shader_validate_[type])
 		{
 			this->FillTFBVaryings(sd);
-			this->AttachGLSL(type);
 		}
 	}
 
@@ -925,13 +923,71 @@ namespace KlayGE
 					}
 				}
 			}
-
-			this->AttachGLSL(type);
 		}
 	}
 
 	void OGLShaderObject::LinkShaders(RenderEffect const & effect)
 	{
+		PipelineCache& pipeline_cache = Context::Instance().RenderFactoryInstance().PipelineCacheInstance();
+
+		// 64-bit on all the platforms, as it's stored in the cache file
+		uint64_t source_hash = 0;
+		for (size_t type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+		{
+			if ((*glsl_srcs_)[type])
+			{
+				HashCombineImpl(source_hash, static_cast<uint64_t>(type));
+				for (char ch : *(*glsl_srcs_)[type])
+				{
+					HashCombineImpl(source_hash, static_cast<uint64_t>(ch));
+				}
+			}
+		}
+		if (glsl_tfb_varyings_)
+		{
+			for (auto const & varying : *glsl_tfb_varyings_)
+			{
+				for (char ch : varying)
+				{
+					HashCombineImpl(source_hash, static_cast<uint64_t>(ch));
+				}
+			}
+		}
+		HashCombineImpl(source_hash, static_cast<uint64_t>(tfb_separate_attribs_));
+
+		glProgramParameteri(glsl_program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+		// The shaders are compiled only if the pipeline cache doesn't have a binary the driver accepts
+		bool from_cache = false;
+		if (pipeline_cache.IsOpen())
+		{
+			uint32_t format;
+			std::vector<uint8_t> binary;
+			if (pipeline_cache.FindProgram(pipeline_key_, source_hash, format, binary))
+			{
+				glProgramBinary(glsl_program_, format, &binary[0], static_cast<GLsizei>(binary.size()));
+
+				GLint linked = false;
+				glGetProgramiv(glsl_program_, GL_LINK_STATUS, &linked);
+				if (linked)
+				{
+					glsl_bin_format_ = format;
+					glsl_bin_program_ = MakeSharedPtr<std::vector<uint8_t>>(std::move(binary));
+					from_cache = true;
+				}
+			}
+		}
+		if (!from_cache)
+		{
+			for (size_t type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
+			{
+				if (is_shader_validate_[type] && (*glsl_srcs_)[type])
+				{
+					this->AttachGLSL(static_cast<uint32_t>(type));
+				}
+			}
+		}
+
 		is_validate_ = true;
 		for (size_t type = 0; type < ShaderObject::ST_NumShaderTypes; ++ type)
 		{
@@ -943,12 +999,13 @@ namespace KlayGE
 
 		if (is_validate_)
 		{
-			glProgramParameteri(glsl_program_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
-
-			this->LinkGLSL();
+			if (!from_cache)
+			{
+				this->LinkGLSL();
+			}
 			this->AttachUBOs(effect);
 
-			if (is_validate_)
+			if (is_validate_ && !from_cache)
 			{
 				GLint num = 0;
 				glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num);
@@ -958,6 +1015,8 @@ namespace KlayGE
 					glGetProgramiv(glsl_program_, GL_PROGRAM_BINARY_LENGTH, &len);
 					glsl_bin_program_ = MakeSharedPtr<std::vector<uint8_t>>(len);
 					glGetProgramBinary(glsl_program_, len, nullptr, &glsl_bin_format_, &(*glsl_bin_program_)[0]);
+
+					pipeline_cache.StoreProgram(pipeline_key_, source_hash, glsl_bin_format_, *glsl_bin_program_);
 				}
 			}
 
@@ -1059,8 +1118,8 @@ namespace KlayGE
 		for (size_t i = 0; i < tex_sampler_binds_.size(); ++ i)
 		{
 			std::get<0>(ret->tex_sampler_binds_[i]) = std::get<0>(tex_sampler_binds_[i]);
-			std::get<1>(ret->tex_sampler_binds_[i]) = effect.ParameterByName(std::get<1>(tex_sampler_binds_[i])->Name());
-			std::get<2>(ret->tex_sampler_binds_[i]) = effect.ParameterByName(std::get<2>(tex_sampler_binds_[i])->Name());
+			std::get<1>(ret->tex_sampler_binds_[i]) = effect.ParameterByName(EffectNameId(std::get<1>(tex_sampler_binds_[i])->NameHash()));
+			std::get<2>(ret->tex_sampler_binds_[i]) = effect.ParameterByName(EffectNameId(std::get<2>(tex_sampler_binds_[i])->NameHash()));
 			std::get<3>(ret->tex_sampler_binds_[i]) = std::get<3>(tex_sampler_binds_[i]);
 		}
 
@@ -1131,7 +1190,7 @@ namespace KlayGE
 			{
 				if (pb.param)
 				{
-					RenderEffectParameter* p = effect.ParameterByName(pb.param->Name());
+					RenderEffectParameter* p = effect.ParameterByName(EffectNameId(pb.param->NameHash()));
 					BOOST_ASSERT(REDT_buffer == p->Type());
 
 					parameter_bind_t new_pb;
@@ -1521,9 +1580,11 @@ namespace KlayGE
 			pb.func();
 		}
 
+		// A cbuffer of a cloned effect gets its own hardware buffer when first written
 		for (size_t i = 0; i < all_cbuffs_.size(); ++ i)
 		{
 			all_cbuffs_[i]->Update();
+			gl_bind_cbuffs_[i] = checked_cast<OGLGraphicsBuffer*>(all_cbuffs_[i]->HWBuff().get())->GLvbo();
 		}
 
 		if (!gl_bind_cbuffs_.empty())
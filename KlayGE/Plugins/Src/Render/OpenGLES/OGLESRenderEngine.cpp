@@ -234,6 +234,21 @@ namespace KlayGE
 		this->FillRenderDeviceCaps();
 		this->InitRenderStates();
 
+		{
+			GLint num = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num);
+			if (num > 0)
+			{
+				// GL_VERSION carries the driver version, so the binaries are dropped after a driver update
+				std::string identity = reinterpret_cast<char const *>(glGetString(GL_VENDOR));
+				identity += '/';
+				identity += reinterpret_cast<char const *>(glGetString(GL_RENDERER));
+				identity += '/';
+				identity += reinterpret_cast<char const *>(glGetString(GL_VERSION));
+				Context::Instance().RenderFactoryInstance().PipelineCacheInstance().Open(native_shader_platform_name_, identity);
+			}
+		}
+
 #ifdef KLAYGE_PLATFORM_DARWIN
 		Context::Instance().AppInstance().MainWnd()->BindListeners();
 #endif
@@ -1616,6 +1631,7 @@ namespace KlayGE
 		{
 			caps_.load_from_buffer_support = false;
 		}
+		caps_.cbuffer_partial_update_support = true;
 
 		caps_.gs_support = glloader_GLES_VERSION_3_2() || glloader_GLES_OES_geometry_shader()
 			|| glloader_GLES_EXT_geometry_shader() || glloader_GLES_ANDROID_extension_pack_es31a();
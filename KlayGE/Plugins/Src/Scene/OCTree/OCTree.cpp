@@ -36,6 +36,7 @@
 
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
 #include <boost/assert.hpp>
 
 #ifdef KLAYGE_DRAW_NODES
@@ -59,6 +60,11 @@ namespace
 		{
 		}
 
+		bool Recordable() const
+		{
+			return false;
+		}
+
 		void Render()
 		{
 			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -98,6 +104,179 @@ namespace
 
 namespace KlayGE
 {
+	// A copy of the tree for the spatial queries. Objects not in the tree are tested one by one.
+	class OCTree::QuerySnapshot : public SceneQuerySnapshot
+	{
+		struct Node
+		{
+			AABBox bb;
+			int first_child_index;
+			std::vector<uint32_t> entry_indices;
+		};
+
+	public:
+		QuerySnapshot(std::vector<SceneObjectPtr> const & scene_objs, std::vector<octree_node_t> const & octree)
+			: SceneQuerySnapshot(scene_objs)
+		{
+			std::unordered_map<SceneObject const *, uint32_t> entry_map;
+			for (uint32_t i = 0; i < entries_.size(); ++ i)
+			{
+				entry_map.emplace(entries_[i].obj.get(), i);
+			}
+
+			std::vector<bool> in_tree(entries_.size(), false);
+			nodes_.resize(octree.size());
+			for (size_t i = 0; i < octree.size(); ++ i)
+			{
+				nodes_[i].bb = octree[i].bb;
+				nodes_[i].first_child_index = octree[i].first_child_index;
+				for (auto so : octree[i].obj_ptrs)
+				{
+					auto iter = entry_map.find(so);
+					if (iter != entry_map.end())
+					{
+						nodes_[i].entry_indices.push_back(iter->second);
+						in_tree[iter->second] = true;
+					}
+				}
+			}
+
+			for (uint32_t i = 0; i < entries_.size(); ++ i)
+			{
+				if (!in_tree[i])
+				{
+					loose_entries_.push_back(i);
+				}
+			}
+		}
+
+	protected:
+		virtual void DoRayCast(SceneRay const * rays, uint32_t num_rays, SceneQueryFilter const & filter,
+			SceneRayHit* hits) const override
+		{
+			std::vector<uint32_t> ray_indices(num_rays);
+			for (uint32_t i = 0; i < num_rays; ++ i)
+			{
+				ray_indices[i] = i;
+			}
+			for (auto ei : loose_entries_)
+			{
+				this->RayCastEntry(entries_[ei], rays, &ray_indices[0], num_rays, filter, hits);
+			}
+			if (!nodes_.empty())
+			{
+				this->RayCastNode(0, rays, ray_indices, filter, hits);
+			}
+		}
+
+		virtual void DoQuery(BoundTest const & test, SceneQueryFilter const & filter,
+			std::vector<SceneObjectPtr>& objs) const override
+		{
+			std::vector<bool> visited(entries_.size(), false);
+			for (auto ei : loose_entries_)
+			{
+				visited[ei] = true;
+				this->QueryEntry(ei, true, test, filter, objs);
+			}
+			if (!nodes_.empty())
+			{
+				this->QueryNode(0, false, test, filter, visited, objs);
+			}
+		}
+
+	private:
+		// Rays only go into a node if it's closer than their current hit, and children are visited front to back
+		void RayCastNode(size_t index, SceneRay const * rays, std::vector<uint32_t> const & ray_indices,
+			SceneQueryFilter const & filter, SceneRayHit* hits) const
+		{
+			Node const & node = nodes_[index];
+
+			std::vector<uint32_t> active;
+			active.reserve(ray_indices.size());
+			for (auto ri : ray_indices)
+			{
+				float const dist = RayAABBDistance(rays[ri], node.bb);
+				if ((dist >= 0) && (dist < hits[ri].dist))
+				{
+					active.push_back(ri);
+				}
+			}
+			if (active.empty())
+			{
+				return;
+			}
+
+			for (auto ei : node.entry_indices)
+			{
+				this->RayCastEntry(entries_[ei], rays, &active[0], static_cast<uint32_t>(active.size()), filter, hits);
+			}
+
+			if (node.first_child_index != -1)
+			{
+				SceneRay const & lead_ray = rays[active[0]];
+				std::pair<float, int> children[8];
+				for (int i = 0; i < 8; ++ i)
+				{
+					float const dist = RayAABBDistance(lead_ray, nodes_[node.first_child_index + i].bb);
+					children[i] = std::make_pair((dist >= 0) ? dist : lead_ray.max_dist, node.first_child_index + i);
+				}
+				std::sort(children, children + 8);
+				for (int i = 0; i < 8; ++ i)
+				{
+					this->RayCastNode(children[i].second, rays, active, filter, hits);
+				}
+			}
+		}
+
+		// Nodes fully inside the query volume accept their objects without testing them
+		void QueryNode(size_t index, bool inside, BoundTest const & test, SceneQueryFilter const & filter,
+			std::vector<bool>& visited, std::vector<SceneObjectPtr>& objs) const
+		{
+			Node const & node = nodes_[index];
+			if (!inside)
+			{
+				BoundOverlap const bo = test(node.bb);
+				if (BO_No == bo)
+				{
+					return;
+				}
+				inside = (BO_Yes == bo);
+			}
+
+			for (auto ei : node.entry_indices)
+			{
+				if (!visited[ei])
+				{
+					visited[ei] = true;
+					this->QueryEntry(ei, !inside, test, filter, objs);
+				}
+			}
+
+			if (node.first_child_index != -1)
+			{
+				for (int i = 0; i < 8; ++ i)
+				{
+					this->QueryNode(node.first_child_index + i, inside, test, filter, visited, objs);
+				}
+			}
+		}
+
+		void QueryEntry(uint32_t index, bool need_test, BoundTest const & test, SceneQueryFilter const & filter,
+			std::vector<SceneObjectPtr>& objs) const
+		{
+			Entry const & entry = entries_[index];
+			if ((!need_test || (test(entry.aabb) != BO_No)) && (!filter || filter(*entry.obj)))
+			{
+				objs.push_back(entry.obj);
+			}
+		}
+
+	private:
+		std::vector<Node> nodes_;
+		std::vector<uint32_t> loose_entries_;
+	};
+
+
 	OCTree::OCTree()
 		: max_tree_depth_(4), rebuild_tree_(false)
 	{
@@ -113,7 +292,7 @@ namespace KlayGE
 		return max_tree_depth_;
 	}
 
-	void OCTree::ClipScene()
+	void OCTree::RebuildTree()
 	{
 		if (rebuild_tree_)
 		{
@@ -141,6 +320,11 @@ namespace KlayGE
 
 			rebuild_tree_ = false;
 		}
+	}
+
+	void OCTree::ClipScene()
+	{
+		this->RebuildTree();
 
 #ifdef KLAYGE_DRAW_NODES
 		if (!node_renderable_)
@@ -253,6 +437,40 @@ namespace KlayGE
 #endif
 	}
 
+	void OCTree::ClipViews(std::vector<CullingView> const & views)
+	{
+		this->RebuildTree();
+		this->BeginClipViews(views);
+
+		for (auto const & obj : scene_objs_)
+		{
+			obj->ViewMask(0);
+		}
+
+		uint32_t const all_views = (culling_views_.size() < 32)
+			? ((1UL << culling_views_.size()) - 1) : 0xFFFFFFFF;
+		if (!octree_.empty())
+		{
+			this->NodeViewMask(0, all_views, 0);
+		}
+
+		// Objects not in the tree, and children that depend on their parents
+		for (auto const & obj : scene_objs_)
+		{
+			uint32_t const attr = obj->Attrib();
+			if (obj->Parent() || !(attr & SceneObject::SOA_Cullable) || (attr & SceneObject::SOA_Moveable))
+			{
+				obj->ViewMask(this->ObjectViewMask(obj.get(), all_views, 0));
+			}
+		}
+	}
+
+	SceneQuerySnapshotPtr OCTree::MakeQuerySnapshot()
+	{
+		this->RebuildTree();
+		return MakeSharedPtr<QuerySnapshot>(scene_objs_, octree_);
+	}
+
 	void OCTree::ClearObject()
 	{
 		SceneManager::ClearObject();
@@ -450,6 +668,73 @@ namespace KlayGE
 		}
 	}
 
+	// Views fully containing a node move from test_mask to inside_mask, so its descendants skip the frustum test for them
+	void OCTree::NodeViewMask(size_t index, uint32_t test_mask, uint32_t inside_mask)
+	{
+		BOOST_ASSERT(index < octree_.size());
+
+		octree_node_t const & node = octree_[index];
+		for (uint32_t i = 0; i < culling_views_.size(); ++ i)
+		{
+			uint32_t const bit = 1UL << i;
+			if ((test_mask | inside_mask) & bit)
+			{
+				CullingViewInfo const & view = culling_views_[i];
+				bool visible = (small_obj_threshold_ <= 0)
+					|| ((MathLib::ortho_area(view.camera->ForwardVec(), node.bb) > small_obj_threshold_)
+						&& (MathLib::perspective_area(view.camera->EyePos(), view.view_proj, node.bb) > small_obj_threshold_));
+				if (visible && (test_mask & bit))
+				{
+					if (view.camera->OmniDirectionalMode())
+					{
+						test_mask &= ~bit;
+						inside_mask |= bit;
+					}
+					else
+					{
+						BoundOverlap const bo = view.frustum.Intersect(node.bb);
+						if (BO_No == bo)
+						{
+							visible = false;
+						}
+						else if (BO_Yes == bo)
+						{
+							test_mask &= ~bit;
+							inside_mask |= bit;
+						}
+					}
+				}
+				if (!visible)
+				{
+					test_mask &= ~bit;
+					inside_mask &= ~bit;
+				}
+			}
+		}
+
+		if (0 == (test_mask | inside_mask))
+		{
+			return;
+		}
+
+		for (auto so : node.obj_ptrs)
+		{
+			if (!so->Parent())
+			{
+				uint32_t const untested = ~so->ViewMask();
+				so->ViewMask(so->ViewMask() | this->ObjectViewMask(so, test_mask & untested, inside_mask & untested));
+			}
+		}
+
+		if (node.first_child_index != -1)
+		{
+			for (int i = 0; i < 8; ++ i)
+			{
+				this->NodeViewMask(node.first_child_index + i, test_mask, inside_mask);
+			}
+		}
+	}
+
 	BoundOverlap OCTree::AABBVisible(AABBox const & aabb) const
 	{
 		// Frustum VS node
@@ -218,6 +218,16 @@ void CascadedShadowMapApp::DoUpdateOverlay()
 		<< deferred_rendering_->NumPrimitivesRendered() << " Primitives "
 		<< deferred_rendering_->NumVerticesRendered() << " Vertices";
 	font_->RenderText(0, 54, Color(1, 1, 1, 1), stream.str(), 16);
+
+	stream.str(L"");
+	stream << "Casters:";
+	for (uint32_t i = 0; i < num_cascades_; ++ i)
+	{
+		stream << ' ' << deferred_rendering_->NumCascadeCastersRendered(i)
+			<< '/' << deferred_rendering_->NumCascadeCastersTested(i);
+	}
+	stream << ", " << deferred_rendering_->NumCascadesReused() << " cascades reused";
+	font_->RenderText(0, 72, Color(1, 1, 1, 1), stream.str(), 16);
 }
 
 uint32_t CascadedShadowMapApp::DoUpdate(uint32_t pass)
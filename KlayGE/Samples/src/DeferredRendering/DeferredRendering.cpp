@@ -422,6 +422,16 @@ void DeferredRenderingApp::DoUpdateOverlay()
 	stream << scene_mgr.NumDrawCalls() << " Draws/frame "
 		<< scene_mgr.NumDispatchCalls() << " Dispatches/frame";
 	font_->RenderText(0, 90, Color(1, 1, 1, 1), stream.str(), 16);
+
+	stream.str(L"");
+	stream << scene_mgr.NumBindsIssued() << " Binds/frame "
+		<< scene_mgr.NumBindsSkipped() << " Skipped/frame";
+	font_->RenderText(0, 108, Color(1, 1, 1, 1), stream.str(), 16);
+
+	stream.str(L"");
+	stream << scene_mgr.NumCBufferBytesWritten() << " CBuffer bytes written/frame "
+		<< scene_mgr.NumCBufferBytesUploaded() << " Uploaded/frame";
+	font_->RenderText(0, 126, Color(1, 1, 1, 1), stream.str(), 16);
 }
 
 uint32_t DeferredRenderingApp::DoUpdate(uint32_t pass)
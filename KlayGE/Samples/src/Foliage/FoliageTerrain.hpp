@@ -28,6 +28,10 @@ namespace KlayGE
 		ProceduralTerrain();
 
 		void Render() override;
+		bool Recordable() const override
+		{
+			return false;
+		}
 
 		uint32_t Num3DPlants() const
 		{
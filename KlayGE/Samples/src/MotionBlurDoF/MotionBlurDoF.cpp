@@ -206,7 +206,7 @@ namespace
 
 		void Instance(float4x4 const & mat, Color const & clr)
 		{
-			model_ = mat;
+			this->ModelMatrix(mat);
 			inst_.clr = clr.ABGR();
 		}
 
@@ -220,19 +220,21 @@ namespace
 			renderable_ = ra;
 		}
 
+		// Only touches the update side: the model matrix, and the instance data copied at the sync
 		virtual void SubThreadUpdate(float /*app_time*/, float elapsed_time) override
 		{
-			last_mats_.push_back(model_);
+			float4x4 const & model = this->ModelMatrix();
+			last_mats_.push_back(model);
 
 			float4x4 matT = MathLib::transpose(last_mats_.front());
 			inst_.last_mat[0] = matT.Row(0);
 			inst_.last_mat[1] = matT.Row(1);
 			inst_.last_mat[2] = matT.Row(2);
 
-			float e = elapsed_time * 0.3f * -model_(3, 1);
-			model_ *= MathLib::rotation_y(e);
+			float e = elapsed_time * 0.3f * -model(3, 1);
+			this->ModelMatrix(model * MathLib::rotation_y(e));
 
-			matT = MathLib::transpose(model_);
+			matT = MathLib::transpose(model);
 			inst_.mat[0] = matT.Row(0);
 			inst_.mat[1] = matT.Row(1);
 			inst_.mat[2] = matT.Row(2);
@@ -145,13 +145,18 @@ namespace
 			}
 		}
 
-		virtual void SubThreadUpdate(float app_time, float /*elapsed_time*/) override
+		// Sets effect parameters, so it's on the main thread
+		virtual bool MainThreadUpdate(float app_time, float elapsed_time) override
 		{
+			bool const refreshed = SceneObjectHelper::MainThreadUpdate(app_time, elapsed_time);
+
 			RenderModelPtr model = checked_pointer_cast<RenderModel>(renderable_);
 			for (uint32_t i = 0; i < model->NumSubrenderables(); ++ i)
 			{
 				checked_pointer_cast<RenderPolygon>(model->Subrenderable(i))->AppTime(app_time);
 			}
+
+			return refreshed;
 		}
 	};
 
@@ -15,6 +15,8 @@
 #include <KlayGE/Mesh.hpp>
 #include <KlayGE/GraphicsBuffer.hpp>
 #include <KlayGE/SceneObjectHelper.hpp>
+#include <KlayGE/WorldStreamer.hpp>
+#include <KlayGE/SceneDesc.hpp>
 #include <KlayGE/UI.hpp>
 #include <KlayGE/Camera.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
@@ -329,6 +331,11 @@ void ScenePlayerApp::LoadScene(std::string const & name)
 
 	RenderFactory& rf = context.RenderFactoryInstance();
 
+	if (streamer_)
+	{
+		streamer_->UnloadAll();
+		streamer_.reset();
+	}
 	scene_models_.clear();
 	scene_objs_.clear();
 	sky_box_.reset();
@@ -336,404 +343,241 @@ void ScenePlayerApp::LoadScene(std::string const & name)
 	lights_.clear();
 	light_proxies_.clear();
 
-	ResIdentifierPtr ifs = ResLoader::Instance().Open(name.c_str());
+	SceneDesc desc;
+	LoadSceneDesc(name, desc);
 
-	KlayGE::XMLDocument doc;
-	XMLNodePtr root = doc.Parse(ifs);
+	if (desc.streaming.enabled)
+	{
+		// The static models are streamed in around the camera instead of loaded up front
+		streamer_ = MakeSharedPtr<WorldStreamer>(desc.streaming.cell_size, desc.streaming.load_radius,
+			desc.streaming.unload_radius, static_cast<uint64_t>(desc.streaming.budget_mb) * 1024 * 1024);
+	}
 
+	auto streamed = [this](SceneDesc::Model const & model)
 	{
-		XMLAttributePtr attr = root->Attrib("skybox");
-		if (attr)
-		{
-			sky_box_ = MakeSharedPtr<SceneObjectSkyBox>();
+		return streamer_ && (SceneDesc::NO_INDEX == model.update_script);
+	};
 
-			std::string skybox_name = attr->ValueString();
-			if (!ResLoader::Instance().Locate(skybox_name).empty())
-			{
-				checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(ASyncLoadTexture(skybox_name,
-					EAH_GPU_Read | EAH_Immutable));
-			}
-			else if (!ResLoader::Instance().Locate(skybox_name + ".dds").empty())
+	// Kick off all the loads in one batch, before any object is made
+	std::vector<RenderModelPtr> res_models(desc.resources.size());
+	std::vector<TexturePtr> res_textures(desc.resources.size());
+	{
+		std::vector<char> needed(desc.resources.size(), false);
+		for (auto const & model : desc.models)
+		{
+			if (!streamed(model))
 			{
-				checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(ASyncLoadTexture(skybox_name + ".dds",
-					EAH_GPU_Read | EAH_Immutable));
+				needed[model.resource] = true;
 			}
-			else if (!ResLoader::Instance().Locate(skybox_name + "_y.dds").empty())
+		}
+		for (auto const & light : desc.lights)
+		{
+			if (light.projective_tex != SceneDesc::NO_INDEX)
 			{
-				checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CompressedCubeMap(
-					ASyncLoadTexture(skybox_name + "_y.dds", EAH_GPU_Read | EAH_Immutable),
-					ASyncLoadTexture(skybox_name + "_c.dds", EAH_GPU_Read | EAH_Immutable));
+				needed[light.projective_tex] = true;
 			}
-			else
-			{
-				std::istringstream attr_ss(skybox_name);
-				Color color(0, 0, 0, 1);
-				attr_ss >> color.r() >> color.g() >> color.b();
+		}
 
-				uint32_t texel;
-				ElementFormat fmt;
-				if (rf.RenderEngineInstance().DeviceCaps().texture_format_support(EF_ABGR8))
+		for (size_t i = 0; i < desc.resources.size(); ++ i)
+		{
+			if (needed[i])
+			{
+				if (SceneDesc::RT_Model == desc.resources[i].type)
 				{
-					fmt = EF_ABGR8;
-					texel = color.ABGR();
+					res_models[i] = ASyncLoadModel(desc.resources[i].name, EAH_GPU_Read | EAH_Immutable);
 				}
 				else
 				{
-					BOOST_ASSERT(rf.RenderEngineInstance().DeviceCaps().texture_format_support(EF_ARGB8));
-
-					fmt = EF_ARGB8;
-					texel = color.ARGB();
+					res_textures[i] = ASyncLoadTexture(desc.resources[i].name, EAH_GPU_Read | EAH_Immutable);
 				}
-				ElementInitData init_data[6];
-				for (int i = 0; i < 6; ++i)
-				{
-					init_data[i].data = &texel;
-					init_data[i].row_pitch = sizeof(uint32_t);
-					init_data[i].slice_pitch = init_data[i].row_pitch;
-				}
-
-				checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(rf.MakeTextureCube(1, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_Immutable, init_data));
 			}
-
-			sky_box_->AddToSceneManager();
 		}
 	}
 
-	for (XMLNodePtr light_node = root->FirstNode("light"); light_node; light_node = light_node->NextSibling("light"))
+	if (!desc.skybox.empty())
 	{
-		LightSourcePtr light;
+		sky_box_ = MakeSharedPtr<SceneObjectSkyBox>();
 
-		std::string lt_str = light_node->Attrib("type")->ValueString();
-		if ("ambient" == lt_str)
+		std::string const & skybox_name = desc.skybox;
+		if (!ResLoader::Instance().Locate(skybox_name).empty())
 		{
-			light = MakeSharedPtr<AmbientLightSource>();
+			checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(ASyncLoadTexture(skybox_name,
+				EAH_GPU_Read | EAH_Immutable));
 		}
-		else if ("sun" == lt_str)
+		else if (!ResLoader::Instance().Locate(skybox_name + ".dds").empty())
 		{
-			light = MakeSharedPtr<SunLightSource>();
+			checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(ASyncLoadTexture(skybox_name + ".dds",
+				EAH_GPU_Read | EAH_Immutable));
 		}
-		else if ("directional" == lt_str)
+		else if (!ResLoader::Instance().Locate(skybox_name + "_y.dds").empty())
 		{
-			light = MakeSharedPtr<DirectionalLightSource>();
-		}
-		else if ("point" == lt_str)
-		{
-			light = MakeSharedPtr<PointLightSource>();
-		}
-		else if ("spot" == lt_str)
-		{
-			light = MakeSharedPtr<SpotLightSource>();
-		}
-		else if ("sphere_area" == lt_str)
-		{
-			light = MakeSharedPtr<SphereAreaLightSource>();
+			checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CompressedCubeMap(
+				ASyncLoadTexture(skybox_name + "_y.dds", EAH_GPU_Read | EAH_Immutable),
+				ASyncLoadTexture(skybox_name + "_c.dds", EAH_GPU_Read | EAH_Immutable));
 		}
 		else
 		{
-			BOOST_ASSERT("tube_area" == lt_str);
-			light = MakeSharedPtr<TubeAreaLightSource>();
-		}
+			std::istringstream attr_ss(skybox_name);
+			Color color(0, 0, 0, 1);
+			attr_ss >> color.r() >> color.g() >> color.b();
 
-		uint32_t light_attr = 0;
-		XMLNodePtr attr_node = light_node->FirstNode("attr");
-		if (attr_node)
-		{
-			std::vector<std::string> tokens;
-			boost::algorithm::split(tokens, attr_node->Attrib("value")->ValueString(), boost::is_any_of(" \t|"));
-			for (auto& token : tokens)
+			uint32_t texel;
+			ElementFormat fmt;
+			if (rf.RenderEngineInstance().DeviceCaps().texture_format_support(EF_ABGR8))
 			{
-				boost::algorithm::trim(token);
+				fmt = EF_ABGR8;
+				texel = color.ABGR();
+			}
+			else
+			{
+				BOOST_ASSERT(rf.RenderEngineInstance().DeviceCaps().texture_format_support(EF_ARGB8));
 
-				if ("no_shadow" == token)
-				{
-					light_attr |= LightSource::LSA_NoShadow;
-				}
-				else if ("no_diffuse" == token)
-				{
-					light_attr |= LightSource::LSA_NoDiffuse;
-				}
-				else if ("no_specular" == token)
-				{
-					light_attr |= LightSource::LSA_NoSpecular;
-				}
-				else if ("indirect" == token)
-				{
-					light_attr |= LightSource::LSA_IndirectLighting;
-				}
+				fmt = EF_ARGB8;
+				texel = color.ARGB();
 			}
+			ElementInitData init_data[6];
+			for (int i = 0; i < 6; ++i)
+			{
+				init_data[i].data = &texel;
+				init_data[i].row_pitch = sizeof(uint32_t);
+				init_data[i].slice_pitch = init_data[i].row_pitch;
+			}
+
+			checked_pointer_cast<SceneObjectSkyBox>(sky_box_)->CubeMap(rf.MakeTextureCube(1, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_Immutable, init_data));
 		}
-		light->Attrib(light_attr);
 
-		XMLNodePtr color_node = light_node->FirstNode("color");
-		if (color_node)
+		sky_box_->AddToSceneManager();
+	}
+
+	for (auto const & light_desc : desc.lights)
+	{
+		LightSourcePtr light;
+		switch (light_desc.type)
 		{
-			std::istringstream attr_ss(color_node->Attrib("v")->ValueString());
-			float3 color;
-			attr_ss >> color.x() >> color.y() >> color.z();
-			light->Color(color);
+		case LightSource::LT_Ambient:
+			light = MakeSharedPtr<AmbientLightSource>();
+			break;
+
+		case LightSource::LT_Sun:
+			light = MakeSharedPtr<SunLightSource>();
+			break;
+
+		case LightSource::LT_Directional:
+			light = MakeSharedPtr<DirectionalLightSource>();
+			break;
+
+		case LightSource::LT_Point:
+			light = MakeSharedPtr<PointLightSource>();
+			break;
+
+		case LightSource::LT_Spot:
+			light = MakeSharedPtr<SpotLightSource>();
+			break;
+
+		case LightSource::LT_SphereArea:
+			light = MakeSharedPtr<SphereAreaLightSource>();
+			break;
+
+		default:
+			BOOST_ASSERT(LightSource::LT_TubeArea == light_desc.type);
+			light = MakeSharedPtr<TubeAreaLightSource>();
+			break;
 		}
 
+		light->Attrib(light_desc.attrib);
+		light->Color(light_desc.color);
 
 		if (light->Type() != LightSource::LT_Ambient)
 		{
-			XMLNodePtr dir_node = light_node->FirstNode("dir");
-			if (dir_node)
-			{
-				std::istringstream attr_ss(dir_node->Attrib("v")->ValueString());
-				float3 dir;
-				attr_ss >> dir.x() >> dir.y() >> dir.z();
-				light->Direction(dir);
-			}
+			light->Direction(light_desc.dir);
 		}
 		if ((LightSource::LT_Point == light->Type()) || (LightSource::LT_Spot == light->Type())
 			|| (LightSource::LT_SphereArea == light->Type()) || (LightSource::LT_TubeArea == light->Type()))
 		{
-			XMLNodePtr pos_node = light_node->FirstNode("pos");
-			if (pos_node)
-			{
-				std::istringstream attr_ss(pos_node->Attrib("v")->ValueString());
-				float3 pos;
-				attr_ss >> pos.x() >> pos.y() >> pos.z();
-				light->Position(pos);
-			}
-
-			XMLNodePtr fall_off_node = light_node->FirstNode("fall_off");
-			if (fall_off_node)
-			{
-				std::istringstream attr_ss(fall_off_node->Attrib("v")->ValueString());
-				float3 fall_off;
-				attr_ss >> fall_off.x() >> fall_off.y() >> fall_off.z();
-				light->Falloff(fall_off);
-			}
+			light->Position(light_desc.pos);
+			light->Falloff(light_desc.falloff);
 
 			if ((LightSource::LT_Point == light->Type()) || (LightSource::LT_Spot == light->Type()))
 			{
-				XMLNodePtr projective_node = light_node->FirstNode("projective");
-				if (projective_node)
+				if (light_desc.projective_tex != SceneDesc::NO_INDEX)
 				{
-					XMLAttributePtr attr = projective_node->Attrib("name");
-					if (attr)
-					{
-						TexturePtr projective = ASyncLoadTexture(attr->ValueString(), EAH_GPU_Read | EAH_Immutable);
-						light->ProjectiveTexture(projective);
-					}
+					light->ProjectiveTexture(res_textures[light_desc.projective_tex]);
 				}
 
 				if (LightSource::LT_Spot == light->Type())
 				{
-					XMLNodePtr angle_node = light_node->FirstNode("angle");
-					if (angle_node)
-					{
-						light->InnerAngle(angle_node->Attrib("inner")->ValueFloat());
-						light->OuterAngle(angle_node->Attrib("outer")->ValueFloat());
-					}
+					light->InnerAngle(light_desc.inner_angle);
+					light->OuterAngle(light_desc.outer_angle);
 				}
 			}
 
 			// TODO: sphere area light and tube area light
 		}
 
-		XMLNodePtr update_node = light_node->FirstNode("update");
-		if (update_node)
+		if (light_desc.update_script != SceneDesc::NO_INDEX)
 		{
-			update_node = update_node->FirstNode();
-			if (update_node && (XNT_CData == update_node->Type()))
-			{
-				std::string update_script = update_node->ValueString();
-				if (!update_script.empty())
-				{
-					light->BindUpdateFunc(LightSourceUpdate(update_script));
-				}
-			}
+			light->BindUpdateFunc(LightSourceUpdate(desc.scripts[light_desc.update_script]));
 		}
 
 		light->AddToSceneManager();
 		lights_.push_back(light);
 
-		XMLNodePtr scale_node = light_node->FirstNode("scale");
-		if (scale_node)
+		if (light_desc.proxy_scale != float3(0, 0, 0))
 		{
-			float3 scale(1, 1, 1);
-			{
-				std::istringstream attr_ss(scale_node->Attrib("v")->ValueString());
-				attr_ss >> scale.x() >> scale.y() >> scale.z();
-			}
-
 			SceneObjectPtr light_proxy = MakeSharedPtr<SceneObjectLightSourceProxy>(light);
-			checked_pointer_cast<SceneObjectLightSourceProxy>(light_proxy)->Scaling(scale);
+			checked_pointer_cast<SceneObjectLightSourceProxy>(light_proxy)->Scaling(light_desc.proxy_scale);
 			light_proxy->AddToSceneManager();
 
 			light_proxies_.push_back(light_proxy);
 		}
 	}
 
-	for (XMLNodePtr model_node = root->FirstNode("model"); model_node; model_node = model_node->NextSibling("model"))
+	for (auto const & model_desc : desc.models)
 	{
-		uint32_t obj_attr = SceneObject::SOA_Cullable;
-		float4x4 obj_mat = float4x4::Identity();
-
-		float3 scale(1, 1, 1);
-		Quaternion rotate = Quaternion::Identity();
-		float3 translate(0, 0, 0);
-
-		XMLNodePtr scale_node = model_node->FirstNode("scale");
-		if (scale_node)
-		{
-			std::istringstream attr_ss(scale_node->Attrib("v")->ValueString());
-			attr_ss >> scale.x() >> scale.y() >> scale.z();
-		}
-		
-		XMLNodePtr rotate_node = model_node->FirstNode("rotate");
-		if (!!rotate_node)
+		if (streamed(model_desc))
 		{
-			std::istringstream attr_ss(rotate_node->Attrib("v")->ValueString());
-			attr_ss >> rotate.x() >> rotate.y() >> rotate.z() >> rotate.w();
-		}
-
-		XMLNodePtr translate_node = model_node->FirstNode("translate");
-		if (scale_node)
-		{
-			std::istringstream attr_ss(translate_node->Attrib("v")->ValueString());
-			attr_ss >> translate.x() >> translate.y() >> translate.z();
-		}
-
-		obj_mat = MathLib::transformation<float>(nullptr, nullptr, &scale, nullptr, &rotate, &translate);
-
-		XMLNodePtr attribute_node = model_node->FirstNode("attr");
-		if (attribute_node)
-		{
-			XMLAttributePtr attr = attribute_node->Attrib("value");
-			if (attr)
-			{
-				if (!attr->TryConvert(obj_attr))
-				{
-					obj_attr = SceneObject::SOA_Cullable;
-
-					std::vector<std::string> tokens;
-					boost::algorithm::split(tokens, attr->ValueString(), boost::is_any_of(" \t|"));
-					for (auto& token : tokens)
-					{
-						boost::algorithm::trim(token);
-						if ("cullable" == token)
-						{
-							obj_attr |= SceneObject::SOA_Cullable;
-						}
-						else if ("overlay" == token)
-						{
-							obj_attr |= SceneObject::SOA_Overlay;
-						}
-						else if ("moveable" == token)
-						{
-							obj_attr |= SceneObject::SOA_Moveable;
-						}
-						else if ("invisible" == token)
-						{
-							obj_attr |= SceneObject::SOA_Invisible;
-						}
-					}
-				}
-			}
+			streamer_->AddObject(desc.resources[model_desc.resource].name, model_desc.transform, model_desc.attrib);
+			continue;
 		}
 
-		std::string update_script;
-		XMLNodePtr update_node = model_node->FirstNode("update");
-		if (update_node)
+		uint32_t obj_attr = model_desc.attrib;
+		if (model_desc.update_script != SceneDesc::NO_INDEX)
 		{
-			update_node = update_node->FirstNode();
-			if (update_node && (XNT_CData == update_node->Type()))
-			{
-				update_script = update_node->ValueString();
-			}
+			// The script engine can't be entered from several threads at once
+			obj_attr |= SceneObject::SOA_SerialUpdate;
 		}
 
-		XMLAttributePtr attr = model_node->Attrib("meshml");
-		BOOST_ASSERT(attr);
-
-		RenderModelPtr model = ASyncLoadModel(attr->ValueString(), EAH_GPU_Read | EAH_Immutable);
+		RenderModelPtr const & model = res_models[model_desc.resource];
 		scene_models_.push_back(model);
 		SceneObjectPtr scene_obj = MakeSharedPtr<SceneObjectHelper>(model, obj_attr);
-		scene_obj->ModelMatrix(obj_mat);
-		if (!update_script.empty())
+		scene_obj->ModelMatrix(model_desc.transform);
+		if (model_desc.update_script != SceneDesc::NO_INDEX)
 		{
-			scene_obj->BindSubThreadUpdateFunc(SceneObjectUpdate(update_script));
+			scene_obj->BindSubThreadUpdateFunc(SceneObjectUpdate(desc.scripts[model_desc.update_script]));
 		}
 		scene_objs_.push_back(scene_obj);
 		scene_obj->AddToSceneManager();
 	}
 
+	if (!desc.cameras.empty())
 	{
-		float3 eye_pos(0, 0, -1);
-		float3 look_at(0, 0, 0);
-		float3 up(0, 1, 0);
-		float fov = PI / 4;
-		float near_plane = 1;
-		float far_plane = 1000;
-
-		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
-		FrameBuffer& fb = *re.CurFrameBuffer();
-		float aspect = static_cast<float>(fb.Width()) / fb.Height();
+		SceneDesc::Camera const & camera_desc = desc.cameras[0];
 
-		XMLNodePtr camera_node = root->FirstNode("camera");
-
-		XMLNodePtr eye_pos_node = camera_node->FirstNode("eye_pos");
-		if (eye_pos_node)
+		float aspect = camera_desc.aspect;
+		if (aspect <= 0)
 		{
-			std::istringstream attr_ss(eye_pos_node->Attrib("v")->ValueString());
-			attr_ss >> eye_pos.x() >> eye_pos.y() >> eye_pos.z();
-		}
-		XMLNodePtr look_at_node = camera_node->FirstNode("look_at");
-		if (look_at_node)
-		{
-			std::istringstream attr_ss(look_at_node->Attrib("v")->ValueString());
-			attr_ss >> look_at.x() >> look_at.y() >> look_at.z();
-		}
-		XMLNodePtr up_node = camera_node->FirstNode("up");
-		if (up_node)
-		{
-			std::istringstream attr_ss(up_node->Attrib("v")->ValueString());
-			attr_ss >> up.x() >> up.y() >> up.z();
-		}
-
-		XMLNodePtr fov_node = camera_node->FirstNode("fov");
-		if (fov_node)
-		{
-			fov = fov_node->Attrib("s")->ValueFloat();
-		}
-		XMLNodePtr aspect_node = camera_node->FirstNode("aspect");
-		if (aspect_node)
-		{
-			aspect = aspect_node->Attrib("s")->ValueFloat();
-		}
-		XMLNodePtr near_plane_node = camera_node->FirstNode("near");
-		if (near_plane_node)
-		{
-			near_plane = near_plane_node->Attrib("s")->ValueFloat();
-		}
-		XMLNodePtr far_plane_node = camera_node->FirstNode("far");
-		if (far_plane_node)
-		{
-			far_plane = far_plane_node->Attrib("s")->ValueFloat();
-		}
-
-		std::string update_script;
-
-		XMLNodePtr update_node = camera_node->FirstNode("update");
-		if (update_node)
-		{
-			update_node = update_node->FirstNode();
-			if (update_node && (XNT_CData == update_node->Type()))
-			{
-				update_script = update_node->ValueString();
-			}
+			FrameBuffer& fb = *rf.RenderEngineInstance().CurFrameBuffer();
+			aspect = static_cast<float>(fb.Width()) / fb.Height();
 		}
 
 		auto& camera = this->ActiveCamera();
-		camera.ViewParams(eye_pos, look_at, up);
-		camera.ProjParams(fov, aspect, near_plane, far_plane);
-		if (!update_script.empty())
+		camera.ViewParams(camera_desc.eye_pos, camera_desc.look_at, camera_desc.up);
+		camera.ProjParams(camera_desc.fov, aspect, camera_desc.near_plane, camera_desc.far_plane);
+		if (camera_desc.update_script != SceneDesc::NO_INDEX)
 		{
-			camera.BindUpdateFunc(CameraUpdate(update_script));
+			camera.BindUpdateFunc(CameraUpdate(desc.scripts[camera_desc.update_script]));
 		}
+		last_eye_pos_ = camera_desc.eye_pos;
 	}
 }
 
@@ -926,5 +770,14 @@ void ScenePlayerApp::DoUpdateOverlay()
 
 uint32_t ScenePlayerApp::DoUpdate(uint32_t pass)
 {
+	if ((0 == pass) && streamer_)
+	{
+		float3 const & eye_pos = this->ActiveCamera().EyePos();
+		float const frame_time = this->FrameTime();
+		float3 const velocity = (frame_time > 0) ? (eye_pos - last_eye_pos_) / frame_time : float3(0, 0, 0);
+		streamer_->Update(eye_pos, velocity);
+		last_eye_pos_ = eye_pos;
+	}
+
 	return deferred_rendering_->Update(pass);
 }
@@ -39,6 +39,9 @@ private:
 	std::vector<KlayGE::SceneObjectPtr> scene_objs_;
 	KlayGE::SceneObjectPtr sky_box_;
 
+	KlayGE::WorldStreamerPtr streamer_;
+	KlayGE::float3 last_eye_pos_;
+
 	std::vector<KlayGE::LightSourcePtr> lights_;
 	std::vector<KlayGE::SceneObjectPtr> light_proxies_;
 
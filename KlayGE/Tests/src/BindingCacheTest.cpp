@@ -0,0 +1,80 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/BindingCache.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+using namespace std;
+using namespace KlayGE;
+
+BOOST_AUTO_TEST_CASE(BindingCacheSkipSame)
+{
+	BindingCache cache;
+	int a, b;
+
+	// A slot never bound is unknown, so even nullptr has to be issued
+	BOOST_CHECK(cache.Bind(BindingCache::BT_IndexBuffer, 0, 0, nullptr));
+	BOOST_CHECK(!cache.Bind(BindingCache::BT_IndexBuffer, 0, 0, nullptr));
+	BOOST_CHECK(cache.Bind(BindingCache::BT_IndexBuffer, 0, 0, &a));
+	BOOST_CHECK(!cache.Bind(BindingCache::BT_IndexBuffer, 0, 0, &a));
+	BOOST_CHECK(cache.Bind(BindingCache::BT_Shader, 1, 0, &a));
+	BOOST_CHECK(cache.Bind(BindingCache::BT_Shader, 0, 0, &a));
+	BOOST_CHECK(cache.Bind(BindingCache::BT_Shader, 0, 0, &b));
+
+	BOOST_CHECK(cache.NumIssued(BindingCache::BT_IndexBuffer) == 2);
+	BOOST_CHECK(cache.NumSkipped(BindingCache::BT_IndexBuffer) == 2);
+	BOOST_CHECK(cache.NumIssued() == 5);
+	BOOST_CHECK(cache.NumSkipped() == 2);
+
+	cache.Invalidate(BindingCache::BT_Shader, 0);
+	BOOST_CHECK(cache.Bind(BindingCache::BT_Shader, 0, 0, &b));
+	BOOST_CHECK(!cache.Bind(BindingCache::BT_Shader, 1, 0, &a));
+
+	cache.Invalidate();
+	BOOST_CHECK(cache.Bind(BindingCache::BT_IndexBuffer, 0, 0, &a));
+
+	cache.ResetNumIssued();
+	BOOST_CHECK(cache.NumIssued() == 0);
+	BOOST_CHECK(cache.NumSkipped() == 3);
+	cache.ResetNumSkipped();
+	BOOST_CHECK(cache.NumSkipped() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(BindingCacheRange)
+{
+	BindingCache cache;
+	int res[6];
+	int* slots[6] = { &res[0], &res[1], &res[2], &res[3], &res[4], &res[5] };
+
+	uint32_t first;
+	BOOST_CHECK(cache.Bind(BindingCache::BT_ShaderResource, 0, 0, 6, slots, first) == 6);
+	BOOST_CHECK(first == 0);
+	BOOST_CHECK(cache.Bind(BindingCache::BT_ShaderResource, 0, 0, 6, slots, first) == 0);
+
+	slots[1] = nullptr;
+	slots[3] = nullptr;
+	BOOST_CHECK(cache.Bind(BindingCache::BT_ShaderResource, 0, 0, 6, slots, first) == 3);
+	BOOST_CHECK(first == 1);
+	BOOST_CHECK(cache.NumIssued() == 8);
+	BOOST_CHECK(cache.NumSkipped() == 10);
+
+	// Other stages and types have their own slots
+	BOOST_CHECK(cache.Bind(BindingCache::BT_ShaderResource, 1, 2, 2, &slots[4], first) == 2);
+	BOOST_CHECK(first == 2);
+	BOOST_CHECK(cache.Bind(BindingCache::BT_Sampler, 0, 0, 1, slots, first) == 1);
+
+	cache.Count(BindingCache::BT_VertexBuffer, true);
+	cache.Count(BindingCache::BT_VertexBuffer, false);
+	cache.Count(BindingCache::BT_ConstantBuffer, 2, 3);
+	BOOST_CHECK(cache.NumIssued(BindingCache::BT_VertexBuffer) == 1);
+	BOOST_CHECK(cache.NumSkipped(BindingCache::BT_VertexBuffer) == 1);
+	BOOST_CHECK(cache.NumIssued(BindingCache::BT_ConstantBuffer) == 2);
+	BOOST_CHECK(cache.NumSkipped(BindingCache::BT_ConstantBuffer) == 3);
+}
@@ -1,6 +1,7 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Util.hpp>
 #include <KFL/Hash.hpp>
+#include <KlayGE/RenderEffect.hpp>
 
 #include <boost/assert.hpp>
 #ifdef KLAYGE_COMPILER_CLANG
@@ -22,3 +23,11 @@ BOOST_AUTO_TEST_CASE(CTHash)
 	BOOST_CHECK(CT_HASH("Test") == RT_HASH("Test"));
 	BOOST_CHECK(CT_HASH("min_linear_mag_point_mip_linear") == RT_HASH("min_linear_mag_point_mip_linear"));
 }
+
+BOOST_AUTO_TEST_CASE(EffectNameIdHash)
+{
+	// Parameter and technique names are hashed from std::string when loaded, the ids made by CT_HASH have to match
+	BOOST_CHECK(EffectNameId(CT_HASH("mvp")).Hash() == EffectNameId(std::string("mvp")).Hash());
+	BOOST_CHECK(EffectNameId(CT_HASH("GBufferAlphaTestMRTTech")).Hash() == EffectNameId(std::string("GBufferAlphaTestMRTTech")).Hash());
+	BOOST_CHECK(EffectNameId(CT_HASH("albedo_tex")).Hash() != EffectNameId(CT_HASH("albedo_clr")).Hash());
+}
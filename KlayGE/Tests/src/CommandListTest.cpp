@@ -0,0 +1,255 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/RenderLayout.hpp>
+#include <KlayGE/CommandList.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Keeps the bytes of the last upload, in place of a device buffer
+	class TestBuffer : public GraphicsBuffer
+	{
+	public:
+		explicit TestBuffer(uint32_t size_in_byte)
+			: GraphicsBuffer(BU_Dynamic, 0, size_in_byte),
+				data_(size_in_byte, 0), num_uploads_(0)
+		{
+		}
+
+		void CopyToBuffer(GraphicsBuffer& rhs) override
+		{
+			KFL_UNUSED(rhs);
+		}
+
+		void CreateHWResource(void const * init_data) override
+		{
+			KFL_UNUSED(init_data);
+		}
+		void DeleteHWResource() override
+		{
+		}
+
+		void UpdateSubresource(uint32_t offset, uint32_t size, void const * data) override
+		{
+			std::memcpy(&data_[offset], data, size);
+			++ num_uploads_;
+		}
+
+		uint32_t Value() const
+		{
+			uint32_t ret;
+			std::memcpy(&ret, &data_[0], sizeof(ret));
+			return ret;
+		}
+		uint32_t NumUploads() const
+		{
+			return num_uploads_;
+		}
+
+	private:
+		void* Map(BufferAccess ba) override
+		{
+			KFL_UNUSED(ba);
+			return &data_[0];
+		}
+		void Unmap() override
+		{
+		}
+
+	private:
+		std::vector<uint8_t> data_;
+		uint32_t num_uploads_;
+	};
+
+	class TestLayout : public RenderLayout
+	{
+	};
+
+	void SetValue(RenderEffectConstantBuffer& cbuff, uint32_t value)
+	{
+		*cbuff.VariableInBuff<uint32_t>(0) = value;
+		cbuff.Dirty(true);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CommandListCBufferSnapshots)
+{
+	auto buff = MakeSharedPtr<TestBuffer>(16);
+	RenderEffectConstantBuffer cbuff;
+	cbuff.BindHWBuff(buff);
+
+	RenderEffect effect;
+	RenderTechnique tech;
+	TestLayout layout;
+
+	CommandList cmd_list;
+
+	SetValue(cbuff, 1);
+	cmd_list.CaptureCBuffer(cbuff, true);
+	cmd_list.Draw(effect, tech, layout);
+	BOOST_CHECK(!cbuff.Dirty());
+
+	SetValue(cbuff, 2);
+	cmd_list.CaptureCBuffer(cbuff, false);
+	cmd_list.Draw(effect, tech, layout);
+
+	// Unchanged, nothing is captured
+	cmd_list.CaptureCBuffer(cbuff, false);
+	cmd_list.Draw(effect, tech, layout);
+
+	SetValue(cbuff, 3);
+	cmd_list.CaptureCBuffer(cbuff, false);
+	cmd_list.Draw(effect, tech, layout);
+
+	BOOST_CHECK(cmd_list.NumPackets() == 4);
+	BOOST_CHECK(cmd_list.Packet(0).num_snapshots == 1);
+	BOOST_CHECK(cmd_list.Packet(2).num_snapshots == 0);
+	BOOST_CHECK(cmd_list.NumSnapshotBytes() == 3 * 16);
+
+	std::vector<uint32_t> values;
+	cmd_list.Execute([&cbuff, &buff, &values](CommandPacket const & packet)
+		{
+			BOOST_CHECK(packet.layout != nullptr);
+			cbuff.Update();
+			values.push_back(buff->Value());
+		});
+
+	BOOST_CHECK(values.size() == 4);
+	BOOST_CHECK(values[0] == 1);
+	BOOST_CHECK(values[1] == 2);
+	BOOST_CHECK(values[2] == 2);
+	BOOST_CHECK(values[3] == 3);
+	BOOST_CHECK(buff->NumUploads() == 3);
+
+	cmd_list.Reset();
+	BOOST_CHECK(cmd_list.NumPackets() == 0);
+	BOOST_CHECK(cmd_list.NumSnapshotBytes() == 0);
+}
+
+BOOST_AUTO_TEST_CASE(CommandListDirtySpans)
+{
+	auto buff = MakeSharedPtr<TestBuffer>(16);
+	RenderEffectConstantBuffer cbuff;
+	cbuff.BindHWBuff(buff);
+
+	RenderEffect effect;
+	RenderTechnique tech;
+	TestLayout layout;
+
+	SetValue(cbuff, 1);
+	cbuff.Update();
+	BOOST_CHECK(buff->NumUploads() == 1);
+
+	// The first draw of an effect captures a clean cbuffer too, but the device already has it
+	CommandList cmd_list;
+	cmd_list.CaptureCBuffer(cbuff, true);
+	cmd_list.Draw(effect, tech, layout);
+
+	*cbuff.VariableInBuff<uint32_t>(4) = 2;
+	cbuff.Dirty(4, 4);
+	cmd_list.CaptureCBuffer(cbuff, false);
+	cmd_list.Draw(effect, tech, layout);
+
+	std::vector<uint32_t> dirty_begins;
+	cmd_list.Execute([&cbuff, &dirty_begins](CommandPacket const & packet)
+		{
+			KFL_UNUSED(packet);
+			dirty_begins.push_back(cbuff.Dirty() ? cbuff.DirtyBegin() : 0xFFFFFFFF);
+			cbuff.Update();
+		});
+
+	BOOST_CHECK(dirty_begins.size() == 2);
+	BOOST_CHECK(dirty_begins[0] == 0xFFFFFFFF);
+	BOOST_CHECK(dirty_begins[1] == 4);
+	BOOST_CHECK(cbuff.DirtyEnd() == 0);
+	BOOST_CHECK(buff->NumUploads() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(CommandRecorderOrder)
+{
+	uint32_t const NUM_ITEMS = 200;
+
+	thread_pool tp(1, 4);
+	CommandRecorder recorder(tp);
+
+	std::vector<std::unique_ptr<RenderEffect>> effects(NUM_ITEMS);
+	for (auto& effect : effects)
+	{
+		effect = MakeUniquePtr<RenderEffect>();
+	}
+	RenderTechnique tech;
+	TestLayout layout;
+
+	std::thread::id const main_id = std::this_thread::get_id();
+	std::vector<std::thread::id> ids(NUM_ITEMS);
+	for (int i = 0; i < 5; ++ i)
+	{
+		recorder.Record(NUM_ITEMS, 4, 16,
+			[&effects, &tech, &layout, &ids](CommandList& cmd_list, uint32_t begin, uint32_t end)
+			{
+				for (uint32_t j = begin; j < end; ++ j)
+				{
+					// Two draws per item, as instances without an instance stream do
+					cmd_list.Draw(*effects[j], tech, layout);
+					cmd_list.Draw(*effects[j], tech, layout);
+					ids[j] = std::this_thread::get_id();
+				}
+			});
+
+		BOOST_CHECK(recorder.NumLists() == 4);
+		BOOST_CHECK(recorder.NumPackets() == NUM_ITEMS * 2);
+		BOOST_CHECK(ids[0] == main_id);
+		BOOST_CHECK(ids[NUM_ITEMS - 1] != main_id);
+
+		std::vector<RenderEffect const *> replayed;
+		recorder.Execute([&replayed](CommandPacket const & packet)
+			{
+				replayed.push_back(packet.effect);
+			});
+
+		BOOST_CHECK(replayed.size() == NUM_ITEMS * 2);
+		for (uint32_t j = 0; j < NUM_ITEMS; ++ j)
+		{
+			BOOST_CHECK(replayed[j * 2 + 0] == effects[j].get());
+			BOOST_CHECK(replayed[j * 2 + 1] == effects[j].get());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(CommandRecorderSmallRange)
+{
+	thread_pool tp(1, 4);
+	CommandRecorder recorder(tp);
+
+	uint32_t num_calls = 0;
+	recorder.Record(20, 4, 16,
+		[&num_calls](CommandList& cmd_list, uint32_t begin, uint32_t end)
+		{
+			KFL_UNUSED(cmd_list);
+			BOOST_CHECK(begin == 0);
+			BOOST_CHECK(end == 20);
+			++ num_calls;
+		});
+
+	BOOST_CHECK(num_calls == 1);
+	BOOST_CHECK(recorder.NumLists() == 1);
+	BOOST_CHECK(recorder.NumPackets() == 0);
+}
@@ -0,0 +1,72 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/FrameArena.hpp>
+#include <KFL/AlignedAllocator.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+BOOST_AUTO_TEST_CASE(FrameArenaAlignment)
+{
+	FrameArena arena(256);
+
+	void* p0 = arena.Allocate(3, 1);
+	void* p1 = arena.Allocate(16, 16);
+	void* p2 = arena.Allocate(8, 8);
+	BOOST_CHECK(p0 != p1);
+	BOOST_CHECK(0 == (reinterpret_cast<size_t>(p1) & 15));
+	BOOST_CHECK(0 == (reinterpret_cast<size_t>(p2) & 7));
+	BOOST_CHECK(arena.BytesAllocated() == 27);
+}
+
+BOOST_AUTO_TEST_CASE(FrameArenaReset)
+{
+	FrameArena arena(256);
+
+	arena.Allocate(200, 4);
+	arena.Allocate(200, 4);
+	arena.Allocate(1000, 4);
+	size_t const capacity = arena.Capacity();
+	BOOST_CHECK(capacity >= 1400);
+
+	arena.Reset();
+	BOOST_CHECK(arena.BytesAllocated() == 0);
+	BOOST_CHECK(arena.Capacity() == capacity);
+
+	// After the merge, the same footprint fits in one block
+	uint8_t* p0 = static_cast<uint8_t*>(arena.Allocate(200, 4));
+	uint8_t* p1 = static_cast<uint8_t*>(arena.Allocate(200, 4));
+	uint8_t* p2 = static_cast<uint8_t*>(arena.Allocate(1000, 4));
+	BOOST_CHECK(p1 == p0 + 200);
+	BOOST_CHECK(p2 == p1 + 200);
+	BOOST_CHECK(arena.Capacity() == capacity);
+}
+
+BOOST_AUTO_TEST_CASE(FrameAllocator)
+{
+	FrameArena arena;
+	frame_allocator<uint32_t> alloc(arena);
+
+	std::vector<uint32_t, frame_allocator<uint32_t>> v(alloc);
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		v.push_back(i);
+	}
+	for (uint32_t i = 0; i < 1000; ++ i)
+	{
+		BOOST_CHECK(v[i] == i);
+	}
+	BOOST_CHECK(v.get_allocator() == alloc);
+	BOOST_CHECK(arena.BytesAllocated() >= 1000 * sizeof(uint32_t));
+}
@@ -0,0 +1,70 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
+#include <KlayGE/FrameTaskGraph.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <atomic>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+BOOST_AUTO_TEST_CASE(FrameTaskGraphOrder)
+{
+	thread_pool tp(1, 4);
+	FrameTaskGraph graph(tp);
+
+	std::atomic<uint32_t> counter(0);
+	uint32_t order[5] = {};
+	auto record = [&counter, &order](uint32_t task)
+	{
+		return [&counter, &order, task]()
+		{
+			order[task] = counter ++;
+		};
+	};
+
+	uint32_t const a = graph.AddTask(record(0), FrameTaskGraph::TA_MainThread);
+	uint32_t const b = graph.AddTask(record(1), FrameTaskGraph::TA_Worker);
+	uint32_t const c = graph.AddTask(record(2), FrameTaskGraph::TA_Worker, { a });
+	uint32_t const d = graph.AddTask(record(3), FrameTaskGraph::TA_MainThread, { b, c });
+	graph.AddTask(record(4), FrameTaskGraph::TA_Worker, { d });
+
+	for (int i = 0; i < 10; ++ i)
+	{
+		counter = 0;
+		graph.Run();
+
+		BOOST_CHECK(counter == 5);
+		BOOST_CHECK(order[0] < order[2]);
+		BOOST_CHECK(order[1] < order[3]);
+		BOOST_CHECK(order[2] < order[3]);
+		BOOST_CHECK(order[3] < order[4]);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(FrameTaskGraphMainThread)
+{
+	thread_pool tp(1, 4);
+	FrameTaskGraph graph(tp);
+
+	std::thread::id const main_id = std::this_thread::get_id();
+	std::thread::id ids[3];
+	uint32_t const a = graph.AddTask([&ids]() { ids[0] = std::this_thread::get_id(); }, FrameTaskGraph::TA_Worker);
+	uint32_t const b = graph.AddTask([&ids]() { ids[1] = std::this_thread::get_id(); }, FrameTaskGraph::TA_MainThread, { a });
+	graph.AddTask([&ids]() { ids[2] = std::this_thread::get_id(); }, FrameTaskGraph::TA_MainThread, { b });
+	graph.Run();
+
+	BOOST_CHECK(ids[0] != main_id);
+	BOOST_CHECK(ids[1] == main_id);
+	BOOST_CHECK(ids[2] == main_id);
+}
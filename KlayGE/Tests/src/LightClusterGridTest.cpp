@@ -0,0 +1,184 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/LightClusterGrid.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	float const NEAR_PLANE = 0.5f;
+	float const FAR_PLANE = 200.0f;
+
+	float Random(float min_v, float max_v)
+	{
+		return min_v + (max_v - min_v) * (std::rand() % 10000) / 10000.0f;
+	}
+
+	std::vector<LightClusterGrid::LightVolume> RandomLights(uint32_t num, bool spot)
+	{
+		std::vector<LightClusterGrid::LightVolume> lights(num);
+		for (auto& light : lights)
+		{
+			light.position = float3(Random(-100, 100), Random(-20, 20), Random(-20, 220));
+			light.range = Random(0.5f, 8);
+			if (spot)
+			{
+				light.direction = MathLib::normalize(float3(Random(-1, 1), Random(-1, 1), Random(-1, 1)) + float3(0, 0, 0.01f));
+				light.cos_half_angle = std::cos(Random(0.1f, 1.2f));
+			}
+			else
+			{
+				light.direction = float3(0, 0, 1);
+				light.cos_half_angle = -1;
+			}
+		}
+		return lights;
+	}
+
+	bool ClusterHasLight(LightClusterGrid const & grid, uint32_t cluster, uint32_t light)
+	{
+		uint2 const range = grid.ClusterRanges()[cluster];
+		auto const begin = grid.LightIndices().begin() + range.x();
+		return std::find(begin, begin + range.y(), light) != begin + range.y();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(LightClusterGridBounded)
+{
+	float4x4 const view = MathLib::look_at_lh(float3(0, 0, 0), float3(0, 0, 1));
+	float4x4 const proj = MathLib::perspective_fov_lh(PI / 3, 16.0f / 9, NEAR_PLANE, FAR_PLANE);
+
+	std::srand(1);
+	std::vector<LightClusterGrid::LightVolume> const lights = RandomLights(512, false);
+
+	LightClusterGrid grid(16, 9, 24);
+	grid.Build(view, proj, NEAR_PLANE, FAR_PLANE, lights);
+
+	for (uint32_t z = 0; z < grid.Slices(); ++ z)
+	{
+		float const z0 = NEAR_PLANE * std::pow(FAR_PLANE / NEAR_PLANE, static_cast<float>(z) / grid.Slices());
+		float const z1 = NEAR_PLANE * std::pow(FAR_PLANE / NEAR_PLANE, static_cast<float>(z + 1) / grid.Slices());
+		for (uint32_t y = 0; y < grid.TilesY(); ++ y)
+		{
+			float const top = (1 - 2.0f * y / grid.TilesY()) / proj(1, 1);
+			float const bottom = (1 - 2.0f * (y + 1) / grid.TilesY()) / proj(1, 1);
+			for (uint32_t x = 0; x < grid.TilesX(); ++ x)
+			{
+				float const left = (-1 + 2.0f * x / grid.TilesX()) / proj(0, 0);
+				float const right = (-1 + 2.0f * (x + 1) / grid.TilesX()) / proj(0, 0);
+				float3 const bb_min(std::min(left * z0, left * z1), std::min(bottom * z0, bottom * z1), z0);
+				float3 const bb_max(std::max(right * z0, right * z1), std::max(top * z0, top * z1), z1);
+
+				// The clusters are tighter than their bounding boxes, but never hold a light outside of them
+				uint2 const range = grid.ClusterRanges()[grid.ClusterIndex(x, y, z)];
+				for (uint32_t j = range.x(); j < range.x() + range.y(); ++ j)
+				{
+					auto const & light = lights[grid.LightIndices()[j]];
+					float3 const closest = MathLib::maximize(MathLib::minimize(light.position, bb_max), bb_min);
+					BOOST_CHECK(MathLib::length_sq(closest - light.position) <= light.range * light.range * 1.0001f);
+				}
+			}
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(LightClusterGridCoverage)
+{
+	float4x4 const view = MathLib::look_at_lh(float3(0, 0, 0), float3(0, 0, 1));
+	float4x4 const proj = MathLib::perspective_fov_lh(PI / 3, 16.0f / 9, NEAR_PLANE, FAR_PLANE);
+
+	std::srand(2);
+	std::vector<LightClusterGrid::LightVolume> lights = RandomLights(512, false);
+	std::vector<LightClusterGrid::LightVolume> const spots = RandomLights(512, true);
+	lights.insert(lights.end(), spots.begin(), spots.end());
+
+	LightClusterGrid grid(16, 9, 24);
+	grid.Build(view, proj, NEAR_PLANE, FAR_PLANE, lights);
+
+	// Every lit point in the view must find the light in its cluster
+	for (uint32_t i = 0; i < lights.size(); ++ i)
+	{
+		auto const & light = lights[i];
+		for (int j = 0; j < 64; ++ j)
+		{
+			float3 const p = light.position + float3(Random(-1, 1), Random(-1, 1), Random(-1, 1)) * light.range;
+			float3 const v = p - light.position;
+			float const dist = MathLib::length(v);
+			if ((dist > light.range) || (MathLib::dot(v, light.direction) < dist * light.cos_half_angle))
+			{
+				continue;
+			}
+
+			float3 const pos_es = MathLib::transform_coord(p, view);
+			float3 const pos_ss = MathLib::transform_coord(pos_es, proj);
+			if ((pos_es.z() < NEAR_PLANE) || (pos_es.z() > FAR_PLANE) || (MathLib::abs(pos_ss.x()) >= 1)
+				|| (MathLib::abs(pos_ss.y()) >= 1))
+			{
+				continue;
+			}
+
+			uint32_t const x = static_cast<uint32_t>((pos_ss.x() * 0.5f + 0.5f) * grid.TilesX());
+			uint32_t const y = static_cast<uint32_t>((0.5f - pos_ss.y() * 0.5f) * grid.TilesY());
+			BOOST_CHECK(ClusterHasLight(grid, grid.ClusterIndex(x, y, grid.Slice(pos_es.z())), i));
+		}
+	}
+
+	// Cones facing away from a cluster must not be in it
+	std::vector<LightClusterGrid::LightVolume> back(1);
+	back[0].position = float3(0, 0, 50);
+	back[0].range = 10;
+	back[0].direction = float3(0, 0, 1);
+	back[0].cos_half_angle = std::cos(0.3f);
+	grid.Build(view, proj, NEAR_PLANE, FAR_PLANE, back);
+	BOOST_CHECK(grid.LightVisible(0));
+	BOOST_CHECK_EQUAL(grid.ClusterRanges()[grid.ClusterIndex(8, 4, grid.Slice(30))].y(), 0U);
+	BOOST_CHECK_EQUAL(grid.ClusterRanges()[grid.ClusterIndex(8, 4, grid.Slice(55))].y(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(LightClusterGridThreads)
+{
+	float4x4 const view = MathLib::look_at_lh(float3(0, 0, 0), float3(0.2f, 0.1f, 1));
+	float4x4 const proj = MathLib::perspective_fov_lh(PI / 3, 16.0f / 9, NEAR_PLANE, FAR_PLANE);
+
+	std::srand(3);
+	std::vector<LightClusterGrid::LightVolume> lights = RandomLights(2048, false);
+	std::vector<LightClusterGrid::LightVolume> const spots = RandomLights(2048, true);
+	lights.insert(lights.end(), spots.begin(), spots.end());
+
+	LightClusterGrid single(32, 18, 32);
+	LightClusterGrid multi(32, 18, 32);
+	thread_pool tp(1, 4);
+
+	Timer timer;
+	single.Build(view, proj, NEAR_PLANE, FAR_PLANE, lights);
+	double const single_time = timer.elapsed();
+	timer.restart();
+	multi.Build(view, proj, NEAR_PLANE, FAR_PLANE, lights, &tp);
+	double const multi_time = timer.elapsed();
+	BOOST_TEST_MESSAGE("Clustering " << lights.size() << " lights: " << single_time * 1000 << " ms on 1 thread, "
+		<< multi_time * 1000 << " ms on the pool");
+
+	BOOST_CHECK(single.ClusterRanges() == multi.ClusterRanges());
+	BOOST_CHECK(single.LightIndices() == multi.LightIndices());
+	for (uint32_t i = 0; i < lights.size(); ++ i)
+	{
+		BOOST_CHECK(single.LightVisible(i) == multi.LightVisible(i));
+	}
+}
@@ -0,0 +1,65 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/ResLoader.hpp>
+#include <KlayGE/PipelineCache.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+// A program saved to the file is found by the next session on the same device, and by no other
+BOOST_AUTO_TEST_CASE(PipelineCacheRoundTrip)
+{
+	std::string const api_name = "PipelineCacheTest";
+	uint64_t const key = 0x0123456789ABCDEFULL;
+	uint64_t const source_hash = 0xFEDCBA9876543210ULL;
+	uint32_t const format = 0x8E21;
+	std::vector<uint8_t> binary(1000);
+	for (size_t i = 0; i < binary.size(); ++ i)
+	{
+		binary[i] = static_cast<uint8_t>(i * 7);
+	}
+
+	std::remove((ResLoader::Instance().LocalFolder() + api_name + "_pipelines.cache").c_str());
+
+	{
+		PipelineCache cache;
+		cache.Open(api_name, "Device 1");
+		cache.StoreProgram(key, source_hash, format, binary);
+		cache.Close();
+	}
+
+	{
+		PipelineCache cache;
+		cache.Open(api_name, "Device 1");
+
+		uint32_t loaded_format = 0;
+		std::vector<uint8_t> loaded_binary;
+		BOOST_CHECK(cache.FindProgram(key, source_hash, loaded_format, loaded_binary));
+		BOOST_CHECK_EQUAL(format, loaded_format);
+		BOOST_CHECK(binary == loaded_binary);
+
+		BOOST_CHECK(!cache.FindProgram(key, source_hash + 1, loaded_format, loaded_binary));
+		BOOST_CHECK(!cache.FindProgram(key + 1, source_hash, loaded_format, loaded_binary));
+	}
+
+	{
+		PipelineCache cache;
+		cache.Open(api_name, "Device 2");
+
+		uint32_t loaded_format = 0;
+		std::vector<uint8_t> loaded_binary;
+		BOOST_CHECK(!cache.FindProgram(key, source_hash, loaded_format, loaded_binary));
+	}
+}
@@ -0,0 +1,65 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/RenderEffect.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+using namespace std;
+using namespace KlayGE;
+
+// Clones share the cbuffer until one of them writes a new value, and only the writer gets a copy
+BOOST_AUTO_TEST_CASE(RenderEffectCloneSharesCBuffer)
+{
+	RenderEffectPtr effect = SyncLoadRenderEffect("Font.fxml");
+	RenderEffectPtr clone0 = effect->Clone();
+	RenderEffectPtr clone1 = effect->Clone();
+
+	RenderEffectParameter const & param = *effect->ParameterByName("half_width_height");
+	RenderEffectParameter const & param0 = *clone0->ParameterByName("half_width_height");
+	RenderEffectParameter const & param1 = *clone1->ParameterByName("half_width_height");
+	BOOST_CHECK(param.InCBuffer());
+	BOOST_CHECK(param0.MemoryInCBuff<float2>() == param.MemoryInCBuff<float2>());
+	BOOST_CHECK(param1.MemoryInCBuff<float2>() == param.MemoryInCBuff<float2>());
+
+	float2 const org_value = *param.MemoryInCBuff<float2>();
+	float2 value;
+	param0.Value(value);
+	BOOST_CHECK(value == org_value);
+	BOOST_CHECK(param0.MemoryInCBuff<float2>() == param.MemoryInCBuff<float2>());
+
+	// Writing the same value doesn't copy
+	*clone0->ParameterByName("half_width_height") = org_value;
+	BOOST_CHECK(param0.MemoryInCBuff<float2>() == param.MemoryInCBuff<float2>());
+
+	float2 const new_value = org_value + float2(1, 2);
+	*clone0->ParameterByName("half_width_height") = new_value;
+	BOOST_CHECK(param0.MemoryInCBuff<float2>() != param.MemoryInCBuff<float2>());
+	BOOST_CHECK(param1.MemoryInCBuff<float2>() == param.MemoryInCBuff<float2>());
+
+	param0.Value(value);
+	BOOST_CHECK(value == new_value);
+	param.Value(value);
+	BOOST_CHECK(value == org_value);
+	param1.Value(value);
+	BOOST_CHECK(value == org_value);
+
+	// The hardware buffer, made when the shaders are, is split on the next update
+	RenderEffectConstantBuffer& cbuff = param.CBuffer();
+	RenderEffectConstantBuffer& cbuff0 = param0.CBuffer();
+	RenderEffectConstantBuffer& cbuff1 = param1.CBuffer();
+	BOOST_CHECK(cbuff0.HWBuff() == cbuff.HWBuff());
+	if (cbuff.HWBuff())
+	{
+		cbuff0.Update();
+		BOOST_CHECK(cbuff0.HWBuff() != cbuff.HWBuff());
+		BOOST_CHECK(cbuff1.HWBuff() == cbuff.HWBuff());
+	}
+}
@@ -0,0 +1,151 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KlayGE/Light.hpp>
+#include <KlayGE/SceneObject.hpp>
+#include <KlayGE/SceneDesc.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <sstream>
+#include <string>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	char const * const test_scene =
+		"<?xml version='1.0'?>\n"
+		"<scene name='test' skybox='sky'>\n"
+		"	<streaming cell_size='50' budget_mb='256'/>\n"
+		"	<light type='spot'>\n"
+		"		<attr value='no_shadow'/>\n"
+		"		<color v='1 2 3'/>\n"
+		"		<pos v='4 5 6'/>\n"
+		"		<angle inner='0.1' outer='0.2'/>\n"
+		"		<projective name='lamp.dds'/>\n"
+		"		<scale v='0.5 0.5 0.5'/>\n"
+		"	</light>\n"
+		"	<light type='ambient'/>\n"
+		"	<model meshml='box.meshml'>\n"
+		"		<translate v='1 0 0'/>\n"
+		"	</model>\n"
+		"	<model meshml='box.meshml'>\n"
+		"		<translate v='2 0 0'/>\n"
+		"		<attr value='moveable'/>\n"
+		"		<update><![CDATA[print(1)]]></update>\n"
+		"	</model>\n"
+		"	<model meshml='ball.meshml'/>\n"
+		"	<camera>\n"
+		"		<eye_pos v='0 1 2'/>\n"
+		"		<fov s='1.5'/>\n"
+		"	</camera>\n"
+		"</scene>\n";
+
+	ResIdentifierPtr MakeRes(std::string const & content)
+	{
+		return MakeSharedPtr<ResIdentifier>("test.kges", 0, MakeSharedPtr<std::stringstream>(content));
+	}
+
+	void CheckTestScene(SceneDesc const & desc)
+	{
+		BOOST_CHECK(desc.skybox == "sky");
+		BOOST_CHECK(desc.streaming.enabled == 1);
+		BOOST_CHECK(desc.streaming.cell_size == 50);
+		BOOST_CHECK(desc.streaming.budget_mb == 256);
+
+		BOOST_REQUIRE(desc.resources.size() == 3);
+		BOOST_REQUIRE(desc.lights.size() == 2);
+		BOOST_REQUIRE(desc.models.size() == 3);
+		BOOST_REQUIRE(desc.cameras.size() == 1);
+		BOOST_REQUIRE(desc.scripts.size() == 1);
+
+		SceneDesc::Light const & spot = desc.lights[0];
+		BOOST_CHECK(spot.type == LightSource::LT_Spot);
+		BOOST_CHECK(spot.attrib == LightSource::LSA_NoShadow);
+		BOOST_CHECK(spot.color == float3(1, 2, 3));
+		BOOST_CHECK(spot.pos == float3(4, 5, 6));
+		BOOST_CHECK(spot.inner_angle == 0.1f);
+		BOOST_CHECK(spot.outer_angle == 0.2f);
+		BOOST_CHECK(spot.proxy_scale == float3(0.5f, 0.5f, 0.5f));
+		BOOST_REQUIRE(spot.projective_tex < desc.resources.size());
+		BOOST_CHECK(desc.resources[spot.projective_tex].type == SceneDesc::RT_Texture);
+		BOOST_CHECK(desc.resources[spot.projective_tex].name == "lamp.dds");
+		BOOST_CHECK(spot.update_script == SceneDesc::NO_INDEX);
+
+		BOOST_CHECK(desc.lights[1].type == LightSource::LT_Ambient);
+		BOOST_CHECK(desc.lights[1].proxy_scale == float3(0, 0, 0));
+		BOOST_CHECK(desc.lights[1].projective_tex == SceneDesc::NO_INDEX);
+
+		// The two boxes share one resource
+		BOOST_CHECK(desc.models[0].resource == desc.models[1].resource);
+		BOOST_CHECK(desc.models[0].resource != desc.models[2].resource);
+		BOOST_CHECK(desc.resources[desc.models[0].resource].name == "box.meshml");
+		BOOST_CHECK(desc.models[0].transform == MathLib::translation(1.0f, 0.0f, 0.0f));
+		BOOST_CHECK(desc.models[0].attrib == SceneObject::SOA_Cullable);
+		BOOST_CHECK(desc.models[1].attrib == (SceneObject::SOA_Cullable | SceneObject::SOA_Moveable));
+		BOOST_REQUIRE(desc.models[1].update_script == 0);
+		BOOST_CHECK(desc.scripts[0] == "print(1)");
+
+		BOOST_CHECK(desc.cameras[0].eye_pos == float3(0, 1, 2));
+		BOOST_CHECK(desc.cameras[0].fov == 1.5f);
+		BOOST_CHECK(desc.cameras[0].aspect == 0);
+		BOOST_CHECK(desc.cameras[0].far_plane == 1000);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(SceneDescXML)
+{
+	SceneDesc desc;
+	LoadSceneXML(MakeRes(test_scene), desc);
+	CheckTestScene(desc);
+}
+
+BOOST_AUTO_TEST_CASE(SceneDescBinRoundTrip)
+{
+	SceneDesc xml_desc;
+	LoadSceneXML(MakeRes(test_scene), xml_desc);
+
+	std::ostringstream oss;
+	SaveSceneBin(xml_desc, oss);
+
+	SceneDesc bin_desc;
+	BOOST_REQUIRE(LoadSceneBin(MakeRes(oss.str()), bin_desc));
+	CheckTestScene(bin_desc);
+}
+
+BOOST_AUTO_TEST_CASE(SceneDescBinCorrupt)
+{
+	SceneDesc xml_desc;
+	LoadSceneXML(MakeRes(test_scene), xml_desc);
+
+	std::ostringstream oss;
+	SaveSceneBin(xml_desc, oss);
+	std::string const bin = oss.str();
+
+	SceneDesc bin_desc;
+	BOOST_CHECK(!LoadSceneBin(MakeRes(std::string()), bin_desc));
+	for (size_t size = 1; size < bin.size(); size += 7)
+	{
+		BOOST_CHECK(!LoadSceneBin(MakeRes(bin.substr(0, size)), bin_desc));
+		BOOST_CHECK(bin_desc.models.empty());
+	}
+
+	std::string bad_fourcc = bin;
+	bad_fourcc[0] = 'X';
+	BOOST_CHECK(!LoadSceneBin(MakeRes(bad_fourcc), bin_desc));
+
+	// A huge count is rejected before anything is allocated for it
+	std::string bad_count = bin;
+	bad_count[2 * sizeof(uint32_t) + 3] = '\x7F';
+	BOOST_CHECK(!LoadSceneBin(MakeRes(bad_count), bin_desc));
+}
@@ -0,0 +1,62 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KlayGE/SceneObjectHelper.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+using namespace std;
+using namespace KlayGE;
+
+// The visible marks cached for an unchanged camera are only tested again for objects with a new transform version
+BOOST_AUTO_TEST_CASE(SceneObjectHideWithStaticCamera)
+{
+	SceneObjectHelper so(SceneObject::SOA_Cullable);
+	so.UpdateAbsModelMatrix();
+	uint32_t const shown_version = so.TransformVersion();
+
+	so.Visible(false);
+	BOOST_CHECK(!so.Visible());
+	uint32_t const hidden_version = so.TransformVersion();
+	BOOST_CHECK(hidden_version != shown_version);
+
+	so.Visible(false);
+	BOOST_CHECK(so.TransformVersion() == hidden_version);
+
+	so.Visible(true);
+	BOOST_CHECK(so.Visible());
+	BOOST_CHECK(so.TransformVersion() != hidden_version);
+}
+
+// When both the main thread and SubThreadUpdate set the model matrix between two syncs, the later write is kept
+BOOST_AUTO_TEST_CASE(SceneObjectSyncKeepsLaterModelWrite)
+{
+	SceneObjectHelper so(SceneObject::SOA_Moveable);
+
+	float4x4 const main_mat = MathLib::translation(1.0f, 0.0f, 0.0f);
+	float4x4 const sub_mat = MathLib::translation(0.0f, 2.0f, 0.0f);
+
+	so.ModelMatrix(main_mat);
+	SceneObject::SubThreadUpdating(true);
+	so.ModelMatrix(sub_mat);
+	SceneObject::SubThreadUpdating(false);
+	BOOST_CHECK(so.ModelMatrix() == main_mat);
+	so.SyncSubThreadState();
+	BOOST_CHECK(so.ModelMatrix() == sub_mat);
+
+	SceneObject::SubThreadUpdating(true);
+	so.ModelMatrix(sub_mat * sub_mat);
+	SceneObject::SubThreadUpdating(false);
+	so.ModelMatrix(main_mat);
+	so.SyncSubThreadState();
+	BOOST_CHECK(so.ModelMatrix() == main_mat);
+	SceneObject::SubThreadUpdating(true);
+	BOOST_CHECK(so.ModelMatrix() == main_mat);
+	SceneObject::SubThreadUpdating(false);
+}
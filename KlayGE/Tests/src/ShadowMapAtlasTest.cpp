@@ -0,0 +1,157 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/ShadowMapAtlas.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	bool Overlap(uint4 const & lhs, uint4 const & rhs)
+	{
+		return (lhs.x() < rhs.x() + rhs.z()) && (rhs.x() < lhs.x() + lhs.z())
+			&& (lhs.y() < rhs.y() + rhs.w()) && (rhs.y() < lhs.y() + lhs.w());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ShadowMapAtlasAllocate)
+{
+	ShadowMapAtlas atlas(1024, 64);
+	atlas.BeginFrame();
+
+	int keys[13];
+	std::vector<uint4> rects;
+	uint32_t const sizes[] = { 512, 512, 512, 256, 256, 256, 128, 128, 128, 64, 64, 64, 64 };
+	for (int i = 0; i < 13; ++ i)
+	{
+		uint4 rect;
+		bool cached;
+		BOOST_CHECK(atlas.Request(&keys[i], sizes[i], 1, rect, cached));
+		BOOST_CHECK(!cached);
+		BOOST_CHECK_EQUAL(rect.z(), sizes[i]);
+		BOOST_CHECK((rect.x() % rect.z() == 0) && (rect.y() % rect.w() == 0));
+		BOOST_CHECK((rect.x() + rect.z() <= 1024) && (rect.y() + rect.w() <= 1024));
+		for (auto const & other : rects)
+		{
+			BOOST_CHECK(!Overlap(rect, other));
+		}
+		rects.push_back(rect);
+	}
+	BOOST_CHECK_EQUAL(atlas.NumTiles(), 13U);
+
+	// Full now, and nothing could be evicted in the same frame
+	int extra;
+	uint4 rect;
+	bool cached;
+	BOOST_CHECK(!atlas.Request(&extra, 64, 1, rect, cached));
+
+	// Freed siblings merge back to a big tile
+	for (int i = 3; i < 13; ++ i)
+	{
+		atlas.Release(&keys[i]);
+	}
+	BOOST_CHECK(atlas.Request(&extra, 512, 1, rect, cached));
+	BOOST_CHECK_EQUAL(rect.z(), 512U);
+	BOOST_CHECK(!Overlap(rect, rects[0]) && !Overlap(rect, rects[1]) && !Overlap(rect, rects[2]));
+}
+
+BOOST_AUTO_TEST_CASE(ShadowMapAtlasCache)
+{
+	ShadowMapAtlas atlas(1024, 64);
+	int light;
+
+	atlas.BeginFrame();
+	uint4 rect;
+	bool cached;
+	BOOST_CHECK(atlas.Request(&light, 256, 42, rect, cached));
+	BOOST_CHECK(!cached);
+
+	atlas.BeginFrame();
+	uint4 same_rect;
+	BOOST_CHECK(atlas.Request(&light, 256, 42, same_rect, cached));
+	BOOST_CHECK(cached);
+	BOOST_CHECK(same_rect == rect);
+
+	// Slightly different sizes keep the tile
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 512, 42, same_rect, cached));
+	BOOST_CHECK(cached);
+	BOOST_CHECK(same_rect == rect);
+
+	// The seed changed, so did the casters or the light
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 256, 43, same_rect, cached));
+	BOOST_CHECK(!cached);
+
+	// Seed 0 never caches
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 256, 0, same_rect, cached));
+	BOOST_CHECK(!cached);
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 256, 0, same_rect, cached));
+	BOOST_CHECK(!cached);
+
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 256, 43, same_rect, cached));
+	atlas.Invalidate(&light);
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 256, 43, same_rect, cached));
+	BOOST_CHECK(!cached);
+
+	// A much bigger request moves it
+	atlas.BeginFrame();
+	BOOST_CHECK(atlas.Request(&light, 1024, 43, rect, cached));
+	BOOST_CHECK(!cached);
+	BOOST_CHECK_EQUAL(rect.z(), 1024U);
+
+	float4 const scale_bias = atlas.ScaleBias(uint4(256, 512, 128, 128));
+	BOOST_CHECK(scale_bias == float4(0.125f, 0.125f, 0.25f, 0.5f));
+}
+
+BOOST_AUTO_TEST_CASE(ShadowMapAtlasEviction)
+{
+	ShadowMapAtlas atlas(1024, 64);
+	int lights[5];
+	uint4 rect;
+	bool cached;
+
+	atlas.BeginFrame();
+	for (int i = 0; i < 4; ++ i)
+	{
+		BOOST_CHECK(atlas.Request(&lights[i], 512, 1, rect, cached));
+	}
+
+	// Only lights 1 to 3 stay in view, so light 0 gives up its tile
+	atlas.BeginFrame();
+	for (int i = 1; i < 4; ++ i)
+	{
+		BOOST_CHECK(atlas.Request(&lights[i], 512, 1, rect, cached));
+		BOOST_CHECK(cached);
+	}
+	BOOST_CHECK(atlas.Request(&lights[4], 512, 1, rect, cached));
+	BOOST_CHECK(!cached);
+	BOOST_CHECK_EQUAL(atlas.NumTiles(), 4U);
+
+	// A full atlas gives smaller tiles
+	atlas.BeginFrame();
+	for (int i = 1; i < 5; ++ i)
+	{
+		BOOST_CHECK(atlas.Request(&lights[i], 512, 1, rect, cached));
+	}
+	BOOST_CHECK(!atlas.Request(&lights[0], 512, 1, rect, cached));
+	atlas.Release(&lights[4]);
+	BOOST_CHECK(atlas.Request(&lights[0], 1024, 1, rect, cached));
+	BOOST_CHECK_EQUAL(rect.z(), 512U);
+}
@@ -0,0 +1,149 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+BOOST_AUTO_TEST_CASE(TransientBufferRingThreads)
+{
+	uint32_t const STRIDE = 24;
+	uint32_t const NUM_THREADS = 4;
+	uint32_t const NUM_ALLOCS = 100;
+
+	TransientBuffer tb(NUM_THREADS * NUM_ALLOCS * 3 * STRIDE * 2, TransientBuffer::BF_Vertex, TransientBuffer::AM_Ring, STRIDE);
+
+	thread_pool tp(1, NUM_THREADS);
+	std::vector<std::vector<SubAlloc>> allocs(NUM_THREADS);
+	std::vector<joiner<void>> joiners;
+	for (uint32_t t = 0; t < NUM_THREADS; ++ t)
+	{
+		joiners.push_back(tp([&tb, &allocs, t]()
+			{
+				std::vector<uint8_t> data(3 * STRIDE, static_cast<uint8_t>(t));
+				for (uint32_t i = 0; i < NUM_ALLOCS; ++ i)
+				{
+					uint32_t const size = (i % 3 + 1) * STRIDE;
+					allocs[t].push_back(tb.Alloc(size, &data[0]));
+				}
+			}));
+	}
+	for (auto& j : joiners)
+	{
+		j();
+	}
+	tb.EnsureDataReady();
+
+	std::vector<SubAlloc> all;
+	for (auto const & thread_allocs : allocs)
+	{
+		all.insert(all.end(), thread_allocs.begin(), thread_allocs.end());
+	}
+	for (auto const & alloc : all)
+	{
+		BOOST_CHECK(alloc.length_ > 0);
+		BOOST_CHECK(0 == alloc.offset_ % STRIDE);
+		BOOST_CHECK(alloc.offset_ + alloc.length_ <= tb.GetBuffer()->Size());
+	}
+
+	std::sort(all.begin(), all.end(),
+		[](SubAlloc const & lhs, SubAlloc const & rhs)
+		{
+			return lhs.offset_ < rhs.offset_;
+		});
+	for (size_t i = 1; i < all.size(); ++ i)
+	{
+		BOOST_CHECK(all[i - 1].offset_ + all[i - 1].length_ <= all[i].offset_);
+	}
+}
+
+// A full ring takes the allocs into its reserve, and grows in EnsureDataReady keeping the offsets handed out before
+BOOST_AUTO_TEST_CASE(TransientBufferRingGrow)
+{
+	TransientBuffer tb(1024, TransientBuffer::BF_Index, TransientBuffer::AM_Ring, 2);
+	BOOST_CHECK(1024 + 512 == tb.GetBuffer()->Size());
+
+	std::vector<uint16_t> indices(512);
+	uint32_t const size = 64 * sizeof(indices[0]);
+	std::vector<SubAlloc> allocs;
+	for (uint32_t i = 0; i < 1024 / size + 1; ++ i)
+	{
+		allocs.push_back(tb.Alloc(size, &indices[0]));
+	}
+	BOOST_CHECK(allocs.back().offset_ >= 1024);
+
+	// Over the reserve as well
+	BOOST_CHECK(0 == tb.Alloc(1024, &indices[0]).length_);
+
+	// Twice the ring and the reserve asked for in the frame, and half of that as the new reserve
+	tb.EnsureDataReady();
+	BOOST_CHECK((1024 + size + 1024) * 3 == tb.GetBuffer()->Size());
+	BOOST_CHECK(1024 == tb.Alloc(1024, &indices[0]).length_);
+
+	std::sort(allocs.begin(), allocs.end(),
+		[](SubAlloc const & lhs, SubAlloc const & rhs)
+		{
+			return lhs.offset_ < rhs.offset_;
+		});
+	for (size_t i = 0; i < allocs.size(); ++ i)
+	{
+		BOOST_CHECK(size == allocs[i].length_);
+		BOOST_CHECK(allocs[i].offset_ + allocs[i].length_ <= tb.GetBuffer()->Size());
+		if (i > 0)
+		{
+			BOOST_CHECK(allocs[i - 1].offset_ + allocs[i - 1].length_ <= allocs[i].offset_);
+		}
+	}
+}
+
+// The space of a frame is reused only after the frame retires
+BOOST_AUTO_TEST_CASE(TransientBufferRingFrameFences)
+{
+	uint32_t const FIRST_FRAME = 100;
+
+	TransientBuffer tb(1024, TransientBuffer::BF_Index, TransientBuffer::AM_Ring, 2);
+
+	std::vector<uint16_t> indices(64);
+	uint32_t const size = static_cast<uint32_t>(indices.size() * sizeof(indices[0]));
+	for (uint32_t i = 0; i < 1024 / size; ++ i)
+	{
+		tb.Alloc(size, &indices[0]);
+	}
+	tb.EnsureDataReady();
+	tb.OnPresent(FIRST_FRAME);
+	BOOST_CHECK(1024 + 512 == tb.GetBuffer()->Size());
+
+	// At most 3 frames in flight
+	for (uint32_t frame = FIRST_FRAME + 1; frame <= FIRST_FRAME + 3; ++ frame)
+	{
+		tb.EnsureDataReady();
+		tb.OnPresent(frame);
+	}
+
+	std::vector<bool> used(1024 / size, false);
+	for (uint32_t i = 0; i < 1024 / size; ++ i)
+	{
+		SubAlloc const alloc = tb.Alloc(size, &indices[0]);
+		BOOST_CHECK(size == alloc.length_);
+		BOOST_CHECK(0 == alloc.offset_ % size);
+		BOOST_CHECK(alloc.offset_ + alloc.length_ <= 1024);
+		BOOST_CHECK(!used[alloc.offset_ / size]);
+		used[alloc.offset_ / size] = true;
+	}
+	tb.EnsureDataReady();
+	BOOST_CHECK(1024 + 512 == tb.GetBuffer()->Size());
+}
@@ -0,0 +1,148 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/TriangleBVH.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// A bumpy height field of size x size quads on the xz plane
+	void BuildGrid(uint32_t size, std::vector<float3>& positions, std::vector<uint32_t>& indices)
+	{
+		for (uint32_t z = 0; z <= size; ++ z)
+		{
+			for (uint32_t x = 0; x <= size; ++ x)
+			{
+				positions.push_back(float3(static_cast<float>(x), ((x + z) & 1) * 0.25f, static_cast<float>(z)));
+			}
+		}
+		for (uint32_t z = 0; z < size; ++ z)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				uint32_t const i0 = z * (size + 1) + x;
+				uint32_t const i1 = i0 + 1;
+				uint32_t const i2 = i0 + size + 1;
+				uint32_t const i3 = i2 + 1;
+				indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+	}
+
+	bool BruteForceRayCast(std::vector<float3> const & positions, std::vector<uint32_t> const & indices,
+		float3 const & origin, float3 const & dir, float max_dist, float& dist)
+	{
+		bool hit = false;
+		dist = max_dist;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			float3 const & v0 = positions[indices[i + 0]];
+			float3 const e1 = positions[indices[i + 1]] - v0;
+			float3 const e2 = positions[indices[i + 2]] - v0;
+			float3 const p = MathLib::cross(dir, e2);
+			float const det = MathLib::dot(e1, p);
+			if (MathLib::abs(det) < 1e-12f)
+			{
+				continue;
+			}
+			float const inv_det = 1 / det;
+			float3 const t = origin - v0;
+			float const u = MathLib::dot(t, p) * inv_det;
+			float3 const q = MathLib::cross(t, e1);
+			float const v = MathLib::dot(dir, q) * inv_det;
+			float const d = MathLib::dot(e2, q) * inv_det;
+			if ((u >= 0) && (v >= 0) && (u + v <= 1) && (d >= 0) && (d < dist))
+			{
+				dist = d;
+				hit = true;
+			}
+		}
+		return hit;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TriangleBVHMatchesBruteForce)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	BuildGrid(16, positions, indices);
+
+	TriangleBVH bvh(positions, indices);
+	BOOST_CHECK(bvh.NumTriangles() == 16 * 16 * 2);
+	BOOST_CHECK(bvh.Bound().Min() == float3(0, 0, 0));
+	BOOST_CHECK(bvh.Bound().Max() == float3(16, 0.25f, 16));
+
+	std::srand(1);
+	for (int i = 0; i < 200; ++ i)
+	{
+		float3 const origin(std::rand() % 1700 / 100.0f - 0.5f, 5, std::rand() % 1700 / 100.0f - 0.5f);
+		float3 const dir = MathLib::normalize(float3(std::rand() % 100 / 100.0f - 0.5f, -1,
+			std::rand() % 100 / 100.0f - 0.5f));
+
+		float expected_dist;
+		bool const expected_hit = BruteForceRayCast(positions, indices, origin, dir, 100, expected_dist);
+
+		float dist;
+		uint32_t tri;
+		bool const hit = bvh.RayCast(origin, dir, 100, dist, tri);
+		BOOST_CHECK(hit == expected_hit);
+		if (hit && expected_hit)
+		{
+			BOOST_CHECK_CLOSE(dist, expected_dist, 0.01f);
+			BOOST_CHECK(tri < bvh.NumTriangles());
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TriangleBVHMaxDistance)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	BuildGrid(4, positions, indices);
+
+	TriangleBVH bvh(positions, indices);
+
+	float dist;
+	uint32_t tri;
+	BOOST_CHECK(!bvh.RayCast(float3(1.5f, 5, 1.5f), float3(0, -1, 0), 4, dist, tri));
+	BOOST_CHECK(bvh.RayCast(float3(1.5f, 5, 1.5f), float3(0, -1, 0), 6, dist, tri));
+	BOOST_CHECK(!bvh.RayCast(float3(1.5f, 5, 1.5f), float3(0, 1, 0), 100, dist, tri));
+}
+
+BOOST_AUTO_TEST_CASE(TriangleBVHRefit)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	BuildGrid(8, positions, indices);
+
+	TriangleBVH bvh(positions, indices);
+
+	for (auto& pos : positions)
+	{
+		pos.y() += 10;
+	}
+	bvh.Refit(positions);
+	BOOST_CHECK(bvh.Bound().Min().y() == 10);
+
+	float dist;
+	uint32_t tri;
+	BOOST_CHECK(bvh.RayCast(float3(3.5f, 20, 3.5f), float3(0, -1, 0), 100, dist, tri));
+	float expected_dist;
+	BruteForceRayCast(positions, indices, float3(3.5f, 20, 3.5f), float3(0, -1, 0), 100, expected_dist);
+	BOOST_CHECK_CLOSE(dist, expected_dist, 0.01f);
+	BOOST_CHECK(dist < 10);
+}
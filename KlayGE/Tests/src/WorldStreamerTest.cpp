@@ -0,0 +1,159 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/WorldStreamer.hpp>
+
+#include <boost/assert.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter" // Ignore unused parameter in boost
+#endif
+#include <boost/test/unit_test.hpp>
+#ifdef KLAYGE_COMPILER_CLANG
+#pragma clang diagnostic pop
+#endif
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Resources are "ready" as soon as they're requested, and take 100 bytes each
+	class TestWorldStreamer : public WorldStreamer
+	{
+	public:
+		TestWorldStreamer(float cell_size, float load_radius, float unload_radius, uint64_t memory_budget)
+			: WorldStreamer(cell_size, load_radius, unload_radius, memory_budget)
+		{
+		}
+
+		std::vector<int2> load_order;
+
+	protected:
+		virtual uint64_t EstimateMemorySize(std::string const & res_name) override
+		{
+			KFL_UNUSED(res_name);
+			return 100;
+		}
+
+		virtual void LoadCell(Cell& cell) override
+		{
+			load_order.push_back(cell.coord);
+		}
+		virtual bool CellReady(Cell const & cell) override
+		{
+			KFL_UNUSED(cell);
+			return true;
+		}
+		virtual void ActivateCell(Cell& cell) override
+		{
+			KFL_UNUSED(cell);
+		}
+		virtual void UnloadCell(Cell& cell) override
+		{
+			KFL_UNUSED(cell);
+		}
+	};
+
+	// One object per cell on a row of cells along x
+	void FillRow(TestWorldStreamer& streamer, int num_cells)
+	{
+		for (int i = 0; i < num_cells; ++ i)
+		{
+			streamer.AddObject("model_" + std::to_string(i) + ".meshml",
+				MathLib::translation(i * 10 + 5.0f, 0.0f, 5.0f), 0);
+		}
+	}
+
+	WorldStreamer::CellState StateOf(TestWorldStreamer const & streamer, int32_t x)
+	{
+		for (uint32_t i = 0; i < streamer.NumCells(); ++ i)
+		{
+			if (streamer.GetCell(i).coord.x() == x)
+			{
+				return streamer.GetCell(i).state;
+			}
+		}
+		return WorldStreamer::CS_Unloaded;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(WorldStreamerHysteresis)
+{
+	TestWorldStreamer streamer(10, 15, 25, 10000);
+	FillRow(streamer, 10);
+	BOOST_CHECK(streamer.NumCells() == 10);
+
+	streamer.Update(float3(5, 0, 5), float3(0, 0, 0));
+	streamer.Update(float3(5, 0, 5), float3(0, 0, 0));
+	BOOST_CHECK(streamer.NumCells(WorldStreamer::CS_Loaded) == 3);
+	BOOST_CHECK(StateOf(streamer, 2) == WorldStreamer::CS_Loaded);
+	BOOST_CHECK(streamer.MemoryUsage() == 300);
+
+	// Cell 0 is 20 away, between the load and unload radius, so it stays
+	streamer.Update(float3(30, 0, 5), float3(0, 0, 0));
+	BOOST_CHECK(StateOf(streamer, 0) != WorldStreamer::CS_Unloaded);
+
+	streamer.Update(float3(50, 0, 5), float3(0, 0, 0));
+	BOOST_CHECK(StateOf(streamer, 0) == WorldStreamer::CS_Unloaded);
+	BOOST_CHECK(StateOf(streamer, 1) == WorldStreamer::CS_Unloaded);
+	BOOST_CHECK(StateOf(streamer, 4) != WorldStreamer::CS_Unloaded);
+}
+
+BOOST_AUTO_TEST_CASE(WorldStreamerPriority)
+{
+	TestWorldStreamer streamer(10, 35, 50, 10000);
+	FillRow(streamer, 10);
+	streamer.MaxLoadingCells(1);
+
+	for (int i = 0; i < 8; ++ i)
+	{
+		streamer.Update(float3(45, 0, 5), float3(0, 0, 0));
+	}
+	BOOST_REQUIRE(streamer.load_order.size() == 8);
+	BOOST_CHECK(streamer.load_order[0].x() == 4);
+	for (size_t i = 1; i < streamer.load_order.size(); ++ i)
+	{
+		int32_t const prev_dist = std::abs(streamer.load_order[i - 1].x() - 4);
+		int32_t const dist = std::abs(streamer.load_order[i].x() - 4);
+		BOOST_CHECK(prev_dist <= dist);
+	}
+
+	// Moving to +x, the cells ahead come before the ones behind at the same distance
+	TestWorldStreamer moving(10, 15, 25, 10000);
+	FillRow(moving, 10);
+	moving.MaxLoadingCells(1);
+	for (int i = 0; i < 5; ++ i)
+	{
+		moving.Update(float3(44, 0, 5), float3(5, 0, 0));
+	}
+	BOOST_REQUIRE(moving.load_order.size() == 5);
+	BOOST_CHECK(moving.load_order[0].x() == 4);
+	BOOST_CHECK(moving.load_order[1].x() == 5);
+	BOOST_CHECK(moving.load_order[2].x() == 3);
+	BOOST_CHECK(moving.load_order[3].x() == 6);
+	BOOST_CHECK(moving.load_order[4].x() == 2);
+}
+
+BOOST_AUTO_TEST_CASE(WorldStreamerBudget)
+{
+	TestWorldStreamer streamer(10, 25, 100, 300);
+	FillRow(streamer, 10);
+
+	streamer.Update(float3(5, 0, 5), float3(0, 0, 0));
+	BOOST_CHECK(streamer.MemoryUsage() == 300);
+	BOOST_CHECK(StateOf(streamer, 0) != WorldStreamer::CS_Unloaded);
+	BOOST_CHECK(StateOf(streamer, 2) != WorldStreamer::CS_Unloaded);
+
+	// Still inside the unload radius, but the nearer cells take the memory
+	streamer.Update(float3(55, 0, 5), float3(0, 0, 0));
+	BOOST_CHECK(streamer.MemoryUsage() <= 300);
+	BOOST_CHECK(StateOf(streamer, 5) != WorldStreamer::CS_Unloaded);
+	BOOST_CHECK(StateOf(streamer, 0) == WorldStreamer::CS_Unloaded);
+
+	streamer.UnloadAll();
+	BOOST_CHECK(streamer.MemoryUsage() == 0);
+	BOOST_CHECK(streamer.NumCells(WorldStreamer::CS_Unloaded) == 10);
+}
@@ -66,6 +66,8 @@ void DetailedSkinnedMesh::VisualizeTexture(int slot)
 
 void DetailedSkinnedMesh::UpdateEffectAttrib()
 {
+	mtl_->DirtyCBuffer();
+
 	effect_attrs_ &= ~EA_TransparencyBack;
 	effect_attrs_ &= ~EA_TransparencyFront;
 	effect_attrs_ &= ~EA_AlphaTest;
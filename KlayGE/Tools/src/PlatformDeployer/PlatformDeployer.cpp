@@ -2,6 +2,7 @@
 #include <KFL/Util.hpp>
 #include <KlayGE/JudaTexture.hpp>
 #include <KlayGE/ResLoader.hpp>
+#include <KlayGE/SceneDesc.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
@@ -364,6 +365,27 @@ void Deploy(std::vector<std::string> const & res_names, std::string const & res_
 			ofs << "@echo on" << std::endl << std::endl;
 		}
 	}
+	else if ("scene" == res_type)
+	{
+		// Compiled here directly, the binary scene is the same on all platforms
+		for (size_t i = 0; i < res_names.size(); ++ i)
+		{
+			cout << "Processing: " << res_names[i] << endl;
+
+			ResIdentifierPtr xml_file = ResLoader::Instance().Open(res_names[i]);
+			if (!xml_file)
+			{
+				cout << "Error: Could not open " << res_names[i] << endl;
+				continue;
+			}
+
+			SceneDesc desc;
+			LoadSceneXML(xml_file, desc);
+
+			std::ofstream bin_ofs((res_names[i] + ".scene_bin").c_str(), std::ios_base::binary);
+			SaveSceneBin(desc, bin_ofs);
+		}
+	}
 	else
 	{
 		printf("Error: Unknown resource type.");
@@ -372,7 +394,7 @@ void Deploy(std::vector<std::string> const & res_names, std::string const & res_
 
 	ofs.close();
 
-	if ((res_type != "cubemap") && (res_type != "model") && (res_type != "effect"))
+	if ((res_type != "cubemap") && (res_type != "model") && (res_type != "effect") && (res_type != "scene"))
 	{
 		system("convert.bat");
 		system("del convert.bat");
@@ -465,6 +487,10 @@ int main(int argc, char* argv[])
 		{
 			res_type = "model";
 		}
+		else if (".kges" == ext_name)
+		{
+			res_type = "scene";
+		}
 		else
 		{
 			cout << "Need resource type name." << endl;